@@ -2,9 +2,17 @@
 
 
 // プラットフォームヘッダ
-#include <windows.h>
-#include <d3d11.h>
-#include <d3dcompiler.h>
+#if defined(_WIN32)
+	#include <windows.h>
+	#include <d3d11_1.h>
+	#include <d3dcompiler.h>
+#else
+	#include <pthread.h>
+	#include <unistd.h>
+	#include <stdio.h>
+	#include <stdarg.h>
+	#include <string.h>
+#endif
 #include <stdint.h>
 #include <assert.h>
 #include <array>
@@ -14,6 +22,17 @@
 // マクロ
 #define ArraySize(p)		(sizeof (p) /sizeof p[0])
 
+// MSVC以外のコンパイラ向け
+#if !defined(_MSC_VER)
+	#ifndef __forceinline
+		#define __forceinline	inline __attribute__((always_inline))
+	#endif
+	#ifndef ARRAYSIZE
+		#define ARRAYSIZE(p)	ArraySize(p)
+	#endif
+	inline void OutputDebugStringA(const char* str) { fputs(str, stderr); }
+#endif
+
 #ifdef _DEBUG
 
 	// デバッグ出力用
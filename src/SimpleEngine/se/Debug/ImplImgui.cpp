@@ -1,5 +1,6 @@
 ﻿#include "se/Debug/ImplImgui.h"
 #include "se/HID/HIDCore.h"
+#include "se/Memory/MemoryTracker.h"
 
 namespace se {
 
@@ -18,37 +19,141 @@ namespace se {
 			float mvp[4][4];
 		};
 		TUniformParameter<ImguiConstants> g_constants;
+
+		// ImGuiRender(snapshot)中の記録先、nullptrなら即時描画
+		ImGuiDrawSnapshot* g_captureTarget = nullptr;
+
+		// 頂点とインデックスのバッファを必要な大きさで確保
+		void ReserveBuffers(uint32_t vertexNum, uint32_t indexNum)
+		{
+			// 頂点バッファ
+			if (!vertexBuffer.GetResource() || vertexBuffer.GetVertexNum() < vertexNum) {
+				vertexBuffer.Destroy();
+				uint32_t vertexCount = vertexNum + 5000;
+				vertexBuffer.Create(vertexCount, VERTEX_ATTR_FLAG_POSITION | VERTEX_ATTR_FLAG_TEXCOORD0 | VERTEX_ATTR_FLAG_BYTE_COLOR, BUFFER_USAGE_DYNAMIC);
+				g_vertexLayout = se::VertexLayoutManager::Get().FindLayout(*g_shader->GetVS(), vertexBuffer.GetAttributes());
+			}
+			// インデックスバッファ
+			if (!indexBuffer.GetResource() || indexBuffer.GetIndexNum() < indexNum) {
+				indexBuffer.Destroy();
+				uint32_t indexCount = indexNum + 10000;
+				indexBuffer.Create(indexCount, BUFFER_USAGE_DYNAMIC);
+			}
+		}
+
+		// コンスタントバッファとパイプラインの設定
+		void SetupRenderState(GraphicsContext& context, const ImVec2& displaySize)
+		{
+			// コンスタントバッファ
+			{
+				float L = 0.0f;
+				float R = displaySize.x;
+				float B = displaySize.y;
+				float T = 0.0f;
+				float mvp[4][4] =
+				{
+					{ 2.0f / (R - L),		0.0f,					0.0f,       0.0f },
+					{ 0.0f,					2.0f / (T - B),			0.0f,       0.0f },
+					{ 0.0f,					0.0f,					0.5f,       0.0f },
+					{ (R + L) / (L - R),	(T + B) / (B - T),		0.5f,       1.0f },
+				};
+				memcpy(g_constants.Contents().mvp, mvp, sizeof(mvp));
+				g_constants.Update(context, true);
+			}
+
+			// Setup
+			context.SetViewport(Rect(0, 0, (int32_t)displaySize.x, (int32_t)displaySize.y));
+			context.SetVertexShader(*g_shader->GetVS());
+			context.SetPixelShader(*g_shader->GetPS());
+			context.SetVertexBuffer(0, &vertexBuffer);
+			context.SetInputLayout(*g_vertexLayout);
+			context.SetIndexBuffer(&indexBuffer);
+			context.SetPrimitiveType(PRIMITIVE_TYPE_TRIANGLE_LIST);
+			context.SetVSConstantBuffer(0, g_constants.GetView());
+			context.SetPSSamplerState(0, SamplerState::Get(SamplerState::LinearWrap));
+			context.SetDepthStencilState(DepthStencilState::Get(DepthStencilState::Disable));
+			context.SetRasterizerState(RasterizerState::Get(RasterizerState::NoCull));
+			context.SetBlendState(BlendState::Get(BlendState::Translucent));
+		}
 	}
 
 
 	/**
-	 * 描画ハンドラ
+	 * 描画データのコピー
 	 */
-	void ImGuiRenderDrawLists(ImDrawData* draw_data)
+	void ImGuiDrawSnapshot::Capture(const ImDrawData* drawData, FrameArena& arena)
 	{
-		auto& context = GraphicsCore::GetImmediateContext();
+		Clear();
+		displaySize = ImGui::GetIO().DisplaySize;
 
-		// 頂点バッファ
-		if (!vertexBuffer.GetResource() || vertexBuffer.GetVertexNum() < (uint32_t)draw_data->TotalVtxCount) {
-			vertexBuffer.Destroy();
-			uint32_t vertexCount = draw_data->TotalVtxCount + 5000;
-			vertexBuffer.Create(vertexCount, VERTEX_ATTR_FLAG_POSITION | VERTEX_ATTR_FLAG_TEXCOORD0 | VERTEX_ATTR_FLAG_BYTE_COLOR, BUFFER_USAGE_DYNAMIC);
-			g_vertexLayout = se::VertexLayoutManager::Get().FindLayout(*g_shader->GetVS(), vertexBuffer.GetAttributes());
+		uint32_t totalCommandNum = 0;
+		for (int n = 0; n < drawData->CmdListsCount; n++) {
+			totalCommandNum += drawData->CmdLists[n]->CmdBuffer.Size;
 		}
-		// インデックスバッファ
-		if (!indexBuffer.GetResource() || indexBuffer.GetIndexNum() < (uint32_t)draw_data->TotalIdxCount) {
-			indexBuffer.Destroy();
-			uint32_t indexCount = draw_data->TotalIdxCount + 10000;
-			indexBuffer.Create(indexCount, BUFFER_USAGE_DYNAMIC);
+		if (totalCommandNum == 0) {
+			return;
 		}
+		ImDrawVert* vertexDst = static_cast<ImDrawVert*>(arena.Allocate(sizeof(ImDrawVert) * drawData->TotalVtxCount, alignof(ImDrawVert)));
+		ImDrawIdx* indexDst = static_cast<ImDrawIdx*>(arena.Allocate(sizeof(ImDrawIdx) * drawData->TotalIdxCount, alignof(ImDrawIdx)));
+		Command* commandDst = static_cast<Command*>(arena.Allocate(sizeof(Command) * totalCommandNum, alignof(Command)));
+
+		for (int n = 0; n < drawData->CmdListsCount; n++) {
+			const ImDrawList* cmdList = drawData->CmdLists[n];
+			uint32_t vertexStart = vertexNum;
+			uint32_t indexStart = indexNum;
+			memcpy(vertexDst + vertexNum, cmdList->VtxBuffer.Data, cmdList->VtxBuffer.Size * sizeof(ImDrawVert));
+			memcpy(indexDst + indexNum, cmdList->IdxBuffer.Data, cmdList->IdxBuffer.Size * sizeof(ImDrawIdx));
+			vertexNum += cmdList->VtxBuffer.Size;
+			indexNum += cmdList->IdxBuffer.Size;
+
+			for (int i = 0; i < cmdList->CmdBuffer.Size; i++) {
+				const ImDrawCmd& cmd = cmdList->CmdBuffer[i];
+				Command& command = commandDst[commandNum++];
+				command.clipRect = cmd.ClipRect;
+				command.textureId = cmd.TextureId;
+				command.indexStart = indexStart;
+				command.indexCount = cmd.ElemCount;
+				command.vertexStart = vertexStart;
+				command.userCallback = cmd.UserCallback;
+				command.userCallbackData = cmd.UserCallbackData;
+				indexStart += cmd.ElemCount;
+			}
+		}
+		vertices = vertexDst;
+		indices = indexDst;
+		commands = commandDst;
+	}
+
+	void ImGuiDrawSnapshot::Clear()
+	{
+		vertices = nullptr;
+		indices = nullptr;
+		commands = nullptr;
+		vertexNum = 0;
+		indexNum = 0;
+		commandNum = 0;
+		displaySize = ImVec2(0, 0);
+	}
+
+
+	/**
+	 * 描画ハンドラ
+	 */
+	void ImGuiRenderDrawLists(ImDrawData* draw_data)
+	{
+		if (g_captureTarget) {
+			g_captureTarget->Capture(draw_data, GlobalFrameArena::Get().GetCurrent());
+			return;
+		}
+
+		// 即時描画はコピーせずにImDrawDataから直接バッファを作る
+		auto& context = GraphicsCore::GetImmediateContext();
+		ReserveBuffers(draw_data->TotalVtxCount, draw_data->TotalIdxCount);
 
 		// バッファ構築
-		void* vertexPtr = context.Map(vertexBuffer);
-		void* indexPtr = context.Map(indexBuffer);
-		ImDrawVert* vtx_dst = (ImDrawVert*)vertexPtr;
-		ImDrawIdx* idx_dst = (ImDrawIdx*)indexPtr;
-		for (int n = 0; n < draw_data->CmdListsCount; n++)
-		{
+		ImDrawVert* vtx_dst = (ImDrawVert*)context.Map(vertexBuffer);
+		ImDrawIdx* idx_dst = (ImDrawIdx*)context.Map(indexBuffer);
+		for (int n = 0; n < draw_data->CmdListsCount; n++) {
 			const ImDrawList* cmd_list = draw_data->CmdLists[n];
 			memcpy(vtx_dst, cmd_list->VtxBuffer.Data, cmd_list->VtxBuffer.Size * sizeof(ImDrawVert));
 			memcpy(idx_dst, cmd_list->IdxBuffer.Data, cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx));
@@ -58,37 +163,7 @@ namespace se {
 		context.Unmap(vertexBuffer);
 		context.Unmap(indexBuffer);
 
-
-		// コンスタントバッファ
-		{
-			float L = 0.0f;
-			float R = ImGui::GetIO().DisplaySize.x;
-			float B = ImGui::GetIO().DisplaySize.y;
-			float T = 0.0f;
-			float mvp[4][4] =
-			{
-				{ 2.0f / (R - L),		0.0f,					0.0f,       0.0f },
-				{ 0.0f,					2.0f / (T - B),			0.0f,       0.0f },
-				{ 0.0f,					0.0f,					0.5f,       0.0f },
-				{ (R + L) / (L - R),	(T + B) / (B - T),		0.5f,       1.0f },
-			};
-			memcpy(g_constants.Contents().mvp, mvp, sizeof(mvp));
-			g_constants.Update(context, true);
-		}
-
-		// Setup
-		context.SetViewport(Rect(0, 0, (int32_t)ImGui::GetIO().DisplaySize.x, (int32_t)ImGui::GetIO().DisplaySize.y));
-		context.SetVertexShader(*g_shader->GetVS());
-		context.SetPixelShader(*g_shader->GetPS());
-		context.SetVertexBuffer(0, &vertexBuffer);
-		context.SetInputLayout(*g_vertexLayout);
-		context.SetIndexBuffer(&indexBuffer);
-		context.SetPrimitiveType(PRIMITIVE_TYPE_TRIANGLE_LIST);
-		context.SetVSConstantBuffer(0, g_constants.GetResource());
-		context.SetPSSamplerState(0, SamplerState::Get(SamplerState::LinearWrap));
-		context.SetDepthStencilState(DepthStencilState::Get(DepthStencilState::Disable));
-		context.SetRasterizerState(RasterizerState::Get(RasterizerState::NoCull));
-		context.SetBlendState(BlendState::Get(BlendState::Translucent));
+		SetupRenderState(context, ImGui::GetIO().DisplaySize);
 
 		// Render command lists
 		int vtx_offset = 0;
@@ -100,7 +175,6 @@ namespace se {
 				if (pcmd->UserCallback) {
 					pcmd->UserCallback(cmd_list, pcmd);
 				} else {
-					const D3D11_RECT r = { (LONG)pcmd->ClipRect.x, (LONG)pcmd->ClipRect.y, (LONG)pcmd->ClipRect.z, (LONG)pcmd->ClipRect.w };
 					context.SetPSResource(0, (GPUResource*)pcmd->TextureId);
 					context.SetScissorRect(Rect((LONG)pcmd->ClipRect.x, (LONG)pcmd->ClipRect.y, (LONG)pcmd->ClipRect.z, (LONG)pcmd->ClipRect.w));
 					context.DrawIndexed(idx_offset, pcmd->ElemCount, vtx_offset);
@@ -111,6 +185,48 @@ namespace se {
 		}
 	}
 
+	/**
+	 * 記録した描画データの描画
+	 */
+	void ImGuiRenderSnapshot(const ImGuiDrawSnapshot& snapshot)
+	{
+		if (snapshot.commandNum == 0) {
+			return;
+		}
+
+		auto& context = GraphicsCore::GetImmediateContext();
+		ReserveBuffers(snapshot.vertexNum, snapshot.indexNum);
+
+		// バッファ構築
+		void* vertexPtr = context.Map(vertexBuffer);
+		void* indexPtr = context.Map(indexBuffer);
+		memcpy(vertexPtr, snapshot.vertices, snapshot.vertexNum * sizeof(ImDrawVert));
+		memcpy(indexPtr, snapshot.indices, snapshot.indexNum * sizeof(ImDrawIdx));
+		context.Unmap(vertexBuffer);
+		context.Unmap(indexBuffer);
+
+		SetupRenderState(context, snapshot.displaySize);
+
+		// Render commands
+		for (uint32_t i = 0; i < snapshot.commandNum; i++) {
+			const auto& command = snapshot.commands[i];
+			if (command.userCallback) {
+				ImDrawCmd cmd;
+				cmd.ElemCount = command.indexCount;
+				cmd.ClipRect = command.clipRect;
+				cmd.TextureId = command.textureId;
+				cmd.UserCallback = command.userCallback;
+				cmd.UserCallbackData = command.userCallbackData;
+				command.userCallback(nullptr, &cmd);
+				continue;
+			}
+			const ImVec4& clip = command.clipRect;
+			context.SetPSResource(0, (GPUResource*)command.textureId);
+			context.SetScissorRect(Rect((LONG)clip.x, (LONG)clip.y, (LONG)clip.z, (LONG)clip.w));
+			context.DrawIndexed(command.indexStart, command.indexCount, command.vertexStart);
+		}
+	}
+
 	/**
 	 * ウインドウプロシージャ
 	 */
@@ -148,6 +264,8 @@ namespace se {
 			return false;
 
 		ImGuiIO& io = ImGui::GetIO();
+		io.MemAllocFn = [](size_t size) { return TrackedAllocate(MemoryTag::ImGui, size); };
+		io.MemFreeFn = TrackedFree;
 		io.KeyMap[ImGuiKey_Tab] = VK_TAB;
 		io.KeyMap[ImGuiKey_LeftArrow] = VK_LEFT;
 		io.KeyMap[ImGuiKey_RightArrow] = VK_RIGHT;
@@ -242,6 +360,13 @@ namespace se {
 		ImGui::Render();
 	}
 
+	void ImGuiRender(ImGuiDrawSnapshot& snapshot)
+	{
+		g_captureTarget = &snapshot;
+		ImGui::Render();
+		g_captureTarget = nullptr;
+	}
+
 
 	/**
 	 * フォント追加
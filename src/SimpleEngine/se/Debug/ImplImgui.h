@@ -1,11 +1,49 @@
 ﻿#pragma once 
 
 #include "se/Graphics/Graphics.h"
+#include "se/Memory/FrameArena.h"
 #include "thirdparty/imgui/imgui.h"
 
 
 namespace se
 {
+	/**
+	 * 描画データのコピー
+	 * ImGui内部のバッファから切り離して別スレッドで描画するために使う
+	 * コピーはアリーナから確保するので、アリーナがResetされるまでに描画すること
+	 * UserCallbackは描画時に呼ぶが、親のImDrawListは残らないのでparent_listにはnullptrを渡す
+	 */
+	struct ImGuiDrawSnapshot
+	{
+		struct Command
+		{
+			ImVec4 clipRect;
+			ImTextureID textureId;
+			uint32_t indexStart;
+			uint32_t indexCount;
+			uint32_t vertexStart;
+			ImDrawCallback userCallback;
+			void* userCallbackData;
+		};
+
+		const ImDrawVert* vertices;
+		const ImDrawIdx* indices;
+		const Command* commands;
+		uint32_t vertexNum;
+		uint32_t indexNum;
+		uint32_t commandNum;
+		ImVec2 displaySize;
+
+		ImGuiDrawSnapshot()
+		{
+			Clear();
+		}
+
+		void Capture(const ImDrawData* drawData, FrameArena& arena);
+		void Clear();
+	};
+
+
 	/**
 	 * functions
 	 */
@@ -13,6 +51,8 @@ namespace se
 	void ImGuiShutdown();
 	void ImGuiNewFrame();
 	void ImGuiRender();
+	void ImGuiRender(ImGuiDrawSnapshot& snapshot);			// 描画せずにsnapshotへ記録(GlobalFrameArenaの現在のフレームに確保)
+	void ImGuiRenderSnapshot(const ImGuiDrawSnapshot& snapshot);
 	void ImGuiAddFontFromFileTTF(const char* filename, float sizePixels);
 
 
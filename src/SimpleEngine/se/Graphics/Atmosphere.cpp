@@ -5,6 +5,9 @@ namespace se
 {
 	namespace {
 		ComputeShader* computeTransmittanceCS = nullptr;
+
+		const uint32_t TRANSMITTANCE_LUT_WIDTH = 256;
+		const uint32_t TRANSMITTANCE_LUT_HEIGHT = 64;
 	}
 
 	Atmosphere::Atmosphere()
@@ -17,11 +20,13 @@ namespace se
 		Assert(computeTransmittanceCS);
 	}
 
-	void Atmosphere::Render(GraphicsContext& context)
+	void Atmosphere::Render(GraphicsContext& context, const Settings& settings)
 	{
-		if(!transmittanceLUT_.IsCreated()) {
-			transmittanceLUT_.Create2D(FORMAT_R16G16B16A16_FLOAT, 256, 64, 1, 1, true);
-
+		bool created = transmittanceLUT_.IsCreated();
+		if (!created) {
+			transmittanceLUT_.Create2D(FORMAT_R16G16B16A16_FLOAT, TRANSMITTANCE_LUT_WIDTH, TRANSMITTANCE_LUT_HEIGHT, 1, 1, true);
+		}
+		if (!created || settings.recomputeTransmittance) {
 			context.SetComputeShader(*computeTransmittanceCS);
 			context.SetCSUnorderedAccessView(0, &transmittanceLUT_);
 			context.Dispatch(TG(transmittanceLUT_.GetWidth(), 16), TG(transmittanceLUT_.GetHeight(), 16), 1);
@@ -29,7 +34,7 @@ namespace se
 		}
 	}
 
-	void Atmosphere::DebugGUI()
+	void Atmosphere::DebugGUI(Settings& settings)
 	{
 		static bool open = true;
 		ImGuiWindowFlags window_flags = 0;
@@ -37,7 +42,10 @@ namespace se
 			ImGui::End();
 		} else {
 			float width = ImGui::GetContentRegionAvailWidth();
-			ImGui::Image(&transmittanceLUT_, se::IMVec2(width, width * ((float)transmittanceLUT_.GetHeight() / transmittanceLUT_.GetWidth())));
+			ImGui::Image(&transmittanceLUT_, se::IMVec2(width, width * ((float)TRANSMITTANCE_LUT_HEIGHT / TRANSMITTANCE_LUT_WIDTH)));
+			if (ImGui::Button("Recompute Transmittance")) {
+				settings.recomputeTransmittance = true;
+			}
 			ImGui::End();
 		}
 	}
@@ -9,6 +9,21 @@ namespace se
 {
 	class Atmosphere
 	{
+	public:
+		/**
+		 * 描画の設定
+		 * DebugGUIで編集し、Renderに値渡しするので描画スレッドとは共有しない
+		 */
+		struct Settings
+		{
+			bool recomputeTransmittance;	// 透過率LUTを次の描画で作り直す
+
+			Settings()
+				: recomputeTransmittance(false)
+			{
+			}
+		};
+
 	private:
 		ColorBuffer transmittanceLUT_;	
 
@@ -17,7 +32,8 @@ namespace se
 
 		void Initialize();
 
-		void Render(GraphicsContext& context);
-		void DebugGUI();
+		void Render(GraphicsContext& context, const Settings& settings);
+		// 描画スレッドが作るtransmittanceLUT_の状態は読まない(表示はテクスチャのポインタのみ記録する)
+		void DebugGUI(Settings& settings);
 	};
 }
\ No newline at end of file
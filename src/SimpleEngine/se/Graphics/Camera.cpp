@@ -20,11 +20,12 @@ namespace se
 	{
 		if (!isUpdated_) return;
 		viewProjection_ = view_ * projection_;
+		frustum_.Set(viewProjection_);
 	}
 
 	void Camera::SetLookAt(const float3& eye, const float3& lookat, const float3& up)
 	{
-		view_ = XMMatrixLookAtRH(eye.ToSIMD(), lookat.ToSIMD(), up.ToSIMD());
+		view_ = float4x4::LookAtRH(eye, lookat, up);
 		world_ = float4x4::Invert(view_);
 		position_ = eye;
 		at_ = lookat;
@@ -32,7 +33,7 @@ namespace se
 	}
 	void Camera::SetPerspective(float aspectRatio, float fieldOfView, float nearClip, float farClip)
 	{
-		projection_ = XMMatrixPerspectiveFovRH(fieldOfView, aspectRatio, nearClip, farClip);
+		projection_ = float4x4::PerspectiveFovRH(fieldOfView, aspectRatio, nearClip, farClip);
 		near_ = nearClip;
 		far_ = farClip;
 		aspect_ = aspectRatio;
@@ -2,6 +2,7 @@
 
 #include "se/Common.h"
 #include "se/Math/Math.h"
+#include "se/Math/Frustum.h"
 #include "se/HID/HIDCore.h"
 
 namespace se
@@ -13,6 +14,7 @@ namespace se
 		float4x4 view_;
 		float4x4 viewProjection_;
 		float4x4 world_;
+		Frustum frustum_;
 		float3 position_;
 		float3 at_;
 		float3 up_;
@@ -33,6 +35,8 @@ namespace se
 		const float4x4& GetProjection() const { return projection_; }
 		const float4x4& GetView() const { return view_; }
 		const float4x4& GetViewProjection() const { return viewProjection_; }
+		// Build時のビュー射影行列から作った視錐台
+		const Frustum& GetFrustum() const { return frustum_; }
 		float GetNear() const { return near_; }
 		float GetFar() const { return far_; }
 
@@ -129,7 +133,7 @@ namespace se
 
 		void ReCalcCamera()
 		{
-			Quaternion q(XMQuaternionRotationRollPitchYaw(rotation_.x, rotation_.y, 0));
+			Quaternion q = Quaternion::SetFromEuler(rotation_.x, rotation_.y, 0);
 
 			float3 new_dir = float3::Transform(float3(0, 0, 1), q);
 			new_dir *= length_;
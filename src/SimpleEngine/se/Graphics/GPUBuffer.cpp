@@ -118,6 +118,58 @@ namespace se
 			return nativeFormats[format];
 		};
 
+		// DXGI_FORMAT -> 1ピクセルのビット数(ブロック圧縮は1ピクセルあたりに換算)
+		uint32_t GetDXGIFormatBitsPerPixel(DXGI_FORMAT format)
+		{
+			if (format >= DXGI_FORMAT_R32G32B32A32_TYPELESS && format <= DXGI_FORMAT_R32G32B32A32_SINT) return 128;
+			if (format >= DXGI_FORMAT_R32G32B32_TYPELESS && format <= DXGI_FORMAT_R32G32B32_SINT) return 96;
+			if (format >= DXGI_FORMAT_R16G16B16A16_TYPELESS && format <= DXGI_FORMAT_X32_TYPELESS_G8X24_UINT) return 64;
+			if (format >= DXGI_FORMAT_R10G10B10A2_TYPELESS && format <= DXGI_FORMAT_X24_TYPELESS_G8_UINT) return 32;
+			if (format >= DXGI_FORMAT_R8G8_TYPELESS && format <= DXGI_FORMAT_R16_SINT) return 16;
+			if (format >= DXGI_FORMAT_R8_TYPELESS && format <= DXGI_FORMAT_A8_UNORM) return 8;
+			if (format == DXGI_FORMAT_R1_UNORM) return 1;
+			if (format >= DXGI_FORMAT_R9G9B9E5_SHAREDEXP && format <= DXGI_FORMAT_G8R8_G8B8_UNORM) return 32;
+			if (format >= DXGI_FORMAT_BC1_TYPELESS && format <= DXGI_FORMAT_BC1_UNORM_SRGB) return 4;
+			if (format >= DXGI_FORMAT_BC2_TYPELESS && format <= DXGI_FORMAT_BC3_UNORM_SRGB) return 8;
+			if (format >= DXGI_FORMAT_BC4_TYPELESS && format <= DXGI_FORMAT_BC4_SNORM) return 4;
+			if (format >= DXGI_FORMAT_BC5_TYPELESS && format <= DXGI_FORMAT_BC5_SNORM) return 8;
+			if (format >= DXGI_FORMAT_B5G6R5_UNORM && format <= DXGI_FORMAT_B5G5R5A1_UNORM) return 16;
+			if (format >= DXGI_FORMAT_B8G8R8A8_UNORM && format <= DXGI_FORMAT_B8G8R8X8_UNORM_SRGB) return 32;
+			if (format >= DXGI_FORMAT_BC6H_TYPELESS && format <= DXGI_FORMAT_BC7_UNORM_SRGB) return 8;
+			return 0;
+		}
+
+		bool IsBlockCompressed(DXGI_FORMAT format)
+		{
+			return (format >= DXGI_FORMAT_BC1_TYPELESS && format <= DXGI_FORMAT_BC5_SNORM)
+				|| (format >= DXGI_FORMAT_BC6H_TYPELESS && format <= DXGI_FORMAT_BC7_UNORM_SRGB);
+		}
+
+		// ミップを含めたテクスチャのサイズ
+		size_t ComputeTextureSize(DXGI_FORMAT format, uint32_t width, uint32_t height, uint32_t arraySize, uint32_t mips)
+		{
+			uint32_t bpp = GetDXGIFormatBitsPerPixel(format);
+			bool blockCompressed = IsBlockCompressed(format);
+			size_t size = 0;
+			for (uint32_t i = 0; i < mips; i++) {
+				size_t w = se::Max<uint32_t>(1, width >> i);
+				size_t h = se::Max<uint32_t>(1, height >> i);
+				if (blockCompressed) {
+					w = (w + 3) & ~3;
+					h = (h + 3) & ~3;
+				}
+				size += w * h * bpp / 8;
+			}
+			return size * arraySize;
+		}
+
+		// 読み込んだ2Dテクスチャのサイズ
+		size_t ComputeTextureSize(ID3D11Resource* resource)
+		{
+			D3D11_TEXTURE2D_DESC desc;
+			static_cast<ID3D11Texture2D*>(resource)->GetDesc(&desc);
+			return ComputeTextureSize(desc.Format, desc.Width, desc.Height, desc.ArraySize, desc.MipLevels);
+		}
 	}
 
 #pragma region ConstantBuffer
@@ -155,6 +207,11 @@ namespace se
 		size_ = size;
 	}
 
+	void ConstantBuffer::Destroy()
+	{
+		COMPTR_RELEASE(buffer_);
+	}
+
 	void ConstantBuffer::Update(GraphicsContext& context, const void* data, uint32_t size)
 	{
 		context.UpdateSubresource(*this, data, size);
@@ -168,6 +225,8 @@ namespace se
 		: resource_(nullptr)
 		, srv_(nullptr)
 		, uav_(nullptr)
+		, memoryTag_(MemoryTag::General)
+		, memorySize_(0)
 	{
 	}
 
@@ -181,6 +240,18 @@ namespace se
 		COMPTR_RELEASE(srv_);
 		COMPTR_RELEASE(uav_);
 		COMPTR_RELEASE(resource_);
+		if (memorySize_ > 0) {
+			MemoryTracker::Get().OnFree(memoryTag_, memorySize_);
+			memorySize_ = 0;
+		}
+	}
+
+	void GPUResource::TrackMemory(MemoryTag tag, size_t size)
+	{
+		Assert(memorySize_ == 0);
+		memoryTag_ = tag;
+		memorySize_ = size;
+		MemoryTracker::Get().OnAllocate(tag, size);
 	}
 
 #pragma endregion
@@ -243,6 +314,7 @@ namespace se
 		resource_ = buffer;
 		stride_ = ComputeVertexStride(attributes);
 		attributes_ = attributes;
+		TrackMemory(MemoryTag::Mesh, size);
 
 		// アンオーダードアクセスビューを生成
 		if (unorderedAccess) {
@@ -290,7 +362,7 @@ namespace se
 	{
 		stride_ = stride;
 		bufferSize_ = size;
-		indexCount_ = indexStrideList[stride];
+		indexCount_ = size / indexStrideList[stride];
 
 		D3D11_BUFFER_DESC ibd;
 		ibd.ByteWidth = size;
@@ -318,6 +390,7 @@ namespace se
 		HRESULT hr = GraphicsCore::GetDevice()->CreateBuffer(&ibd, pInit, &buffer);
 		THROW_IF_FAILED(hr);
 		resource_ = buffer;
+		TrackMemory(MemoryTag::Mesh, size);
 	}
 
 	void IndexBuffer::Create(uint32_t num, BufferUsage usage)
@@ -405,6 +478,7 @@ namespace se
 		ID3D11Texture2D* texture;
 		THROW_IF_FAILED(device->CreateTexture2D(&objdesc, nullptr, &texture));
 		resource_ = texture;
+		TrackMemory(MemoryTag::Texture, ComputeTextureSize(dxgiFormat, width, height, arraySize, mips));
 
 		//	シェーダリソースビュー
 		bool isArray = (arraySize > 1);
@@ -489,6 +563,7 @@ namespace se
 		auto hr = device->CreateTexture2D(&descDepth, NULL, &texture2d);
 		THROW_IF_FAILED(hr);
 		resource_ = texture2d;
+		TrackMemory(MemoryTag::Texture, ComputeTextureSize(descDepth.Format, width, height, 1, 1));
 
 		// デプスステンシルビュー
 		D3D11_DEPTH_STENCIL_VIEW_DESC descDSV;
@@ -525,6 +600,7 @@ namespace se
 		mbstowcs_s(&size, buffer, fileName, sizeof(buffer));
 		auto hr = DirectX::CreateDDSTextureFromFile(GraphicsCore::GetDevice(), buffer, &resource_, &srv_);
 		THROW_IF_FAILED(hr);
+		TrackMemory(MemoryTag::Texture, ComputeTextureSize(resource_));
 
 		// 2D only
 		ID3D11Texture2D* texture = (ID3D11Texture2D*)resource_;
@@ -537,8 +613,10 @@ namespace se
 
 	void Texture::LoadFromMemory(const void* data, uint32_t size)
 	{
-		DirectX::CreateDDSTextureFromMemory(GraphicsCore::GetDevice(), reinterpret_cast<const byte*>(data), static_cast<size_t>(size), &resource_, &srv_);
-		
+		auto hr = DirectX::CreateDDSTextureFromMemory(GraphicsCore::GetDevice(), reinterpret_cast<const byte*>(data), static_cast<size_t>(size), &resource_, &srv_);
+		THROW_IF_FAILED(hr);
+		TrackMemory(MemoryTag::Texture, ComputeTextureSize(resource_));
+
 		// 2D only
 		ID3D11Texture2D* texture = (ID3D11Texture2D*)resource_;
 		D3D11_TEXTURE2D_DESC desc;
@@ -595,6 +673,7 @@ namespace se
 		ID3D11Texture2D* texture;
 		THROW_IF_FAILED(device->CreateTexture2D(&objdesc, &dataBin, &texture));
 		resource_ = texture;
+		TrackMemory(MemoryTag::Texture, static_cast<size_t>(bpp) * width * height);
 
 		//	シェーダリソースビュー
 		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
@@ -623,7 +702,7 @@ namespace se
 
 	void Query::Create(Type type)
 	{
-		static D3D11_QUERY types[] = { D3D11_QUERY_TIMESTAMP, D3D11_QUERY_TIMESTAMP_DISJOINT };
+		static D3D11_QUERY types[] = { D3D11_QUERY_TIMESTAMP, D3D11_QUERY_TIMESTAMP_DISJOINT, D3D11_QUERY_EVENT };
 		Assert(type < UNKNOWN);
 
 		type_ = type;
@@ -641,4 +720,178 @@ namespace se
 
 #pragma endregion
 
+#pragma region DynamicConstantBuffer
+
+	DynamicConstantBuffer::DynamicConstantBuffer()
+		: frame_(1)
+		, completedFrame_(0)
+		, pageSize_(DEFAULT_PAGE_SIZE)
+		, frameAllocNum_(0)
+		, lastFrameAllocNum_(0)
+		, isSupported_(false)
+	{
+	}
+
+	DynamicConstantBuffer::~DynamicConstantBuffer()
+	{
+		Finalize();
+	}
+
+	void DynamicConstantBuffer::Initialize(uint32_t pageSize)
+	{
+		Assert(pages_.empty());
+		Assert(pageSize % ALIGNMENT == 0);
+		pageSize_ = pageSize;
+		frame_ = 1;
+		completedFrame_ = 0;
+
+		// オフセット指定のバインドとコンスタントバッファへのNO_OVERWRITEは11.1の機能
+		D3D11_FEATURE_DATA_D3D11_OPTIONS options;
+		ZeroMemory(&options, sizeof(options));
+		auto* device = GraphicsCore::GetDevice();
+		HRESULT hr = device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+		isSupported_ = SUCCEEDED(hr)
+			&& options.ConstantBufferOffsetting
+			&& options.MapNoOverwriteOnDynamicConstantBuffer
+			&& GraphicsCore::GetImmediateContext().GetDeviceContext1() != nullptr;
+		if (!isSupported_) {
+			Printf("DynamicConstantBuffer: constant buffer offsetting is not supported.\n");
+			return;
+		}
+
+		for (auto& fence : fences_) {
+			fence.Create(Query::EVENT);
+		}
+		pages_.push_back(CreatePage(pageSize_));
+	}
+
+	void DynamicConstantBuffer::Finalize()
+	{
+		for (auto* page : pages_) {
+			COMPTR_RELEASE(page->buffer);
+			delete page;
+		}
+		pages_.clear();
+		for (auto& fence : fences_) {
+			fence.Destroy();
+		}
+		isSupported_ = false;
+	}
+
+	DynamicConstantBuffer::Page* DynamicConstantBuffer::CreatePage(uint32_t size)
+	{
+		D3D11_BUFFER_DESC bd;
+		ZeroMemory(&bd, sizeof(bd));
+		bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		bd.ByteWidth = size;
+		bd.Usage = D3D11_USAGE_DYNAMIC;
+		bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+		Page* page = new Page();
+		THROW_IF_FAILED(GraphicsCore::GetDevice()->CreateBuffer(&bd, nullptr, &page->buffer));
+		page->ring.Initialize(size);
+		page->discarded = false;
+		return page;
+	}
+
+	ConstantBufferView DynamicConstantBuffer::Allocate(GraphicsContext& context, const void* data, uint32_t size)
+	{
+		Assert(isSupported_);
+		Assert(size > 0 && size <= D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT * 16);
+
+		// バインドする範囲は16定数単位なので確保もそれに合わせる
+		uint32_t allocSize = (size + (ALIGNMENT - 1)) & ~(ALIGNMENT - 1);
+		Page* page = nullptr;
+		size_t offset = RingAllocator::INVALID_OFFSET;
+		for (auto* p : pages_) {
+			offset = p->ring.Allocate(allocSize, ALIGNMENT);
+			if (offset != RingAllocator::INVALID_OFFSET) {
+				page = p;
+				break;
+			}
+		}
+		if (!page) {
+			// GPUが追いつくのを待たずにページを増やす
+			page = CreatePage(pageSize_);
+			pages_.push_back(page);
+			offset = page->ring.Allocate(allocSize, ALIGNMENT);
+			Assert(offset != RingAllocator::INVALID_OFFSET);
+			Printf("DynamicConstantBuffer: added page. (%d pages)\n", static_cast<int>(pages_.size()));
+		}
+
+		// 既に書き込んだ範囲はGPUが参照している可能性があるので上書きしない
+		D3D11_MAP mapType = page->discarded ? D3D11_MAP_WRITE_NO_OVERWRITE : D3D11_MAP_WRITE_DISCARD;
+		page->discarded = true;
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		THROW_IF_FAILED(context.GetDeviceContext()->Map(page->buffer, 0, mapType, 0, &mapped));
+		memcpy(static_cast<uint8_t*>(mapped.pData) + offset, data, size);
+		context.GetDeviceContext()->Unmap(page->buffer, 0);
+
+		frameAllocNum_++;
+		ConstantBufferView view;
+		view.buffer = page->buffer;
+		view.firstConstant = static_cast<uint32_t>(offset / 16);
+		view.numConstants = allocSize / 16;
+		return view;
+	}
+
+	void DynamicConstantBuffer::EndFrame(GraphicsContext& context)
+	{
+		lastFrameAllocNum_ = frameAllocNum_;
+		frameAllocNum_ = 0;
+		if (!isSupported_) {
+			return;
+		}
+
+		// D3D11にはフェンスがないのでイベントクエリの完了をフレームの完了とみなす
+		context.EndQuery(fences_[frame_ % MAX_FRAME_LATENCY]);
+		for (auto* page : pages_) {
+			page->ring.EndFrame(frame_);
+		}
+		frame_++;
+		RetireFrames(context);
+	}
+
+	void DynamicConstantBuffer::RetireFrames(GraphicsContext& context)
+	{
+		// 完了したフレームを順に回収する
+		// 次のフレームで使うクエリがまだ終わっていなければ、それが終わるまで待つ
+		while (completedFrame_ + 1 < frame_) {
+			uint64_t frame = completedFrame_ + 1;
+			Query& fence = fences_[frame % MAX_FRAME_LATENCY];
+			bool mustWait = (frame_ - frame) >= MAX_FRAME_LATENCY;
+			BOOL done = FALSE;
+			while (!context.GetQueryData(fence, &done, sizeof(done)) || !done) {
+				if (!mustWait) {
+					break;
+				}
+				Sleep(0);
+			}
+			if (!done) {
+				break;
+			}
+			completedFrame_ = frame;
+		}
+
+		for (auto* page : pages_) {
+			page->ring.Retire(completedFrame_);
+		}
+	}
+
+	DynamicConstantBuffer::Stats DynamicConstantBuffer::GetStats() const
+	{
+		Stats stats;
+		stats.pageNum = static_cast<uint32_t>(pages_.size());
+		stats.totalSize = 0;
+		stats.usedSize = 0;
+		for (auto* page : pages_) {
+			stats.totalSize += page->ring.GetSize();
+			stats.usedSize += page->ring.GetUsedSize();
+		}
+		stats.frameAllocNum = lastFrameAllocNum_;
+		return stats;
+	}
+
+#pragma endregion
+
 }
\ No newline at end of file
@@ -3,6 +3,9 @@
 #include "se/Common.h"
 #include "se/Graphics/GraphicsCommon.h"
 #include "se/Graphics/GraphicsContext.h"
+#include "se/Memory/RingAllocator.h"
+#include "se/Memory/MemoryTracker.h"
+#include <vector>
 
 namespace se
 {
@@ -21,6 +24,18 @@ namespace se
 	};
 
 
+	/**
+	 * コンスタントバッファの範囲
+	 * firstConstant, numConstantsは16byte単位、numConstantsが0ならバッファ全体
+	 */
+	struct ConstantBufferView
+	{
+		ID3D11Buffer* buffer;
+		uint32_t firstConstant;
+		uint32_t numConstants;
+	};
+
+
 	/**
 	 * コンスタントバッファ
 	 */
@@ -37,12 +52,20 @@ namespace se
 		virtual ~ConstantBuffer();
 
 		void Create(uint32_t size, BufferUsage usage);
+		void Destroy();
 		void Update(GraphicsContext& context, const void* data, uint32_t size);
+
+		ConstantBufferView GetView() const
+		{
+			ConstantBufferView view = { buffer_, 0, 0 };
+			return view;
+		}
 	};
 
 
 	/**
 	 * GPUで使用されるリソース
+	 * 生成したリソースのサイズはMemoryTrackerに記録し、Destroyで差し引く
 	 */
 	class GPUResource
 	{
@@ -50,6 +73,11 @@ namespace se
 		ID3D11Resource*				resource_;
 		ID3D11ShaderResourceView*	srv_;
 		ID3D11UnorderedAccessView*	uav_;
+		MemoryTag					memoryTag_;
+		size_t						memorySize_;
+
+	protected:
+		void TrackMemory(MemoryTag tag, size_t size);
 
 	public:
 		GPUResource();
@@ -221,6 +249,7 @@ namespace se
 		enum Type {
 			TIMESTAMP,
 			TIMESTAMP_DISJOINT,
+			EVENT,
 
 			UNKNOWN
 		};
@@ -239,23 +268,104 @@ namespace se
 	};
 
 
+	/**
+	 * 動的コンスタントバッファ
+	 * 大きなDYNAMICバッファからフレームごとに切り出してWRITE_NO_OVERWRITEで書き込み、オフセット指定でバインドする
+	 * 切り出した領域はGPUがそのフレームを終えたこと(イベントクエリ)を確認してから再利用する
+	 * D3D11.1のオフセット指定が使えない環境ではIsSupportedがfalseになる
+	 * 描画コマンドを発行するスレッドからのみ使うこと
+	 */
+	class DynamicConstantBuffer
+	{
+	public:
+		static const uint32_t DEFAULT_PAGE_SIZE = 1024 * 1024;
+		static const uint32_t MAX_FRAME_LATENCY = 4;		// GPUの完了を待たずに進めるフレーム数
+		static const uint32_t ALIGNMENT = 256;				// オフセットは16定数単位
+
+		static DynamicConstantBuffer& Get() {
+			static DynamicConstantBuffer instance;
+			return instance;
+		}
+
+		struct Stats
+		{
+			uint32_t pageNum;
+			size_t totalSize;
+			size_t usedSize;			// GPUの完了待ちを含む
+			uint32_t frameAllocNum;		// 直前のフレームの切り出し数
+		};
+
+	private:
+		struct Page
+		{
+			ID3D11Buffer* buffer;
+			RingAllocator ring;
+			bool discarded;		// 作成後の最初のMapはDISCARDで行う
+		};
+
+	private:
+		std::vector<Page*> pages_;
+		Query fences_[MAX_FRAME_LATENCY];
+		uint64_t frame_;
+		uint64_t completedFrame_;
+		uint32_t pageSize_;
+		uint32_t frameAllocNum_;
+		uint32_t lastFrameAllocNum_;
+		bool isSupported_;
+
+	private:
+		DynamicConstantBuffer();
+		~DynamicConstantBuffer();
+		DynamicConstantBuffer(const DynamicConstantBuffer&) = delete;
+		DynamicConstantBuffer& operator=(const DynamicConstantBuffer&) = delete;
+
+		Page* CreatePage(uint32_t size);
+		void RetireFrames(GraphicsContext& context);
+
+	public:
+		void Initialize(uint32_t pageSize = DEFAULT_PAGE_SIZE);
+		void Finalize();
+
+		bool IsSupported() const { return isSupported_; }
+
+		// 現在のフレーム番号、切り出した領域はこのフレームの間だけ有効
+		uint64_t GetFrame() const { return frame_; }
+
+		// dataを書き込んだ領域を返す
+		ConstantBufferView Allocate(GraphicsContext& context, const void* data, uint32_t size);
+
+		// フレームの終わり(Present後)に呼ぶ
+		void EndFrame(GraphicsContext& context);
+
+		Stats GetStats() const;
+	};
+
+
 	/**
 	 * ユニフォームパラメータ
+	 * DynamicConstantBufferが使えればそこから切り出し、使えなければ個別のバッファをUpdateSubresourceで更新する
+	 * 切り出した領域はそのフレームだけ有効なので、バインドするフレームで毎回Updateを呼ぶこと
 	 */
 	template <class T>
 	class TUniformParameter
 	{
 	private:
 		ConstantBuffer resource_;
+		ConstantBufferView view_;
 		T contents_;
+		uint64_t allocatedFrame_;
 		bool isCreated_;
 		bool isUpdated_;
 
 	public:
 		TUniformParameter()
-			: isCreated_(false)
+			: allocatedFrame_(0)
+			, isCreated_(false)
 			, isUpdated_(true)
 		{
+			view_.buffer = nullptr;
+			view_.firstConstant = 0;
+			view_.numConstants = 0;
 		}
 
 		void Destroy()
@@ -272,8 +382,20 @@ namespace se
 
 		void Update(GraphicsContext& context, bool forceUpdate = false)
 		{
+			auto& dynamicBuffer = DynamicConstantBuffer::Get();
+			if (dynamicBuffer.IsSupported()) {
+				// 前のフレームの領域は再利用されるので、内容が同じでもフレームが変わったら切り出し直す
+				if (isUpdated_ || forceUpdate || allocatedFrame_ != dynamicBuffer.GetFrame()) {
+					view_ = dynamicBuffer.Allocate(context, &contents_, sizeof(T));
+					allocatedFrame_ = dynamicBuffer.GetFrame();
+					isUpdated_ = false;
+				}
+				return;
+			}
+
 			if (!isCreated_) {
 				resource_.Create(sizeof(T), BUFFER_USAGE_DEFAULT);
+				view_ = resource_.GetView();
 				isCreated_ = true;
 			}
 			if (isUpdated_ || forceUpdate) {
@@ -285,7 +407,7 @@ namespace se
 		T& Contents() { return contents_; }
 		const T& Contents() const { return contents_; }
 		void Updated() { isUpdated_ = true; }
-		const ConstantBuffer& GetResource() const { return resource_; }
+		const ConstantBufferView& GetView() const { return view_; }
 		bool IsCreated() const { return isCreated_; }
 	};
 }
\ No newline at end of file
@@ -9,6 +9,7 @@ namespace se
 		, currentQuery_(0)
 		, currentFrameFirstQuery_(0)
 		, currentFrameProfilerTree_(nullptr)
+		, treeArena_(16 * 1024, MemoryTag::Profiler)
 	{
 	}
 
@@ -31,9 +32,8 @@ namespace se
 
 	void GPUProfiler::Finalize()
 	{
-		if (currentFrameProfilerTree_) {
-			delete currentFrameProfilerTree_;
-		}
+		currentFrameProfilerTree_ = nullptr;
+		treeArena_.Release();
 	}
 
 	void GPUProfiler::BeginProfilePoint(GraphicsContext& context, const char* profilePointName)
@@ -93,22 +93,23 @@ namespace se
 
 		IncrementCurrentDisjointQuery();
 
-		if (currentFrameProfilerTree_) {
-			delete currentFrameProfilerTree_;
-		}
-
 		// Time to fetch prev frames!
 		if (pendingFrames_.size() > 4) {
 			pendingFrame = pendingFrames_.front();
 			pendingFrames_.pop();
 			D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjointData;
 			context.GetQueryData(disjointQueries_[pendingFrame.disjointQueryId_], &disjointData, sizeof(disjointData));
-			ProfilerTreeMember* parent = new ProfilerTreeMember();
+
+			// 前のツリーを破棄
+			currentFrameProfilerTree_ = nullptr;
+			treeArena_.Reset();
+
+			ProfilerTreeMember* parent = treeArena_.New<ProfilerTreeMember>(treeArena_);
 			ProfilerTreeMember* frameParent = parent;
 
 			for (int queryIterator = pendingFrame.beginQuery_; queryIterator != (pendingFrame.endQuery_ + 1) % MAX_HW_QUERIES; queryIterator = (queryIterator + 1) % MAX_HW_QUERIES) {
 				if (correspondingQueryEnds_[queryIterator] != INT_MAX) {
-					auto* profilerObject = new ProfilerTreeMember();
+					auto* profilerObject = treeArena_.New<ProfilerTreeMember>(treeArena_);
 					int correspondingEnd = correspondingQueryEnds_[queryIterator];
 					uint64_t beginProfilePointData, endProfilePointData;
 					context.GetQueryData(hwQueries_[queryIterator], &beginProfilePointData, sizeof(beginProfilePointData));
@@ -3,6 +3,7 @@
 #include "se/Common.h"
 #include "se/Graphics/GraphicsContext.h"
 #include "se/Graphics/GPUBuffer.h"
+#include "se/Memory/FrameArena.h"
 #include <vector>
 #include <stack>
 #include <queue>
@@ -29,26 +30,21 @@ namespace se
 		};
 
 	public:
+		// ツリーはフレームアリーナ上に作り、次のツリーを作る時に一括で破棄する
 		struct ProfilerTreeMember
 		{
-			std::vector<ProfilerTreeMember*> childMembers_;
+			FrameVector<ProfilerTreeMember*> childMembers_;
 			ProfilerTreeMember* parent_;
 			const char* name_;
 			double time_;
 
-			ProfilerTreeMember()
+			ProfilerTreeMember(FrameArena& arena)
+				: childMembers_(FrameArenaAllocator<ProfilerTreeMember*>(arena))
 			{
 				parent_ = nullptr;
 				name_ = "invalid";
 				time_ = 0.0;
 			}
-
-			~ProfilerTreeMember()
-			{
-				for (auto* c : childMembers_) {
-					delete c;
-				}
-			}
 		};
 
 	private:
@@ -64,6 +60,7 @@ namespace se
 		int currentFrameFirstQuery_;
 
 		ProfilerTreeMember* currentFrameProfilerTree_;
+		FrameArena treeArena_;
 		std::queue<PendingFrameQueries> pendingFrames_;
 
 	private:
@@ -10,6 +10,7 @@
 #include "se/Graphics/GraphicsStates.h"
 #include "se/Graphics/GPUBuffer.h"
 #include "se/Graphics/Shader.h"
+#include "se/Graphics/TextureManager.h"
 #include "se/Graphics/StaticMesh.h"
 #include "se/Graphics/Camera.h"
 #include "se/Graphics/Uniforms.h"
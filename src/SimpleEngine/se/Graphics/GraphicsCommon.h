@@ -1,7 +1,7 @@
 ﻿#pragma once
 
 #include <windows.h>
-#include <d3d11.h>
+#include <d3d11_1.h>
 
 #ifndef COMPTR_RELEASE
 	#define COMPTR_RELEASE(p)	if(p) { p->Release(); p = nullptr; }
@@ -7,6 +7,7 @@ namespace se
 {
 	GraphicsContext::GraphicsContext()
 		: deviceContext_(nullptr)
+		, deviceContext1_(nullptr)
 	{
 	}
 
@@ -18,6 +19,9 @@ namespace se
 	void GraphicsContext::Initialize(ID3D11DeviceContext * context)
 	{
 		deviceContext_ = context;
+		if (FAILED(deviceContext_->QueryInterface(__uuidof(ID3D11DeviceContext1), reinterpret_cast<void**>(&deviceContext1_)))) {
+			deviceContext1_ = nullptr;
+		}
 	}
 
 	void GraphicsContext::Finalize()
@@ -25,6 +29,7 @@ namespace se
 		if (deviceContext_) {
 			deviceContext_->ClearState();
 		}
+		COMPTR_RELEASE(deviceContext1_);
 		COMPTR_RELEASE(deviceContext_);
 	}
 
@@ -189,6 +194,33 @@ namespace se
 		deviceContext_->CSSetConstantBuffers(slot, 1, &buffer.buffer_);
 	}
 
+	void GraphicsContext::SetVSConstantBuffer(uint32_t slot, const ConstantBufferView& view)
+	{
+		if (view.numConstants > 0) {
+			deviceContext1_->VSSetConstantBuffers1(slot, 1, &view.buffer, &view.firstConstant, &view.numConstants);
+		} else {
+			deviceContext_->VSSetConstantBuffers(slot, 1, &view.buffer);
+		}
+	}
+
+	void GraphicsContext::SetPSConstantBuffer(uint32_t slot, const ConstantBufferView& view)
+	{
+		if (view.numConstants > 0) {
+			deviceContext1_->PSSetConstantBuffers1(slot, 1, &view.buffer, &view.firstConstant, &view.numConstants);
+		} else {
+			deviceContext_->PSSetConstantBuffers(slot, 1, &view.buffer);
+		}
+	}
+
+	void GraphicsContext::SetCSConstantBuffer(uint32_t slot, const ConstantBufferView& view)
+	{
+		if (view.numConstants > 0) {
+			deviceContext1_->CSSetConstantBuffers1(slot, 1, &view.buffer, &view.firstConstant, &view.numConstants);
+		} else {
+			deviceContext_->CSSetConstantBuffers(slot, 1, &view.buffer);
+		}
+	}
+
 	void GraphicsContext::DrawIndexed(uint32_t indexStart, uint32_t indexCount, uint32_t vertexStart)
 	{
 		deviceContext_->DrawIndexed(indexCount, indexStart, vertexStart);
@@ -226,9 +258,9 @@ namespace se
 		deviceContext_->End(query.query_);
 	}
 
-	void GraphicsContext::GetQueryData(Query& query, void* data, uint32_t size)
+	bool GraphicsContext::GetQueryData(Query& query, void* data, uint32_t size)
 	{
-		deviceContext_->GetData(query.query_, data, size, 0);
+		return deviceContext_->GetData(query.query_, data, size, 0) == S_OK;
 	}
 
 }
\ No newline at end of file
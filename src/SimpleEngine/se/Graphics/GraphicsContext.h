@@ -10,6 +10,7 @@ namespace se
 	class PixelShader;
 	class ComputeShader;
 	class ConstantBuffer;
+	struct ConstantBufferView;
 	class GPUResource;
 	class VertexBuffer;
 	class IndexBuffer;
@@ -29,6 +30,7 @@ namespace se
 	{
 	private:
 		ID3D11DeviceContext* deviceContext_;
+		ID3D11DeviceContext1* deviceContext1_;		// 11.1が使えなければnullptr
 
 	public:
 		GraphicsContext();
@@ -37,6 +39,7 @@ namespace se
 		void Initialize(ID3D11DeviceContext* context);
 		void Finalize();
 		ID3D11DeviceContext* GetDeviceContext() { return deviceContext_; }
+		ID3D11DeviceContext1* GetDeviceContext1() { return deviceContext1_; }
 
 		// RenderTarget
 		void SetRenderTarget(const ColorBuffer* colorBuffers, uint32_t count, const DepthStencilBuffer* depthStencil);
@@ -70,6 +73,9 @@ namespace se
 		void SetVSConstantBuffer(uint32_t slot, const ConstantBuffer& buffer);
 		void SetPSConstantBuffer(uint32_t slot, const ConstantBuffer& buffer);
 		void SetCSConstantBuffer(uint32_t slot, const ConstantBuffer& buffer);
+		void SetVSConstantBuffer(uint32_t slot, const ConstantBufferView& view);
+		void SetPSConstantBuffer(uint32_t slot, const ConstantBufferView& view);
+		void SetCSConstantBuffer(uint32_t slot, const ConstantBufferView& view);
 
 		// Batching
 		void DrawIndexed(uint32_t indexStart, uint32_t indexCount, uint32_t vertexStart = 0);
@@ -83,6 +89,6 @@ namespace se
 		// Query
 		void BeginQuery(Query& query);
 		void EndQuery(Query& query);
-		void GetQueryData(Query& query, void* data, uint32_t size);
+		bool GetQueryData(Query& query, void* data, uint32_t size);		// 結果が取得できたらtrue
 	};
 }
\ No newline at end of file
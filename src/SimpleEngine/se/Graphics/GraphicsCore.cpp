@@ -115,6 +115,9 @@ namespace se
 		immediateContext_.SetPrimitiveType(PRIMITIVE_TYPE_TRIANGLE_LIST);
 		immediateContext_.SetViewportAndScissorRect(Rect(0, 0, width_, height_));
 
+		// 動的コンスタントバッファ
+		DynamicConstantBuffer::Get().Initialize();
+
 		// 頂点レイアウトマネージャ
 		VertexLayoutManager::Get().Initialize();
 
@@ -127,6 +130,7 @@ namespace se
 	{
 		VertexLayoutManager::Get().Finalize();
 		GPUProfiler::Get().Finalize();
+		DynamicConstantBuffer::Get().Finalize();
 
 		immediateContext_.Finalize();
 		COMPTR_RELEASE(swapChain_);
@@ -137,6 +141,7 @@ namespace se
 	void GraphicsCore::Present(uint32_t syncInterval, uint32_t flags)
 	{
 		swapChain_->Present(syncInterval, flags);
+		DynamicConstantBuffer::Get().EndFrame(immediateContext_);
 	}
 
 }
\ No newline at end of file
@@ -0,0 +1,647 @@
+﻿#include "se/Graphics/MeshOptimizer.h"
+#include "se/Math/Math.h"
+#include "se/async/Parallel.h"
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+namespace se
+{
+namespace meshopt
+{
+	namespace {
+
+		const uint32_t WELD_PARALLEL_THRESHOLD = 1 << 16;	// これ未満の頂点数は分割せずに処理する
+		const uint32_t WELD_PARTITION_BITS = 6;
+		const uint32_t INVALID_INDEX = 0xffffffff;
+
+		// 頂点のバイト列を4バイトずつ混ぜる(MurmurHash3と同じ混ぜ方)
+		uint32_t HashVertex(const uint8_t* vertex, uint32_t vertexStride)
+		{
+			uint32_t h = 0;
+			for (uint32_t i = 0; i < vertexStride; i += 4) {
+				uint32_t k;
+				memcpy(&k, vertex + i, sizeof(k));
+				k *= 0xcc9e2d51;
+				k = (k << 15) | (k >> 17);
+				k *= 0x1b873593;
+				h ^= k;
+				h = (h << 13) | (h >> 19);
+				h = h * 5 + 0xe6546b64;
+			}
+			h ^= vertexStride;
+			h ^= h >> 16;
+			h *= 0x85ebca6b;
+			h ^= h >> 13;
+			h *= 0xc2b2ae35;
+			h ^= h >> 16;
+			return h;
+		}
+
+		uint32_t NextPowerOfTwo(uint32_t v)
+		{
+			uint32_t result = 1;
+			while (result < v) {
+				result <<= 1;
+			}
+			return result;
+		}
+
+		// 範囲内で使われている頂点に0から番号を振り直してlocalIndicesに入れ、頂点数を返す
+		uint32_t BuildLocalIndices(const uint32_t* indices, uint32_t indexCount, std::vector<uint32_t>& localIndices)
+		{
+			std::vector<uint32_t> vertices(indices, indices + indexCount);
+			std::sort(vertices.begin(), vertices.end());
+			vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+
+			localIndices.resize(indexCount);
+			for (uint32_t i = 0; i < indexCount; i++) {
+				localIndices[i] = static_cast<uint32_t>(std::lower_bound(vertices.begin(), vertices.end(), indices[i]) - vertices.begin());
+			}
+			return static_cast<uint32_t>(vertices.size());
+		}
+
+		float3 GetPosition(const uint8_t* vertices, uint32_t vertexStride, uint32_t index)
+		{
+			float3 position;
+			memcpy(&position, vertices + static_cast<size_t>(vertexStride) * index, sizeof(position));
+			return position;
+		}
+
+
+		/* Forsythの頂点キャッシュ最適化 */
+
+		const uint32_t FORSYTH_CACHE_SIZE = 32;		// 想定するLRUキャッシュのサイズ
+		const uint32_t FORSYTH_VALENCE_TABLE_SIZE = 32;
+		const float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+		const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+		const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+		const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+		struct ForsythScoreTable
+		{
+			float cache[FORSYTH_CACHE_SIZE];
+			float valence[FORSYTH_VALENCE_TABLE_SIZE];
+
+			ForsythScoreTable()
+			{
+				for (uint32_t i = 0; i < FORSYTH_CACHE_SIZE; i++) {
+					// 直前の三角形の頂点は、同じ三角形ばかり続かないよう一律の点数にする
+					if (i < 3) {
+						cache[i] = FORSYTH_LAST_TRIANGLE_SCORE;
+					} else {
+						float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+						cache[i] = powf(1.0f - (i - 3) * scaler, FORSYTH_CACHE_DECAY_POWER);
+					}
+				}
+				valence[0] = 0.0f;
+				for (uint32_t i = 1; i < FORSYTH_VALENCE_TABLE_SIZE; i++) {
+					valence[i] = FORSYTH_VALENCE_BOOST_SCALE * powf(static_cast<float>(i), -FORSYTH_VALENCE_BOOST_POWER);
+				}
+			}
+		};
+
+		// 残りの三角形が少ない頂点ほど先に使い切るよう点数を上げる
+		float ComputeVertexScore(const ForsythScoreTable& table, int32_t cachePosition, uint32_t remainingNum)
+		{
+			if (remainingNum == 0) {
+				return -1.0f;
+			}
+			float score = (cachePosition < 0) ? 0.0f : table.cache[cachePosition];
+			if (remainingNum < FORSYTH_VALENCE_TABLE_SIZE) {
+				score += table.valence[remainingNum];
+			} else {
+				score += FORSYTH_VALENCE_BOOST_SCALE * powf(static_cast<float>(remainingNum), -FORSYTH_VALENCE_BOOST_POWER);
+			}
+			return score;
+		}
+
+
+		/**
+		 * FIFOの頂点キャッシュの真似
+		 * 最後に読み込んだ時刻を頂点ごとに持ち、それからcacheSize回の読み込みの間はキャッシュに残っているとみなす
+		 */
+		class FifoCache
+		{
+		private:
+			std::vector<uint32_t> timestamps_;
+			uint32_t cacheSize_;
+			uint32_t time_;
+
+		public:
+			FifoCache(uint32_t vertexNum, uint32_t cacheSize)
+				: timestamps_(vertexNum, 0)
+				, cacheSize_(cacheSize)
+				, time_(cacheSize + 1)
+			{
+			}
+
+			// キャッシュを空にする
+			void Reset()
+			{
+				time_ += cacheSize_ + 1;
+			}
+
+			// 三角形を1つ処理して、頂点の読み込み回数を返す
+			uint32_t Update(const uint32_t* triangle)
+			{
+				uint32_t missNum = 0;
+				for (int i = 0; i < 3; i++) {
+					uint32_t v = triangle[i];
+					if (time_ - timestamps_[v] > cacheSize_) {
+						timestamps_[v] = time_++;
+						missNum++;
+					}
+				}
+				return missNum;
+			}
+		};
+
+		const uint32_t OVERDRAW_CACHE_SIZE = 16;	// クラスタ分割に使うFIFOのサイズ
+		const uint32_t OVERDRAW_GRID_SIZE = 256;	// AnalyzeOverdrawの解像度
+	}
+
+	uint32_t WeldVertices(const uint8_t* vertices, uint32_t vertexNum, uint32_t vertexStride, uint32_t* remap, uint8_t* weldedVertices)
+	{
+		Assert(vertexStride > 0 && vertexStride % 4 == 0);
+		if (vertexNum == 0) {
+			return 0;
+		}
+
+		std::vector<uint32_t> hashes(vertexNum);
+		ParallelForRange(0, vertexNum, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				hashes[i] = HashVertex(vertices + static_cast<size_t>(vertexStride) * i, vertexStride);
+			}
+		});
+
+		// ハッシュの上位ビットで分割する(同じ頂点は必ず同じ分割に入る)
+		// 分割内は元の順番のままなので、最初に現れた頂点が代表になる
+		uint32_t partitionBits = (vertexNum >= WELD_PARALLEL_THRESHOLD) ? WELD_PARTITION_BITS : 0;
+		uint32_t partitionNum = 1u << partitionBits;
+		uint32_t partitionShift = 32 - partitionBits;
+		auto getPartition = [&](uint32_t hash) {
+			return (partitionBits == 0) ? 0 : (hash >> partitionShift);
+		};
+
+		std::vector<uint32_t> partitionOffsets(partitionNum + 1, 0);
+		for (uint32_t i = 0; i < vertexNum; i++) {
+			partitionOffsets[getPartition(hashes[i]) + 1]++;
+		}
+		for (uint32_t p = 0; p < partitionNum; p++) {
+			partitionOffsets[p + 1] += partitionOffsets[p];
+		}
+		std::vector<uint32_t> sorted(vertexNum);
+		{
+			std::vector<uint32_t> cursor(partitionOffsets.begin(), partitionOffsets.end() - 1);
+			for (uint32_t i = 0; i < vertexNum; i++) {
+				sorted[cursor[getPartition(hashes[i])]++] = i;
+			}
+		}
+
+		// 分割ごとにオープンアドレス法のハッシュテーブルで代表の頂点を探す
+		ParallelFor(0, partitionNum, [&](uint32_t p) {
+			uint32_t begin = partitionOffsets[p];
+			uint32_t end = partitionOffsets[p + 1];
+			if (begin == end) {
+				return;
+			}
+			uint32_t tableMask = NextPowerOfTwo((end - begin) * 2) - 1;
+			std::vector<uint32_t> table(tableMask + 1, INVALID_INDEX);
+			for (uint32_t i = begin; i < end; i++) {
+				uint32_t vertex = sorted[i];
+				const uint8_t* data = vertices + static_cast<size_t>(vertexStride) * vertex;
+				uint32_t slot = hashes[vertex] & tableMask;
+				for (;;) {
+					uint32_t candidate = table[slot];
+					if (candidate == INVALID_INDEX) {
+						table[slot] = vertex;
+						remap[vertex] = vertex;
+						break;
+					}
+					if (hashes[candidate] == hashes[vertex] &&
+						memcmp(vertices + static_cast<size_t>(vertexStride) * candidate, data, vertexStride) == 0) {
+						remap[vertex] = candidate;
+						break;
+					}
+					slot = (slot + 1) & tableMask;
+				}
+			}
+		}, 1);
+
+		// 代表は必ず自分より前にあるので、先頭から順に新しい番号を振れる
+		uint32_t weldedNum = 0;
+		for (uint32_t i = 0; i < vertexNum; i++) {
+			if (remap[i] == i) {
+				if (weldedNum != i || weldedVertices != vertices) {
+					memmove(weldedVertices + static_cast<size_t>(vertexStride) * weldedNum, vertices + static_cast<size_t>(vertexStride) * i, vertexStride);
+				}
+				remap[i] = weldedNum++;
+			} else {
+				remap[i] = remap[remap[i]];
+			}
+		}
+		return weldedNum;
+	}
+
+	void OptimizeVertexCache(uint32_t* indices, uint32_t indexCount)
+	{
+		Assert(indexCount % 3 == 0);
+		uint32_t triangleNum = indexCount / 3;
+		if (triangleNum == 0) {
+			return;
+		}
+		static const ForsythScoreTable table;
+
+		std::vector<uint32_t> localIndices;
+		uint32_t vertexNum = BuildLocalIndices(indices, indexCount, localIndices);
+
+		// 頂点ごとにまだ出力していない三角形の一覧(先頭からremainingNum個が有効)
+		std::vector<uint32_t> remainingNums(vertexNum, 0);
+		for (uint32_t v : localIndices) {
+			remainingNums[v]++;
+		}
+		std::vector<uint32_t> triangleOffsets(vertexNum + 1, 0);
+		for (uint32_t v = 0; v < vertexNum; v++) {
+			triangleOffsets[v + 1] = triangleOffsets[v] + remainingNums[v];
+		}
+		std::vector<uint32_t> vertexTriangles(indexCount);
+		{
+			std::vector<uint32_t> cursor(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (uint32_t i = 0; i < indexCount; i++) {
+				vertexTriangles[cursor[localIndices[i]]++] = i / 3;
+			}
+		}
+
+		std::vector<int32_t> cachePositions(vertexNum, -1);
+		std::vector<float> vertexScores(vertexNum);
+		for (uint32_t v = 0; v < vertexNum; v++) {
+			vertexScores[v] = ComputeVertexScore(table, -1, remainingNums[v]);
+		}
+		std::vector<float> triangleScores(triangleNum);
+		uint32_t best = 0;
+		for (uint32_t t = 0; t < triangleNum; t++) {
+			const uint32_t* triangle = &localIndices[t * 3];
+			triangleScores[t] = vertexScores[triangle[0]] + vertexScores[triangle[1]] + vertexScores[triangle[2]];
+			if (triangleScores[t] > triangleScores[best]) {
+				best = t;
+			}
+		}
+
+		std::vector<uint8_t> emitted(triangleNum, 0);
+		std::vector<uint32_t> result(indexCount);
+		uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+		uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+		uint32_t cacheNum = 0;
+		uint32_t scanCursor = 0;
+
+		for (uint32_t output = 0; output < triangleNum; output++) {
+			// キャッシュ内の頂点に残りの三角形がなければ、まだ出力していない先頭の三角形から続ける
+			if (best == INVALID_INDEX) {
+				while (emitted[scanCursor]) {
+					scanCursor++;
+				}
+				best = scanCursor;
+			}
+			emitted[best] = 1;
+			memcpy(&result[output * 3], &indices[best * 3], sizeof(uint32_t) * 3);
+			const uint32_t* triangle = &localIndices[best * 3];
+
+			// 出力した三角形を頂点の一覧から外す
+			for (int i = 0; i < 3; i++) {
+				uint32_t v = triangle[i];
+				uint32_t* begin = &vertexTriangles[triangleOffsets[v]];
+				uint32_t* end = begin + remainingNums[v];
+				uint32_t* found = std::find(begin, end, best);
+				Assert(found != end);
+				std::swap(*found, *(end - 1));
+				remainingNums[v]--;
+			}
+
+			// 三角形の頂点をLRUの先頭に入れる
+			uint32_t newCacheNum = 0;
+			for (int i = 0; i < 3; i++) {
+				if (std::find(newCache, newCache + newCacheNum, triangle[i]) == newCache + newCacheNum) {
+					newCache[newCacheNum++] = triangle[i];
+				}
+			}
+			for (uint32_t i = 0; i < cacheNum; i++) {
+				uint32_t v = cache[i];
+				if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+					newCache[newCacheNum++] = v;
+				}
+			}
+
+			// 溢れた頂点を含めて点数を更新し、キャッシュ内の頂点を使う三角形から次を選ぶ
+			for (uint32_t i = 0; i < newCacheNum; i++) {
+				uint32_t v = newCache[i];
+				cachePositions[v] = (i < FORSYTH_CACHE_SIZE) ? static_cast<int32_t>(i) : -1;
+				vertexScores[v] = ComputeVertexScore(table, cachePositions[v], remainingNums[v]);
+			}
+			best = INVALID_INDEX;
+			float bestScore = -FLT_MAX;
+			for (uint32_t i = 0; i < newCacheNum; i++) {
+				uint32_t v = newCache[i];
+				const uint32_t* triangles = &vertexTriangles[triangleOffsets[v]];
+				for (uint32_t j = 0; j < remainingNums[v]; j++) {
+					uint32_t t = triangles[j];
+					const uint32_t* tv = &localIndices[t * 3];
+					float score = vertexScores[tv[0]] + vertexScores[tv[1]] + vertexScores[tv[2]];
+					triangleScores[t] = score;
+					if (score > bestScore) {
+						bestScore = score;
+						best = t;
+					}
+				}
+			}
+
+			cacheNum = (std::min)(newCacheNum, FORSYTH_CACHE_SIZE);
+			memcpy(cache, newCache, sizeof(uint32_t) * cacheNum);
+		}
+
+		memcpy(indices, result.data(), sizeof(uint32_t) * indexCount);
+	}
+
+	void OptimizeOverdraw(uint32_t* indices, uint32_t indexCount, const uint8_t* vertices, uint32_t vertexStride, float threshold)
+	{
+		Assert(indexCount % 3 == 0);
+		uint32_t triangleNum = indexCount / 3;
+		if (triangleNum == 0) {
+			return;
+		}
+
+		std::vector<uint32_t> localIndices;
+		uint32_t vertexNum = BuildLocalIndices(indices, indexCount, localIndices);
+		FifoCache cache(vertexNum, OVERDRAW_CACHE_SIZE);
+
+		// 3頂点とも読み込みになる三角形(キャッシュが途切れる所)で分割する
+		std::vector<uint32_t> hardStarts;
+		for (uint32_t t = 0; t < triangleNum; t++) {
+			if (cache.Update(&localIndices[t * 3]) == 3) {
+				hardStarts.push_back(t);
+			}
+		}
+		hardStarts.push_back(triangleNum);
+
+		// ACMRがクラスタ全体のthreshold倍以下に収まる所でさらに分割する
+		std::vector<uint32_t> clusterStarts;
+		for (size_t c = 0; c + 1 < hardStarts.size(); c++) {
+			uint32_t begin = hardStarts[c];
+			uint32_t end = hardStarts[c + 1];
+
+			cache.Reset();
+			uint32_t clusterMissNum = 0;
+			for (uint32_t t = begin; t < end; t++) {
+				clusterMissNum += cache.Update(&localIndices[t * 3]);
+			}
+			float clusterThreshold = threshold * clusterMissNum / (end - begin);
+
+			cache.Reset();
+			clusterStarts.push_back(begin);
+			uint32_t missNum = 0;
+			uint32_t clusterTriangleNum = 0;
+			for (uint32_t t = begin; t + 1 < end; t++) {
+				missNum += cache.Update(&localIndices[t * 3]);
+				clusterTriangleNum++;
+				if (missNum <= clusterThreshold * clusterTriangleNum) {
+					clusterStarts.push_back(t + 1);
+					cache.Reset();
+					missNum = 0;
+					clusterTriangleNum = 0;
+				}
+			}
+		}
+		uint32_t clusterNum = static_cast<uint32_t>(clusterStarts.size());
+		clusterStarts.push_back(triangleNum);
+
+		// クラスタごとの面積で重み付けした法線と重心
+		std::vector<Vector3> clusterNormals(clusterNum);
+		std::vector<Vector3> clusterCentroids(clusterNum);
+		Vector3 meshCentroid(0.0f);
+		float meshArea = 0.0f;
+		for (uint32_t c = 0; c < clusterNum; c++) {
+			Vector3 normal(0.0f);
+			Vector3 centroid(0.0f);
+			float clusterArea = 0.0f;
+			for (uint32_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+				Vector3 p0 = GetPosition(vertices, vertexStride, indices[t * 3 + 0]);
+				Vector3 p1 = GetPosition(vertices, vertexStride, indices[t * 3 + 1]);
+				Vector3 p2 = GetPosition(vertices, vertexStride, indices[t * 3 + 2]);
+				Vector3 n = Vector3::Cross(p1 - p0, p2 - p0);
+				float area = n.Length();
+				normal = Vector3(normal.x + n.x, normal.y + n.y, normal.z + n.z);
+				float weight = area / 3.0f;
+				centroid = Vector3(centroid.x + (p0.x + p1.x + p2.x) * weight, centroid.y + (p0.y + p1.y + p2.y) * weight, centroid.z + (p0.z + p1.z + p2.z) * weight);
+				clusterArea += area;
+			}
+			normal.Normalize();
+			clusterNormals[c] = normal;
+			clusterCentroids[c] = (clusterArea > 0.0f) ? centroid * (1.0f / clusterArea) : centroid;
+			meshCentroid = Vector3(meshCentroid.x + centroid.x, meshCentroid.y + centroid.y, meshCentroid.z + centroid.z);
+			meshArea += clusterArea;
+		}
+		if (meshArea > 0.0f) {
+			meshCentroid *= 1.0f / meshArea;
+		}
+
+		// 外側を向いているクラスタほど手前にあることが多いので先に描く
+		std::vector<float> sortKeys(clusterNum);
+		std::vector<uint32_t> order(clusterNum);
+		for (uint32_t c = 0; c < clusterNum; c++) {
+			sortKeys[c] = Vector3::Dot(clusterCentroids[c] - meshCentroid, clusterNormals[c]);
+			order[c] = c;
+		}
+		std::stable_sort(order.begin(), order.end(), [&sortKeys](uint32_t a, uint32_t b) {
+			return sortKeys[a] > sortKeys[b];
+		});
+
+		std::vector<uint32_t> result;
+		result.reserve(indexCount);
+		for (uint32_t c : order) {
+			result.insert(result.end(), indices + clusterStarts[c] * 3, indices + clusterStarts[c + 1] * 3);
+		}
+		memcpy(indices, result.data(), sizeof(uint32_t) * indexCount);
+	}
+
+	uint32_t OptimizeVertexFetch(uint32_t* indices, uint32_t indexCount, const uint8_t* vertices, uint32_t vertexNum, uint32_t vertexStride, uint8_t* outVertices)
+	{
+		Assert(vertices != outVertices);
+		std::vector<uint32_t> remap(vertexNum, INVALID_INDEX);
+		uint32_t usedNum = 0;
+		for (uint32_t i = 0; i < indexCount; i++) {
+			uint32_t v = indices[i];
+			if (remap[v] == INVALID_INDEX) {
+				memcpy(outVertices + static_cast<size_t>(vertexStride) * usedNum, vertices + static_cast<size_t>(vertexStride) * v, vertexStride);
+				remap[v] = usedNum++;
+			}
+			indices[i] = remap[v];
+		}
+		return usedNum;
+	}
+
+	void SplitIndexRange(uint32_t* indices, uint32_t indexStart, uint32_t indexCount, uint32_t maxVertexNum, std::vector<uint32_t>& sourceVertices, std::vector<IndexRange>& ranges)
+	{
+		Assert(indexCount % 3 == 0 && maxVertexNum >= 3);
+		uint32_t end = indexStart + indexCount;
+		if (indexCount == 0) {
+			return;
+		}
+
+		// 区間内の番号は範囲内の頂点だけで引く(rangeOfが現在の区間でなければ未登録)
+		uint32_t minIndex = INVALID_INDEX;
+		uint32_t maxIndex = 0;
+		for (uint32_t i = indexStart; i < end; i++) {
+			minIndex = (std::min)(minIndex, indices[i]);
+			maxIndex = (std::max)(maxIndex, indices[i]);
+		}
+		std::vector<uint32_t> rangeOf(maxIndex - minIndex + 1, INVALID_INDEX);
+		std::vector<uint32_t> localOf(maxIndex - minIndex + 1);
+
+		uint32_t rangeId = 0;
+		IndexRange range = { indexStart, 0, static_cast<uint32_t>(sourceVertices.size()) };
+		uint32_t localNum = 0;
+		for (uint32_t i = indexStart; i < end; i += 3) {
+			// 収まらなければ区間を閉じる
+			uint32_t newNum = 0;
+			for (uint32_t k = 0; k < 3; k++) {
+				uint32_t v = indices[i + k] - minIndex;
+				bool duplicated = (k >= 1 && indices[i + k] == indices[i]) || (k == 2 && indices[i + 2] == indices[i + 1]);
+				newNum += (rangeOf[v] != rangeId && !duplicated) ? 1 : 0;
+			}
+			if (localNum + newNum > maxVertexNum) {
+				range.indexCount = i - range.indexStart;
+				ranges.push_back(range);
+				rangeId++;
+				range.indexStart = i;
+				range.vertexStart = static_cast<uint32_t>(sourceVertices.size());
+				localNum = 0;
+			}
+
+			for (uint32_t k = 0; k < 3; k++) {
+				uint32_t v = indices[i + k] - minIndex;
+				if (rangeOf[v] != rangeId) {
+					rangeOf[v] = rangeId;
+					localOf[v] = localNum++;
+					sourceVertices.push_back(indices[i + k]);
+				}
+				indices[i + k] = localOf[v];
+			}
+		}
+		range.indexCount = end - range.indexStart;
+		ranges.push_back(range);
+	}
+
+	VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, uint32_t indexCount, uint32_t vertexNum, uint32_t cacheSize)
+	{
+		VertexCacheStats stats = {};
+		stats.triangleNum = indexCount / 3;
+
+		FifoCache cache(vertexNum, cacheSize);
+		std::vector<uint8_t> used(vertexNum, 0);
+		for (uint32_t t = 0; t < stats.triangleNum; t++) {
+			stats.transformedNum += cache.Update(&indices[t * 3]);
+			for (int i = 0; i < 3; i++) {
+				uint32_t v = indices[t * 3 + i];
+				stats.vertexNum += used[v] ? 0 : 1;
+				used[v] = 1;
+			}
+		}
+		stats.acmr = (stats.triangleNum > 0) ? static_cast<float>(stats.transformedNum) / stats.triangleNum : 0.0f;
+		stats.atvr = (stats.vertexNum > 0) ? static_cast<float>(stats.transformedNum) / stats.vertexNum : 0.0f;
+		return stats;
+	}
+
+	OverdrawStats AnalyzeOverdraw(const uint32_t* indices, uint32_t indexCount, const uint8_t* vertices, uint32_t vertexNum, uint32_t vertexStride)
+	{
+		OverdrawStats stats = {};
+
+		// 一番長い辺がグリッドに収まるように拡大する
+		float3 minPos(FLT_MAX, FLT_MAX, FLT_MAX);
+		float3 maxPos(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (uint32_t i = 0; i < indexCount; i++) {
+			// 範囲外の頂点は読まずに打ち切る
+			if (indices[i] >= vertexNum) {
+				Assert(false);
+				return stats;
+			}
+			float3 p = GetPosition(vertices, vertexStride, indices[i]);
+			minPos = float3((std::min)(minPos.x, p.x), (std::min)(minPos.y, p.y), (std::min)(minPos.z, p.z));
+			maxPos = float3((std::max)(maxPos.x, p.x), (std::max)(maxPos.y, p.y), (std::max)(maxPos.z, p.z));
+		}
+		float extent = (std::max)((std::max)(maxPos.x - minPos.x, maxPos.y - minPos.y), maxPos.z - minPos.z);
+		if (indexCount < 3 || extent <= 0.0f) {
+			return stats;
+		}
+		float scale = (OVERDRAW_GRID_SIZE - 1) / extent;
+
+		std::vector<float> depthBuffer(OVERDRAW_GRID_SIZE * OVERDRAW_GRID_SIZE);
+		for (int axis = 0; axis < 3; axis++) {
+			int axisU = (axis + 1) % 3;
+			int axisV = (axis + 2) % 3;
+			for (float direction = -1.0f; direction <= 1.0f; direction += 2.0f) {
+				std::fill(depthBuffer.begin(), depthBuffer.end(), FLT_MAX);
+
+				for (uint32_t t = 0; t < indexCount / 3; t++) {
+					float3 p[3];
+					for (int i = 0; i < 3; i++) {
+						p[i] = GetPosition(vertices, vertexStride, indices[t * 3 + i]);
+					}
+
+					// directionの向きに見た時の裏面(反時計回りが表)は描かない
+					Vector3 normal = Vector3::Cross(p[1] - p[0], p[2] - p[0]);
+					if ((&normal.x)[axis] * direction >= 0.0f) {
+						continue;
+					}
+
+					float x[3], y[3], z[3];
+					for (int i = 0; i < 3; i++) {
+						x[i] = ((&p[i].x)[axisU] - (&minPos.x)[axisU]) * scale;
+						y[i] = ((&p[i].x)[axisV] - (&minPos.x)[axisV]) * scale;
+						z[i] = (&p[i].x)[axis] * direction;
+					}
+					float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+					if (area == 0.0f) {
+						continue;
+					}
+					if (area < 0.0f) {
+						std::swap(x[1], x[2]);
+						std::swap(y[1], y[2]);
+						std::swap(z[1], z[2]);
+						area = -area;
+					}
+
+					// ピクセル中心が三角形の内側にあれば描く
+					int minX = (std::max)(static_cast<int>((std::min)((std::min)(x[0], x[1]), x[2])), 0);
+					int maxX = (std::min)(static_cast<int>((std::max)((std::max)(x[0], x[1]), x[2])), static_cast<int>(OVERDRAW_GRID_SIZE) - 1);
+					int minY = (std::max)(static_cast<int>((std::min)((std::min)(y[0], y[1]), y[2])), 0);
+					int maxY = (std::min)(static_cast<int>((std::max)((std::max)(y[0], y[1]), y[2])), static_cast<int>(OVERDRAW_GRID_SIZE) - 1);
+					for (int py = minY; py <= maxY; py++) {
+						float cy = py + 0.5f;
+						for (int px = minX; px <= maxX; px++) {
+							float cx = px + 0.5f;
+							float w0 = (x[2] - x[1]) * (cy - y[1]) - (y[2] - y[1]) * (cx - x[1]);
+							float w1 = (x[0] - x[2]) * (cy - y[2]) - (y[0] - y[2]) * (cx - x[2]);
+							float w2 = (x[1] - x[0]) * (cy - y[0]) - (y[1] - y[0]) * (cx - x[0]);
+							if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) {
+								continue;
+							}
+							float depth = (w0 * z[0] + w1 * z[1] + w2 * z[2]) / area;
+							float& stored = depthBuffer[py * OVERDRAW_GRID_SIZE + px];
+							if (depth < stored) {
+								stored = depth;
+								stats.shadedPixelNum++;
+							}
+						}
+					}
+				}
+
+				for (float depth : depthBuffer) {
+					stats.coveredPixelNum += (depth != FLT_MAX) ? 1 : 0;
+				}
+			}
+		}
+		stats.overdraw = (stats.coveredPixelNum > 0) ? static_cast<float>(stats.shadedPixelNum) / stats.coveredPixelNum : 0.0f;
+		return stats;
+	}
+}
+}
@@ -0,0 +1,83 @@
+﻿#pragma once
+
+#include "se/Common.h"
+#include <vector>
+
+namespace se
+{
+	/**
+	 * メッシュのキャッシュ生成時に使う最適化処理
+	 * 頂点は任意の構造のバイト列として扱う(vertexStrideは4の倍数)
+	 */
+	namespace meshopt
+	{
+		/**
+		 * 頂点の溶接
+		 * 全バイトが一致する頂点を1つにまとめ、remap[i]に元の頂点iの新しい番号を入れる
+		 * 新しい番号は最初に現れた順に振り、まとめた頂点をweldedVerticesに詰めて新しい頂点数を返す
+		 * インデックス展開した頂点列なら、remapがそのままインデックスバッファになる
+		 * weldedVerticesはverticesと同じでもよい、頂点数が多ければハッシュの上位ビットで分割して並列に処理する
+		 */
+		uint32_t WeldVertices(const uint8_t* vertices, uint32_t vertexNum, uint32_t vertexStride, uint32_t* remap, uint8_t* weldedVertices);
+
+		/**
+		 * 頂点キャッシュ向けの三角形の並べ替え(Forsythの方法)
+		 * indicesの範囲内だけで並べ替えるので、シェイプごとに呼べる
+		 */
+		void OptimizeVertexCache(uint32_t* indices, uint32_t indexCount);
+
+		/**
+		 * オーバードロー向けの三角形の並べ替え(Tipsifyのクラスタ分割)
+		 * OptimizeVertexCacheの結果をキャッシュが途切れる所で分割し、外側を向いたクラスタから描くように並べる
+		 * thresholdはクラスタを細かくする際に許すACMRの悪化の割合(1.05なら5%)
+		 * 位置は各頂点の先頭のfloat3を使う
+		 */
+		void OptimizeOverdraw(uint32_t* indices, uint32_t indexCount, const uint8_t* vertices, uint32_t vertexStride, float threshold = 1.05f);
+
+		/**
+		 * 頂点フェッチ向けの頂点の並べ替え
+		 * indicesで最初に参照された順に頂点を並べてoutVerticesに書き、indicesを書き換える
+		 * 参照されない頂点は捨て、新しい頂点数を返す(outVerticesはverticesと別の領域であること)
+		 */
+		uint32_t OptimizeVertexFetch(uint32_t* indices, uint32_t indexCount, const uint8_t* vertices, uint32_t vertexNum, uint32_t vertexStride, uint8_t* outVertices);
+
+		struct IndexRange
+		{
+			uint32_t indexStart;
+			uint32_t indexCount;
+			uint32_t vertexStart;	// 区間の頂点の先頭(インデックスはここからの番号)
+		};
+
+		/**
+		 * 小さいインデックス型に収めるための分割
+		 * indices[indexStart, indexStart + indexCount)を三角形単位で先頭から区切り、各区間で参照する頂点がmaxVertexNum個以下になるようにrangesに追加する
+		 * 区間ごとに参照順で元の頂点番号をsourceVerticesの末尾に追加し(区間をまたいで使われる頂点は複製する)、
+		 * indicesを区間の先頭からの番号に書き換える、呼び出し側はsourceVerticesの順に頂点を集めて新しい頂点バッファを作る
+		 * 頂点番号の幅によらず必ず分割できる(maxVertexNumは3以上)
+		 */
+		void SplitIndexRange(uint32_t* indices, uint32_t indexStart, uint32_t indexCount, uint32_t maxVertexNum, std::vector<uint32_t>& sourceVertices, std::vector<IndexRange>& ranges);
+
+
+		struct VertexCacheStats
+		{
+			uint32_t triangleNum;
+			uint32_t vertexNum;			// 参照された頂点数
+			uint32_t transformedNum;	// 頂点シェーダーの実行回数
+			float acmr;					// 三角形あたりの実行回数(最良で0.5程度、最悪で3)
+			float atvr;					// 頂点あたりの実行回数(最良で1)
+		};
+
+		struct OverdrawStats
+		{
+			uint32_t coveredPixelNum;
+			uint32_t shadedPixelNum;
+			float overdraw;				// 描画されたピクセルあたりのシェーディング回数(最良で1)
+		};
+
+		// サイズcacheSizeのFIFOの頂点キャッシュを真似て数える
+		VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, uint32_t indexCount, uint32_t vertexNum, uint32_t cacheSize = 16);
+		// 軸に沿った6方向から平行投影でラスタライズして数える(裏面は除く、深度テストはLESSで描画順に行う)
+		// vertexNum以上のインデックスがあれば何も数えずに返す
+		OverdrawStats AnalyzeOverdraw(const uint32_t* indices, uint32_t indexCount, const uint8_t* vertices, uint32_t vertexNum, uint32_t vertexStride);
+	}
+}
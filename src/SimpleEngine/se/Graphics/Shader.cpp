@@ -1,7 +1,8 @@
 ﻿#include "se/Graphics/Shader.h"
 #include "se/Graphics/GraphicsCore.h"
+#include "se/async/IOService.h"
+#include "se/Memory/MemoryTracker.h"
 #include "thirdparty/picojson/picojson.h"
-#include <fstream>
 
 namespace se
 {
@@ -78,6 +79,14 @@ namespace se
 
 			COMPTR_RELEASE(pErrorBlob);
 		}
+
+		// 定義ファイル(json)の読み込み結果をパース
+		void ParseDefinitionFile(const Task<std::vector<uint8_t>>& file, picojson::value* json)
+		{
+			const auto& data = file.Get();
+			const char* begin = reinterpret_cast<const char*>(data.data());
+			picojson::parse(*json, begin, begin + data.size(), nullptr);
+		}
 	}
 
 
@@ -314,13 +323,15 @@ namespace se
 
 	VertexShader::~VertexShader()
 	{
-		COMPTR_RELEASE(shader_);
-		COMPTR_RELEASE(blob_);
+		Destroy();
 	}
 
 	void VertexShader::Destroy()
 	{
 		COMPTR_RELEASE(shader_);
+		if (blob_) {
+			MemoryTracker::Get().OnFree(MemoryTag::Shader, blob_->GetBufferSize());
+		}
 		COMPTR_RELEASE(blob_);
 	}
 
@@ -343,6 +354,7 @@ namespace se
 	void VertexShader::CompileFromFile(const char* fileName, const char* entryPoint, ShaderReflection* reflection)
 	{
 		CompileShaderFromFile(fileName, entryPoint, "vs_5_0", &blob_);
+		MemoryTracker::Get().OnAllocate(MemoryTag::Shader, blob_->GetBufferSize());	// 入力レイアウト作成用に保持する
 		HRESULT hr = GraphicsCore::GetDevice()->CreateVertexShader(blob_->GetBufferPointer(), blob_->GetBufferSize(), nullptr, &shader_);
 		THROW_IF_FAILED(hr);
 		data_ = blob_->GetBufferPointer();
@@ -360,6 +372,7 @@ namespace se
 	void VertexShader::CompileFromString(const char* source, int length, const char* entryPoint, ShaderReflection* reflection)
 	{
 		CompileShaderFromString(source, length, entryPoint, "vs_5_0", &blob_);
+		MemoryTracker::Get().OnAllocate(MemoryTag::Shader, blob_->GetBufferSize());	// 入力レイアウト作成用に保持する
 		HRESULT hr = GraphicsCore::GetDevice()->CreateVertexShader(blob_->GetBufferPointer(), blob_->GetBufferSize(), nullptr, &shader_);
 		THROW_IF_FAILED(hr);
 		data_ = blob_->GetBufferPointer();
@@ -495,15 +508,18 @@ namespace se
 
 	void ShaderManager::Initialize(const char* directoryPath)
 	{
+		ScopedLock<ReadWriteLock> lock(lock_);
+
+		// 定義ファイルは両方とも先に読み込みを発行しておく
+		std::string directory = directoryPath;
+		directory += "\\";
+		auto shaderDefinition = ReadFileAsync((directory + "shaders.json").c_str(), IOPriority::High);
+		auto computeDefinition = ReadFileAsync((directory + "compute_shaders.json").c_str(), IOPriority::High);
+
 		try {
 			// シェーダ定義ファイル読み込み
-			std::string directory = directoryPath;
-			directory += "\\";
-			std::string definisionFile = directory + "shaders.json";
 			picojson::value json;
-			std::ifstream stream(definisionFile);
-			stream >> json;
-			stream.close();
+			ParseDefinitionFile(shaderDefinition, &json);
 			picojson::array& defines = json.get<picojson::array>();
 
 			// シェーダコンパイル
@@ -535,13 +551,8 @@ namespace se
 
 		try {
 			// コンピュートシェーダ定義ファイル読み込み
-			std::string directory = directoryPath;
-			directory += "\\";
-			std::string definisionFile = directory + "compute_shaders.json";
 			picojson::value json;
-			std::ifstream stream(definisionFile);
-			stream >> json;
-			stream.close();
+			ParseDefinitionFile(computeDefinition, &json);
 			picojson::array& defines = json.get<picojson::array>();
 
 			// シェーダコンパイル
@@ -570,21 +581,21 @@ namespace se
 
 	void ShaderManager::Finalize()
 	{
+		ScopedLock<ReadWriteLock> lock(lock_);
 		shaderMap_.clear();
 		csMap_.clear();
 	}
 
 	void ShaderManager::Reload()
 	{
+		ScopedLock<ReadWriteLock> lock(lock_);
+
 		try {
 			// シェーダ定義ファイル読み込み
 			std::string directory = directoryPath_;
 			directory += "\\";
-			std::string definisionFile = directory + "shaders.json";
 			picojson::value json;
-			std::ifstream stream(definisionFile);
-			stream >> json;
-			stream.close();
+			ParseDefinitionFile(ReadFileAsync((directory + "shaders.json").c_str(), IOPriority::High), &json);
 			picojson::array& defines = json.get<picojson::array>();
 
 			// シェーダコンパイル
@@ -597,7 +608,7 @@ namespace se
 				std::string ps = obj["PSEntry"].get<std::string>();
 
 				size_t shaderHash = hasher(name);
-				ShaderSet* shader = Find(shaderHash);
+				ShaderSet* shader = FindLocked(shaderHash);
 				if (shader) {
 					// 元のシェーダを破棄
 					shader->vs_.Destroy();
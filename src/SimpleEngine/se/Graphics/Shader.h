@@ -3,6 +3,7 @@
 #include "se/Common.h"
 #include "se/Graphics/GraphicsCommon.h"
 #include "se/Graphics/GraphicsContext.h"
+#include "se/async/Threading.h"
 #include <unordered_map>
 
 namespace se
@@ -196,6 +197,14 @@ namespace se
 		std::string directoryPath_;
 		std::unordered_map<size_t, ShaderSet> shaderMap_;
 		std::unordered_map<size_t, ComputeShader> csMap_;
+		ReadWriteLock lock_;	// 検索は並行、初期化・リロードは排他
+
+	private:
+		ShaderSet* FindLocked(size_t hash)
+		{
+			auto iter = shaderMap_.find(hash);
+			return (iter != shaderMap_.end()) ? &iter->second : nullptr;
+		}
 
 	public:
 		void Initialize(const char* directoryPath);
@@ -209,8 +218,8 @@ namespace se
 		}
 		ShaderSet* Find(size_t hash)
 		{
-			auto& iter = shaderMap_.find(hash);
-			return (iter != shaderMap_.end()) ? &iter->second : nullptr;
+			ScopedReadLock<ReadWriteLock> lock(lock_);
+			return FindLocked(hash);
 		}
 		ComputeShader* FindCompute(const char* name)
 		{
@@ -219,7 +228,8 @@ namespace se
 		}
 		ComputeShader* FindCompute(size_t hash)
 		{
-			auto& iter = csMap_.find(hash);
+			ScopedReadLock<ReadWriteLock> lock(lock_);
+			auto iter = csMap_.find(hash);
 			return (iter != csMap_.end()) ? &iter->second : nullptr;
 		}
 	};
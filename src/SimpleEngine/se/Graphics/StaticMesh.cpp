@@ -1,4 +1,8 @@
 ﻿#include "se/Graphics/StaticMesh.h"
+#include "se/Graphics/MeshOptimizer.h"
+#include "se/async/Parallel.h"
+#include "se/async/IOService.h"
+#include "se/Memory/MemoryTracker.h"
 #include <fstream>
 
 #define TINYOBJLOADER_IMPLEMENTATION
@@ -7,17 +11,32 @@
 namespace se 
 {
 	namespace {
+		const uint32_t CACHE_MAGIC = 0x4D534553;	// "SESM"
+		const uint32_t CACHE_VERSION = 4;		// 形式を変えたら上げる(古いキャッシュはobjから作り直す)
+
 		struct CacheHeader
 		{
+			uint32_t magic;
+			uint32_t version;
 			uint16_t shapeNum;
 			uint16_t materialNum;
 			uint16_t vertexAttrs;
+			uint16_t indexStride;		// IndexBufferStride
 			uint32_t vertexNum;
+			uint32_t indexNum;
 			uint32_t offsetToShapes;
 			uint32_t offsetToVertices;
 			uint32_t offsetToIndeces;
 			uint32_t offsetToMaterial;
 		};
+
+		const uint32_t MATERIAL_NAME_SIZE = 256;
+
+		// [offset, offset + size)がキャッシュに収まるか
+		bool IsInCache(uint32_t offset, uint64_t size, size_t cacheSize)
+		{
+			return static_cast<uint64_t>(offset) + size <= cacheSize;
+		}
 	}
 
 	StaticMesh::StaticMesh()
@@ -26,224 +45,423 @@ namespace se
 
 	StaticMesh::~StaticMesh()
 	{
-		for (auto& m : materials_) {
-			delete m.albedo;
+		// 読み込み中の継続がthisを参照しているので完了を待つ
+		loading_.Wait();
+		auto& textureManager = TextureManager::Get();
+		for (auto t : textures_) {
+			textureManager.Release(t);
 		}
 	}
 
-	void StaticMesh::Create(const char* fileName)
+	Task<void> StaticMesh::LoadMaterialsAsync(const std::string& baseDir, const std::vector<std::string>& albedoNames)
+	{
+		// 重複を除いたテクスチャ一覧を作成
+		std::unordered_map<std::string, uint32_t> textureMap;
+		std::vector<const std::string*> uniqueNames;
+		std::vector<uint32_t> materialTextures(albedoNames.size(), 0xffffffff);
+		for (size_t i = 0; i < albedoNames.size(); i++) {
+			const auto& name = albedoNames[i];
+			if (name.empty()) {
+				continue;
+			}
+			auto iter = textureMap.find(name);
+			if (iter == textureMap.end()) {
+				iter = textureMap.emplace(name, static_cast<uint32_t>(uniqueNames.size())).first;
+				uniqueNames.push_back(&name);
+			}
+			materialTextures[i] = iter->second;
+		}
+
+		// テクスチャ読み込み(他のメッシュが読み込んだものは共有される)
+		textures_.resize(uniqueNames.size());
+		std::vector<Task<void>> textureTasks(uniqueNames.size());
+		for (size_t i = 0; i < uniqueNames.size(); i++) {
+			char path[256];
+			snprintf(path, sizeof(path), "%s%s", baseDir.c_str(), uniqueNames[i]->c_str());
+			textures_[i] = TextureManager::Get().Load(path, &textureTasks[i]);
+		}
+
+		// 全テクスチャの読み込み後にマテリアルを設定
+		return WhenAll(textureTasks).Then([this, materialTextures]() {
+			materials_.resize(materialTextures.size());
+			for (size_t i = 0; i < materials_.size(); i++) {
+				materials_[i].albedo = TextureHandle();
+				if (materialTextures[i] != 0xffffffff && TextureManager::Get().GetTexture(textures_[materialTextures[i]])) {
+					materials_[i].albedo = textures_[materialTextures[i]];
+				}
+			}
+		}, TaskExecution::Inline);
+	}
+
+	void StaticMesh::ComputeBounds(const uint8_t* vertices, uint32_t vertexStride, const void* indices, IndexBufferStride indexStride)
+	{
+		// 位置は頂点の先頭にある
+		bounds_ = AABB::Empty();
+		shapeBounds_.resize(shapes_.size());
+		for (size_t i = 0; i < shapes_.size(); i++) {
+			const Shape& shape = shapes_[i];
+			AABB box = AABB::Empty();
+			for (uint32_t j = 0; j < shape.indexCount; j++) {
+				uint32_t index = (indexStride == INDEX_BUFFER_STRIDE_U16)
+					? static_cast<const uint16_t*>(indices)[shape.indexStart + j]
+					: static_cast<const uint32_t*>(indices)[shape.indexStart + j];
+				float3 position;
+				memcpy(&position, vertices + vertexStride * (shape.vertexStart + index), sizeof(position));
+				box.Merge(position);
+			}
+			shapeBounds_[i] = box;
+			bounds_.Merge(box);
+		}
+	}
+
+	bool StaticMesh::CreateFromCache(const std::vector<uint8_t>& cacheData, std::vector<std::string>* albedoNames)
+	{
+		if (cacheData.size() < sizeof(CacheHeader)) {
+			return false;
+		}
+
+		// パース
+		const CacheHeader* header = (const CacheHeader*)cacheData.data();
+		if (header->magic != CACHE_MAGIC || header->version != CACHE_VERSION) {
+			return false;
+		}
+		if (header->indexStride != INDEX_BUFFER_STRIDE_U16 && header->indexStride != INDEX_BUFFER_STRIDE_U32) {
+			return false;
+		}
+		uint32_t vtxStride = ComputeVertexStride(header->vertexAttrs);
+		IndexBufferStride indexStride = static_cast<IndexBufferStride>(header->indexStride);
+		uint32_t indexSize = (indexStride == INDEX_BUFFER_STRIDE_U16) ? sizeof(uint16_t) : sizeof(uint32_t);
+		if (vtxStride < sizeof(float3) || header->vertexNum == 0 || header->indexNum == 0) {
+			return false;
+		}
+
+		// 各領域がキャッシュに収まるか
+		size_t cacheSize = cacheData.size();
+		if (!IsInCache(header->offsetToShapes, static_cast<uint64_t>(sizeof(Shape)) * header->shapeNum, cacheSize) ||
+			!IsInCache(header->offsetToVertices, static_cast<uint64_t>(vtxStride) * header->vertexNum, cacheSize) ||
+			!IsInCache(header->offsetToIndeces, static_cast<uint64_t>(indexSize) * header->indexNum, cacheSize) ||
+			!IsInCache(header->offsetToMaterial, static_cast<uint64_t>(MATERIAL_NAME_SIZE) * header->materialNum, cacheSize)) {
+			return false;
+		}
+
+		// 各シェイプのインデックスと、それが指す頂点が範囲内か(失敗時はobjから作り直すのでメンバは変えない)
+		std::vector<Shape> shapes(header->shapeNum);
+		if (!shapes.empty()) {
+			memcpy(&shapes[0], cacheData.data() + header->offsetToShapes, sizeof(Shape) * shapes.size());
+		}
+		const uint8_t* indices = cacheData.data() + header->offsetToIndeces;
+		for (const auto& shape : shapes) {
+			if (static_cast<uint64_t>(shape.indexStart) + shape.indexCount > header->indexNum) {
+				return false;
+			}
+			uint32_t maxIndex = 0;
+			for (uint32_t j = 0; j < shape.indexCount; j++) {
+				uint32_t index;
+				if (indexStride == INDEX_BUFFER_STRIDE_U16) {
+					uint16_t index16;
+					memcpy(&index16, indices + sizeof(uint16_t) * (shape.indexStart + j), sizeof(index16));
+					index = index16;
+				} else {
+					memcpy(&index, indices + sizeof(uint32_t) * (shape.indexStart + j), sizeof(index));
+				}
+				maxIndex = Max(maxIndex, index);
+			}
+			if (shape.indexCount > 0 && static_cast<uint64_t>(shape.vertexStart) + maxIndex >= header->vertexNum) {
+				return false;
+			}
+		}
+		shapes_ = std::move(shapes);
+
+		vertexBuffer_.Create(cacheData.data() + header->offsetToVertices, vtxStride * header->vertexNum, header->vertexAttrs);
+		indexBuffer_.Create(cacheData.data() + header->offsetToIndeces, indexSize * header->indexNum, indexStride);
+		ComputeBounds(cacheData.data() + header->offsetToVertices, vtxStride, cacheData.data() + header->offsetToIndeces, indexStride);
+
+		const char* materials = (const char*)(cacheData.data() + header->offsetToMaterial);
+		albedoNames->resize(header->materialNum);
+		for (size_t i = 0; i < albedoNames->size(); i++) {
+			// 終端がなくても領域内で止める
+			const char* name = materials + (MATERIAL_NAME_SIZE * i);
+			(*albedoNames)[i].assign(name, strnlen(name, MATERIAL_NAME_SIZE));
+		}
+		return true;
+	}
+
+	bool StaticMesh::CreateFromObj(const char* fileName, const char* baseDir, const char* cachePath, std::vector<std::string>* albedoNames)
 	{
-		char baseDir[256];
-		char fileNameWoExt[256];
 		char tempPath[256];
-		_splitpath_s(fileName, nullptr, 0, baseDir, sizeof(baseDir), fileNameWoExt, sizeof(baseDir), nullptr, 0);
 
-		// キャッシュファイル名
-		snprintf(tempPath, sizeof(tempPath), "%s%s.cache", baseDir, fileNameWoExt);
-		std::ifstream cacheFile(tempPath, std::ios::in | std::ios::binary);
-		if (cacheFile) {
-			/** キャッシュから読み込み **/
-
-			// ファイル全体をリード
-			cacheFile.seekg(0, std::fstream::end);
-			uint32_t eofPos = (uint32_t)cacheFile.tellg();
-			cacheFile.clear();
-			cacheFile.seekg(0, std::fstream::beg);
-			uint32_t begPos = (uint32_t)cacheFile.tellg();
-			uint32_t size = eofPos - begPos;
-			std::unique_ptr<uint8_t> cacheData(new uint8_t[size]);
-			cacheFile.read((char*)cacheData.get(), size);
-
-			// パース
-			const CacheHeader* header = (CacheHeader*)cacheData.get();
-			const Shape* shapes = (Shape*)(cacheData.get() + header->offsetToShapes);
-			shapes_.resize(header->shapeNum);
-			memcpy(&shapes_[0], shapes, sizeof(Shape) * header->shapeNum);
-
-			uint32_t vtxStride = ComputeVertexStride(header->vertexAttrs);
-			vertexBuffer_.Create(cacheData.get() + header->offsetToVertices, vtxStride * header->vertexNum, header->vertexAttrs);
-			indexBuffer_.Create(cacheData.get() + header->offsetToIndeces, sizeof(uint32_t) * header->vertexNum, INDEX_BUFFER_STRIDE_U32);
-
-			const char* materials = (const char*)(cacheData.get() + header->offsetToMaterial);
-			materials_.resize(header->materialNum);
-			std::unordered_map<std::string, uint32_t> textureMap;
-			for (size_t i = 0; i < (uint32_t)materials_.size(); i++) {
-				const char* m = materials + (256 * i);
-				ZeroMemory(&materials_[i], sizeof(materials_[i]));
-
-				// テクスチャ検索
-				if (strlen(m) > 0) {
-					Texture* texture = nullptr;
-					auto iter = textureMap.find(m);
-					if (iter != textureMap.end()) {
-						texture = textures_[iter->second];
-					} else {
-						texture = new Texture();
-						snprintf(tempPath, sizeof(tempPath), "%s%s", baseDir, m);
-						texture->LoadFromFile(tempPath);
-						textures_.push_back(texture);
-						uint32_t index = (uint32_t)textures_.size() - 1;
-						textureMap[m] = index;
+		tinyobj::attrib_t attrib;
+		std::vector<tinyobj::shape_t> shapes;
+		std::vector<tinyobj::material_t> materials;
+
+		Printf("Loading %s\n", fileName);
+		std::string err;
+		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, fileName, baseDir, true)) {
+			if (!err.empty()) {
+				Printf(err.c_str());
+			}
+			Printf("Failed to load/parse .obj.\n");
+			return false;
+		}
+		//Printf("# of vertices  : %d\n", (attrib.vertices.size() / 3));
+		//Printf("# of normals   : %d\n", (attrib.normals.size() / 3));
+		//Printf("# of texcoords : %d\n", (attrib.texcoords.size() / 2));
+		//Printf("# of shapes    : %d\n", shapes.size());
+		//Printf("# of materials : %d\n", materials.size());
+
+		// 現状はすべてのシェイプで頂点構造が一致している前提で処理しているため1つの頂点バッファにすべて入っている
+		// TODO:tangent, bitangent計算
+		uint32_t vtxAttrs = VERTEX_ATTR_FLAG_POSITION;
+		vtxAttrs |= (attrib.normals.size() > 0) ? VERTEX_ATTR_FLAG_NORMAL : 0;
+		vtxAttrs |= (attrib.texcoords.size() > 0) ? VERTEX_ATTR_FLAG_TEXCOORD0 : 0;
+		uint32_t vtxStride = ComputeVertexStride(vtxAttrs);
+
+		// 全インデックス数と各シェイプの先頭面番号を計算
+		uint32_t totalIndexNum = 0;
+		uint32_t totalFaceNum = 0;
+		std::vector<uint32_t> faceOffsets(shapes.size() + 1);
+		for (uint32_t i = 0; i < shapes.size(); i++) {
+			faceOffsets[i] = totalFaceNum;
+			totalFaceNum += static_cast<uint32_t>(shapes[i].mesh.num_face_vertices.size());
+			totalIndexNum += static_cast<uint32_t>(shapes[i].mesh.indices.size());
+		}
+		faceOffsets[shapes.size()] = totalFaceNum;
+		Assert(totalFaceNum * 3 == totalIndexNum);
 
+		// マテリアルの切り替わりでシェイプを分割
+		// 再読み込みやキャッシュの検証に失敗した後でも前の範囲が残らないよう、空にしてから詰める
+		shapes_.clear();
+		for (uint32_t i = 0; i < shapes.size(); i++) {
+			auto& shape = shapes[i];
+			Assert(shape.mesh.num_face_vertices.size() == shape.mesh.material_ids.size());
+			if (shape.mesh.num_face_vertices.empty()) {
+				continue;
+			}
+
+			uint32_t currentMaterial = 0xffffffff;
+			Shape currentShape;
+			for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
+				uint32_t currentIndex = (faceOffsets[i] + static_cast<uint32_t>(f)) * 3;
+				if (currentMaterial != shape.mesh.material_ids[f]) {
+					if (currentMaterial != 0xffffffff) {
+						currentShape.indexCount = currentIndex - currentShape.indexStart;
+						shapes_.push_back(currentShape);
 					}
-					materials_[i].albedo = texture;
+					currentMaterial = shape.mesh.material_ids[f];
+					currentShape.materialIndex = currentMaterial;
+					currentShape.indexStart = currentIndex;
+					currentShape.indexCount = 0;
+					currentShape.vertexStart = 0;
 				}
 			}
-		} else {
-			/** キャッシュがなかったらobjを読み込み **/
-			tinyobj::attrib_t attrib;
-			std::vector<tinyobj::shape_t> shapes;
-			std::vector<tinyobj::material_t> materials;
-
-			Printf("Loading %s\n", fileName);
-			std::string err;
-			if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, fileName, baseDir, true)) {
-				if (!err.empty()) {
-					Printf(err.c_str());
+
+			// 最後のマテリアル分追加
+			currentShape.indexCount = faceOffsets[i + 1] * 3 - currentShape.indexStart;
+			shapes_.push_back(currentShape);
+		}
+
+		// 一旦インデックス展開するためトータルインデックス数分の頂点バッファを確保(後で溶接して詰める)
+		std::unique_ptr<uint8_t, TrackedDeleter> vertexData(static_cast<uint8_t*>(TrackedAllocate(MemoryTag::Mesh, vtxStride * totalIndexNum)));
+		std::unique_ptr<uint8_t, TrackedDeleter> indexData(static_cast<uint8_t*>(TrackedAllocate(MemoryTag::Mesh, sizeof(uint32_t) * totalIndexNum)));
+		uint32_t* indexBufferPtr = reinterpret_cast<uint32_t*>(indexData.get());
+
+		// 面ごとに出力先が決まっているので並列に展開する
+		ParallelForRange(0, totalFaceNum, [&](uint32_t faceBegin, uint32_t faceEnd) {
+			uint32_t shapeIndex = static_cast<uint32_t>(std::upper_bound(faceOffsets.begin(), faceOffsets.end(), faceBegin) - faceOffsets.begin()) - 1;
+			for (uint32_t face = faceBegin; face < faceEnd; face++) {
+				while (face >= faceOffsets[shapeIndex + 1]) {
+					shapeIndex++;
 				}
-				Printf("Failed to load/parse .obj.\n");
-				return;
-			}
-			//Printf("# of vertices  : %d\n", (attrib.vertices.size() / 3));
-			//Printf("# of normals   : %d\n", (attrib.normals.size() / 3));
-			//Printf("# of texcoords : %d\n", (attrib.texcoords.size() / 2));
-			//Printf("# of shapes    : %d\n", shapes.size());
-			//Printf("# of materials : %d\n", materials.size());
-
-			// 現状はすべてのシェイプで頂点構造が一致している前提で処理しているため1つの頂点バッファにすべて入っている
-			// TODO:tangent, bitangent計算
-			uint32_t vtxAttrs = VERTEX_ATTR_FLAG_POSITION;
-			vtxAttrs |= (attrib.normals.size() > 0) ? VERTEX_ATTR_FLAG_NORMAL : 0;
-			vtxAttrs |= (attrib.texcoords.size() > 0) ? VERTEX_ATTR_FLAG_TEXCOORD0 : 0;
-			uint32_t vtxStride = ComputeVertexStride(vtxAttrs);
-
-			// 全インデックス数を計算
-			uint32_t totalIndexNum = 0;
-			for (auto& shape : shapes) {
-				totalIndexNum += static_cast<uint32_t>(shape.mesh.indices.size());
-			}
-
-			// 頂点をインデックス展開するためトータルインデックス数分の頂点バッファを確保
-			std::unique_ptr<uint8_t> vertexData(new uint8_t[vtxStride * totalIndexNum]);
-			std::unique_ptr<uint8_t> indexData(new uint8_t[sizeof(uint32_t) * totalIndexNum]);
-			uint32_t currentIndex = 0;
-			uint32_t* currentIndexBufferPtr = reinterpret_cast<uint32_t*>(indexData.get());
-			for (uint32_t i = 0; i < shapes.size(); i++) {
-				auto& shape = shapes[i];
-				Assert(shape.mesh.num_face_vertices.size() == shape.mesh.material_ids.size());
-
-				// For each face
-				uint32_t currentMaterial = 0xffffffff;
-				Shape currentShape;
-				for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
-					Assert(shape.mesh.num_face_vertices[f] == 3);	// 三角形化済みのはず
-
-					// マテリアルの切り替わり判定
-					if (currentMaterial != shape.mesh.material_ids[f]) {
-						if (currentMaterial != 0xffffffff) {
-							currentShape.indexCount = currentIndex - currentShape.indexStart;
-							shapes_.push_back(currentShape);
-						}
-						currentMaterial = shape.mesh.material_ids[f];
-						currentShape.materialIndex = currentMaterial;
-						currentShape.indexStart = currentIndex;
-						currentShape.indexCount = 0;
-					}
+				auto& shape = shapes[shapeIndex];
+				size_t f = face - faceOffsets[shapeIndex];
+				Assert(shape.mesh.num_face_vertices[f] == 3);	// 三角形化済みのはず
 
-					// For each vertex in the face
-					uint32_t ptrOffset = 0;
+				// For each vertex in the face
+				uint32_t currentIndex = face * 3;
+				for (size_t v = 0; v < 3; v++) {
+					tinyobj::index_t idx = shape.mesh.indices[(f * 3) + v];
 					uint8_t* currentVertexBufferPtr = vertexData.get() + (vtxStride * currentIndex);
-					for (size_t v = 0; v < 3; v++) {
-						tinyobj::index_t idx = shape.mesh.indices[(f * 3) + v];
+					uint32_t ptrOffset = 0;
+
+					// position
+					memcpy(currentVertexBufferPtr + ptrOffset, &attrib.vertices[idx.vertex_index * 3], 12);
+					ptrOffset += 12;
 
-						// position
-						memcpy(currentVertexBufferPtr + ptrOffset, &attrib.vertices[idx.vertex_index * 3], 12);
+					// normal
+					if (vtxAttrs & VERTEX_ATTR_FLAG_NORMAL) {
+						memcpy(currentVertexBufferPtr + ptrOffset, &attrib.normals[idx.normal_index * 3], 12);
 						ptrOffset += 12;
+					}
 
-						// normal
-						if (vtxAttrs & VERTEX_ATTR_FLAG_NORMAL) {
-							memcpy(currentVertexBufferPtr + ptrOffset, &attrib.normals[idx.normal_index * 3], 12);
-							ptrOffset += 12;
-						}
-
-						// texcoord
-						if (vtxAttrs & VERTEX_ATTR_FLAG_TEXCOORD0) {
-							float2* uv = reinterpret_cast<float2*>(currentVertexBufferPtr + ptrOffset);
-							uv->x = attrib.texcoords[idx.texcoord_index * 2 + 0];
-							uv->y = 1.0f - attrib.texcoords[idx.texcoord_index * 2 + 1]; // OpenGL -> DirectX
-							ptrOffset += 8;
-						}
-
-						currentIndexBufferPtr[currentIndex] = currentIndex;
-						currentIndex++;
+					// texcoord
+					if (vtxAttrs & VERTEX_ATTR_FLAG_TEXCOORD0) {
+						float2* uv = reinterpret_cast<float2*>(currentVertexBufferPtr + ptrOffset);
+						uv->x = attrib.texcoords[idx.texcoord_index * 2 + 0];
+						uv->y = 1.0f - attrib.texcoords[idx.texcoord_index * 2 + 1]; // OpenGL -> DirectX
+						ptrOffset += 8;
 					}
-				}
 
-				// 最後のマテリアル分追加
-				currentShape.indexCount = currentIndex - currentShape.indexStart;
-				shapes_.push_back(currentShape);
+					currentIndex++;
+				}
 			}
+		});
 
-			vertexBuffer_.Create(vertexData.get(), vtxStride * totalIndexNum, vtxAttrs);
-			indexBuffer_.Create(indexData.get(), sizeof(uint32_t) * totalIndexNum, INDEX_BUFFER_STRIDE_U32);
+		// 同じ頂点をまとめてインデックスバッファを作る、溶接した頂点はvertexDataの先頭に詰まる
+		uint32_t vertexNum = meshopt::WeldVertices(vertexData.get(), totalIndexNum, vtxStride, indexBufferPtr, vertexData.get());
+		Printf("Welded vertices: %u -> %u\n", totalIndexNum, vertexNum);
 
-			// マテリアル
-			materials_.resize(materials.size());
-			std::unordered_map<std::string, uint32_t> textureMap;
-			for (size_t i = 0; i < (uint32_t)materials_.size(); i++) {
-				auto& m = materials[i];
-				ZeroMemory(&materials_[i], sizeof(materials_[i]));
-
-				// テクスチャ検索
-				if (m.diffuse_texname.size() > 0) {
-					Texture* texture = nullptr;
-					auto iter = textureMap.find(m.diffuse_texname);
-					if (iter != textureMap.end()) {
-						texture = textures_[iter->second];
-					} else {
-						texture = new Texture();
-						snprintf(tempPath, sizeof(tempPath), "%s%s", baseDir, m.diffuse_texname.c_str());
-						texture->LoadFromFile(tempPath);
-						textures_.push_back(texture);
-						uint32_t index = (uint32_t)textures_.size() - 1;
-						textureMap[m.diffuse_texname] = index;
+#if defined(DEBUG) || defined(_DEBUG)
+		meshopt::VertexCacheStats cacheBefore = meshopt::AnalyzeVertexCache(indexBufferPtr, totalIndexNum, vertexNum);
+		meshopt::OverdrawStats overdrawBefore = meshopt::AnalyzeOverdraw(indexBufferPtr, totalIndexNum, vertexData.get(), vertexNum, vtxStride);
+#endif
 
-					}
-					materials_[i].albedo = texture;
+		// シェイプごとに頂点キャッシュとオーバードロー向けに三角形を並べ替え、最後に参照順に頂点を並べ直す
+		ParallelFor(0, static_cast<uint32_t>(shapes_.size()), [&](uint32_t i) {
+			uint32_t* shapeIndices = indexBufferPtr + shapes_[i].indexStart;
+			meshopt::OptimizeVertexCache(shapeIndices, shapes_[i].indexCount);
+			meshopt::OptimizeOverdraw(shapeIndices, shapes_[i].indexCount, vertexData.get(), vtxStride);
+		}, 1);
+		{
+			std::unique_ptr<uint8_t, TrackedDeleter> orderedVertexData(static_cast<uint8_t*>(TrackedAllocate(MemoryTag::Mesh, vtxStride * vertexNum)));
+			vertexNum = meshopt::OptimizeVertexFetch(indexBufferPtr, totalIndexNum, vertexData.get(), vertexNum, vtxStride, orderedVertexData.get());
+			vertexData = std::move(orderedVertexData);
+		}
+
+#if defined(DEBUG) || defined(_DEBUG)
+		meshopt::VertexCacheStats cacheAfter = meshopt::AnalyzeVertexCache(indexBufferPtr, totalIndexNum, vertexNum);
+		meshopt::OverdrawStats overdrawAfter = meshopt::AnalyzeOverdraw(indexBufferPtr, totalIndexNum, vertexData.get(), vertexNum, vtxStride);
+		Printf("Vertex cache: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", cacheBefore.acmr, cacheAfter.acmr, cacheBefore.atvr, cacheAfter.atvr);
+		Printf("Overdraw: %.3f -> %.3f\n", overdrawBefore.overdraw, overdrawAfter.overdraw);
+#endif
+
+		// インデックスを16bitにする
+		// 頂点が多ければシェイプを65536頂点以下の区間に分け、区間ごとに頂点を連続に並べ直して区間の先頭からの番号にする
+		// (区間をまたいで使われる頂点は複製する)
+		IndexBufferStride indexStride = INDEX_BUFFER_STRIDE_U16;
+		uint32_t indexSize = sizeof(uint16_t);
+		{
+			std::vector<meshopt::IndexRange> ranges;
+			std::vector<uint32_t> rangeMaterials;
+			if (vertexNum <= USHRT_MAX + 1) {
+				for (const Shape& shape : shapes_) {
+					meshopt::IndexRange range = { shape.indexStart, shape.indexCount, 0 };
+					ranges.push_back(range);
+					rangeMaterials.push_back(shape.materialIndex);
+				}
+			} else {
+				std::vector<uint32_t> sourceVertices;
+				for (const Shape& shape : shapes_) {
+					meshopt::SplitIndexRange(indexBufferPtr, shape.indexStart, shape.indexCount, USHRT_MAX + 1, sourceVertices, ranges);
+					rangeMaterials.resize(ranges.size(), shape.materialIndex);
 				}
-			}
 
-			// 読み込み高速化のためのキャッシュデータを生成
-			{
-				snprintf(tempPath, sizeof(tempPath), "%s%s.cache", baseDir, fileNameWoExt);
-				std::ofstream file(tempPath, std::ios::out | std::ios::binary);
-
-				CacheHeader header;
-				header.shapeNum = (uint16_t)shapes_.size();
-				header.materialNum = (uint16_t)materials_.size();
-				header.vertexAttrs = (uint16_t)vtxAttrs;
-				header.vertexNum = totalIndexNum;
-				header.offsetToShapes = sizeof(CacheHeader);
-				header.offsetToVertices = header.offsetToShapes + sizeof(Shape) * header.shapeNum;
-				header.offsetToIndeces = header.offsetToVertices + (vtxStride * totalIndexNum);
-				header.offsetToMaterial = header.offsetToIndeces + (sizeof(uint32_t) * totalIndexNum);
-				file.write((char*)&header, sizeof(header));
-
-				// シェイプ
-				for (auto& s : shapes_) {
-					file.write((char*)&s, sizeof(s));
+				uint32_t splitVertexNum = static_cast<uint32_t>(sourceVertices.size());
+				std::unique_ptr<uint8_t, TrackedDeleter> splitVertexData(static_cast<uint8_t*>(TrackedAllocate(MemoryTag::Mesh, vtxStride * splitVertexNum)));
+				for (uint32_t i = 0; i < splitVertexNum; i++) {
+					memcpy(splitVertexData.get() + vtxStride * i, vertexData.get() + vtxStride * sourceVertices[i], vtxStride);
 				}
-				// 頂点
-				file.write((char*)vertexData.get(), vtxStride * totalIndexNum);
-				// インデックス
-				file.write((char*)indexData.get(), sizeof(uint32_t) * totalIndexNum);
-				// マテリアル
-				for (auto& m : materials) {
-					FillMemory(tempPath, sizeof(tempPath), 0);
-					snprintf(tempPath, sizeof(tempPath), "%s", m.diffuse_texname.c_str());
-					file.write(tempPath, sizeof(tempPath));
+				Printf("16bit indices: %u shapes -> %u, vertices %u -> %u\n", static_cast<uint32_t>(shapes_.size()), static_cast<uint32_t>(ranges.size()), vertexNum, splitVertexNum);
+				vertexData = std::move(splitVertexData);
+				vertexNum = splitVertexNum;
+			}
+
+			std::unique_ptr<uint8_t, TrackedDeleter> indexData16(static_cast<uint8_t*>(TrackedAllocate(MemoryTag::Mesh, sizeof(uint16_t) * totalIndexNum)));
+			uint16_t* indices16 = reinterpret_cast<uint16_t*>(indexData16.get());
+			shapes_.resize(ranges.size());
+			for (size_t i = 0; i < ranges.size(); i++) {
+				const auto& range = ranges[i];
+				shapes_[i].indexStart = range.indexStart;
+				shapes_[i].indexCount = range.indexCount;
+				shapes_[i].vertexStart = range.vertexStart;
+				shapes_[i].materialIndex = rangeMaterials[i];
+				for (uint32_t j = range.indexStart; j < range.indexStart + range.indexCount; j++) {
+					Assert(indexBufferPtr[j] <= USHRT_MAX);
+					indices16[j] = static_cast<uint16_t>(indexBufferPtr[j]);
 				}
 			}
+			indexData = std::move(indexData16);
+			indexBufferPtr = nullptr;
+		}
+
+		vertexBuffer_.Create(vertexData.get(), vtxStride * vertexNum, vtxAttrs);
+		indexBuffer_.Create(indexData.get(), indexSize * totalIndexNum, indexStride);
+		ComputeBounds(vertexData.get(), vtxStride, indexData.get(), indexStride);
+
+		// マテリアル
+		albedoNames->resize(materials.size());
+		for (size_t i = 0; i < albedoNames->size(); i++) {
+			(*albedoNames)[i] = materials[i].diffuse_texname;
+		}
+
+		// 読み込み高速化のためのキャッシュデータを生成
+		{
+			std::ofstream file(cachePath, std::ios::out | std::ios::binary);
+
+			CacheHeader header;
+			header.magic = CACHE_MAGIC;
+			header.version = CACHE_VERSION;
+			header.shapeNum = (uint16_t)shapes_.size();
+			header.materialNum = (uint16_t)albedoNames->size();
+			header.vertexAttrs = (uint16_t)vtxAttrs;
+			header.indexStride = (uint16_t)indexStride;
+			header.vertexNum = vertexNum;
+			header.indexNum = totalIndexNum;
+			header.offsetToShapes = sizeof(CacheHeader);
+			header.offsetToVertices = header.offsetToShapes + sizeof(Shape) * header.shapeNum;
+			header.offsetToIndeces = header.offsetToVertices + (vtxStride * vertexNum);
+			header.offsetToMaterial = header.offsetToIndeces + (indexSize * totalIndexNum);
+			file.write((char*)&header, sizeof(header));
+
+			// シェイプ
+			for (auto& s : shapes_) {
+				file.write((char*)&s, sizeof(s));
+			}
+			// 頂点
+			file.write((char*)vertexData.get(), vtxStride * vertexNum);
+			// インデックス
+			file.write((char*)indexData.get(), indexSize * totalIndexNum);
+			// マテリアル
+			for (auto& m : materials) {
+				FillMemory(tempPath, sizeof(tempPath), 0);
+				snprintf(tempPath, sizeof(tempPath), "%s", m.diffuse_texname.c_str());
+				file.write(tempPath, sizeof(tempPath));
+			}
 		}
+
+		return true;
+	}
+
+	Task<void> StaticMesh::CreateAsync(const char* fileName)
+	{
+		Assert(!loading_.IsValid() || loading_.IsReady());
+
+		char baseDir[256];
+		char fileNameWoExt[256];
+		char cachePath[256];
+		_splitpath_s(fileName, nullptr, 0, baseDir, sizeof(baseDir), fileNameWoExt, sizeof(baseDir), nullptr, 0);
+
+		// キャッシュファイル名
+		snprintf(cachePath, sizeof(cachePath), "%s%s.cache", baseDir, fileNameWoExt);
+
+		// キャッシュ読み込み → パースとバッファ生成 → テクスチャを並列に読み込み → マテリアル設定
+		std::string objPath(fileName);
+		std::string baseDirPath(baseDir);
+		std::string cachePathString(cachePath);
+		loading_ = ReadFileAsync(cachePath).Then([this, objPath, baseDirPath, cachePathString](std::vector<uint8_t>& cacheData) {
+			std::vector<std::string> albedoNames;
+			if (!CreateFromCache(cacheData, &albedoNames)) {
+				// キャッシュがなかったらobjを読み込み
+				if (!CreateFromObj(objPath.c_str(), baseDirPath.c_str(), cachePathString.c_str(), &albedoNames)) {
+					return MakeReadyTask();
+				}
+			}
+			return LoadMaterialsAsync(baseDirPath, albedoNames);
+		});
+		return loading_;
+	}
+
+	void StaticMesh::Create(const char* fileName)
+	{
+		CreateAsync(fileName).Wait();
 	}
 }
\ No newline at end of file
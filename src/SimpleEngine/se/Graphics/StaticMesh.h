@@ -2,6 +2,9 @@
 
 #include "se/Common.h"
 #include "se/Graphics/GPUBuffer.h"
+#include "se/Graphics/TextureManager.h"
+#include "se/Math/Bounds.h"
+#include "se/async/Task.h"
 
 namespace se
 {
@@ -16,20 +19,30 @@ namespace se
 		{
 			uint32_t indexStart;
 			uint32_t indexCount;
+			uint32_t vertexStart;		// インデックスに足す頂点番号(DrawIndexedのvertexStartに渡す)
 			uint32_t materialIndex;
 		};
 
 		struct Material
 		{
-			Texture* albedo;
+			TextureHandle albedo;		// TextureManager::GetTextureで参照する
 		};
 
 	private:
 		std::vector<Shape> shapes_;
+		std::vector<AABB> shapeBounds_;		// シェイプごとのローカル座標の境界ボックス
+		AABB bounds_;
 		VertexBuffer vertexBuffer_;
 		IndexBuffer indexBuffer_;
-		std::vector<Texture*> textures_;
+		std::vector<TextureHandle> textures_;		// 参照を持っているテクスチャ
 		std::vector<Material> materials_;
+		Task<void> loading_;
+
+	private:
+		bool CreateFromCache(const std::vector<uint8_t>& cacheData, std::vector<std::string>* albedoNames);
+		bool CreateFromObj(const char* fileName, const char* baseDir, const char* cachePath, std::vector<std::string>* albedoNames);
+		void ComputeBounds(const uint8_t* vertices, uint32_t vertexStride, const void* indices, IndexBufferStride indexStride);
+		Task<void> LoadMaterialsAsync(const std::string& baseDir, const std::vector<std::string>& albedoNames);
 
 	public:
 		StaticMesh();
@@ -37,11 +50,18 @@ namespace se
 
 		void Create(const char* fileName);
 
+		// 非同期に読み込む、完了するまで描画に使わないこと
+		// 読み込みはワーカーで行い、テクスチャはファイルごとに並行に読み込む
+		Task<void> CreateAsync(const char* fileName);
+		bool IsLoaded() const { return loading_.IsReady(); }
+
 		const VertexBuffer& GetVertexBuffer() const { return vertexBuffer_; }
 		const IndexBuffer& GetIndexBuffer() const { return indexBuffer_; }
 		uint32_t GetShapeNum() const { return static_cast<uint32_t>(shapes_.size()); }
 		const Shape& GetShape(uint32_t index) const { return shapes_[index]; }
-		uint32_t GetMaterialNum() const { static_cast<uint32_t>(materials_.size()); }
+		const AABB& GetShapeBounds(uint32_t index) const { return shapeBounds_[index]; }
+		const AABB& GetBounds() const { return bounds_; }
+		uint32_t GetMaterialNum() const { return static_cast<uint32_t>(materials_.size()); }
 		const Material& GetMaterial(uint32_t index) const { return materials_[index]; }
 	};
 
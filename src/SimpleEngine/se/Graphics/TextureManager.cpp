@@ -0,0 +1,88 @@
+﻿#include "se/Graphics/TextureManager.h"
+
+namespace se
+{
+	TextureManager::TextureManager()
+		: pool_(MemoryTag::Texture)
+	{
+	}
+
+	TextureManager::~TextureManager()
+	{
+	}
+
+	TextureHandle TextureManager::Load(const char* fileName, Task<void>* loaded, IOPriority priority)
+	{
+		std::shared_ptr<detail::TaskState<void>> state;
+		TextureHandle handle;
+		{
+			ScopedLock<Mutex> lock(lock_);
+			auto iter = pathMap_.find(fileName);
+			if (iter != pathMap_.end()) {
+				pool_.AddRef(iter->second);
+				if (loaded) {
+					*loaded = pool_.Get(iter->second)->loading;
+				}
+				return iter->second;
+			}
+
+			handle = pool_.Create();
+			if (handle.IsNull()) {
+				Printf("TextureManager: pool is full.\n");
+				if (loaded) {
+					*loaded = MakeReadyTask();
+				}
+				return handle;
+			}
+
+			// 完了タスクは読み込みの発行前に登録して、同じパスを後から要求した側も待てるようにする
+			state = std::make_shared<detail::TaskState<void>>();
+			Entry* entry = pool_.Get(handle);
+			entry->path = fileName;
+			entry->loading = Task<void>(state);
+			pathMap_.emplace(entry->path, handle);
+
+			// 読み込み中は読み込み側も参照を持つ
+			pool_.AddRef(handle);
+		}
+
+		if (loaded) {
+			*loaded = Task<void>(state);
+		}
+
+		// デバイスはフリースレッドなのでテクスチャ生成もワーカーで行う
+		ReadFileAsync(fileName, priority).Then([this, handle, state](std::vector<uint8_t>& data) {
+			Entry* entry = pool_.Get(handle);
+			if (data.empty()) {
+				Printf("Failed to load texture. (%s)\n", entry->path.c_str());
+			} else {
+				entry->texture.LoadFromMemory(data.data(), static_cast<uint32_t>(data.size()));
+				entry->loaded.Store(true, MemoryOrder::Release);
+			}
+			state->SetValue();
+			Release(handle);
+		});
+		return handle;
+	}
+
+	void TextureManager::AddRef(TextureHandle handle)
+	{
+		ScopedLock<Mutex> lock(lock_);
+		pool_.AddRef(handle);
+	}
+
+	void TextureManager::Release(TextureHandle handle)
+	{
+		ScopedLock<Mutex> lock(lock_);
+		Entry* entry = pool_.Get(handle);
+		if (!entry) {
+			return;
+		}
+		// 最後の参照ならパスの登録を外す(破棄されたテクスチャを同じパスで引かせない)
+		if (pool_.GetRefCount(handle) == 1) {
+			pathMap_.erase(entry->path);
+		}
+		pool_.Release(handle);
+	}
+
+}
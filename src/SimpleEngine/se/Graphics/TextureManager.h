@@ -0,0 +1,68 @@
+﻿#pragma once
+
+#include "se/Common.h"
+#include "se/Graphics/GPUBuffer.h"
+#include "se/Memory/ResourcePool.h"
+#include "se/async/Task.h"
+#include "se/async/IOService.h"
+#include <string>
+#include <unordered_map>
+
+namespace se
+{
+	typedef Handle<Texture> TextureHandle;
+
+	/**
+	 * テクスチャマネージャ
+	 * ファイルパスごとに1つだけ読み込み、ハンドルと参照カウントで共有する
+	 * 参照が無くなったテクスチャは破棄され、古いハンドルはGetでnullptrになる(ストリーミングで解放しても安全)
+	 */
+	class TextureManager
+	{
+	public:
+		static TextureManager& Get() {
+			static TextureManager instance;
+			return instance;
+		}
+
+	private:
+		struct Entry
+		{
+			Texture texture;
+			std::string path;
+			Atomic<bool> loaded;		// 読み込みが成功したらtrue
+			Task<void> loading;
+		};
+
+	private:
+		ResourcePool<Entry, Texture> pool_;
+		std::unordered_map<std::string, TextureHandle> pathMap_;
+		Mutex lock_;			// パスの登録と参照カウントの増減
+
+	private:
+		TextureManager();
+		~TextureManager();
+		TextureManager(const TextureManager&) = delete;
+		TextureManager& operator=(const TextureManager&) = delete;
+
+	public:
+		// 非同期に読み込み参照を1つ持ったハンドルを返す
+		// 同じパスが読み込み済み・読み込み中なら参照を増やして同じハンドルを返す
+		// loaded:読み込みの完了(失敗含む)で完了するタスク
+		TextureHandle Load(const char* fileName, Task<void>* loaded = nullptr, IOPriority priority = IOPriority::Normal);
+
+		void AddRef(TextureHandle handle);
+		void Release(TextureHandle handle);
+
+		// 読み込みが終わっていない・失敗した・解放済みのハンドルならnullptr
+		Texture* GetTexture(TextureHandle handle) const
+		{
+			Entry* entry = pool_.Get(handle);
+			return (entry && entry->loaded.Load(MemoryOrder::Acquire)) ? &entry->texture : nullptr;
+		}
+
+		bool IsValid(TextureHandle handle) const { return pool_.IsValid(handle); }
+		uint32_t GetTextureNum() const { return pool_.GetAliveNum(); }
+	};
+
+}
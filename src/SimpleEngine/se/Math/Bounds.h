@@ -0,0 +1,147 @@
+﻿#pragma once
+
+#include "se/Math/Math.h"
+#include <float.h>
+
+namespace se
+{
+	/**
+	 * 軸に平行な境界ボックス
+	 * minPos > maxPosの状態を空とする
+	 */
+	struct AABB
+	{
+		float3 minPos;
+		float3 maxPos;
+
+		AABB(){}
+		AABB(const float3& minPos, const float3& maxPos)
+			: minPos(minPos), maxPos(maxPos)
+		{
+		}
+
+		bool IsEmpty() const
+		{
+			return minPos.x > maxPos.x || minPos.y > maxPos.y || minPos.z > maxPos.z;
+		}
+
+		void Merge(const float3& p)
+		{
+			minPos = float3(Min(minPos.x, p.x), Min(minPos.y, p.y), Min(minPos.z, p.z));
+			maxPos = float3(Max(maxPos.x, p.x), Max(maxPos.y, p.y), Max(maxPos.z, p.z));
+		}
+
+		void Merge(const AABB& other)
+		{
+			if (other.IsEmpty()) return;
+			Merge(other.minPos);
+			Merge(other.maxPos);
+		}
+
+		float3 GetCenter() const
+		{
+			return float3((minPos.x + maxPos.x) * 0.5f, (minPos.y + maxPos.y) * 0.5f, (minPos.z + maxPos.z) * 0.5f);
+		}
+
+		// 中心から各面までの距離
+		float3 GetExtent() const
+		{
+			return float3((maxPos.x - minPos.x) * 0.5f, (maxPos.y - minPos.y) * 0.5f, (maxPos.z - minPos.z) * 0.5f);
+		}
+
+	public:
+		static AABB Empty()
+		{
+			return AABB(float3(FLT_MAX), float3(-FLT_MAX));
+		}
+
+		static AABB FromCenterExtent(const float3& center, const float3& extent)
+		{
+			return AABB(center - extent, float3(center.x + extent.x, center.y + extent.y, center.z + extent.z));
+		}
+
+		// 変換後の8頂点を囲むボックス(回転が入ると元より大きくなる)
+		static AABB Transform(const AABB& box, const Matrix4x4& m)
+		{
+			if (box.IsEmpty()) return box;
+			float3 center = float3::Transform(box.GetCenter(), m);
+			float3 extent = box.GetExtent();
+			float3 newExtent(
+				fabsf(m._11) * extent.x + fabsf(m._21) * extent.y + fabsf(m._31) * extent.z,
+				fabsf(m._12) * extent.x + fabsf(m._22) * extent.y + fabsf(m._32) * extent.z,
+				fabsf(m._13) * extent.x + fabsf(m._23) * extent.y + fabsf(m._33) * extent.z);
+			return FromCenterExtent(center, newExtent);
+		}
+	};
+
+
+	/**
+	 * 境界球
+	 */
+	struct Sphere
+	{
+		float3 center;
+		float radius;
+
+		Sphere(){}
+		Sphere(const float3& center, float radius)
+			: center(center), radius(radius)
+		{
+		}
+
+	public:
+		// ボックスに外接する球
+		static Sphere FromAABB(const AABB& box)
+		{
+			return Sphere(box.GetCenter(), box.GetExtent().Length());
+		}
+	};
+
+
+	/**
+	 * 平面
+	 * Dot(normal, p) + distance >= 0 の側を表とする
+	 */
+	struct Plane
+	{
+		float3 normal;
+		float distance;
+
+		Plane(){}
+		Plane(const float3& normal, float distance)
+			: normal(normal), distance(distance)
+		{
+		}
+
+		// 法線を正規化する前は法線の長さ倍された距離になる
+		float GetDistance(const float3& p) const
+		{
+			return normal.x * p.x + normal.y * p.y + normal.z * p.z + distance;
+		}
+
+		void Normalize()
+		{
+			float length = normal.Length();
+			if (length > 0.0f) {
+				float invLength = 1.0f / length;
+				normal *= invLength;
+				distance *= invLength;
+			}
+		}
+	};
+
+
+	/**
+	 * SoA形式の境界ボックス列(中心と広がり)
+	 * 各ポインタは要素数分の連続した配列を指す
+	 */
+	struct AABBSoA
+	{
+		float* centerX;
+		float* centerY;
+		float* centerZ;
+		float* extentX;
+		float* extentY;
+		float* extentZ;
+	};
+}
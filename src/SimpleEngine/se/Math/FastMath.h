@@ -0,0 +1,250 @@
+﻿#pragma once
+
+#include "se/Math/SIMD.h"
+
+namespace se
+{
+/**
+ * 近似数学関数
+ * simd::Vectorの4要素をまとめて多項式近似で計算する(floatの版は1要素だけ使う)
+ * 精度は3段階から選ぶ、各関数のコメントの誤差は上限で、実測の最大値に余裕を持たせたもの
+ * (src/UnitTest/FastMathTest.cppで標本を取って確かめている)
+ *   Low    : 相対誤差1e-4程度
+ *   Medium : 相対誤差1e-6程度
+ *   High   : floatの数ULP程度
+ * 入力は有限値であること(無限大やNaNの結果は保証しない)
+ */
+namespace fastmath
+{
+	enum class Precision
+	{
+		Low,
+		Medium,
+		High,
+	};
+
+	namespace detail {
+
+		const float PI = 3.14159265358979f;
+		const float HALF_PI = 1.57079632679490f;
+		const float INV_TWO_PI = 0.159154943091895f;
+		// 2πを上位(下位ビットが0)と下位に分けたもの、周期の引き算で桁落ちしないようにする
+		const float TWO_PI_HI = 6.28125f;
+		const float TWO_PI_LO = 1.93530717958646e-3f;
+		const float LOG2E = 1.44269504088896f;
+		const float LN2_HI = 0.693359375f;
+		const float LN2_LO = -2.12194440e-4f;
+		const float EXP_MIN = -87.3365f;		// 結果が正規化数に収まる範囲
+		const float EXP_MAX = 88.37f;
+
+		// c0 + x * (c1 + x * (c2 + ...))
+		__forceinline simd::Vector Horner(simd::Vector, float c0)
+		{
+			return simd::Splat(c0);
+		}
+		template<class... Rest>
+		__forceinline simd::Vector Horner(simd::Vector x, float c0, Rest... rest)
+		{
+			return simd::MultiplyAdd(x, Horner(x, rest...), simd::Splat(c0));
+		}
+
+		// y = y * (1.5 - 0.5 * v * y * y)
+		__forceinline simd::Vector RefineReciprocalSqrt(simd::Vector v, simd::Vector y)
+		{
+			simd::Vector vyy = simd::Mul(simd::Mul(v, y), y);
+			return simd::Mul(y, simd::MultiplyAdd(vyy, simd::Splat(-0.5f), simd::Splat(1.5f)));
+		}
+
+		// [-π/2, π/2]のsin、係数は相対誤差のミニマックス近似
+		template<Precision P>
+		__forceinline simd::Vector SinKernel(simd::Vector x, simd::Vector x2)
+		{
+			simd::Vector p;
+			if (P == Precision::Low) {
+				p = Horner(x2, -0.166129191f, 7.65654511e-3f);
+			} else if (P == Precision::Medium) {
+				p = Horner(x2, -0.166658533f, 8.31427475e-3f, -1.85422230e-4f);
+			} else {
+				p = Horner(x2, -0.166666666f, 8.33333113e-3f, -1.98408702e-4f, 2.75254749e-6f, -2.38903362e-8f);
+			}
+			return simd::MultiplyAdd(simd::Mul(x, x2), p, x);
+		}
+
+		// [-π/2, π/2]のcos、係数は絶対誤差のミニマックス近似
+		template<Precision P>
+		__forceinline simd::Vector CosKernel(simd::Vector x2)
+		{
+			if (P == Precision::Low) {
+				return Horner(x2, 1.0f, -0.499935631f, 4.15070669e-2f, -1.27575199e-3f);
+			} else if (P == Precision::Medium) {
+				return Horner(x2, 1.0f, -0.499999323f, 4.16639895e-2f, -1.38559272e-3f, 2.31943866e-5f);
+			}
+			return Horner(x2, 1.0f, -0.499999995f, 4.16666407e-2f, -1.38884030e-3f, 2.47618619e-5f, -2.60767087e-7f);
+		}
+
+		// xを[-π/2, π/2]に畳み込み、cosの符号を返す
+		__forceinline simd::Vector ReduceSinCos(simd::Vector& x)
+		{
+			// [-π, π]へ
+			simd::Vector q = simd::Round(simd::Mul(x, simd::Splat(INV_TWO_PI)));
+			x = simd::MultiplyAdd(q, simd::Splat(-TWO_PI_HI), x);
+			x = simd::MultiplyAdd(q, simd::Splat(-TWO_PI_LO), x);
+
+			// |x| > π/2 なら sin(x) = sin(±π - x)、cos(x) = -cos(±π - x)
+			simd::Vector zero = simd::Zero();
+			simd::Vector signedPi = simd::Select(simd::Splat(PI), simd::Splat(-PI), simd::Greater(zero, x));
+			simd::Vector reflect = simd::Greater(simd::Abs(x), simd::Splat(HALF_PI));
+			x = simd::Select(x, simd::Sub(signedPi, x), reflect);
+			return simd::Select(simd::Splat(1.0f), simd::Splat(-1.0f), reflect);
+		}
+
+		// [0, 1]のatan、係数は相対誤差のミニマックス近似
+		template<Precision P>
+		__forceinline simd::Vector AtanKernel(simd::Vector t)
+		{
+			simd::Vector t2 = simd::Mul(t, t);
+			simd::Vector p;
+			if (P == Precision::Low) {
+				p = Horner(t2, -0.327622760f, 0.159314204f, -4.64964629e-2f);
+			} else if (P == Precision::Medium) {
+				p = Horner(t2, -0.333284919f, 0.198978731f, -0.135445754f, 8.48410238e-2f, -3.77967058e-2f, 8.10636281e-3f);
+			} else {
+				p = Horner(t2, -0.333331525f, 0.199937679f, -0.142110156f, 0.106658496f, -7.55188805e-2f, 4.32080634e-2f, -1.63656259e-2f, 2.92012478e-3f);
+			}
+			return simd::MultiplyAdd(simd::Mul(t, t2), p, t);
+		}
+	}
+
+
+	/**
+	 * 平方根(v >= 0)
+	 * 相対誤差 Low:3.7e-4 Medium:3.0e-7 High:6.0e-8(simd::Sqrt、floatへの丸めのみ)
+	 */
+	template<Precision P = Precision::Medium>
+	__forceinline simd::Vector Sqrt(simd::Vector v)
+	{
+		if (P == Precision::High) {
+			return simd::Sqrt(v);
+		}
+		simd::Vector y = simd::ReciprocalSqrtEstimate(v);
+		if (P == Precision::Medium) {
+			y = detail::RefineReciprocalSqrt(v, y);
+		}
+		// v = 0 は 0 * ∞ になるので0にする
+		return simd::Select(simd::Zero(), simd::Mul(v, y), simd::Greater(v, simd::Zero()));
+	}
+
+	/**
+	 * 平方根の逆数(v > 0)
+	 * 相対誤差 Low:3.7e-4 Medium:2.8e-7 High:9.0e-8(1 / simd::Sqrt)
+	 */
+	template<Precision P = Precision::Medium>
+	__forceinline simd::Vector Rsqrt(simd::Vector v)
+	{
+		if (P == Precision::High) {
+			return simd::Div(simd::Splat(1.0f), simd::Sqrt(v));
+		}
+		simd::Vector y = simd::ReciprocalSqrtEstimate(v);
+		if (P == Precision::Medium) {
+			y = detail::RefineReciprocalSqrt(v, y);
+		}
+		return y;
+	}
+
+	/**
+	 * 指数関数
+	 * 相対誤差 Low:1.1e-4 Medium:3.0e-6 High:1.2e-7
+	 * 結果が正規化数に収まるよう、xは[-87.3, 88.3]に飽和させる
+	 */
+	template<Precision P = Precision::Medium>
+	__forceinline simd::Vector Exp(simd::Vector x)
+	{
+		using namespace detail;
+		x = simd::Min(simd::Max(x, simd::Splat(EXP_MIN)), simd::Splat(EXP_MAX));
+
+		// e^x = 2^n * e^r (|r| <= ln2 / 2)
+		simd::Vector n = simd::Round(simd::Mul(x, simd::Splat(LOG2E)));
+		simd::Vector r = simd::MultiplyAdd(n, simd::Splat(-LN2_HI), x);
+		r = simd::MultiplyAdd(n, simd::Splat(-LN2_LO), r);
+
+		simd::Vector p;
+		if (P == Precision::Low) {
+			p = Horner(r, 1.0f, 1.00019584f, 0.504130378f, 0.165179754f);
+		} else if (P == Precision::Medium) {
+			p = Horner(r, 1.0f, 0.999966837f, 0.500030136f, 0.167874734f, 4.15138471e-2f);
+		} else {
+			p = Horner(r, 1.0f, 1.00000003f, 0.499999942f, 0.166664313f, 4.16680020e-2f, 8.37415530e-3f, 1.38436528e-3f);
+		}
+		return simd::Mul(p, simd::Pow2(n));
+	}
+
+	/**
+	 * 正弦と余弦
+	 * 絶対誤差(|x| <= 1000)
+	 *   sin Low:1.4e-4 Medium:1.3e-6 High:2.4e-7
+	 *   cos Low:8.5e-6 Medium:3.1e-7 High:2.8e-7
+	 * 周期の引き算の誤差が|x|に比例して増えるので、大きな角度は呼び出し側で畳んでおくこと
+	 */
+	template<Precision P = Precision::Medium>
+	__forceinline void SinCos(simd::Vector x, simd::Vector* sin, simd::Vector* cos)
+	{
+		simd::Vector cosSign = detail::ReduceSinCos(x);
+		simd::Vector x2 = simd::Mul(x, x);
+		*sin = detail::SinKernel<P>(x, x2);
+		*cos = simd::Mul(detail::CosKernel<P>(x2), cosSign);
+	}
+
+	template<Precision P = Precision::Medium>
+	__forceinline simd::Vector Sin(simd::Vector x)
+	{
+		detail::ReduceSinCos(x);
+		return detail::SinKernel<P>(x, simd::Mul(x, x));
+	}
+
+	template<Precision P = Precision::Medium>
+	__forceinline simd::Vector Cos(simd::Vector x)
+	{
+		simd::Vector cosSign = detail::ReduceSinCos(x);
+		return simd::Mul(detail::CosKernel<P>(simd::Mul(x, x)), cosSign);
+	}
+
+	/**
+	 * atan2(y, x)、結果は[-π, π]
+	 * 絶対誤差 Low:2.1e-4 Medium:8.6e-7 High:3.0e-7
+	 * x = y = 0 は0を返す、-0は+0として扱う
+	 */
+	template<Precision P = Precision::Medium>
+	__forceinline simd::Vector Atan2(simd::Vector y, simd::Vector x)
+	{
+		using namespace detail;
+		simd::Vector zero = simd::Zero();
+		simd::Vector absX = simd::Abs(x);
+		simd::Vector absY = simd::Abs(y);
+		simd::Vector maxXY = simd::Max(absX, absY);
+		simd::Vector t = simd::Div(simd::Min(absX, absY), maxXY);
+		t = simd::Select(zero, t, simd::Greater(maxXY, zero));
+
+		// atan(t)を求めてから象限に合わせる
+		simd::Vector a = AtanKernel<P>(t);
+		a = simd::Select(a, simd::Sub(simd::Splat(HALF_PI), a), simd::Greater(absY, absX));
+		a = simd::Select(a, simd::Sub(simd::Splat(PI), a), simd::Greater(zero, x));
+		return simd::Select(a, simd::Negate(a), simd::Greater(zero, y));
+	}
+
+
+	/* float版 */
+
+	template<Precision P = Precision::Medium>
+	__forceinline float Sqrt(float v) { return simd::GetX(Sqrt<P>(simd::Splat(v))); }
+	template<Precision P = Precision::Medium>
+	__forceinline float Rsqrt(float v) { return simd::GetX(Rsqrt<P>(simd::Splat(v))); }
+	template<Precision P = Precision::Medium>
+	__forceinline float Exp(float x) { return simd::GetX(Exp<P>(simd::Splat(x))); }
+	template<Precision P = Precision::Medium>
+	__forceinline float Sin(float x) { return simd::GetX(Sin<P>(simd::Splat(x))); }
+	template<Precision P = Precision::Medium>
+	__forceinline float Cos(float x) { return simd::GetX(Cos<P>(simd::Splat(x))); }
+	template<Precision P = Precision::Medium>
+	__forceinline float Atan2(float y, float x) { return simd::GetX(Atan2<P>(simd::Splat(y), simd::Splat(x))); }
+}
+}
@@ -0,0 +1,200 @@
+﻿#include "se/Math/Frustum.h"
+
+namespace se
+{
+	namespace {
+
+		// 平面ごとに各成分を全要素に展開したもの
+		struct PlaneVectors
+		{
+			simd::Vector nx, ny, nz;
+			simd::Vector ax, ay, az;		// 法線の絶対値
+			simd::Vector d;
+		};
+
+		void SetupPlaneVectors(const Plane* planes, PlaneVectors* out)
+		{
+			for (uint32_t i = 0; i < Frustum::PLANE_NUM; i++) {
+				const Plane& p = planes[i];
+				out[i].nx = simd::Splat(p.normal.x);
+				out[i].ny = simd::Splat(p.normal.y);
+				out[i].nz = simd::Splat(p.normal.z);
+				out[i].ax = simd::Splat(fabsf(p.normal.x));
+				out[i].ay = simd::Splat(fabsf(p.normal.y));
+				out[i].az = simd::Splat(fabsf(p.normal.z));
+				out[i].d = simd::Splat(p.distance);
+			}
+		}
+
+		// 平面から中心までの距離に、法線方向へのボックスの広がりを足したもの
+		// 負なら平面の裏側に完全に入っている
+		__forceinline float ComputeAABBDistance(const Plane& p, const float3& c, const float3& e)
+		{
+			float dist = p.normal.x * c.x + p.normal.y * c.y + p.normal.z * c.z + p.distance;
+			float radius = fabsf(p.normal.x) * e.x + fabsf(p.normal.y) * e.y + fabsf(p.normal.z) * e.z;
+			return dist + radius;
+		}
+
+		// begin番目から4個を判定して、交差するもののビットを返す
+		__forceinline uint32_t TestAABBs4(const PlaneVectors* planes, const AABBSoA& bounds, uint32_t begin)
+		{
+			simd::Vector cx = simd::LoadFloat4(bounds.centerX + begin);
+			simd::Vector cy = simd::LoadFloat4(bounds.centerY + begin);
+			simd::Vector cz = simd::LoadFloat4(bounds.centerZ + begin);
+			simd::Vector ex = simd::LoadFloat4(bounds.extentX + begin);
+			simd::Vector ey = simd::LoadFloat4(bounds.extentY + begin);
+			simd::Vector ez = simd::LoadFloat4(bounds.extentZ + begin);
+
+			// ComputeAABBDistanceと同じ順序で計算し、全平面での最小値を取る
+			simd::Vector minDist = simd::Splat(FLT_MAX);
+			for (uint32_t i = 0; i < Frustum::PLANE_NUM; i++) {
+				const PlaneVectors& p = planes[i];
+				simd::Vector dist = simd::Add(simd::Add(simd::Add(simd::Mul(p.nx, cx), simd::Mul(p.ny, cy)), simd::Mul(p.nz, cz)), p.d);
+				simd::Vector radius = simd::Add(simd::Add(simd::Mul(p.ax, ex), simd::Mul(p.ay, ey)), simd::Mul(p.az, ez));
+				minDist = simd::Min(minDist, simd::Add(dist, radius));
+			}
+
+			float result[4];
+			simd::StoreFloat4(result, minDist);
+			return (result[0] >= 0.0f ? 0x1 : 0) | (result[1] >= 0.0f ? 0x2 : 0) | (result[2] >= 0.0f ? 0x4 : 0) | (result[3] >= 0.0f ? 0x8 : 0);
+		}
+
+		// maskの立っているビットのインデックスを書き出す
+		// 書き込み位置は常にbegin + bit以下なので、分岐せずに書いてから進める
+		__forceinline void AppendVisible(uint32_t mask, uint32_t begin, uint32_t num, uint32_t* visibleIndices, uint32_t& visibleNum)
+		{
+			for (uint32_t i = 0; i < num; i++) {
+				visibleIndices[visibleNum] = begin + i;
+				visibleNum += (mask >> i) & 1;
+			}
+		}
+
+#if defined(SE_SIMD_AVX2_DISPATCH)
+		// 8個ずつ判定して、処理し終えた位置を返す
+		SE_TARGET_AVX2 uint32_t CullAABBsAVX2(const Plane* planes, const AABBSoA& bounds, uint32_t count, uint32_t* visibleIndices, uint32_t& visibleNum)
+		{
+			__m256 nx[Frustum::PLANE_NUM], ny[Frustum::PLANE_NUM], nz[Frustum::PLANE_NUM];
+			__m256 ax[Frustum::PLANE_NUM], ay[Frustum::PLANE_NUM], az[Frustum::PLANE_NUM];
+			__m256 d[Frustum::PLANE_NUM];
+			for (uint32_t i = 0; i < Frustum::PLANE_NUM; i++) {
+				nx[i] = _mm256_set1_ps(planes[i].normal.x);
+				ny[i] = _mm256_set1_ps(planes[i].normal.y);
+				nz[i] = _mm256_set1_ps(planes[i].normal.z);
+				ax[i] = _mm256_set1_ps(fabsf(planes[i].normal.x));
+				ay[i] = _mm256_set1_ps(fabsf(planes[i].normal.y));
+				az[i] = _mm256_set1_ps(fabsf(planes[i].normal.z));
+				d[i] = _mm256_set1_ps(planes[i].distance);
+			}
+
+			__m256 zero = _mm256_setzero_ps();
+			uint32_t i = 0;
+			for (; i + 8 <= count; i += 8) {
+				__m256 cx = _mm256_loadu_ps(bounds.centerX + i);
+				__m256 cy = _mm256_loadu_ps(bounds.centerY + i);
+				__m256 cz = _mm256_loadu_ps(bounds.centerZ + i);
+				__m256 ex = _mm256_loadu_ps(bounds.extentX + i);
+				__m256 ey = _mm256_loadu_ps(bounds.extentY + i);
+				__m256 ez = _mm256_loadu_ps(bounds.extentZ + i);
+
+				__m256 minDist = _mm256_set1_ps(FLT_MAX);
+				for (uint32_t p = 0; p < Frustum::PLANE_NUM; p++) {
+					__m256 dist = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx[p], cx), _mm256_mul_ps(ny[p], cy)), _mm256_mul_ps(nz[p], cz)), d[p]);
+					__m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax[p], ex), _mm256_mul_ps(ay[p], ey)), _mm256_mul_ps(az[p], ez));
+					minDist = _mm256_min_ps(minDist, _mm256_add_ps(dist, radius));
+				}
+
+				uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(minDist, zero, _CMP_GE_OQ)));
+				AppendVisible(mask, i, 8, visibleIndices, visibleNum);
+			}
+			return i;
+		}
+#endif
+	}
+
+
+	Frustum::Frustum(const Matrix4x4& viewProjection)
+	{
+		Set(viewProjection);
+	}
+
+	void Frustum::Set(const Matrix4x4& viewProjection)
+	{
+		// クリップ座標は行ベクトル×行列なので、各成分は行列の列との内積になる
+		// -w <= x <= w, -w <= y <= w, 0 <= z <= w
+		const Matrix4x4& m = viewProjection;
+		planes_[PLANE_LEFT]   = Plane(float3(m._14 + m._11, m._24 + m._21, m._34 + m._31), m._44 + m._41);
+		planes_[PLANE_RIGHT]  = Plane(float3(m._14 - m._11, m._24 - m._21, m._34 - m._31), m._44 - m._41);
+		planes_[PLANE_BOTTOM] = Plane(float3(m._14 + m._12, m._24 + m._22, m._34 + m._32), m._44 + m._42);
+		planes_[PLANE_TOP]    = Plane(float3(m._14 - m._12, m._24 - m._22, m._34 - m._32), m._44 - m._42);
+		planes_[PLANE_NEAR]   = Plane(float3(m._13, m._23, m._33), m._43);
+		planes_[PLANE_FAR]    = Plane(float3(m._14 - m._13, m._24 - m._23, m._34 - m._33), m._44 - m._43);
+		for (auto& p : planes_) {
+			p.Normalize();
+		}
+	}
+
+	bool Frustum::Contains(const float3& p) const
+	{
+		for (const auto& plane : planes_) {
+			if (plane.GetDistance(p) < 0.0f) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool Frustum::Intersects(const Sphere& sphere) const
+	{
+		for (const auto& plane : planes_) {
+			if (plane.GetDistance(sphere.center) < -sphere.radius) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool Frustum::Intersects(const AABB& box) const
+	{
+		float3 center = box.GetCenter();
+		float3 extent = box.GetExtent();
+		float minDist = FLT_MAX;
+		for (const auto& plane : planes_) {
+			minDist = Min(minDist, ComputeAABBDistance(plane, center, extent));
+		}
+		return minDist >= 0.0f;
+	}
+
+	uint32_t Frustum::CullAABBs(const AABBSoA& bounds, uint32_t count, uint32_t* visibleIndices) const
+	{
+		uint32_t visibleNum = 0;
+		uint32_t i = 0;
+#if defined(SE_SIMD_AVX2_DISPATCH)
+		if (simd::IsAVX2Supported()) {
+			i = CullAABBsAVX2(planes_, bounds, count, visibleIndices, visibleNum);
+		}
+#endif
+
+		PlaneVectors planes[PLANE_NUM];
+		SetupPlaneVectors(planes_, planes);
+		for (; i + 4 <= count; i += 4) {
+			AppendVisible(TestAABBs4(planes, bounds, i), i, 4, visibleIndices, visibleNum);
+		}
+
+		if (i < count) {
+			// 端数は作業領域にコピーして4個で判定する
+			float tail[6][4] = {};
+			uint32_t rest = count - i;
+			for (uint32_t j = 0; j < rest; j++) {
+				tail[0][j] = bounds.centerX[i + j];
+				tail[1][j] = bounds.centerY[i + j];
+				tail[2][j] = bounds.centerZ[i + j];
+				tail[3][j] = bounds.extentX[i + j];
+				tail[4][j] = bounds.extentY[i + j];
+				tail[5][j] = bounds.extentZ[i + j];
+			}
+			AABBSoA tailBounds = { tail[0], tail[1], tail[2], tail[3], tail[4], tail[5] };
+			AppendVisible(TestAABBs4(planes, tailBounds, 0), i, rest, visibleIndices, visibleNum);
+		}
+		return visibleNum;
+	}
+}
@@ -0,0 +1,49 @@
+﻿#pragma once
+
+#include "se/Math/Bounds.h"
+
+namespace se
+{
+	/**
+	 * 視錐台
+	 * ビュー射影行列(行ベクトル×行列、クリップ空間のzは0～1)から6平面を取り出す
+	 * 各平面は内側を表とし、法線は正規化済み
+	 */
+	class Frustum
+	{
+	public:
+		enum PlaneIndex
+		{
+			PLANE_LEFT,
+			PLANE_RIGHT,
+			PLANE_BOTTOM,
+			PLANE_TOP,
+			PLANE_NEAR,
+			PLANE_FAR,
+			PLANE_NUM,
+		};
+
+	private:
+		Plane planes_[PLANE_NUM];
+
+	public:
+		Frustum(){}
+		explicit Frustum(const Matrix4x4& viewProjection);
+
+		void Set(const Matrix4x4& viewProjection);
+		const Plane& GetPlane(uint32_t index) const { return planes_[index]; }
+
+		bool Contains(const float3& p) const;
+		// 平面ごとの判定なので、視錐台の角の外側にあるものは交差していると判定されることがある
+		bool Intersects(const Sphere& sphere) const;
+		bool Intersects(const AABB& box) const;
+
+		/**
+		 * ボックスをまとめて判定して、交差するもののインデックスをvisibleIndicesに書き出す
+		 * SSE/NEON/スカラーでは4個ずつ、AVX2が使えるCPUでは8個ずつ6平面と判定する
+		 * 判定結果はIntersects(const AABB&)と同じ
+		 * visibleIndicesにはcount個分の領域が必要、戻り値は書き出した数
+		 */
+		uint32_t CullAABBs(const AABBSoA& bounds, uint32_t count, uint32_t* visibleIndices) const;
+	};
+}
@@ -1,7 +1,8 @@
 ﻿#pragma once 
 
-#include <DirectXMath.h>
-using namespace DirectX;
+#include "se/Common.h"
+#include "se/Math/SIMD.h"
+#include <float.h>
 
 namespace se
 {
@@ -14,24 +15,22 @@ namespace se
 	/**
 	 * Vector2
 	 */
-	struct Vector2 : public XMFLOAT2
+	struct Vector2
 	{
+		float x, y;
+
 		Vector2() {}
 		Vector2(float xy)
-			: XMFLOAT2(xy, xy)
+			: x(xy), y(xy)
 		{
 		}
 		Vector2(float x, float y)
-			: XMFLOAT2(x, y)
-		{
-		}
-		Vector2(const XMFLOAT2& xy)
-			: XMFLOAT2(xy)
+			: x(x), y(y)
 		{
 		}
-		Vector2(FXMVECTOR v)
+		Vector2(simd::Vector v)
 		{
-			XMStoreFloat2(this, v);
+			simd::StoreFloat2(&x, v);
 		}
 
 		Vector2& operator*=(const Vector2& other)
@@ -61,7 +60,7 @@ namespace se
 			return result;
 		}
 
-		FXMVECTOR ToSIMD() const { return XMLoadFloat2(this); }
+		simd::Vector ToSIMD() const { return simd::LoadFloat2(&x); }
 
 		float* ToFloatArray() { return reinterpret_cast<float*>(this); }
 		const float* ToFloatArray() const { return reinterpret_cast<const float*>(this); }
@@ -71,24 +70,22 @@ namespace se
 	/**
 	 * Vector3
 	 */
-	struct Vector3 : public XMFLOAT3
+	struct Vector3
 	{
+		float x, y, z;
+
 		Vector3(){}
 		Vector3(float xyz)
-			: XMFLOAT3(xyz, xyz, xyz)
+			: x(xyz), y(xyz), z(xyz)
 		{
 		}
 		Vector3(float x, float y, float z)
-			: XMFLOAT3(x, y, z)
+			: x(x), y(y), z(z)
 		{
 		}
-		Vector3(const XMFLOAT3& xyz)
-			: XMFLOAT3(xyz)
+		Vector3(simd::Vector v)
 		{
-		}
-		Vector3(FXMVECTOR v)
-		{
-			XMStoreFloat3(this, v);
+			simd::StoreFloat3(&x, v);
 		}
 
 		Vector3& operator*=(const Vector3& other)
@@ -140,21 +137,19 @@ namespace se
 
 		float Length() const
 		{
-			float length;
-			XMVectorGetXPtr(&length, XMVector3Length(ToSIMD()));
-			return length;
+			simd::Vector v = ToSIMD();
+			return simd::GetX(simd::Sqrt(simd::Dot3(v, v)));
 		}
 
 		void Normalize()
 		{
-			auto res = XMVector3Normalize(ToSIMD());
-			XMStoreFloat3(this, res);
+			simd::StoreFloat3(&x, simd::Vector3Normalize(ToSIMD()));
 		}
 
 		void Transform(const Matrix4x4& m);
 		void Transform(const Quaternion& q);
 
-		FXMVECTOR ToSIMD() const { return XMLoadFloat3(this); }
+		simd::Vector ToSIMD() const { return simd::LoadFloat3(&x); }
 
 		float* ToFloatArray() { return reinterpret_cast<float*>(this); }
 		const float* ToFloatArray() const { return reinterpret_cast<const float*>(this); }
@@ -163,6 +158,7 @@ namespace se
 		static Vector3 Transform(const Vector3& v, const Matrix4x4& m);
 		static Vector3 Transform(const Vector3& v, const Quaternion& q);
 		static Vector3 Cross(const Vector3& a, const Vector3& b);
+		static float Dot(const Vector3& a, const Vector3& b);
 	};
 	typedef Vector3 float3;
 
@@ -170,36 +166,31 @@ namespace se
 	/**
 	 * Vector4
 	 */
-	struct Vector4 : public XMFLOAT4
+	struct Vector4
 	{
+		float x, y, z, w;
+
 		Vector4(){}
 		Vector4(float xyz)
-			: XMFLOAT4(xyz, xyz, xyz, 1.0f)
+			: x(xyz), y(xyz), z(xyz), w(1.0f)
 		{
 		}
 		Vector4(float x, float y, float z, float w)
-			: XMFLOAT4(x, y, z, w)
+			: x(x), y(y), z(z), w(w)
 		{
 		}
-		Vector4(const XMFLOAT4& xyzw)
-			: XMFLOAT4(xyzw)
+		Vector4(const Vector3& xyz)
+			: x(xyz.x), y(xyz.y), z(xyz.z), w(1.0f)
 		{
 		}
-		Vector4(const XMFLOAT3& xyz)
+		Vector4(simd::Vector v)
 		{
-			x = xyz.x;
-			y = xyz.y;
-			z = xyz.z;
-			w = 1.0f;
-		}
-		Vector4(FXMVECTOR v)
-		{
-			XMStoreFloat4(this, v);
+			simd::StoreFloat4(&x, v);
 		}
 
 		void Transform(const Matrix4x4& m);
 
-		FXMVECTOR ToSIMD() const { return XMLoadFloat4(this); }
+		simd::Vector ToSIMD() const { return simd::LoadFloat4(&x); }
 
 		float* ToFloatArray() { return reinterpret_cast<float*>(this); }
 		const float* ToFloatArray() const { return reinterpret_cast<const float*>(this); }
@@ -213,30 +204,48 @@ namespace se
 	/**
 	 * Matrix4x4
 	 */
-	struct Matrix4x4 : public XMFLOAT4X4
+	struct Matrix4x4
 	{
+		union
+		{
+			struct
+			{
+				float _11, _12, _13, _14;
+				float _21, _22, _23, _24;
+				float _31, _32, _33, _34;
+				float _41, _42, _43, _44;
+			};
+			float m[4][4];
+		};
+
 		Matrix4x4()
 		{
 		}
-		Matrix4x4(const XMFLOAT4X4& m)
-			: XMFLOAT4X4(m)
+		Matrix4x4(float m00, float m01, float m02, float m03,
+				  float m10, float m11, float m12, float m13,
+				  float m20, float m21, float m22, float m23,
+				  float m30, float m31, float m32, float m33)
 		{
+			_11 = m00; _12 = m01; _13 = m02; _14 = m03;
+			_21 = m10; _22 = m11; _23 = m12; _24 = m13;
+			_31 = m20; _32 = m21; _33 = m22; _34 = m23;
+			_41 = m30; _42 = m31; _43 = m32; _44 = m33;
 		}
-		Matrix4x4(CXMMATRIX m)
+		Matrix4x4(const simd::Matrix& m)
 		{
-			XMStoreFloat4x4(this, m);
+			for (int i = 0; i < 4; i++) {
+				simd::StoreFloat4(this->m[i], m.r[i]);
+			}
 		}
 
 		Matrix4x4& operator*=(const Matrix4x4& other)
 		{
-			auto result = ToSIMD() * other.ToSIMD();
-			XMStoreFloat4x4(this, result);
+			*this = Matrix4x4(simd::MatrixMultiply(ToSIMD(), other.ToSIMD()));
 			return *this;
 		}
 		Matrix4x4 operator*(const Matrix4x4& other) const
 		{
-			auto result = ToSIMD() * other.ToSIMD();
-			return Matrix4x4(result);
+			return Matrix4x4(simd::MatrixMultiply(ToSIMD(), other.ToSIMD()));
 		}
 
 		bool operator==(const Matrix4x4& other) const
@@ -272,19 +281,23 @@ namespace se
 			_43 = t.z;
 		}
 
-		XMMATRIX ToSIMD() const { return XMLoadFloat4x4(this); }
+		simd::Matrix ToSIMD() const
+		{
+			simd::Matrix result;
+			for (int i = 0; i < 4; i++) {
+				result.r[i] = simd::LoadFloat4(m[i]);
+			}
+			return result;
+		}
 
 		/* static methods */
 		static Matrix4x4 Transpose(const Matrix4x4& m)
 		{
-			return XMMatrixTranspose(m.ToSIMD());
+			return simd::MatrixTranspose(m.ToSIMD());
 		}
 
-		static Matrix4x4 Invert(const Matrix4x4& m)
-		{
-			XMVECTOR det;
-			return XMMatrixInverse(&det, m.ToSIMD());
-		}
+		// 余因子展開による逆行列、正則でなければ全要素が非数・無限大になる
+		static Matrix4x4 Invert(const Matrix4x4& m);
 
 		static Matrix4x4 ScaleMatrix(float s)
 		{
@@ -315,6 +328,12 @@ namespace se
 			m._43 = t.z;
 			return m;
 		}
+
+		// 右手系のビュー行列
+		static Matrix4x4 LookAtRH(const Vector3& eye, const Vector3& at, const Vector3& up);
+
+		// 右手系の透視射影行列(深度は0～1)
+		static Matrix4x4 PerspectiveFovRH(float fovY, float aspect, float nearClip, float farClip);
 	};
 	typedef Matrix4x4 float4x4;
 
@@ -336,7 +355,7 @@ namespace se
 			*this = SetFromAxisAngle(axis, angle);
 		}
 
-		Quaternion(const XMFLOAT4& q)
+		Quaternion(const Vector4& q)
 		{
 			x = q.x;
 			y = q.y;
@@ -344,17 +363,22 @@ namespace se
 			w = q.w;
 		}
 
-		Quaternion(FXMVECTOR q)
+		Quaternion(simd::Vector q)
 		{
-			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(this), q);
+			simd::StoreFloat4(&x, q);
 		}
 
+		// thisの回転の後にotherの回転を行うクォータニオン(DirectXMathのXMQuaternionMultiplyと同じ順序)
 		Quaternion& operator*=(const Quaternion& other)
 		{
-			XMVECTOR q = ToSIMD();
-			q = XMQuaternionMultiply(q, other.ToSIMD());
-			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(this), q);
-
+			const Quaternion& a = *this;
+			const Quaternion& b = other;
+			Quaternion q;
+			q.x = ((b.w * a.x + b.x * a.w) + b.y * a.z) - b.z * a.y;
+			q.y = ((b.w * a.y - b.x * a.z) + b.y * a.w) + b.z * a.x;
+			q.z = ((b.w * a.z + b.x * a.y) - b.y * a.x) + b.z * a.w;
+			q.w = ((b.w * a.w - b.x * a.x) - b.y * a.y) - b.z * a.z;
+			*this = q;
 			return *this;
 		}
 
@@ -377,44 +401,69 @@ namespace se
 
 		float4x4 ToFloat4x4() const
 		{
-			return float4x4(XMMatrixRotationQuaternion(ToSIMD()));
+			float xx = x * x, yy = y * y, zz = z * z;
+			float xy = x * y, xz = x * z, yz = y * z;
+			float wx = w * x, wy = w * y, wz = w * z;
+			return float4x4(
+				1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f,
+				2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f,
+				2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f,
+				0.0f, 0.0f, 0.0f, 1.0f);
 		}
 
-		Quaternion Identity()
+		static Quaternion Identity()
 		{
 			return Quaternion(0.0f, 0.0f, 0.0f, 1.0f);
 		}
 
-		Quaternion Invert(const Quaternion& q)
+		// 長さが0に近ければ0を返す
+		static Quaternion Invert(const Quaternion& q)
 		{
-			return Quaternion(XMQuaternionInverse(q.ToSIMD()));
+			simd::Vector v = q.ToSIMD();
+			float lengthSq = simd::GetX(simd::Dot4(v, v));
+			if (lengthSq <= FLT_EPSILON) {
+				return Quaternion(0.0f, 0.0f, 0.0f, 0.0f);
+			}
+			simd::Vector conjugate = simd::Mul(v, simd::Set(-1.0f, -1.0f, -1.0f, 1.0f));
+			return Quaternion(simd::Div(conjugate, simd::Splat(lengthSq)));
 		}
 
-		Quaternion SetFromAxisAngle(const float3& axis, float angle)
+		static Quaternion SetFromAxisAngle(const float3& axis, float angle)
 		{
-			XMVECTOR q = XMQuaternionRotationAxis(axis.ToSIMD(), angle);
-			return Quaternion(q);
+			simd::Vector n = simd::Vector3Normalize(axis.ToSIMD());
+			float s = sinf(angle * 0.5f);
+			Quaternion q(simd::Mul(n, simd::Splat(s)));
+			q.w = cosf(angle * 0.5f);
+			return q;
 		}
 
-		Quaternion SetFromEuler(float x, float y, float z)
+		// x:pitch(X軸) y:yaw(Y軸) z:roll(Z軸)、roll→pitch→yawの順に回転する
+		static Quaternion SetFromEuler(float x, float y, float z)
 		{
-			XMVECTOR q = XMQuaternionRotationRollPitchYaw(x, y, z);
-			return Quaternion(q);
+			float sp = sinf(x * 0.5f), cp = cosf(x * 0.5f);
+			float sy = sinf(y * 0.5f), cy = cosf(y * 0.5f);
+			float sr = sinf(z * 0.5f), cr = cosf(z * 0.5f);
+			return Quaternion(
+				sp * cy * cr + cp * sy * sr,
+				cp * sy * cr - sp * cy * sr,
+				cp * cy * sr - sp * sy * cr,
+				cp * cy * cr + sp * sy * sr);
 		}
 
-		Quaternion Normalize(const Quaternion& q)
+		static Quaternion Normalize(const Quaternion& q)
 		{
-			return Quaternion(XMQuaternionNormalize(q.ToSIMD()));
+			simd::Vector v = q.ToSIMD();
+			return Quaternion(simd::Div(v, simd::Sqrt(simd::Dot4(v, v))));
 		}
 
-		float4x4 ToFloat4x4(const Quaternion& q)
+		static float4x4 ToFloat4x4(const Quaternion& q)
 		{
 			return q.ToFloat4x4();
 		}
 
-		XMVECTOR ToSIMD() const
+		simd::Vector ToSIMD() const
 		{
-			return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(this));
+			return simd::LoadFloat4(&x);
 		}
 	};
 
@@ -487,8 +536,7 @@ namespace se
 	/** class inline functions **/
 	__forceinline void Vector3::Transform(const Matrix4x4& m)
 	{
-		XMVECTOR vec = ToSIMD();
-		*this = XMVector3TransformCoord(vec, m.ToSIMD());
+		*this = simd::Vector3TransformCoord(ToSIMD(), m.ToSIMD());
 	}
 
 	__forceinline void Vector3::Transform(const Quaternion& q)
@@ -498,9 +546,7 @@ namespace se
 
 	__forceinline Vector3 Vector3::Transform(const Vector3& v, const Matrix4x4& m)
 	{
-		XMVECTOR vec = v.ToSIMD();
-		vec = XMVector3TransformCoord(vec, m.ToSIMD());
-		return Vector3(vec);
+		return Vector3(simd::Vector3TransformCoord(v.ToSIMD(), m.ToSIMD()));
 	}
 
 	__forceinline Vector3 Vector3::Transform(const Vector3& v, const Quaternion& q)
@@ -510,22 +556,94 @@ namespace se
 
 	__forceinline Vector3 Vector3::Cross(const Vector3& a, const Vector3& b)
 	{
-		Vector3 result;
-		XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&result), XMVector3Cross(a.ToSIMD(), b.ToSIMD()));
-		return result;
+		return Vector3(simd::Cross3(a.ToSIMD(), b.ToSIMD()));
+	}
+
+	__forceinline float Vector3::Dot(const Vector3& a, const Vector3& b)
+	{
+		return simd::GetX(simd::Dot3(a.ToSIMD(), b.ToSIMD()));
 	}
 
 
 	__forceinline void Vector4::Transform(const float4x4& m)
 	{
-		XMVECTOR vec = ToSIMD();
-		*this = XMVector4Transform(vec, m.ToSIMD());
+		*this = simd::Vector4Transform(ToSIMD(), m.ToSIMD());
 	}
 
 	__forceinline Vector4 Vector4::Transform(const Vector4& v, const Matrix4x4& m)
 	{
-		XMVECTOR vec = v.ToSIMD();
-		vec = XMVector4Transform(vec, m.ToSIMD());
-		return Vector4(vec);
+		return Vector4(simd::Vector4Transform(v.ToSIMD(), m.ToSIMD()));
+	}
+
+
+	inline Matrix4x4 Matrix4x4::Invert(const Matrix4x4& m)
+	{
+		// 上2行と下2行の2x2小行列式
+		const float (&a)[4][4] = m.m;
+		float s0 = a[0][0] * a[1][1] - a[1][0] * a[0][1];
+		float s1 = a[0][0] * a[1][2] - a[1][0] * a[0][2];
+		float s2 = a[0][0] * a[1][3] - a[1][0] * a[0][3];
+		float s3 = a[0][1] * a[1][2] - a[1][1] * a[0][2];
+		float s4 = a[0][1] * a[1][3] - a[1][1] * a[0][3];
+		float s5 = a[0][2] * a[1][3] - a[1][2] * a[0][3];
+		float c5 = a[2][2] * a[3][3] - a[3][2] * a[2][3];
+		float c4 = a[2][1] * a[3][3] - a[3][1] * a[2][3];
+		float c3 = a[2][1] * a[3][2] - a[3][1] * a[2][2];
+		float c2 = a[2][0] * a[3][3] - a[3][0] * a[2][3];
+		float c1 = a[2][0] * a[3][2] - a[3][0] * a[2][2];
+		float c0 = a[2][0] * a[3][1] - a[3][0] * a[2][1];
+
+		float det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+		float invDet = 1.0f / det;
+
+		return Matrix4x4(
+			( a[1][1] * c5 - a[1][2] * c4 + a[1][3] * c3) * invDet,
+			(-a[0][1] * c5 + a[0][2] * c4 - a[0][3] * c3) * invDet,
+			( a[3][1] * s5 - a[3][2] * s4 + a[3][3] * s3) * invDet,
+			(-a[2][1] * s5 + a[2][2] * s4 - a[2][3] * s3) * invDet,
+
+			(-a[1][0] * c5 + a[1][2] * c2 - a[1][3] * c1) * invDet,
+			( a[0][0] * c5 - a[0][2] * c2 + a[0][3] * c1) * invDet,
+			(-a[3][0] * s5 + a[3][2] * s2 - a[3][3] * s1) * invDet,
+			( a[2][0] * s5 - a[2][2] * s2 + a[2][3] * s1) * invDet,
+
+			( a[1][0] * c4 - a[1][1] * c2 + a[1][3] * c0) * invDet,
+			(-a[0][0] * c4 + a[0][1] * c2 - a[0][3] * c0) * invDet,
+			( a[3][0] * s4 - a[3][1] * s2 + a[3][3] * s0) * invDet,
+			(-a[2][0] * s4 + a[2][1] * s2 - a[2][3] * s0) * invDet,
+
+			(-a[1][0] * c3 + a[1][1] * c1 - a[1][2] * c0) * invDet,
+			( a[0][0] * c3 - a[0][1] * c1 + a[0][2] * c0) * invDet,
+			(-a[3][0] * s3 + a[3][1] * s1 - a[3][2] * s0) * invDet,
+			( a[2][0] * s3 - a[2][1] * s1 + a[2][2] * s0) * invDet);
+	}
+
+	inline Matrix4x4 Matrix4x4::LookAtRH(const Vector3& eye, const Vector3& at, const Vector3& up)
+	{
+		// 右手系なので視線の逆向きをZ軸にする
+		simd::Vector eyePos = eye.ToSIMD();
+		simd::Vector axisZ = simd::Vector3Normalize(simd::Sub(eyePos, at.ToSIMD()));
+		simd::Vector axisX = simd::Vector3Normalize(simd::Cross3(up.ToSIMD(), axisZ));
+		simd::Vector axisY = simd::Cross3(axisZ, axisX);
+
+		simd::Vector negEye = simd::Negate(eyePos);
+		Vector3 x(axisX), y(axisY), z(axisZ);
+		return Matrix4x4(
+			x.x, y.x, z.x, 0.0f,
+			x.y, y.y, z.y, 0.0f,
+			x.z, y.z, z.z, 0.0f,
+			simd::GetX(simd::Dot3(axisX, negEye)), simd::GetX(simd::Dot3(axisY, negEye)), simd::GetX(simd::Dot3(axisZ, negEye)), 1.0f);
+	}
+
+	inline Matrix4x4 Matrix4x4::PerspectiveFovRH(float fovY, float aspect, float nearClip, float farClip)
+	{
+		float height = cosf(fovY * 0.5f) / sinf(fovY * 0.5f);
+		float width = height / aspect;
+		float range = farClip / (nearClip - farClip);
+		return Matrix4x4(
+			width, 0.0f, 0.0f, 0.0f,
+			0.0f, height, 0.0f, 0.0f,
+			0.0f, 0.0f, range, -1.0f,
+			0.0f, 0.0f, range * nearClip, 0.0f);
 	}
 }
\ No newline at end of file
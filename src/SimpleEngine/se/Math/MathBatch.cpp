@@ -0,0 +1,358 @@
+﻿#include "se/Math/MathBatch.h"
+
+namespace se
+{
+namespace batch
+{
+	namespace {
+
+		const size_t AOS_BLOCK_SIZE = 64;		// AoSをSoAに並べ替えて処理する単位
+
+		/* 4要素版(全バックエンド) */
+
+		// beginから4要素ずつ処理して、処理し終えた位置を返す
+		size_t TransformPoints4(const Float3SoA& in, const Float3SoA& out, size_t begin, size_t count, const Matrix4x4& m)
+		{
+			simd::Vector m11 = simd::Splat(m._11), m12 = simd::Splat(m._12), m13 = simd::Splat(m._13), m14 = simd::Splat(m._14);
+			simd::Vector m21 = simd::Splat(m._21), m22 = simd::Splat(m._22), m23 = simd::Splat(m._23), m24 = simd::Splat(m._24);
+			simd::Vector m31 = simd::Splat(m._31), m32 = simd::Splat(m._32), m33 = simd::Splat(m._33), m34 = simd::Splat(m._34);
+			simd::Vector m41 = simd::Splat(m._41), m42 = simd::Splat(m._42), m43 = simd::Splat(m._43), m44 = simd::Splat(m._44);
+
+			size_t i = begin;
+			for (; i + 4 <= count; i += 4) {
+				simd::Vector x = simd::LoadFloat4(in.x + i);
+				simd::Vector y = simd::LoadFloat4(in.y + i);
+				simd::Vector z = simd::LoadFloat4(in.z + i);
+
+				// simd::Vector3TransformCoordと同じ順序で足す
+				simd::Vector rx = simd::MultiplyAdd(z, m31, m41);
+				simd::Vector ry = simd::MultiplyAdd(z, m32, m42);
+				simd::Vector rz = simd::MultiplyAdd(z, m33, m43);
+				simd::Vector rw = simd::MultiplyAdd(z, m34, m44);
+				rx = simd::MultiplyAdd(y, m21, rx);
+				ry = simd::MultiplyAdd(y, m22, ry);
+				rz = simd::MultiplyAdd(y, m23, rz);
+				rw = simd::MultiplyAdd(y, m24, rw);
+				rx = simd::MultiplyAdd(x, m11, rx);
+				ry = simd::MultiplyAdd(x, m12, ry);
+				rz = simd::MultiplyAdd(x, m13, rz);
+				rw = simd::MultiplyAdd(x, m14, rw);
+
+				simd::StoreFloat4(out.x + i, simd::Div(rx, rw));
+				simd::StoreFloat4(out.y + i, simd::Div(ry, rw));
+				simd::StoreFloat4(out.z + i, simd::Div(rz, rw));
+			}
+			return i;
+		}
+
+		size_t NormalizeVectors4(const Float3SoA& in, const Float3SoA& out, size_t begin, size_t count)
+		{
+			simd::Vector zero = simd::Zero();
+			size_t i = begin;
+			for (; i + 4 <= count; i += 4) {
+				simd::Vector x = simd::LoadFloat4(in.x + i);
+				simd::Vector y = simd::LoadFloat4(in.y + i);
+				simd::Vector z = simd::LoadFloat4(in.z + i);
+
+				// simd::Dot3と同じく ((x + y) + z)
+				simd::Vector dot = simd::Add(simd::Mul(x, x), simd::Mul(y, y));
+				dot = simd::Add(dot, simd::Mul(z, z));
+				simd::Vector length = simd::Sqrt(dot);
+				simd::Vector valid = simd::Greater(length, zero);
+
+				simd::StoreFloat4(out.x + i, simd::Select(zero, simd::Div(x, length), valid));
+				simd::StoreFloat4(out.y + i, simd::Select(zero, simd::Div(y, length), valid));
+				simd::StoreFloat4(out.z + i, simd::Select(zero, simd::Div(z, length), valid));
+			}
+			return i;
+		}
+
+		// 4要素分、Quaternion::ToFloat4x4と同じ式で回転を作り、スケールと平行移動を入れる
+		void ComposeTRS4(const Vector3* translation, const Quaternion* rotation, const Vector3* scale, Matrix4x4* out)
+		{
+			simd::Matrix q;
+			simd::Matrix s;
+			for (int i = 0; i < 4; i++) {
+				q.r[i] = rotation[i].ToSIMD();
+				s.r[i] = scale[i].ToSIMD();
+			}
+			q = simd::MatrixTranspose(q);
+			s = simd::MatrixTranspose(s);
+			simd::Vector x = q.r[0], y = q.r[1], z = q.r[2], w = q.r[3];
+
+			simd::Vector one = simd::Splat(1.0f);
+			simd::Vector two = simd::Splat(2.0f);
+			simd::Vector xx = simd::Mul(x, x), yy = simd::Mul(y, y), zz = simd::Mul(z, z);
+			simd::Vector xy = simd::Mul(x, y), xz = simd::Mul(x, z), yz = simd::Mul(y, z);
+			simd::Vector wx = simd::Mul(w, x), wy = simd::Mul(w, y), wz = simd::Mul(w, z);
+
+			simd::Matrix rows[3];
+			rows[0].r[0] = simd::Sub(one, simd::Mul(two, simd::Add(yy, zz)));
+			rows[0].r[1] = simd::Mul(two, simd::Add(xy, wz));
+			rows[0].r[2] = simd::Mul(two, simd::Sub(xz, wy));
+			rows[1].r[0] = simd::Mul(two, simd::Sub(xy, wz));
+			rows[1].r[1] = simd::Sub(one, simd::Mul(two, simd::Add(xx, zz)));
+			rows[1].r[2] = simd::Mul(two, simd::Add(yz, wx));
+			rows[2].r[0] = simd::Mul(two, simd::Add(xz, wy));
+			rows[2].r[1] = simd::Mul(two, simd::Sub(yz, wx));
+			rows[2].r[2] = simd::Sub(one, simd::Mul(two, simd::Add(xx, yy)));
+
+			for (int row = 0; row < 3; row++) {
+				for (int column = 0; column < 3; column++) {
+					rows[row].r[column] = simd::Mul(s.r[row], rows[row].r[column]);
+				}
+				rows[row].r[3] = simd::Zero();
+
+				// 要素ごとの行に並べ直す
+				simd::Matrix transposed = simd::MatrixTranspose(rows[row]);
+				for (int i = 0; i < 4; i++) {
+					simd::StoreFloat4(out[i].m[row], transposed.r[i]);
+				}
+			}
+			for (int i = 0; i < 4; i++) {
+				out[i].m[3][0] = translation[i].x;
+				out[i].m[3][1] = translation[i].y;
+				out[i].m[3][2] = translation[i].z;
+				out[i].m[3][3] = 1.0f;
+			}
+		}
+
+
+		/* AVX2版(8要素) */
+#if defined(SE_SIMD_AVX2_DISPATCH)
+
+		SE_TARGET_AVX2 size_t TransformPointsAVX2(const Float3SoA& in, const Float3SoA& out, size_t count, const Matrix4x4& m)
+		{
+			__m256 m11 = _mm256_set1_ps(m._11), m12 = _mm256_set1_ps(m._12), m13 = _mm256_set1_ps(m._13), m14 = _mm256_set1_ps(m._14);
+			__m256 m21 = _mm256_set1_ps(m._21), m22 = _mm256_set1_ps(m._22), m23 = _mm256_set1_ps(m._23), m24 = _mm256_set1_ps(m._24);
+			__m256 m31 = _mm256_set1_ps(m._31), m32 = _mm256_set1_ps(m._32), m33 = _mm256_set1_ps(m._33), m34 = _mm256_set1_ps(m._34);
+			__m256 m41 = _mm256_set1_ps(m._41), m42 = _mm256_set1_ps(m._42), m43 = _mm256_set1_ps(m._43), m44 = _mm256_set1_ps(m._44);
+
+			// 1要素版と結果を揃えるためFMAは使わない
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8) {
+				__m256 x = _mm256_loadu_ps(in.x + i);
+				__m256 y = _mm256_loadu_ps(in.y + i);
+				__m256 z = _mm256_loadu_ps(in.z + i);
+
+				__m256 rx = _mm256_add_ps(_mm256_mul_ps(z, m31), m41);
+				__m256 ry = _mm256_add_ps(_mm256_mul_ps(z, m32), m42);
+				__m256 rz = _mm256_add_ps(_mm256_mul_ps(z, m33), m43);
+				__m256 rw = _mm256_add_ps(_mm256_mul_ps(z, m34), m44);
+				rx = _mm256_add_ps(_mm256_mul_ps(y, m21), rx);
+				ry = _mm256_add_ps(_mm256_mul_ps(y, m22), ry);
+				rz = _mm256_add_ps(_mm256_mul_ps(y, m23), rz);
+				rw = _mm256_add_ps(_mm256_mul_ps(y, m24), rw);
+				rx = _mm256_add_ps(_mm256_mul_ps(x, m11), rx);
+				ry = _mm256_add_ps(_mm256_mul_ps(x, m12), ry);
+				rz = _mm256_add_ps(_mm256_mul_ps(x, m13), rz);
+				rw = _mm256_add_ps(_mm256_mul_ps(x, m14), rw);
+
+				_mm256_storeu_ps(out.x + i, _mm256_div_ps(rx, rw));
+				_mm256_storeu_ps(out.y + i, _mm256_div_ps(ry, rw));
+				_mm256_storeu_ps(out.z + i, _mm256_div_ps(rz, rw));
+			}
+			return i;
+		}
+
+		SE_TARGET_AVX2 size_t NormalizeVectorsAVX2(const Float3SoA& in, const Float3SoA& out, size_t count)
+		{
+			__m256 zero = _mm256_setzero_ps();
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8) {
+				__m256 x = _mm256_loadu_ps(in.x + i);
+				__m256 y = _mm256_loadu_ps(in.y + i);
+				__m256 z = _mm256_loadu_ps(in.z + i);
+
+				__m256 dot = _mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y));
+				dot = _mm256_add_ps(dot, _mm256_mul_ps(z, z));
+				__m256 length = _mm256_sqrt_ps(dot);
+				__m256 valid = _mm256_cmp_ps(length, zero, _CMP_GT_OQ);
+
+				_mm256_storeu_ps(out.x + i, _mm256_and_ps(valid, _mm256_div_ps(x, length)));
+				_mm256_storeu_ps(out.y + i, _mm256_and_ps(valid, _mm256_div_ps(y, length)));
+				_mm256_storeu_ps(out.z + i, _mm256_and_ps(valid, _mm256_div_ps(z, length)));
+			}
+			return i;
+		}
+
+		// 2行ずつ a * b、bの各行は上下128bitに同じ行を入れておく
+		// simd::MatrixMultiplyと同じく (x * b0 + z * b2) + (y * b1 + w * b3)
+		SE_TARGET_AVX2 inline void MultiplyMatrixAVX2(const float* a, const __m256* b, float* out)
+		{
+			__m256 rows[2] = { _mm256_loadu_ps(a), _mm256_loadu_ps(a + 8) };
+			for (int i = 0; i < 2; i++) {
+				__m256 x = _mm256_mul_ps(_mm256_shuffle_ps(rows[i], rows[i], _MM_SHUFFLE(0, 0, 0, 0)), b[0]);
+				__m256 y = _mm256_mul_ps(_mm256_shuffle_ps(rows[i], rows[i], _MM_SHUFFLE(1, 1, 1, 1)), b[1]);
+				x = _mm256_add_ps(_mm256_mul_ps(_mm256_shuffle_ps(rows[i], rows[i], _MM_SHUFFLE(2, 2, 2, 2)), b[2]), x);
+				y = _mm256_add_ps(_mm256_mul_ps(_mm256_shuffle_ps(rows[i], rows[i], _MM_SHUFFLE(3, 3, 3, 3)), b[3]), y);
+				rows[i] = _mm256_add_ps(x, y);
+			}
+			_mm256_storeu_ps(out, rows[0]);
+			_mm256_storeu_ps(out + 8, rows[1]);
+		}
+
+		SE_TARGET_AVX2 void MultiplyMatricesAVX2(const Matrix4x4* a, const Matrix4x4* b, Matrix4x4* out, size_t count)
+		{
+			for (size_t i = 0; i < count; i++) {
+				__m256 rows[4];
+				for (int k = 0; k < 4; k++) {
+					rows[k] = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b[i].m[k]));
+				}
+				MultiplyMatrixAVX2(a[i].m[0], rows, out[i].m[0]);
+			}
+		}
+
+		SE_TARGET_AVX2 void MultiplyMatricesAVX2(const Matrix4x4* a, const Matrix4x4& b, Matrix4x4* out, size_t count)
+		{
+			__m256 rows[4];
+			for (int k = 0; k < 4; k++) {
+				rows[k] = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b.m[k]));
+			}
+			for (size_t i = 0; i < count; i++) {
+				MultiplyMatrixAVX2(a[i].m[0], rows, out[i].m[0]);
+			}
+		}
+
+#endif
+
+		// 4要素に満たない端数を一時領域に移して4要素版で処理する
+		template<class Kernel>
+		void ProcessTail(const Float3SoA& in, const Float3SoA& out, size_t begin, size_t count, Kernel kernel)
+		{
+			if (begin >= count) {
+				return;
+			}
+			float x[4] = {}, y[4] = {}, z[4] = {};
+			size_t size = (count - begin) * sizeof(float);
+			memcpy(x, in.x + begin, size);
+			memcpy(y, in.y + begin, size);
+			memcpy(z, in.z + begin, size);
+			Float3SoA temp = { x, y, z };
+			kernel(temp, temp, 0, 4);
+			memcpy(out.x + begin, x, size);
+			memcpy(out.y + begin, y, size);
+			memcpy(out.z + begin, z, size);
+		}
+
+		// AoSをブロックごとにSoAに並べ替えて処理する
+		template<class Function>
+		void ProcessAoS(const Vector3* in, Vector3* out, size_t count, Function function)
+		{
+			float x[AOS_BLOCK_SIZE], y[AOS_BLOCK_SIZE], z[AOS_BLOCK_SIZE];
+			Float3SoA block = { x, y, z };
+			for (size_t begin = 0; begin < count; begin += AOS_BLOCK_SIZE) {
+				size_t num = Min(count - begin, AOS_BLOCK_SIZE);
+				for (size_t i = 0; i < num; i++) {
+					x[i] = in[begin + i].x;
+					y[i] = in[begin + i].y;
+					z[i] = in[begin + i].z;
+				}
+				function(block, num);
+				for (size_t i = 0; i < num; i++) {
+					out[begin + i] = Vector3(x[i], y[i], z[i]);
+				}
+			}
+		}
+	}
+
+
+	const char* GetBackendName()
+	{
+		return simd::IsAVX2Supported() ? "AVX2" : SE_SIMD_BACKEND_NAME;
+	}
+
+	void TransformPoints(const Float3SoA& in, const Float3SoA& out, size_t count, const Matrix4x4& m)
+	{
+		size_t i = 0;
+#if defined(SE_SIMD_AVX2_DISPATCH)
+		if (simd::IsAVX2Supported()) {
+			i = TransformPointsAVX2(in, out, count, m);
+		}
+#endif
+		i = TransformPoints4(in, out, i, count, m);
+		ProcessTail(in, out, i, count, [&m](const Float3SoA& in, const Float3SoA& out, size_t begin, size_t count) {
+			TransformPoints4(in, out, begin, count, m);
+		});
+	}
+
+	void TransformPoints(const Vector3* in, Vector3* out, size_t count, const Matrix4x4& m)
+	{
+		ProcessAoS(in, out, count, [&m](const Float3SoA& block, size_t num) {
+			TransformPoints(block, block, num, m);
+		});
+	}
+
+	void NormalizeVectors(const Float3SoA& in, const Float3SoA& out, size_t count)
+	{
+		size_t i = 0;
+#if defined(SE_SIMD_AVX2_DISPATCH)
+		if (simd::IsAVX2Supported()) {
+			i = NormalizeVectorsAVX2(in, out, count);
+		}
+#endif
+		i = NormalizeVectors4(in, out, i, count);
+		ProcessTail(in, out, i, count, NormalizeVectors4);
+	}
+
+	void NormalizeVectors(const Vector3* in, Vector3* out, size_t count)
+	{
+		ProcessAoS(in, out, count, [](const Float3SoA& block, size_t num) {
+			NormalizeVectors(block, block, num);
+		});
+	}
+
+	void MultiplyMatrices(const Matrix4x4* a, const Matrix4x4* b, Matrix4x4* out, size_t count)
+	{
+#if defined(SE_SIMD_AVX2_DISPATCH)
+		if (simd::IsAVX2Supported()) {
+			MultiplyMatricesAVX2(a, b, out, count);
+			return;
+		}
+#endif
+		for (size_t i = 0; i < count; i++) {
+			out[i] = Matrix4x4(simd::MatrixMultiply(a[i].ToSIMD(), b[i].ToSIMD()));
+		}
+	}
+
+	void MultiplyMatrices(const Matrix4x4* a, const Matrix4x4& b, Matrix4x4* out, size_t count)
+	{
+#if defined(SE_SIMD_AVX2_DISPATCH)
+		if (simd::IsAVX2Supported()) {
+			MultiplyMatricesAVX2(a, b, out, count);
+			return;
+		}
+#endif
+		simd::Matrix rhs = b.ToSIMD();
+		for (size_t i = 0; i < count; i++) {
+			out[i] = Matrix4x4(simd::MatrixMultiply(a[i].ToSIMD(), rhs));
+		}
+	}
+
+	void ComposeTRS(const Vector3* translation, const Quaternion* rotation, const Vector3* scale, Matrix4x4* out, size_t count)
+	{
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			ComposeTRS4(translation + i, rotation + i, scale + i, out + i);
+		}
+		if (i < count) {
+			// 端数は単位変換で埋めて4要素で処理する
+			Vector3 t[4] = { Vector3(0.0f), Vector3(0.0f), Vector3(0.0f), Vector3(0.0f) };
+			Quaternion r[4] = { Quaternion::Identity(), Quaternion::Identity(), Quaternion::Identity(), Quaternion::Identity() };
+			Vector3 s[4] = { Vector3(1.0f), Vector3(1.0f), Vector3(1.0f), Vector3(1.0f) };
+			Matrix4x4 m[4];
+			size_t rest = count - i;
+			for (size_t j = 0; j < rest; j++) {
+				t[j] = translation[i + j];
+				r[j] = rotation[i + j];
+				s[j] = scale[i + j];
+			}
+			ComposeTRS4(t, r, s, m);
+			for (size_t j = 0; j < rest; j++) {
+				out[i + j] = m[j];
+			}
+		}
+	}
+
+}
+}
@@ -0,0 +1,46 @@
+﻿#pragma once
+
+#include "se/Math/Math.h"
+
+namespace se
+{
+	/**
+	 * SoA形式の3要素ベクトル列
+	 * x, y, zはそれぞれ要素数分の連続した配列を指す
+	 */
+	struct Float3SoA
+	{
+		float* x;
+		float* y;
+		float* z;
+	};
+
+
+	/**
+	 * まとめて処理する数学関数
+	 * SSE/NEON/スカラーでは4要素ずつ、AVX2が使えるCPUでは実行時に切り替えて8要素ずつ処理する(ComposeTRSは常に4要素ずつ)
+	 * 要素ごとの演算の順序はMath.hの1要素版と同じなので、結果も1要素版と一致する
+	 * 入力と出力は同じ配列を指してもよい(部分的に重なるのは不可)
+	 */
+	namespace batch
+	{
+		// 使用中の実装名("AVX2"や"SSE"など)
+		const char* GetBackendName();
+
+		// out[i] = Vector3::Transform(in[i], m)
+		void TransformPoints(const Float3SoA& in, const Float3SoA& out, size_t count, const Matrix4x4& m);
+		void TransformPoints(const Vector3* in, Vector3* out, size_t count, const Matrix4x4& m);
+
+		// in[i]を正規化する、長さが0ならゼロベクトル
+		void NormalizeVectors(const Float3SoA& in, const Float3SoA& out, size_t count);
+		void NormalizeVectors(const Vector3* in, Vector3* out, size_t count);
+
+		// out[i] = a[i] * b[i]
+		void MultiplyMatrices(const Matrix4x4* a, const Matrix4x4* b, Matrix4x4* out, size_t count);
+		// out[i] = a[i] * b (インスタンスの行列にビュー射影を掛ける場合など)
+		void MultiplyMatrices(const Matrix4x4* a, const Matrix4x4& b, Matrix4x4* out, size_t count);
+
+		// out[i] = ScaleMatrix(scale[i]) * rotation[i].ToFloat4x4() * TranslationMatrix(translation[i])
+		void ComposeTRS(const Vector3* translation, const Quaternion* rotation, const Vector3* scale, Matrix4x4* out, size_t count);
+	}
+}
@@ -0,0 +1,496 @@
+﻿#include "se/Math/Packing.h"
+
+namespace se
+{
+namespace packing
+{
+	namespace {
+
+		/* 整数との変換(バックエンドごと) */
+
+#if SE_SIMD_BACKEND == SE_SIMD_SSE
+		// 最近接偶数丸めで整数にする(MXCSRの丸めモードが既定のままであること)
+		__forceinline void StoreInt4(int32_t* p, simd::Vector v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_cvtps_epi32(v)); }
+		__forceinline simd::Vector LoadInt4(const int32_t* p) { return _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))); }
+#elif SE_SIMD_BACKEND == SE_SIMD_NEON
+		__forceinline void StoreInt4(int32_t* p, simd::Vector v) { vst1q_s32(p, vcvtnq_s32_f32(v)); }
+		__forceinline simd::Vector LoadInt4(const int32_t* p) { return vcvtq_f32_s32(vld1q_s32(p)); }
+#else
+		__forceinline void StoreInt4(int32_t* p, simd::Vector v)
+		{
+			for (int i = 0; i < 4; i++) {
+				p[i] = static_cast<int32_t>(nearbyintf(v.f[i]));
+			}
+		}
+		__forceinline simd::Vector LoadInt4(const int32_t* p)
+		{
+			return simd::Set(static_cast<float>(p[0]), static_cast<float>(p[1]), static_cast<float>(p[2]), static_cast<float>(p[3]));
+		}
+#endif
+
+		// NaNを0にしてから[lo, hi]に収めてscaleを掛ける
+		__forceinline simd::Vector Quantize(simd::Vector v, simd::Vector lo, simd::Vector hi, simd::Vector scale)
+		{
+			simd::Vector isNumber = simd::Greater(simd::Abs(v), simd::Splat(-1.0f));
+			v = simd::Select(simd::Zero(), v, isNumber);
+			return simd::Mul(simd::Min(simd::Max(v, lo), hi), scale);
+		}
+
+		// float配列を整数型Tの配列にする
+		template<class T>
+		void QuantizeArray(const float* in, T* out, size_t count, float lo, float hi, float scale)
+		{
+			simd::Vector vlo = simd::Splat(lo);
+			simd::Vector vhi = simd::Splat(hi);
+			simd::Vector vscale = simd::Splat(scale);
+			int32_t quantized[4];
+
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				StoreInt4(quantized, Quantize(simd::LoadFloat4(in + i), vlo, vhi, vscale));
+				for (int j = 0; j < 4; j++) {
+					out[i + j] = static_cast<T>(quantized[j]);
+				}
+			}
+			if (i < count) {
+				float padded[4] = {};
+				for (size_t j = i; j < count; j++) {
+					padded[j - i] = in[j];
+				}
+				StoreInt4(quantized, Quantize(simd::LoadFloat4(padded), vlo, vhi, vscale));
+				for (size_t j = i; j < count; j++) {
+					out[j] = static_cast<T>(quantized[j - i]);
+				}
+			}
+		}
+
+		// 整数型Tの配列をscaleを掛けてfloat配列にする、結果はlo以上にする
+		template<class T>
+		void DequantizeArray(const T* in, float* out, size_t count, float lo, float scale)
+		{
+			simd::Vector vlo = simd::Splat(lo);
+			simd::Vector vscale = simd::Splat(scale);
+			int32_t values[4];
+
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				for (int j = 0; j < 4; j++) {
+					values[j] = in[i + j];
+				}
+				simd::StoreFloat4(out + i, simd::Max(simd::Mul(LoadInt4(values), vscale), vlo));
+			}
+			if (i < count) {
+				float result[4];
+				for (int j = 0; j < 4; j++) {
+					values[j] = (i + j < count) ? in[i + j] : 0;
+				}
+				simd::StoreFloat4(result, simd::Max(simd::Mul(LoadInt4(values), vscale), vlo));
+				for (size_t j = i; j < count; j++) {
+					out[j] = result[j - i];
+				}
+			}
+		}
+
+		// Vector4を要素ごとのビット数(bits)で詰める
+		void PackVector4(const Vector4* in, uint32_t* out, size_t count, const int bits[4], simd::Vector lo, simd::Vector scale)
+		{
+			simd::Vector hi = simd::Splat(1.0f);
+			int32_t quantized[4];
+			uint32_t masks[4];
+			int shifts[4];
+			int shift = 0;
+			for (int j = 0; j < 4; j++) {
+				masks[j] = (1u << bits[j]) - 1;
+				shifts[j] = shift;
+				shift += bits[j];
+			}
+
+			for (size_t i = 0; i < count; i++) {
+				StoreInt4(quantized, Quantize(simd::LoadFloat4(&in[i].x), lo, hi, scale));
+				uint32_t packed = 0;
+				for (int j = 0; j < 4; j++) {
+					packed |= (static_cast<uint32_t>(quantized[j]) & masks[j]) << shifts[j];
+				}
+				out[i] = packed;
+			}
+		}
+
+		// PackVector4の逆、signedなら各要素を符号拡張する
+		void UnpackVector4(const uint32_t* in, Vector4* out, size_t count, const int bits[4], bool isSigned, simd::Vector scale)
+		{
+			simd::Vector lo = simd::Splat(isSigned ? -1.0f : 0.0f);
+			int32_t values[4];
+			for (size_t i = 0; i < count; i++) {
+				uint32_t packed = in[i];
+				int shift = 0;
+				for (int j = 0; j < 4; j++) {
+					// 上位に寄せてから算術シフトで戻す
+					int32_t v = static_cast<int32_t>(packed << (32 - bits[j] - shift));
+					values[j] = isSigned ? (v >> (32 - bits[j])) : static_cast<int32_t>(static_cast<uint32_t>(v) >> (32 - bits[j]));
+					shift += bits[j];
+				}
+				simd::StoreFloat4(&out[i].x, simd::Max(simd::Mul(LoadInt4(values), scale), lo));
+			}
+		}
+
+		const int RGBA8_BITS[4] = { 8, 8, 8, 8 };
+		const int RGB10A2_BITS[4] = { 10, 10, 10, 2 };
+
+
+		/* 八面体マッピング */
+
+		// v >= 0 なら1、それ以外は-1
+		__forceinline simd::Vector SignNotZero(simd::Vector v)
+		{
+			return simd::Select(simd::Splat(1.0f), simd::Splat(-1.0f), simd::Greater(simd::Zero(), v));
+		}
+
+		// 4要素分のx, y, zを(u, v)にする
+		__forceinline void EncodeOctahedral4(simd::Vector x, simd::Vector y, simd::Vector z, simd::Vector& u, simd::Vector& v)
+		{
+			simd::Vector one = simd::Splat(1.0f);
+			simd::Vector l1 = simd::Add(simd::Add(simd::Abs(x), simd::Abs(y)), simd::Abs(z));
+			simd::Vector invL1 = simd::Div(one, simd::Max(l1, simd::Splat(1e-30f)));
+			simd::Vector px = simd::Mul(x, invL1);
+			simd::Vector py = simd::Mul(y, invL1);
+
+			// 下半球は対角線で折り返す
+			simd::Vector foldX = simd::Mul(simd::Sub(one, simd::Abs(py)), SignNotZero(px));
+			simd::Vector foldY = simd::Mul(simd::Sub(one, simd::Abs(px)), SignNotZero(py));
+			simd::Vector lower = simd::Greater(simd::Zero(), z);
+			u = simd::Select(px, foldX, lower);
+			v = simd::Select(py, foldY, lower);
+		}
+
+		__forceinline void DecodeOctahedral4(simd::Vector u, simd::Vector v, simd::Vector& x, simd::Vector& y, simd::Vector& z)
+		{
+			simd::Vector zero = simd::Zero();
+			z = simd::Sub(simd::Sub(simd::Splat(1.0f), simd::Abs(u)), simd::Abs(v));
+			simd::Vector t = simd::Max(simd::Negate(z), zero);
+			x = simd::Add(u, simd::Select(simd::Negate(t), t, simd::Greater(zero, u)));
+			y = simd::Add(v, simd::Select(simd::Negate(t), t, simd::Greater(zero, v)));
+
+			// |u| + |v| <= 1なので長さは0にならない
+			simd::Vector length = simd::Sqrt(simd::Add(simd::Add(simd::Mul(x, x), simd::Mul(y, y)), simd::Mul(z, z)));
+			x = simd::Div(x, length);
+			y = simd::Div(y, length);
+			z = simd::Div(z, length);
+		}
+
+		// Vector3を4要素ずつSoAに並べ替えて処理する、端数は(0, 0, 1)で埋める
+		template<class Func>
+		void ForEachVector3Block(const Vector3* in, size_t count, Func func)
+		{
+			for (size_t i = 0; i < count; i += 4) {
+				Vector3 block[4] = { Vector3(0.0f, 0.0f, 1.0f), Vector3(0.0f, 0.0f, 1.0f), Vector3(0.0f, 0.0f, 1.0f), Vector3(0.0f, 0.0f, 1.0f) };
+				size_t num = (std::min)(count - i, static_cast<size_t>(4));
+				for (size_t j = 0; j < num; j++) {
+					block[j] = in[i + j];
+				}
+				simd::Vector x = simd::Set(block[0].x, block[1].x, block[2].x, block[3].x);
+				simd::Vector y = simd::Set(block[0].y, block[1].y, block[2].y, block[3].y);
+				simd::Vector z = simd::Set(block[0].z, block[1].z, block[2].z, block[3].z);
+				func(i, num, x, y, z);
+			}
+		}
+
+		__forceinline void StoreVector3Block(Vector3* out, size_t num, simd::Vector x, simd::Vector y, simd::Vector z)
+		{
+			float fx[4], fy[4], fz[4];
+			simd::StoreFloat4(fx, x);
+			simd::StoreFloat4(fy, y);
+			simd::StoreFloat4(fz, z);
+			for (size_t j = 0; j < num; j++) {
+				out[j] = Vector3(fx[j], fy[j], fz[j]);
+			}
+		}
+
+
+		/* 半精度浮動小数点 */
+
+		inline uint32_t FloatToBits(float f)
+		{
+			uint32_t u;
+			memcpy(&u, &f, sizeof(u));
+			return u;
+		}
+		inline float BitsToFloat(uint32_t u)
+		{
+			float f;
+			memcpy(&f, &u, sizeof(f));
+			return f;
+		}
+
+#if defined(SE_SIMD_AVX2_DISPATCH)
+		// 8要素ずつ処理して、処理し終えた位置を返す
+		SE_TARGET_F16C size_t FloatToHalfF16C(const float* in, uint16_t* out, size_t count)
+		{
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8) {
+				__m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), h);
+			}
+			for (; i + 4 <= count; i += 4) {
+				__m128i h = _mm_cvtps_ph(_mm_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT);
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), h);
+			}
+			return i;
+		}
+
+		SE_TARGET_F16C size_t HalfToFloatF16C(const uint16_t* in, float* out, size_t count)
+		{
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8) {
+				__m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+				_mm256_storeu_ps(out + i, _mm256_cvtph_ps(h));
+			}
+			for (; i + 4 <= count; i += 4) {
+				__m128i h = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i));
+				_mm_storeu_ps(out + i, _mm_cvtph_ps(h));
+			}
+			return i;
+		}
+#elif SE_SIMD_BACKEND == SE_SIMD_NEON
+		size_t FloatToHalfNEON(const float* in, uint16_t* out, size_t count)
+		{
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				vst1_u16(out + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(in + i))));
+			}
+			return i;
+		}
+
+		size_t HalfToFloatNEON(const uint16_t* in, float* out, size_t count)
+		{
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				vst1q_f32(out + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(in + i))));
+			}
+			return i;
+		}
+#endif
+	}
+
+	const char* GetHalfBackendName()
+	{
+#if defined(SE_SIMD_AVX2_DISPATCH)
+		return simd::IsF16CSupported() ? "F16C" : "Scalar";
+#elif SE_SIMD_BACKEND == SE_SIMD_NEON
+		return "NEON";
+#else
+		return "Scalar";
+#endif
+	}
+
+	uint16_t FloatToHalf(float f)
+	{
+		uint32_t u = FloatToBits(f);
+		uint32_t sign = u & 0x80000000;
+		u ^= sign;
+
+		uint32_t h;
+		if (u >= 0x47800000) {
+			// 無限大かNaN、NaNは上位の仮数を残してquietにする(F16Cと同じ)
+			h = (u > 0x7F800000) ? (0x7E00 | ((u >> 13) & 0x3FF)) : 0x7C00;
+		} else if (u < 0x38800000) {
+			// 半精度では非正規化数か0、0.5を足して仮数の下位に揃えるとFPUの丸めで偶数丸めになる
+			const uint32_t denormMagic = ((127 - 15) + (23 - 10) + 1) << 23;
+			h = FloatToBits(BitsToFloat(u) + BitsToFloat(denormMagic)) - denormMagic;
+		} else {
+			// 指数の付け替えと偶数丸め
+			uint32_t mantissaOdd = (u >> 13) & 1;
+			u += (static_cast<uint32_t>(15 - 127) << 23) + 0xFFF;
+			u += mantissaOdd;
+			h = u >> 13;
+		}
+		return static_cast<uint16_t>(h | (sign >> 16));
+	}
+
+	float HalfToFloat(uint16_t h)
+	{
+		const uint32_t shiftedExponent = 0x7C00 << 13;
+		uint32_t u = (h & 0x7FFF) << 13;
+		uint32_t exponent = u & shiftedExponent;
+		u += (127 - 15) << 23;
+
+		if (exponent == shiftedExponent) {
+			// 無限大かNaN、NaNはquietにする(F16Cと同じ)
+			u += (128 - 16) << 23;
+			if (u & 0x007FFFFF) {
+				u |= 0x00400000;
+			}
+		} else if (exponent == 0) {
+			// 非正規化数は指数を1つ上げてから暗黙の1の分を引く
+			const uint32_t magic = 113 << 23;
+			u += 1 << 23;
+			u = FloatToBits(BitsToFloat(u) - BitsToFloat(magic));
+		}
+		return BitsToFloat(u | ((h & 0x8000) << 16));
+	}
+
+	void FloatToHalf(const float* in, uint16_t* out, size_t count)
+	{
+		size_t i = 0;
+#if defined(SE_SIMD_AVX2_DISPATCH)
+		if (simd::IsF16CSupported()) {
+			i = FloatToHalfF16C(in, out, count);
+		}
+#elif SE_SIMD_BACKEND == SE_SIMD_NEON
+		i = FloatToHalfNEON(in, out, count);
+#endif
+		for (; i < count; i++) {
+			out[i] = FloatToHalf(in[i]);
+		}
+	}
+
+	void HalfToFloat(const uint16_t* in, float* out, size_t count)
+	{
+		size_t i = 0;
+#if defined(SE_SIMD_AVX2_DISPATCH)
+		if (simd::IsF16CSupported()) {
+			i = HalfToFloatF16C(in, out, count);
+		}
+#elif SE_SIMD_BACKEND == SE_SIMD_NEON
+		i = HalfToFloatNEON(in, out, count);
+#endif
+		for (; i < count; i++) {
+			out[i] = HalfToFloat(in[i]);
+		}
+	}
+
+	void FloatToUNorm8(const float* in, uint8_t* out, size_t count)
+	{
+		QuantizeArray(in, out, count, 0.0f, 1.0f, 255.0f);
+	}
+
+	void FloatToUNorm16(const float* in, uint16_t* out, size_t count)
+	{
+		QuantizeArray(in, out, count, 0.0f, 1.0f, 65535.0f);
+	}
+
+	void FloatToSNorm8(const float* in, int8_t* out, size_t count)
+	{
+		QuantizeArray(in, out, count, -1.0f, 1.0f, 127.0f);
+	}
+
+	void FloatToSNorm16(const float* in, int16_t* out, size_t count)
+	{
+		QuantizeArray(in, out, count, -1.0f, 1.0f, 32767.0f);
+	}
+
+	void UNorm8ToFloat(const uint8_t* in, float* out, size_t count)
+	{
+		DequantizeArray(in, out, count, 0.0f, 1.0f / 255.0f);
+	}
+
+	void UNorm16ToFloat(const uint16_t* in, float* out, size_t count)
+	{
+		DequantizeArray(in, out, count, 0.0f, 1.0f / 65535.0f);
+	}
+
+	void SNorm8ToFloat(const int8_t* in, float* out, size_t count)
+	{
+		DequantizeArray(in, out, count, -1.0f, 1.0f / 127.0f);
+	}
+
+	void SNorm16ToFloat(const int16_t* in, float* out, size_t count)
+	{
+		DequantizeArray(in, out, count, -1.0f, 1.0f / 32767.0f);
+	}
+
+	void PackR8G8B8A8UNorm(const Vector4* in, uint32_t* out, size_t count)
+	{
+		PackVector4(in, out, count, RGBA8_BITS, simd::Zero(), simd::Splat(255.0f));
+	}
+
+	void PackR8G8B8A8SNorm(const Vector4* in, uint32_t* out, size_t count)
+	{
+		PackVector4(in, out, count, RGBA8_BITS, simd::Splat(-1.0f), simd::Splat(127.0f));
+	}
+
+	void PackR10G10B10A2UNorm(const Vector4* in, uint32_t* out, size_t count)
+	{
+		PackVector4(in, out, count, RGB10A2_BITS, simd::Zero(), simd::Set(1023.0f, 1023.0f, 1023.0f, 3.0f));
+	}
+
+	void UnpackR8G8B8A8UNorm(const uint32_t* in, Vector4* out, size_t count)
+	{
+		UnpackVector4(in, out, count, RGBA8_BITS, false, simd::Splat(1.0f / 255.0f));
+	}
+
+	void UnpackR8G8B8A8SNorm(const uint32_t* in, Vector4* out, size_t count)
+	{
+		UnpackVector4(in, out, count, RGBA8_BITS, true, simd::Splat(1.0f / 127.0f));
+	}
+
+	void UnpackR10G10B10A2UNorm(const uint32_t* in, Vector4* out, size_t count)
+	{
+		UnpackVector4(in, out, count, RGB10A2_BITS, false, simd::Set(1.0f / 1023.0f, 1.0f / 1023.0f, 1.0f / 1023.0f, 1.0f / 3.0f));
+	}
+
+	void EncodeOctahedral(const Vector3* in, Vector2* out, size_t count)
+	{
+		ForEachVector3Block(in, count, [out](size_t begin, size_t num, simd::Vector x, simd::Vector y, simd::Vector z) {
+			simd::Vector u, v;
+			EncodeOctahedral4(x, y, z, u, v);
+			float fu[4], fv[4];
+			simd::StoreFloat4(fu, u);
+			simd::StoreFloat4(fv, v);
+			for (size_t j = 0; j < num; j++) {
+				out[begin + j] = Vector2(fu[j], fv[j]);
+			}
+		});
+	}
+
+	void DecodeOctahedral(const Vector2* in, Vector3* out, size_t count)
+	{
+		for (size_t i = 0; i < count; i += 4) {
+			size_t num = (std::min)(count - i, static_cast<size_t>(4));
+			float fu[4] = {}, fv[4] = {};
+			for (size_t j = 0; j < num; j++) {
+				fu[j] = in[i + j].x;
+				fv[j] = in[i + j].y;
+			}
+			simd::Vector x, y, z;
+			DecodeOctahedral4(simd::LoadFloat4(fu), simd::LoadFloat4(fv), x, y, z);
+			StoreVector3Block(out + i, num, x, y, z);
+		}
+	}
+
+	void EncodeOctahedralSNorm16(const Vector3* in, uint32_t* out, size_t count)
+	{
+		simd::Vector lo = simd::Splat(-1.0f);
+		simd::Vector hi = simd::Splat(1.0f);
+		simd::Vector scale = simd::Splat(32767.0f);
+		ForEachVector3Block(in, count, [&](size_t begin, size_t num, simd::Vector x, simd::Vector y, simd::Vector z) {
+			simd::Vector u, v;
+			EncodeOctahedral4(x, y, z, u, v);
+			int32_t qu[4], qv[4];
+			StoreInt4(qu, Quantize(u, lo, hi, scale));
+			StoreInt4(qv, Quantize(v, lo, hi, scale));
+			for (size_t j = 0; j < num; j++) {
+				out[begin + j] = (static_cast<uint32_t>(qu[j]) & 0xFFFF) | (static_cast<uint32_t>(qv[j]) << 16);
+			}
+		});
+	}
+
+	void DecodeOctahedralSNorm16(const uint32_t* in, Vector3* out, size_t count)
+	{
+		simd::Vector lo = simd::Splat(-1.0f);
+		simd::Vector scale = simd::Splat(1.0f / 32767.0f);
+		for (size_t i = 0; i < count; i += 4) {
+			size_t num = (std::min)(count - i, static_cast<size_t>(4));
+			int32_t qu[4] = {}, qv[4] = {};
+			for (size_t j = 0; j < num; j++) {
+				qu[j] = static_cast<int16_t>(in[i + j] & 0xFFFF);
+				qv[j] = static_cast<int16_t>(in[i + j] >> 16);
+			}
+			simd::Vector u = simd::Max(simd::Mul(LoadInt4(qu), scale), lo);
+			simd::Vector v = simd::Max(simd::Mul(LoadInt4(qv), scale), lo);
+			simd::Vector x, y, z;
+			DecodeOctahedral4(u, v, x, y, z);
+			StoreVector3Block(out + i, num, x, y, z);
+		}
+	}
+}
+}
@@ -0,0 +1,62 @@
+﻿#pragma once
+
+#include "se/Math/Math.h"
+
+namespace se
+{
+	/**
+	 * 頂点やテクスチャのデータを圧縮した形式に詰める関数
+	 * 配列版は4要素ずつ(半精度はF16Cが使えるCPUでは8要素ずつ)まとめて処理する
+	 * 丸めは全て最近接偶数丸め、範囲外の値は飽和させる(NaNは0として扱う、半精度はNaNのまま)
+	 * 入力と出力は重ならないこと
+	 */
+	namespace packing
+	{
+		// 半精度浮動小数点の変換に使う実装名("F16C"や"NEON"など)
+		const char* GetHalfBackendName();
+
+		/* 半精度浮動小数点(FORMAT_R16_FLOATなど) */
+
+		// 表せない大きさは無限大、非正規化数も扱う
+		uint16_t FloatToHalf(float f);
+		float HalfToFloat(uint16_t h);
+
+		void FloatToHalf(const float* in, uint16_t* out, size_t count);
+		void HalfToFloat(const uint16_t* in, float* out, size_t count);
+
+		/* 正規化整数(FORMAT_R8_UNORMなど) */
+
+		// UNORMは[0, 1]を[0, 2^n-1]に、SNORMは[-1, 1]を[-(2^(n-1)-1), 2^(n-1)-1]に割り当てる
+		// SNORMの最小値(-128など)は-1.0に戻す
+		void FloatToUNorm8(const float* in, uint8_t* out, size_t count);
+		void FloatToUNorm16(const float* in, uint16_t* out, size_t count);
+		void FloatToSNorm8(const float* in, int8_t* out, size_t count);
+		void FloatToSNorm16(const float* in, int16_t* out, size_t count);
+
+		void UNorm8ToFloat(const uint8_t* in, float* out, size_t count);
+		void UNorm16ToFloat(const uint16_t* in, float* out, size_t count);
+		void SNorm8ToFloat(const int8_t* in, float* out, size_t count);
+		void SNorm16ToFloat(const int16_t* in, float* out, size_t count);
+
+		// Vector4(x, y, z, w)を1要素32bitに詰める、xが下位ビット
+		void PackR8G8B8A8UNorm(const Vector4* in, uint32_t* out, size_t count);
+		void PackR8G8B8A8SNorm(const Vector4* in, uint32_t* out, size_t count);
+		void PackR10G10B10A2UNorm(const Vector4* in, uint32_t* out, size_t count);
+
+		void UnpackR8G8B8A8UNorm(const uint32_t* in, Vector4* out, size_t count);
+		void UnpackR8G8B8A8SNorm(const uint32_t* in, Vector4* out, size_t count);
+		void UnpackR10G10B10A2UNorm(const uint32_t* in, Vector4* out, size_t count);
+
+		/* 八面体マッピングによる法線の圧縮 */
+
+		// 単位ベクトルを[-1, 1]の2要素に写す、長さ0のベクトルは(0, 0)になる(戻すと(0, 0, 1))
+		void EncodeOctahedral(const Vector3* in, Vector2* out, size_t count);
+		// 戻した結果は正規化する
+		void DecodeOctahedral(const Vector2* in, Vector3* out, size_t count);
+
+		// EncodeOctahedralの結果をSNORM16の2要素にして32bitに詰める(FORMAT_R16G16_SNORM相当、xが下位16bit)
+		// 角度の誤差は最大で0.005度程度
+		void EncodeOctahedralSNorm16(const Vector3* in, uint32_t* out, size_t count);
+		void DecodeOctahedralSNorm16(const uint32_t* in, Vector3* out, size_t count);
+	}
+}
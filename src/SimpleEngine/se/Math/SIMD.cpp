@@ -0,0 +1,78 @@
+﻿#include "se/Math/SIMD.h"
+
+#if defined(SE_SIMD_AVX2_DISPATCH) && defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+namespace se
+{
+namespace simd
+{
+	namespace {
+
+#if defined(SE_SIMD_AVX2_DISPATCH) && defined(_MSC_VER)
+		// AVXに対応していて、OSがYMMレジスタを退避するか
+		bool IsAVXEnabled()
+		{
+			int info[4];
+			__cpuid(info, 1);
+			const int osxsave = 1 << 27;
+			const int avx = 1 << 28;
+			return (info[2] & (osxsave | avx)) == (osxsave | avx) && (_xgetbv(0) & 0x6) == 0x6;
+		}
+#endif
+
+		bool DetectAVX2()
+		{
+#if !defined(SE_SIMD_AVX2_DISPATCH)
+			return false;
+#elif defined(__AVX2__)
+			return true;
+#elif defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7 || !IsAVXEnabled()) {
+				return false;
+			}
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#else
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2") != 0;
+#endif
+		}
+
+		bool DetectF16C()
+		{
+#if !defined(SE_SIMD_AVX2_DISPATCH)
+			return false;
+#elif defined(__F16C__)
+			return true;
+#elif defined(_MSC_VER)
+			if (!IsAVXEnabled()) {
+				return false;
+			}
+			int info[4];
+			__cpuid(info, 1);
+			return (info[2] & (1 << 29)) != 0;
+#else
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("f16c") != 0;
+#endif
+		}
+	}
+
+	bool IsAVX2Supported()
+	{
+		static const bool supported = DetectAVX2();
+		return supported;
+	}
+
+	bool IsF16CSupported()
+	{
+		static const bool supported = DetectF16C();
+		return supported;
+	}
+
+}
+}
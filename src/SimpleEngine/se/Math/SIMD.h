@@ -0,0 +1,548 @@
+﻿#pragma once
+
+#include "se/Common.h"
+#include <math.h>
+#include <string.h>
+
+/**
+ * SIMDバックエンドの選択
+ * SE_SIMD_BACKENDを定義しなければコンパイル対象から自動で選ぶ
+ *   SE_SIMD_SSE    : x86/x64 (SSE2、__SSE4_1__/__AVX__が有効なら一部でそれらを使う)
+ *   SE_SIMD_NEON   : AArch64
+ *   SE_SIMD_SCALAR : それ以外、またはSE_MATH_FORCE_SCALARを定義した場合
+ *
+ * 全てのバックエンドで演算の順序を揃えているので、同じ入力には同じビット列を返す
+ * ただし名前が～Estimateの関数は例外で、誤差の上限だけを揃えている(値はバックエンドごとに異なる)
+ * ただしSE_SIMD_FMAを定義した場合(積和を1回の丸めで行う)と、コンパイラが積和を融合する設定
+ * (GCC/Clangの-ffp-contract=fastなど)ではスカラーとの一致は保証しない
+ */
+#define SE_SIMD_SCALAR	0
+#define SE_SIMD_SSE		1
+#define SE_SIMD_NEON	2
+
+#if !defined(SE_SIMD_BACKEND)
+	#if defined(SE_MATH_FORCE_SCALAR)
+		#define SE_SIMD_BACKEND		SE_SIMD_SCALAR
+	#elif defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+		#define SE_SIMD_BACKEND		SE_SIMD_SSE
+	#elif defined(_M_ARM64) || defined(__aarch64__)
+		#define SE_SIMD_BACKEND		SE_SIMD_NEON
+	#else
+		#define SE_SIMD_BACKEND		SE_SIMD_SCALAR
+	#endif
+#endif
+
+#if SE_SIMD_BACKEND == SE_SIMD_SSE
+	#if defined(__AVX__) || defined(__AVX2__)
+		#define SE_SIMD_AVX		1
+		#include <immintrin.h>
+	#elif defined(__SSE4_1__)
+		#include <smmintrin.h>
+	#else
+		#include <emmintrin.h>
+	#endif
+	#if defined(__SSE4_1__) || defined(SE_SIMD_AVX)
+		#define SE_SIMD_SSE4	1
+	#endif
+	#define SE_SIMD_BACKEND_NAME	"SSE"
+#elif SE_SIMD_BACKEND == SE_SIMD_NEON
+	#include <arm_neon.h>
+	#define SE_SIMD_BACKEND_NAME	"NEON"
+#else
+	#define SE_SIMD_BACKEND_NAME	"Scalar"
+#endif
+
+/**
+ * AVX2/F16Cの実行時切り替え
+ * x86ではプロジェクト全体をAVX2向けにビルドしなくても使えるよう、SE_TARGET_AVX2/SE_TARGET_F16Cを付けた関数だけ有効にする
+ * 呼び出す前にsimd::IsAVX2Supported()/simd::IsF16CSupported()で確認すること
+ */
+#if SE_SIMD_BACKEND == SE_SIMD_SSE
+	#define SE_SIMD_AVX2_DISPATCH	1
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#define SE_TARGET_AVX2
+		#define SE_TARGET_F16C
+	#else
+		#define SE_TARGET_AVX2	__attribute__((target("avx2")))
+		#define SE_TARGET_F16C	__attribute__((target("f16c")))
+	#endif
+#endif
+
+namespace se {
+namespace simd {
+
+#if SE_SIMD_BACKEND == SE_SIMD_SSE
+	typedef __m128 Vector;
+#elif SE_SIMD_BACKEND == SE_SIMD_NEON
+	typedef float32x4_t Vector;
+#else
+	struct Vector
+	{
+		float f[4];
+	};
+#endif
+
+	/**
+	 * 行ベクトル4本の行列(行ベクトル×行列の並び)
+	 */
+	struct Matrix
+	{
+		Vector r[4];
+	};
+
+	// 実行中のCPUとOSでAVX2が使えるか(SE_SIMD_AVX2_DISPATCHが無効なら常にfalse)
+	bool IsAVX2Supported();
+	// 同じく半精度浮動小数点の変換命令(F16C)が使えるか
+	bool IsF16CSupported();
+
+
+#if SE_SIMD_BACKEND == SE_SIMD_SSE
+
+	__forceinline Vector Set(float x, float y, float z, float w) { return _mm_set_ps(w, z, y, x); }
+	__forceinline Vector Splat(float f) { return _mm_set1_ps(f); }
+	__forceinline Vector Zero() { return _mm_setzero_ps(); }
+
+	__forceinline Vector LoadFloat2(const float* p)
+	{
+		return _mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+	}
+	__forceinline Vector LoadFloat3(const float* p)
+	{
+#if defined(SE_SIMD_SSE4)
+		return _mm_insert_ps(LoadFloat2(p), _mm_load_ss(p + 2), 0x20);
+#else
+		return _mm_movelh_ps(LoadFloat2(p), _mm_load_ss(p + 2));
+#endif
+	}
+	__forceinline Vector LoadFloat4(const float* p) { return _mm_loadu_ps(p); }
+
+	__forceinline void StoreFloat2(float* p, Vector v)
+	{
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_castps_si128(v));
+	}
+	__forceinline void StoreFloat3(float* p, Vector v)
+	{
+		StoreFloat2(p, v);
+		_mm_store_ss(p + 2, _mm_movehl_ps(v, v));
+	}
+	__forceinline void StoreFloat4(float* p, Vector v) { _mm_storeu_ps(p, v); }
+
+	__forceinline float GetX(Vector v) { return _mm_cvtss_f32(v); }
+
+	__forceinline Vector SplatX(Vector v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)); }
+	__forceinline Vector SplatY(Vector v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)); }
+	__forceinline Vector SplatZ(Vector v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)); }
+	__forceinline Vector SplatW(Vector v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)); }
+
+	__forceinline Vector Add(Vector a, Vector b) { return _mm_add_ps(a, b); }
+	__forceinline Vector Sub(Vector a, Vector b) { return _mm_sub_ps(a, b); }
+	__forceinline Vector Mul(Vector a, Vector b) { return _mm_mul_ps(a, b); }
+	__forceinline Vector Div(Vector a, Vector b) { return _mm_div_ps(a, b); }
+	__forceinline Vector Min(Vector a, Vector b) { return _mm_min_ps(a, b); }
+	__forceinline Vector Max(Vector a, Vector b) { return _mm_max_ps(a, b); }
+	__forceinline Vector Sqrt(Vector v) { return _mm_sqrt_ps(v); }
+	__forceinline Vector Abs(Vector v) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+	// 1/sqrt(v)の近似(相対誤差は1.5*2^-12以下)
+	__forceinline Vector ReciprocalSqrtEstimate(Vector v) { return _mm_rsqrt_ps(v); }
+	// 最も近い整数に丸める(偶数丸め、|v| < 2^31)
+	__forceinline Vector Round(Vector v) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(v)); }
+	// 2のn乗(nは-126～127の整数値)
+	__forceinline Vector Pow2(Vector n)
+	{
+		return _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(n), _mm_set1_epi32(127)), 23));
+	}
+
+	// a > b の要素は全ビット1、それ以外は0
+	__forceinline Vector Greater(Vector a, Vector b) { return _mm_cmpgt_ps(a, b); }
+	// maskのビットが立っている所はb、それ以外はa
+	__forceinline Vector Select(Vector a, Vector b, Vector mask)
+	{
+#if defined(SE_SIMD_SSE4)
+		return _mm_blendv_ps(a, b, mask);
+#else
+		return _mm_or_ps(_mm_andnot_ps(mask, a), _mm_and_ps(mask, b));
+#endif
+	}
+
+	// a * b + c
+	__forceinline Vector MultiplyAdd(Vector a, Vector b, Vector c)
+	{
+#if defined(SE_SIMD_FMA)
+		return _mm_fmadd_ps(a, b, c);
+#else
+		return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+	}
+
+	// ((x + y) + z)を全要素に入れて返す
+	__forceinline Vector Dot3(Vector a, Vector b)
+	{
+		Vector m = _mm_mul_ps(a, b);
+		Vector t = _mm_add_ss(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1)));
+		t = _mm_add_ss(t, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 2, 2, 2)));
+		return _mm_shuffle_ps(t, t, _MM_SHUFFLE(0, 0, 0, 0));
+	}
+
+	// (((x + y) + z) + w)を全要素に入れて返す
+	__forceinline Vector Dot4(Vector a, Vector b)
+	{
+		Vector m = _mm_mul_ps(a, b);
+		Vector t = _mm_add_ss(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1)));
+		t = _mm_add_ss(t, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 2, 2, 2)));
+		t = _mm_add_ss(t, _mm_shuffle_ps(m, m, _MM_SHUFFLE(3, 3, 3, 3)));
+		return _mm_shuffle_ps(t, t, _MM_SHUFFLE(0, 0, 0, 0));
+	}
+
+	// wは0
+	__forceinline Vector Cross3(Vector a, Vector b)
+	{
+		Vector t0 = _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2)));
+		Vector t1 = _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1)));
+		Vector result = _mm_sub_ps(t0, t1);
+#if defined(SE_SIMD_SSE4)
+		return _mm_blend_ps(result, _mm_setzero_ps(), 0x8);
+#else
+		return _mm_and_ps(result, _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1)));
+#endif
+	}
+
+	__forceinline Matrix MatrixTranspose(const Matrix& m)
+	{
+		Matrix result = m;
+		_MM_TRANSPOSE4_PS(result.r[0], result.r[1], result.r[2], result.r[3]);
+		return result;
+	}
+
+#elif SE_SIMD_BACKEND == SE_SIMD_NEON
+
+	__forceinline Vector Set(float x, float y, float z, float w)
+	{
+		const float v[4] = { x, y, z, w };
+		return vld1q_f32(v);
+	}
+	__forceinline Vector Splat(float f) { return vdupq_n_f32(f); }
+	__forceinline Vector Zero() { return vdupq_n_f32(0.0f); }
+
+	__forceinline Vector LoadFloat2(const float* p) { return vcombine_f32(vld1_f32(p), vdup_n_f32(0.0f)); }
+	__forceinline Vector LoadFloat3(const float* p)
+	{
+		return vcombine_f32(vld1_f32(p), vld1_lane_f32(p + 2, vdup_n_f32(0.0f), 0));
+	}
+	__forceinline Vector LoadFloat4(const float* p) { return vld1q_f32(p); }
+
+	__forceinline void StoreFloat2(float* p, Vector v) { vst1_f32(p, vget_low_f32(v)); }
+	__forceinline void StoreFloat3(float* p, Vector v)
+	{
+		vst1_f32(p, vget_low_f32(v));
+		vst1q_lane_f32(p + 2, v, 2);
+	}
+	__forceinline void StoreFloat4(float* p, Vector v) { vst1q_f32(p, v); }
+
+	__forceinline float GetX(Vector v) { return vgetq_lane_f32(v, 0); }
+
+	__forceinline Vector SplatX(Vector v) { return vdupq_laneq_f32(v, 0); }
+	__forceinline Vector SplatY(Vector v) { return vdupq_laneq_f32(v, 1); }
+	__forceinline Vector SplatZ(Vector v) { return vdupq_laneq_f32(v, 2); }
+	__forceinline Vector SplatW(Vector v) { return vdupq_laneq_f32(v, 3); }
+
+	__forceinline Vector Add(Vector a, Vector b) { return vaddq_f32(a, b); }
+	__forceinline Vector Sub(Vector a, Vector b) { return vsubq_f32(a, b); }
+	__forceinline Vector Mul(Vector a, Vector b) { return vmulq_f32(a, b); }
+	__forceinline Vector Div(Vector a, Vector b) { return vdivq_f32(a, b); }
+	__forceinline Vector Min(Vector a, Vector b) { return vminq_f32(a, b); }
+	__forceinline Vector Max(Vector a, Vector b) { return vmaxq_f32(a, b); }
+	__forceinline Vector Sqrt(Vector v) { return vsqrtq_f32(v); }
+	__forceinline Vector Abs(Vector v) { return vabsq_f32(v); }
+	// 1/sqrt(v)の近似(相対誤差は1.5*2^-12以下)
+	__forceinline Vector ReciprocalSqrtEstimate(Vector v)
+	{
+		// vrsqrteは8ビット程度なので、SSEの精度に揃えるため1回補正する
+		Vector e = vrsqrteq_f32(v);
+		return vmulq_f32(e, vrsqrtsq_f32(vmulq_f32(v, e), e));
+	}
+	// 最も近い整数に丸める(偶数丸め、|v| < 2^31)
+	__forceinline Vector Round(Vector v) { return vcvtq_f32_s32(vcvtnq_s32_f32(v)); }
+	// 2のn乗(nは-126～127の整数値)
+	__forceinline Vector Pow2(Vector n)
+	{
+		return vreinterpretq_f32_s32(vshlq_n_s32(vaddq_s32(vcvtq_s32_f32(n), vdupq_n_s32(127)), 23));
+	}
+
+	// a > b の要素は全ビット1、それ以外は0
+	__forceinline Vector Greater(Vector a, Vector b) { return vreinterpretq_f32_u32(vcgtq_f32(a, b)); }
+	// maskのビットが立っている所はb、それ以外はa
+	__forceinline Vector Select(Vector a, Vector b, Vector mask) { return vbslq_f32(vreinterpretq_u32_f32(mask), b, a); }
+
+	// a * b + c
+	__forceinline Vector MultiplyAdd(Vector a, Vector b, Vector c)
+	{
+#if defined(SE_SIMD_FMA)
+		return vfmaq_f32(c, a, b);
+#else
+		return vaddq_f32(vmulq_f32(a, b), c);
+#endif
+	}
+
+	// ((x + y) + z)を全要素に入れて返す
+	__forceinline Vector Dot3(Vector a, Vector b)
+	{
+		Vector m = vmulq_f32(a, b);
+		float t = vgetq_lane_f32(m, 0) + vgetq_lane_f32(m, 1);
+		t = t + vgetq_lane_f32(m, 2);
+		return vdupq_n_f32(t);
+	}
+
+	// (((x + y) + z) + w)を全要素に入れて返す
+	__forceinline Vector Dot4(Vector a, Vector b)
+	{
+		Vector m = vmulq_f32(a, b);
+		float t = vgetq_lane_f32(m, 0) + vgetq_lane_f32(m, 1);
+		t = t + vgetq_lane_f32(m, 2);
+		t = t + vgetq_lane_f32(m, 3);
+		return vdupq_n_f32(t);
+	}
+
+	// wは0
+	__forceinline Vector Cross3(Vector a, Vector b)
+	{
+		// (y, z, x, *) と (z, x, y, *) の並びを作る
+		Vector a1 = vsetq_lane_f32(vgetq_lane_f32(a, 0), vextq_f32(a, a, 1), 2);
+		Vector b1 = vsetq_lane_f32(vgetq_lane_f32(b, 0), vextq_f32(b, b, 1), 2);
+		Vector a2 = vsetq_lane_f32(vgetq_lane_f32(a, 2), vextq_f32(a, a, 3), 0);
+		Vector b2 = vsetq_lane_f32(vgetq_lane_f32(b, 2), vextq_f32(b, b, 3), 0);
+		Vector result = vsubq_f32(vmulq_f32(a1, b2), vmulq_f32(a2, b1));
+		return vsetq_lane_f32(0.0f, result, 3);
+	}
+
+	__forceinline Matrix MatrixTranspose(const Matrix& m)
+	{
+		Vector t0 = vzip1q_f32(m.r[0], m.r[2]);
+		Vector t1 = vzip1q_f32(m.r[1], m.r[3]);
+		Vector t2 = vzip2q_f32(m.r[0], m.r[2]);
+		Vector t3 = vzip2q_f32(m.r[1], m.r[3]);
+		Matrix result;
+		result.r[0] = vzip1q_f32(t0, t1);
+		result.r[1] = vzip2q_f32(t0, t1);
+		result.r[2] = vzip1q_f32(t2, t3);
+		result.r[3] = vzip2q_f32(t2, t3);
+		return result;
+	}
+
+#else
+
+	__forceinline Vector Set(float x, float y, float z, float w)
+	{
+		Vector v = { { x, y, z, w } };
+		return v;
+	}
+	__forceinline Vector Splat(float f) { return Set(f, f, f, f); }
+	__forceinline Vector Zero() { return Set(0.0f, 0.0f, 0.0f, 0.0f); }
+
+	__forceinline Vector LoadFloat2(const float* p) { return Set(p[0], p[1], 0.0f, 0.0f); }
+	__forceinline Vector LoadFloat3(const float* p) { return Set(p[0], p[1], p[2], 0.0f); }
+	__forceinline Vector LoadFloat4(const float* p) { return Set(p[0], p[1], p[2], p[3]); }
+
+	__forceinline void StoreFloat2(float* p, Vector v) { p[0] = v.f[0]; p[1] = v.f[1]; }
+	__forceinline void StoreFloat3(float* p, Vector v) { p[0] = v.f[0]; p[1] = v.f[1]; p[2] = v.f[2]; }
+	__forceinline void StoreFloat4(float* p, Vector v) { p[0] = v.f[0]; p[1] = v.f[1]; p[2] = v.f[2]; p[3] = v.f[3]; }
+
+	__forceinline float GetX(Vector v) { return v.f[0]; }
+
+	__forceinline Vector SplatX(Vector v) { return Splat(v.f[0]); }
+	__forceinline Vector SplatY(Vector v) { return Splat(v.f[1]); }
+	__forceinline Vector SplatZ(Vector v) { return Splat(v.f[2]); }
+	__forceinline Vector SplatW(Vector v) { return Splat(v.f[3]); }
+
+	__forceinline Vector Add(Vector a, Vector b) { return Set(a.f[0] + b.f[0], a.f[1] + b.f[1], a.f[2] + b.f[2], a.f[3] + b.f[3]); }
+	__forceinline Vector Sub(Vector a, Vector b) { return Set(a.f[0] - b.f[0], a.f[1] - b.f[1], a.f[2] - b.f[2], a.f[3] - b.f[3]); }
+	__forceinline Vector Mul(Vector a, Vector b) { return Set(a.f[0] * b.f[0], a.f[1] * b.f[1], a.f[2] * b.f[2], a.f[3] * b.f[3]); }
+	__forceinline Vector Div(Vector a, Vector b) { return Set(a.f[0] / b.f[0], a.f[1] / b.f[1], a.f[2] / b.f[2], a.f[3] / b.f[3]); }
+	// SSEと同じく、比較が成り立たなければ(NaNを含めば)bを返す
+	__forceinline Vector Min(Vector a, Vector b)
+	{
+		return Set(a.f[0] < b.f[0] ? a.f[0] : b.f[0], a.f[1] < b.f[1] ? a.f[1] : b.f[1], a.f[2] < b.f[2] ? a.f[2] : b.f[2], a.f[3] < b.f[3] ? a.f[3] : b.f[3]);
+	}
+	__forceinline Vector Max(Vector a, Vector b)
+	{
+		return Set(a.f[0] > b.f[0] ? a.f[0] : b.f[0], a.f[1] > b.f[1] ? a.f[1] : b.f[1], a.f[2] > b.f[2] ? a.f[2] : b.f[2], a.f[3] > b.f[3] ? a.f[3] : b.f[3]);
+	}
+	__forceinline Vector Sqrt(Vector v) { return Set(sqrtf(v.f[0]), sqrtf(v.f[1]), sqrtf(v.f[2]), sqrtf(v.f[3])); }
+	__forceinline Vector Abs(Vector v) { return Set(fabsf(v.f[0]), fabsf(v.f[1]), fabsf(v.f[2]), fabsf(v.f[3])); }
+	// 1/sqrt(v)の近似(相対誤差は1.5*2^-12以下)、スカラーでは近似せずに計算する
+	__forceinline Vector ReciprocalSqrtEstimate(Vector v)
+	{
+		return Set(1.0f / sqrtf(v.f[0]), 1.0f / sqrtf(v.f[1]), 1.0f / sqrtf(v.f[2]), 1.0f / sqrtf(v.f[3]));
+	}
+	// 最も近い整数に丸める(偶数丸め、|v| < 2^31)
+	__forceinline Vector Round(Vector v) { return Set(nearbyintf(v.f[0]), nearbyintf(v.f[1]), nearbyintf(v.f[2]), nearbyintf(v.f[3])); }
+	// 2のn乗(nは-126～127の整数値)
+	__forceinline Vector Pow2(Vector n)
+	{
+		Vector result;
+		for (int i = 0; i < 4; i++) {
+			uint32_t bits = static_cast<uint32_t>(static_cast<int32_t>(n.f[i]) + 127) << 23;
+			memcpy(&result.f[i], &bits, sizeof(float));
+		}
+		return result;
+	}
+
+	// a > b の要素は全ビット1、それ以外は0
+	__forceinline Vector Greater(Vector a, Vector b)
+	{
+		const uint32_t bits[2] = { 0, 0xFFFFFFFF };
+		Vector result;
+		for (int i = 0; i < 4; i++) {
+			memcpy(&result.f[i], &bits[a.f[i] > b.f[i] ? 1 : 0], sizeof(float));
+		}
+		return result;
+	}
+	// maskのビットが立っている所はb、それ以外はa
+	__forceinline Vector Select(Vector a, Vector b, Vector mask)
+	{
+		Vector result;
+		for (int i = 0; i < 4; i++) {
+			uint32_t ua, ub, um;
+			memcpy(&ua, &a.f[i], sizeof(uint32_t));
+			memcpy(&ub, &b.f[i], sizeof(uint32_t));
+			memcpy(&um, &mask.f[i], sizeof(uint32_t));
+			uint32_t ur = (ua & ~um) | (ub & um);
+			memcpy(&result.f[i], &ur, sizeof(float));
+		}
+		return result;
+	}
+
+	// a * b + c
+	__forceinline Vector MultiplyAdd(Vector a, Vector b, Vector c)
+	{
+#if defined(SE_SIMD_FMA)
+		return Set(fmaf(a.f[0], b.f[0], c.f[0]), fmaf(a.f[1], b.f[1], c.f[1]), fmaf(a.f[2], b.f[2], c.f[2]), fmaf(a.f[3], b.f[3], c.f[3]));
+#else
+		return Add(Mul(a, b), c);
+#endif
+	}
+
+	// ((x + y) + z)を全要素に入れて返す
+	__forceinline Vector Dot3(Vector a, Vector b)
+	{
+		Vector m = Mul(a, b);
+		float t = m.f[0] + m.f[1];
+		t = t + m.f[2];
+		return Splat(t);
+	}
+
+	// (((x + y) + z) + w)を全要素に入れて返す
+	__forceinline Vector Dot4(Vector a, Vector b)
+	{
+		Vector m = Mul(a, b);
+		float t = m.f[0] + m.f[1];
+		t = t + m.f[2];
+		t = t + m.f[3];
+		return Splat(t);
+	}
+
+	// wは0
+	__forceinline Vector Cross3(Vector a, Vector b)
+	{
+		float x = a.f[1] * b.f[2];
+		float y = a.f[2] * b.f[0];
+		float z = a.f[0] * b.f[1];
+		x = x - a.f[2] * b.f[1];
+		y = y - a.f[0] * b.f[2];
+		z = z - a.f[1] * b.f[0];
+		return Set(x, y, z, 0.0f);
+	}
+
+	__forceinline Matrix MatrixTranspose(const Matrix& m)
+	{
+		Matrix result;
+		for (int i = 0; i < 4; i++) {
+			result.r[i] = Set(m.r[0].f[i], m.r[1].f[i], m.r[2].f[i], m.r[3].f[i]);
+		}
+		return result;
+	}
+
+#endif
+
+
+	/**
+	 * 以下はバックエンド共通
+	 * 演算の順序を揃えるため、基本演算の組み合わせだけで書く
+	 */
+
+	__forceinline Vector Negate(Vector v) { return Sub(Zero(), v); }
+
+	// 行ベクトル×行列
+	// 各行は (x * r0 + z * r2) + (y * r1 + w * r3)
+	__forceinline Matrix MatrixMultiply(const Matrix& a, const Matrix& b)
+	{
+		Matrix result;
+#if defined(SE_SIMD_AVX) && !defined(SE_SIMD_FMA)
+		// 2行ずつ処理する(要素ごとの演算は128bit版と同じ)
+		__m256 b0 = _mm256_insertf128_ps(_mm256_castps128_ps256(b.r[0]), b.r[0], 1);
+		__m256 b1 = _mm256_insertf128_ps(_mm256_castps128_ps256(b.r[1]), b.r[1], 1);
+		__m256 b2 = _mm256_insertf128_ps(_mm256_castps128_ps256(b.r[2]), b.r[2], 1);
+		__m256 b3 = _mm256_insertf128_ps(_mm256_castps128_ps256(b.r[3]), b.r[3], 1);
+		for (int i = 0; i < 4; i += 2) {
+			__m256 rows = _mm256_insertf128_ps(_mm256_castps128_ps256(a.r[i]), a.r[i + 1], 1);
+			__m256 x = _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+			__m256 y = _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(1, 1, 1, 1)), b1);
+			__m256 z = _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(2, 2, 2, 2)), b2);
+			__m256 w = _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(3, 3, 3, 3)), b3);
+			__m256 sum = _mm256_add_ps(_mm256_add_ps(x, z), _mm256_add_ps(y, w));
+			result.r[i] = _mm256_castps256_ps128(sum);
+			result.r[i + 1] = _mm256_extractf128_ps(sum, 1);
+		}
+#else
+		for (int i = 0; i < 4; i++) {
+			Vector row = a.r[i];
+			Vector x = Mul(SplatX(row), b.r[0]);
+			Vector y = Mul(SplatY(row), b.r[1]);
+			x = MultiplyAdd(SplatZ(row), b.r[2], x);
+			y = MultiplyAdd(SplatW(row), b.r[3], y);
+			result.r[i] = Add(x, y);
+		}
+#endif
+		return result;
+	}
+
+	// (x, y, z, 1) × m をwで割ったもの
+	__forceinline Vector Vector3TransformCoord(Vector v, const Matrix& m)
+	{
+		Vector result = MultiplyAdd(SplatZ(v), m.r[2], m.r[3]);
+		result = MultiplyAdd(SplatY(v), m.r[1], result);
+		result = MultiplyAdd(SplatX(v), m.r[0], result);
+		return Div(result, SplatW(result));
+	}
+
+	// (x, y, z, 0) × m
+	__forceinline Vector Vector3TransformNormal(Vector v, const Matrix& m)
+	{
+		Vector result = Mul(SplatZ(v), m.r[2]);
+		result = MultiplyAdd(SplatY(v), m.r[1], result);
+		result = MultiplyAdd(SplatX(v), m.r[0], result);
+		return result;
+	}
+
+	// v × m
+	__forceinline Vector Vector4Transform(Vector v, const Matrix& m)
+	{
+		Vector result = Mul(SplatW(v), m.r[3]);
+		result = MultiplyAdd(SplatZ(v), m.r[2], result);
+		result = MultiplyAdd(SplatY(v), m.r[1], result);
+		result = MultiplyAdd(SplatX(v), m.r[0], result);
+		return result;
+	}
+
+	// 長さが0ならゼロベクトル
+	__forceinline Vector Vector3Normalize(Vector v)
+	{
+		Vector length = Sqrt(Dot3(v, v));
+		if (GetX(length) > 0.0f) {
+			return Div(v, length);
+		}
+		return Zero();
+	}
+
+}
+}
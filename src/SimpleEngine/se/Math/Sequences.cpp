@@ -0,0 +1,440 @@
+﻿#include "se/Math/Sequences.h"
+#include "se/Math/SIMD.h"
+#include "se/async/IOService.h"
+#include <fstream>
+#include <float.h>
+#include <random>
+
+namespace se
+{
+	namespace {
+
+		const float ONE_MINUS_EPSILON = 0.99999994f;		// 1未満の最大のfloat
+		const float UNIT_SCALE = 1.0f / 16777216.0f;		// 2^-24
+
+		// R2列の刻み幅(1/φ2, 1/φ2^2)を32ビットの固定小数点にしたもの、初期値は0.5
+		const uint32_t R2_ALPHA_X = 3242174889u;
+		const uint32_t R2_ALPHA_Y = 2447445414u;
+		const uint32_t R2_OFFSET = 0x80000000u;
+
+		struct BlueNoiseCacheHeader
+		{
+			uint32_t magic;
+			uint32_t size;
+		};
+		const uint32_t BLUE_NOISE_CACHE_MAGIC = 0x4E424553;	// "SEBN"
+
+
+		/* 32ビットの固定小数点での計算、2進の列は4要素ずつまとめて計算する */
+
+#if SE_SIMD_BACKEND == SE_SIMD_SSE
+		typedef __m128i UInt4;
+		__forceinline UInt4 SplatUInt(uint32_t v) { return _mm_set1_epi32(static_cast<int>(v)); }
+		__forceinline UInt4 SetUInt(uint32_t x, uint32_t y, uint32_t z, uint32_t w)
+		{
+			return _mm_set_epi32(static_cast<int>(w), static_cast<int>(z), static_cast<int>(y), static_cast<int>(x));
+		}
+		__forceinline UInt4 AddUInt(UInt4 a, UInt4 b) { return _mm_add_epi32(a, b); }
+		__forceinline UInt4 XorUInt(UInt4 a, UInt4 b) { return _mm_xor_si128(a, b); }
+		__forceinline UInt4 AndUInt(UInt4 a, UInt4 b) { return _mm_and_si128(a, b); }
+		__forceinline UInt4 ShiftRight1(UInt4 v) { return _mm_srli_epi32(v, 1); }
+		// 最下位ビットが立っていれば全ビット1
+		__forceinline UInt4 LowBitMask(UInt4 v) { return _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(v, _mm_set1_epi32(1))); }
+		__forceinline void StoreUnitFloat4(float* out, UInt4 v)
+		{
+			simd::StoreFloat4(out, simd::Mul(_mm_cvtepi32_ps(_mm_srli_epi32(v, 8)), simd::Splat(UNIT_SCALE)));
+		}
+#elif SE_SIMD_BACKEND == SE_SIMD_NEON
+		typedef uint32x4_t UInt4;
+		__forceinline UInt4 SplatUInt(uint32_t v) { return vdupq_n_u32(v); }
+		__forceinline UInt4 SetUInt(uint32_t x, uint32_t y, uint32_t z, uint32_t w)
+		{
+			const uint32_t v[4] = { x, y, z, w };
+			return vld1q_u32(v);
+		}
+		__forceinline UInt4 AddUInt(UInt4 a, UInt4 b) { return vaddq_u32(a, b); }
+		__forceinline UInt4 XorUInt(UInt4 a, UInt4 b) { return veorq_u32(a, b); }
+		__forceinline UInt4 AndUInt(UInt4 a, UInt4 b) { return vandq_u32(a, b); }
+		__forceinline UInt4 ShiftRight1(UInt4 v) { return vshrq_n_u32(v, 1); }
+		__forceinline UInt4 LowBitMask(UInt4 v) { return vreinterpretq_u32_s32(vnegq_s32(vreinterpretq_s32_u32(vandq_u32(v, vdupq_n_u32(1))))); }
+		__forceinline void StoreUnitFloat4(float* out, UInt4 v)
+		{
+			simd::StoreFloat4(out, simd::Mul(vcvtq_f32_u32(vshrq_n_u32(v, 8)), simd::Splat(UNIT_SCALE)));
+		}
+#else
+		struct UInt4
+		{
+			uint32_t u[4];
+		};
+		__forceinline UInt4 SetUInt(uint32_t x, uint32_t y, uint32_t z, uint32_t w) { return UInt4{ { x, y, z, w } }; }
+		__forceinline UInt4 SplatUInt(uint32_t v) { return SetUInt(v, v, v, v); }
+		__forceinline UInt4 AddUInt(UInt4 a, UInt4 b) { return SetUInt(a.u[0] + b.u[0], a.u[1] + b.u[1], a.u[2] + b.u[2], a.u[3] + b.u[3]); }
+		__forceinline UInt4 XorUInt(UInt4 a, UInt4 b) { return SetUInt(a.u[0] ^ b.u[0], a.u[1] ^ b.u[1], a.u[2] ^ b.u[2], a.u[3] ^ b.u[3]); }
+		__forceinline UInt4 AndUInt(UInt4 a, UInt4 b) { return SetUInt(a.u[0] & b.u[0], a.u[1] & b.u[1], a.u[2] & b.u[2], a.u[3] & b.u[3]); }
+		__forceinline UInt4 ShiftRight1(UInt4 v) { return SetUInt(v.u[0] >> 1, v.u[1] >> 1, v.u[2] >> 1, v.u[3] >> 1); }
+		__forceinline UInt4 LowBitMask(UInt4 v) { return SetUInt(0u - (v.u[0] & 1), 0u - (v.u[1] & 1), 0u - (v.u[2] & 1), 0u - (v.u[3] & 1)); }
+		__forceinline void StoreUnitFloat4(float* out, UInt4 v)
+		{
+			for (int i = 0; i < 4; i++) {
+				out[i] = static_cast<float>(v.u[i] >> 8) * UNIT_SCALE;
+			}
+		}
+#endif
+
+		// 固定小数点の[0, 1)をfloatにする(上位24ビットを使うので1にはならない)
+		__forceinline float ToUnitFloat(uint32_t v)
+		{
+			return static_cast<float>(v >> 8) * UNIT_SCALE;
+		}
+
+		// Sobol列の方向数(Joe-Kuoの原始多項式と初期値)
+		// 1次元目はビット反転(2を基数とするHalton列と同じ)
+		typedef uint32_t SobolDirections[Sequences::SOBOL_DIMENSION_NUM][32];
+		const SobolDirections& GetSobolDirections()
+		{
+			struct Table
+			{
+				SobolDirections v;
+
+				Table()
+				{
+					struct Polynomial
+					{
+						uint32_t degree;
+						uint32_t coefficients;
+						uint32_t initial[3];
+					};
+					const Polynomial polynomials[Sequences::SOBOL_DIMENSION_NUM - 1] = {
+						{ 1, 0, { 1 } },
+						{ 2, 1, { 1, 3 } },
+						{ 3, 1, { 1, 3, 1 } },
+					};
+
+					for (uint32_t i = 0; i < 32; i++) {
+						v[0][i] = 1u << (31 - i);
+					}
+					for (uint32_t d = 1; d < Sequences::SOBOL_DIMENSION_NUM; d++) {
+						const Polynomial& p = polynomials[d - 1];
+						uint32_t* dir = v[d];
+						for (uint32_t i = 0; i < p.degree; i++) {
+							dir[i] = p.initial[i] << (31 - i);
+						}
+						for (uint32_t i = p.degree; i < 32; i++) {
+							dir[i] = dir[i - p.degree] ^ (dir[i - p.degree] >> p.degree);
+							for (uint32_t k = 1; k < p.degree; k++) {
+								if ((p.coefficients >> (p.degree - 1 - k)) & 1) {
+									dir[i] ^= dir[i - k];
+								}
+							}
+						}
+					}
+				}
+			};
+			static const Table table;
+			return table.v;
+		}
+
+		uint32_t SobolBits(uint32_t index, const uint32_t* directions)
+		{
+			uint32_t result = 0;
+			for (uint32_t i = 0; index != 0; i++, index >>= 1) {
+				if (index & 1) {
+					result ^= directions[i];
+				}
+			}
+			return result;
+		}
+
+		// void-and-cluster法で使う、環状につないだタイル上のガウス重みの合計
+		class BlueNoiseEnergy
+		{
+		private:
+			uint32_t size_;
+			std::vector<float> weights_;		// 1方向の距離ごとの重み(2次元の重みは積で求まる)
+			std::vector<float> energy_;
+			std::vector<uint8_t> pattern_;
+
+		public:
+			explicit BlueNoiseEnergy(uint32_t size)
+				: size_(size)
+				, weights_(size)
+				, energy_(size * size, 0.0f)
+				, pattern_(size * size, 0)
+			{
+				const float sigma = 1.5f;
+				for (uint32_t d = 0; d < size; d++) {
+					float distance = static_cast<float>(Min(d, size - d));
+					weights_[d] = expf(-(distance * distance) / (2.0f * sigma * sigma));
+				}
+			}
+
+			bool IsSet(uint32_t index) const { return pattern_[index] != 0; }
+
+			void Set(uint32_t index, bool set)
+			{
+				Assert(IsSet(index) != set);
+				pattern_[index] = set ? 1 : 0;
+				float sign = set ? 1.0f : -1.0f;
+				uint32_t mask = size_ - 1;
+				uint32_t px = index & mask;
+				uint32_t py = index / size_;
+				for (uint32_t y = 0; y < size_; y++) {
+					float wy = weights_[(y - py) & mask] * sign;
+					float* row = &energy_[y * size_];
+					for (uint32_t x = 0; x < size_; x++) {
+						row[x] += wy * weights_[(x - px) & mask];
+					}
+				}
+			}
+
+			// 点のある所で最も密な所
+			uint32_t FindTightestCluster() const
+			{
+				uint32_t result = 0;
+				float maxEnergy = -FLT_MAX;
+				for (uint32_t i = 0; i < energy_.size(); i++) {
+					if (pattern_[i] && energy_[i] > maxEnergy) {
+						maxEnergy = energy_[i];
+						result = i;
+					}
+				}
+				return result;
+			}
+
+			// 点のない所で最も疎な所
+			uint32_t FindLargestVoid() const
+			{
+				uint32_t result = 0;
+				float minEnergy = FLT_MAX;
+				for (uint32_t i = 0; i < energy_.size(); i++) {
+					if (!pattern_[i] && energy_[i] < minEnergy) {
+						minEnergy = energy_[i];
+						result = i;
+					}
+				}
+				return result;
+			}
+		};
+	}
+
+
+	Sequences::Sequences()
+		: blueNoiseReady_(false)
+	{
+	}
+
+	Sequences::~Sequences()
+	{
+		blueNoiseLoading_.Wait();
+	}
+
+	void Sequences::Initialize(const char* blueNoiseCachePath)
+	{
+		// 2次元列のテーブル
+		std::vector<float> x(TABLE_SIZE);
+		std::vector<float> y(TABLE_SIZE);
+		halton23_.resize(TABLE_SIZE);
+		GenerateHalton(2, 0, TABLE_SIZE, x.data());
+		GenerateHalton(3, 0, TABLE_SIZE, y.data());
+		for (uint32_t i = 0; i < TABLE_SIZE; i++) {
+			halton23_[i] = float2(x[i], y[i]);
+		}
+		sobol2D_.resize(TABLE_SIZE);
+		GenerateSobol(0, 0, TABLE_SIZE, x.data());
+		GenerateSobol(1, 0, TABLE_SIZE, y.data());
+		for (uint32_t i = 0; i < TABLE_SIZE; i++) {
+			sobol2D_[i] = float2(x[i], y[i]);
+		}
+		r2_.resize(TABLE_SIZE);
+		GenerateR2(0, TABLE_SIZE, r2_.data());
+
+		blueNoiseCachePath_ = blueNoiseCachePath;
+	}
+
+	Task<void> Sequences::LoadBlueNoiseAsync()
+	{
+		ScopedLock<SpinLock> lock(blueNoiseLock_);
+		if (blueNoiseLoading_.IsValid()) {
+			return blueNoiseLoading_;
+		}
+		Assert(!blueNoiseCachePath_.empty());
+
+		// キャッシュが使えなければ生成して書き出す
+		std::string cachePath = blueNoiseCachePath_;
+		blueNoiseLoading_ = ReadFileAsync(cachePath.c_str()).Then([this, cachePath](std::vector<uint8_t>& cacheData) {
+			const uint32_t num = BLUE_NOISE_SIZE * BLUE_NOISE_SIZE;
+			const BlueNoiseCacheHeader* header = reinterpret_cast<const BlueNoiseCacheHeader*>(cacheData.data());
+			if (cacheData.size() == sizeof(BlueNoiseCacheHeader) + sizeof(float) * num &&
+				header->magic == BLUE_NOISE_CACHE_MAGIC && header->size == BLUE_NOISE_SIZE) {
+				blueNoise_.resize(num);
+				memcpy(blueNoise_.data(), cacheData.data() + sizeof(BlueNoiseCacheHeader), sizeof(float) * num);
+				blueNoiseReady_.Store(true, MemoryOrder::Release);
+				return;
+			}
+
+			Printf("Generating blue noise %ux%u\n", BLUE_NOISE_SIZE, BLUE_NOISE_SIZE);
+			std::vector<float> blueNoise(num);
+			GenerateBlueNoise(BLUE_NOISE_SIZE, blueNoise.data());
+
+			std::ofstream file(cachePath, std::ios::out | std::ios::binary);
+			BlueNoiseCacheHeader newHeader;
+			newHeader.magic = BLUE_NOISE_CACHE_MAGIC;
+			newHeader.size = BLUE_NOISE_SIZE;
+			file.write((const char*)&newHeader, sizeof(newHeader));
+			file.write((const char*)blueNoise.data(), sizeof(float) * num);
+			blueNoise_.swap(blueNoise);
+			blueNoiseReady_.Store(true, MemoryOrder::Release);
+		});
+		return blueNoiseLoading_;
+	}
+
+	void Sequences::Finalize()
+	{
+		blueNoiseLoading_.Wait();
+		blueNoiseLoading_ = Task<void>();
+		blueNoiseReady_.Store(false, MemoryOrder::Release);
+		blueNoiseCachePath_.clear();
+		halton23_.clear();
+		sobol2D_.clear();
+		r2_.clear();
+		blueNoise_.clear();
+	}
+
+	float Sequences::Halton(uint32_t index, uint32_t base)
+	{
+		Assert(base >= 2);
+		if (base == 2) {
+			return Sobol(index, 0);
+		}
+
+		// 桁を逆順に並べた整数を基数のべき乗で割る
+		double invBase = 1.0 / base;
+		double invBaseN = 1.0;
+		uint64_t reversed = 0;
+		while (index > 0) {
+			uint32_t next = index / base;
+			reversed = reversed * base + (index - next * base);
+			invBaseN *= invBase;
+			index = next;
+		}
+		return Min(static_cast<float>(reversed * invBaseN), ONE_MINUS_EPSILON);
+	}
+
+	float Sequences::Sobol(uint32_t index, uint32_t dimension)
+	{
+		Assert(dimension < SOBOL_DIMENSION_NUM);
+		return ToUnitFloat(SobolBits(index, GetSobolDirections()[dimension]));
+	}
+
+	float2 Sequences::R2(uint32_t index)
+	{
+		return float2(ToUnitFloat(R2_OFFSET + index * R2_ALPHA_X), ToUnitFloat(R2_OFFSET + index * R2_ALPHA_Y));
+	}
+
+	void Sequences::GenerateHalton(uint32_t base, uint32_t first, uint32_t count, float* out)
+	{
+		if (base == 2) {
+			GenerateSobol(0, first, count, out);
+			return;
+		}
+		for (uint32_t i = 0; i < count; i++) {
+			out[i] = Halton(first + i, base);
+		}
+	}
+
+	void Sequences::GenerateSobol(uint32_t dimension, uint32_t first, uint32_t count, float* out)
+	{
+		Assert(dimension < SOBOL_DIMENSION_NUM);
+		const uint32_t* directions = GetSobolDirections()[dimension];
+
+		// 4要素ずつ、インデックスのビットごとに方向数を排他的論理和で足し込む
+		uint32_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			uint32_t index = first + i;
+			UInt4 bits = SetUInt(index, index + 1, index + 2, index + 3);
+			UInt4 result = SplatUInt(0);
+			for (uint32_t b = 0; b < 32 && ((index + 3) >> b) != 0; b++) {
+				result = XorUInt(result, AndUInt(LowBitMask(bits), SplatUInt(directions[b])));
+				bits = ShiftRight1(bits);
+			}
+			StoreUnitFloat4(out + i, result);
+		}
+		for (; i < count; i++) {
+			out[i] = ToUnitFloat(SobolBits(first + i, directions));
+		}
+	}
+
+	void Sequences::GenerateR2(uint32_t first, uint32_t count, float2* out)
+	{
+		// 固定小数点なのでインデックスが大きくなっても精度が落ちない
+		UInt4 x = AddUInt(SplatUInt(R2_OFFSET + first * R2_ALPHA_X), SetUInt(0, R2_ALPHA_X, R2_ALPHA_X * 2, R2_ALPHA_X * 3));
+		UInt4 y = AddUInt(SplatUInt(R2_OFFSET + first * R2_ALPHA_Y), SetUInt(0, R2_ALPHA_Y, R2_ALPHA_Y * 2, R2_ALPHA_Y * 3));
+		UInt4 stepX = SplatUInt(R2_ALPHA_X * 4);
+		UInt4 stepY = SplatUInt(R2_ALPHA_Y * 4);
+		uint32_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			float xs[4];
+			float ys[4];
+			StoreUnitFloat4(xs, x);
+			StoreUnitFloat4(ys, y);
+			for (uint32_t j = 0; j < 4; j++) {
+				out[i + j] = float2(xs[j], ys[j]);
+			}
+			x = AddUInt(x, stepX);
+			y = AddUInt(y, stepY);
+		}
+		for (; i < count; i++) {
+			out[i] = R2(first + i);
+		}
+	}
+
+	void Sequences::GenerateBlueNoise(uint32_t size, float* out)
+	{
+		Assert(size > 0 && (size & (size - 1)) == 0);
+		const uint32_t num = size * size;
+		std::vector<uint32_t> ranks(num);
+
+		// 初期パターン: 1割の点を乱数で置き、最も密な点を最も疎な所へ動かすのを動かなくなるまで繰り返す
+		// 生成結果が毎回同じになるよう乱数の種は固定
+		BlueNoiseEnergy initial(size);
+		std::mt19937 random(0x5eed);
+		uint32_t initialNum = Max(num / 10, 1u);
+		for (uint32_t placed = 0; placed < initialNum; ) {
+			uint32_t index = random() % num;
+			if (!initial.IsSet(index)) {
+				initial.Set(index, true);
+				placed++;
+			}
+		}
+		for (uint32_t iteration = 0; iteration < num; iteration++) {
+			uint32_t cluster = initial.FindTightestCluster();
+			initial.Set(cluster, false);
+			uint32_t largestVoid = initial.FindLargestVoid();
+			initial.Set(largestVoid, true);
+			if (largestVoid == cluster) {
+				break;
+			}
+		}
+
+		// 初期パターンから密な順に抜いて、小さい順位を付ける
+		BlueNoiseEnergy removing = initial;
+		for (uint32_t rank = initialNum; rank > 0; rank--) {
+			uint32_t cluster = removing.FindTightestCluster();
+			removing.Set(cluster, false);
+			ranks[cluster] = rank - 1;
+		}
+
+		// 初期パターンから疎な所へ順に足して、大きい順位を付ける
+		// (Ulichneyの方法では半分を超えたら点のない側で数えるが、ここでは同じ基準のまま埋める)
+		BlueNoiseEnergy adding = initial;
+		for (uint32_t rank = initialNum; rank < num; rank++) {
+			uint32_t largestVoid = adding.FindLargestVoid();
+			adding.Set(largestVoid, true);
+			ranks[largestVoid] = rank;
+		}
+
+		for (uint32_t i = 0; i < num; i++) {
+			out[i] = static_cast<float>(ranks[i]) / static_cast<float>(num);
+		}
+	}
+}
@@ -0,0 +1,96 @@
+﻿#pragma once
+
+#include "se/Common.h"
+#include "se/Math/Math.h"
+#include "se/async/Task.h"
+#include "se/async/Threading.h"
+#include <vector>
+#include <string>
+
+namespace se
+{
+	/**
+	 * 低食い違い列とブルーノイズ
+	 * 静的関数は列を直接生成する(まとめて生成する版は2進の列をSIMDで4要素ずつ計算する)
+	 * インスタンスはよく使う2次元列を生成済みのテーブルとして持ち、インデックスを折り返して引く
+	 * ブルーノイズはvoid-and-cluster法で生成し、生成に時間がかかるのでファイルにキャッシュする
+ * 使わないアプリケーションで起動を遅くしないよう、最初に使うときに読み込む
+	 */
+	class Sequences
+	{
+	public:
+		static const uint32_t TABLE_SIZE = 4096;			// 2次元列のテーブルの要素数(2のべき乗)
+		static const uint32_t BLUE_NOISE_SIZE = 64;			// ブルーノイズのタイルの一辺(2のべき乗)
+		static const uint32_t SOBOL_DIMENSION_NUM = 4;
+
+	private:
+		std::vector<float2> halton23_;
+		std::vector<float2> sobol2D_;
+		std::vector<float2> r2_;
+		std::vector<float> blueNoise_;
+		std::string blueNoiseCachePath_;
+		SpinLock blueNoiseLock_;				// blueNoiseLoading_を始める時だけ使う
+		Task<void> blueNoiseLoading_;
+		Atomic<bool> blueNoiseReady_;
+
+	private:
+		Sequences();
+		~Sequences();
+
+	public:
+		static Sequences& Get()
+		{
+			static Sequences instance;
+			return instance;
+		}
+
+		/**
+		 * 2次元列のテーブルを生成する
+		 * ブルーノイズはここでは読み込まず、キャッシュの場所だけ覚えておく
+		 */
+		void Initialize(const char* blueNoiseCachePath);
+		void Finalize();
+
+		/**
+		 * ブルーノイズをキャッシュから読み込む(なければ生成して書き出す)
+		 * 2回目以降は最初のタスクを返す、使う前に読み込みを済ませておきたい場合に呼ぶ
+		 */
+		Task<void> LoadBlueNoiseAsync();
+
+		// インデックスはテーブルの大きさで折り返す
+		const float2& GetHalton23(uint32_t index) const { return halton23_[index & (TABLE_SIZE - 1)]; }
+		const float2& GetSobol2D(uint32_t index) const { return sobol2D_[index & (TABLE_SIZE - 1)]; }
+		const float2& GetR2(uint32_t index) const { return r2_[index & (TABLE_SIZE - 1)]; }
+
+		// [0, 1)の値、座標はタイルの大きさで折り返す
+		// 読み込みが済んでいなければ読み込みを始めて完了を待つ
+		bool IsBlueNoiseReady() const { return blueNoiseReady_.Load(MemoryOrder::Acquire); }
+		float GetBlueNoise(uint32_t x, uint32_t y)
+		{
+			return GetBlueNoiseTable()[(y & (BLUE_NOISE_SIZE - 1)) * BLUE_NOISE_SIZE + (x & (BLUE_NOISE_SIZE - 1))];
+		}
+		const float* GetBlueNoiseTable()
+		{
+			if (!IsBlueNoiseReady()) {
+				LoadBlueNoiseAsync().Wait();
+			}
+			return blueNoise_.data();
+		}
+
+	public:
+		// baseを基数とするindex番目のHalton列(基数逆関数)
+		static float Halton(uint32_t index, uint32_t base);
+		// index番目のSobol列のdimension次元目(dimension < SOBOL_DIMENSION_NUM)
+		static float Sobol(uint32_t index, uint32_t dimension);
+		// index番目のR2列(黄金比を2次元に拡張した加法的な列)
+		static float2 R2(uint32_t index);
+
+		// first番目からcount個を生成する、2の基数とSobolとR2は4要素ずつSIMDで計算する
+		static void GenerateHalton(uint32_t base, uint32_t first, uint32_t count, float* out);
+		static void GenerateSobol(uint32_t dimension, uint32_t first, uint32_t count, float* out);
+		static void GenerateR2(uint32_t first, uint32_t count, float2* out);
+
+		// size×size(2のべき乗)のタイル状のブルーノイズを生成する、各値は[0, 1)で重複しない
+		static void GenerateBlueNoise(uint32_t size, float* out);
+	};
+}
@@ -0,0 +1,180 @@
+﻿#include "se/Memory/FrameArena.h"
+
+namespace se {
+
+	namespace {
+		const uint32_t UNASSIGNED_SLOT = 0xFFFFFFFF;
+
+		/**
+		 * スレッドへのスロット番号の割り当て
+		 * 終了したスレッドの番号は次に使い始めたスレッドに回す
+		 */
+		class ThreadSlotRegistry
+		{
+		private:
+			SpinLock lock_;
+			std::vector<uint32_t> freeSlots_;
+			uint32_t nextSlot_;
+
+		public:
+			ThreadSlotRegistry()
+				: nextSlot_(0)
+			{
+			}
+
+			// 空きがなければMAX_THREAD_NUMを返す(そのスレッドはロックを取る経路で確保する)
+			uint32_t Acquire()
+			{
+				ScopedLock<SpinLock> lock(lock_);
+				if (!freeSlots_.empty()) {
+					uint32_t index = freeSlots_.back();
+					freeSlots_.pop_back();
+					return index;
+				}
+				if (nextSlot_ < FrameArena::MAX_THREAD_NUM) {
+					return nextSlot_++;
+				}
+				return FrameArena::MAX_THREAD_NUM;
+			}
+
+			void Release(uint32_t index)
+			{
+				ScopedLock<SpinLock> lock(lock_);
+				freeSlots_.push_back(index);
+			}
+		};
+
+		ThreadSlotRegistry& GetThreadSlotRegistry()
+		{
+			static ThreadSlotRegistry registry;
+			return registry;
+		}
+
+		// スレッドの終了時にスロットを返す
+		// 前のスレッドが切り出していたチャンクの残りは、同じスロットを使う次のスレッドがそのまま使う
+		struct ThreadSlot
+		{
+			uint32_t index;
+
+			ThreadSlot()
+				: index(UNASSIGNED_SLOT)
+			{
+			}
+
+			~ThreadSlot()
+			{
+				if (index < FrameArena::MAX_THREAD_NUM) {
+					GetThreadSlotRegistry().Release(index);
+				}
+			}
+		};
+
+		thread_local ThreadSlot tlsThreadSlot;
+	}
+
+
+	uint32_t FrameArena::GetThreadSlotIndex()
+	{
+		if (tlsThreadSlot.index == UNASSIGNED_SLOT) {
+			// レジストリをスロットより先に生成して、スレッドの終了時に破棄済みにならないようにする
+			tlsThreadSlot.index = GetThreadSlotRegistry().Acquire();
+			Assert(tlsThreadSlot.index < MAX_THREAD_NUM);
+		}
+		return tlsThreadSlot.index;
+	}
+
+	FrameArena::FrameArena(size_t chunkSize, MemoryTag tag)
+		: chunkSize_(chunkSize)
+		, tag_(tag)
+	{
+		static_assert(sizeof(Slot) == 64, "Slot should occupy a cache line");
+		memset(slots_, 0, sizeof(slots_));
+		memset(&stats_, 0, sizeof(stats_));
+		// 破棄時に集計できるようトラッカーを先に生成しておく
+		MemoryTracker::Get();
+	}
+
+	FrameArena::~FrameArena()
+	{
+		Release();
+	}
+
+	void* FrameArena::AllocateSlow(Slot* slot, size_t size, size_t alignment)
+	{
+		ScopedLock<SpinLock> lock(lock_);
+
+		// チャンクに収まらないものは個別に確保してResetで返す
+		if (!slot || size + alignment > chunkSize_) {
+			Chunk chunk;
+			chunk.size = size + alignment;
+			chunk.data = new uint8_t[chunk.size];
+			oversizedChunks_.push_back(chunk);
+			MemoryTracker::Get().OnAllocate(tag_, chunk.size);
+			if (slot) {
+				slot->allocatedSize += size;
+			}
+			return AlignPointer(chunk.data, alignment);
+		}
+
+		// 新しいチャンクに切り替え(前のチャンクの残りは捨てる)
+		Chunk chunk;
+		if (!freeChunks_.empty()) {
+			chunk = freeChunks_.back();
+			freeChunks_.pop_back();
+		} else {
+			chunk.size = chunkSize_;
+			chunk.data = new uint8_t[chunk.size];
+			MemoryTracker::Get().OnAllocate(tag_, chunk.size);
+		}
+		usedChunks_.push_back(chunk);
+
+		uint8_t* ptr = AlignPointer(chunk.data, alignment);
+		slot->cursor = ptr + size;
+		slot->end = chunk.data + chunk.size;
+		slot->allocatedSize += size;
+		return ptr;
+	}
+
+	void FrameArena::Reset()
+	{
+		ScopedLock<SpinLock> lock(lock_);
+
+		size_t frameSize = 0;
+		for (auto& slot : slots_) {
+			frameSize += slot.allocatedSize;
+			slot.cursor = nullptr;
+			slot.end = nullptr;
+			slot.allocatedSize = 0;
+		}
+
+		stats_.frameSize = frameSize;
+		stats_.highWaterMark = (std::max)(stats_.highWaterMark, frameSize);
+		stats_.oversizedNum = static_cast<uint32_t>(oversizedChunks_.size());
+
+		for (auto& chunk : oversizedChunks_) {
+			delete[] chunk.data;
+			MemoryTracker::Get().OnFree(tag_, chunk.size);
+		}
+		oversizedChunks_.clear();
+		freeChunks_.insert(freeChunks_.end(), usedChunks_.begin(), usedChunks_.end());
+		usedChunks_.clear();
+
+		stats_.chunkNum = static_cast<uint32_t>(freeChunks_.size());
+		stats_.reservedSize = freeChunks_.size() * chunkSize_;
+	}
+
+	void FrameArena::Release()
+	{
+		Reset();
+
+		ScopedLock<SpinLock> lock(lock_);
+		for (auto& chunk : freeChunks_) {
+			delete[] chunk.data;
+			MemoryTracker::Get().OnFree(tag_, chunk.size);
+		}
+		freeChunks_.clear();
+		stats_.chunkNum = 0;
+		stats_.reservedSize = 0;
+	}
+
+}
@@ -0,0 +1,217 @@
+﻿#pragma once
+
+#include "se/Common.h"
+#include "se/async/Threading.h"
+#include "se/Memory/MemoryTracker.h"
+#include <vector>
+#include <new>
+#include <utility>
+
+namespace se {
+
+	/**
+	 * フレームアリーナ
+	 * 1フレームだけ生きる一時データ用のバンプアロケータ
+	 * スレッドごとに専用のチャンクから切り出すので確保はロックなしで、解放はResetで一括して行う
+	 * Resetは確保したメモリを誰も使っていない時点(フレーム境界)で1スレッドから呼ぶこと
+	 * New<T>で作ったオブジェクトのデストラクタは呼ばれない
+	 */
+	class FrameArena
+	{
+	public:
+		static const size_t DEFAULT_CHUNK_SIZE = 256 * 1024;
+		static const uint32_t MAX_THREAD_NUM = 128;
+
+		struct Stats
+		{
+			size_t frameSize;			// 直前のフレームで確保したサイズ
+			size_t highWaterMark;		// これまでの1フレームの最大確保サイズ
+			size_t reservedSize;		// 保持しているチャンクの合計サイズ
+			uint32_t chunkNum;
+			uint32_t oversizedNum;		// 直前のフレームでチャンクに収まらず個別に確保した数
+		};
+
+	private:
+		struct Chunk
+		{
+			uint8_t* data;
+			size_t size;
+		};
+
+		// スレッドごとの切り出し位置、キャッシュラインを分ける
+		struct Slot
+		{
+			uint8_t* cursor;
+			uint8_t* end;
+			size_t allocatedSize;
+			uint8_t padding[64 - sizeof(uint8_t*) * 2 - sizeof(size_t)];
+		};
+
+	private:
+		Slot slots_[MAX_THREAD_NUM];
+		size_t chunkSize_;
+		MemoryTag tag_;
+
+		SpinLock lock_;
+		std::vector<Chunk> usedChunks_;		// このフレームで使用中
+		std::vector<Chunk> freeChunks_;
+		std::vector<Chunk> oversizedChunks_;
+		Stats stats_;
+
+	private:
+		FrameArena(const FrameArena&) = delete;
+		FrameArena& operator=(const FrameArena&) = delete;
+
+		void* AllocateSlow(Slot* slot, size_t size, size_t alignment);
+
+		static uint8_t* AlignPointer(uint8_t* ptr, size_t alignment)
+		{
+			return reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(ptr) + (alignment - 1)) & ~static_cast<uintptr_t>(alignment - 1));
+		}
+
+		// 呼び出したスレッドのスロット番号(初回に割り当てられ、全アリーナで共通、スレッドの終了時に返される)
+		static uint32_t GetThreadSlotIndex();
+
+	public:
+		// tag:チャンクの確保を集計するタグ
+		explicit FrameArena(size_t chunkSize = DEFAULT_CHUNK_SIZE, MemoryTag tag = MemoryTag::General);
+		~FrameArena();
+
+		// alignmentは2のべき乗
+		void* Allocate(size_t size, size_t alignment = 16)
+		{
+			Assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+			uint32_t index = GetThreadSlotIndex();
+			if (index >= MAX_THREAD_NUM) {
+				// スロットを使い切ったスレッドはロックを取って個別に確保
+				return AllocateSlow(nullptr, size, alignment);
+			}
+			Slot& slot = slots_[index];
+			uint8_t* ptr = AlignPointer(slot.cursor, alignment);
+			if (!slot.cursor || ptr + size > slot.end) {
+				return AllocateSlow(&slot, size, alignment);
+			}
+			slot.cursor = ptr + size;
+			slot.allocatedSize += size;
+			return ptr;
+		}
+
+		template<class T, class... Args>
+		T* New(Args&&... args)
+		{
+			return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		}
+
+		template<class T>
+		T* NewArray(size_t count)
+		{
+			T* ptr = static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+			for (size_t i = 0; i < count; i++) {
+				new (ptr + i) T();
+			}
+			return ptr;
+		}
+
+		// 全確保を破棄してチャンクを再利用に回す
+		void Reset();
+
+		// チャンクを全てOSに返す
+		void Release();
+
+		const Stats& GetStats() const { return stats_; }
+	};
+
+
+	/**
+	 * FrameArenaから確保するSTLアロケータ
+	 * 解放は何もしないので、コンテナはアリーナのResetまでに使い終えること
+	 */
+	template<class T>
+	class FrameArenaAllocator
+	{
+		template<class U> friend class FrameArenaAllocator;
+
+	private:
+		FrameArena* arena_;
+
+	public:
+		typedef T value_type;
+
+		FrameArenaAllocator(FrameArena& arena)
+			: arena_(&arena)
+		{
+		}
+
+		template<class U>
+		FrameArenaAllocator(const FrameArenaAllocator<U>& other)
+			: arena_(other.arena_)
+		{
+		}
+
+		T* allocate(size_t n)
+		{
+			return static_cast<T*>(arena_->Allocate(sizeof(T) * n, alignof(T)));
+		}
+
+		void deallocate(T*, size_t)
+		{
+		}
+
+		FrameArena& GetArena() const { return *arena_; }
+
+		template<class U>
+		bool operator==(const FrameArenaAllocator<U>& other) const { return arena_ == other.arena_; }
+		template<class U>
+		bool operator!=(const FrameArenaAllocator<U>& other) const { return arena_ != other.arena_; }
+	};
+
+	template<class T>
+	using FrameVector = std::vector<T, FrameArenaAllocator<T>>;
+
+
+	/**
+	 * フレームの一時データ用のグローバルなアリーナ
+	 * 描画スレッドが遅れて読むデータも置けるよう、FRAME_NUM個のアリーナをフレームごとに巡回して使う
+	 * BeginFrameはフレームの開始時にメインスレッドから呼び、FRAME_NUMフレーム前のアリーナをResetする
+	 * (FramePipelineのバッファ数はFRAME_NUM以下にすること)
+	 */
+	class GlobalFrameArena
+	{
+	public:
+		static const uint32_t FRAME_NUM = 3;
+
+	private:
+		FrameArena arenas_[FRAME_NUM];
+		uint32_t current_;
+
+	private:
+		GlobalFrameArena()
+			: current_(0)
+		{
+		}
+
+	public:
+		static GlobalFrameArena& Get()
+		{
+			static GlobalFrameArena instance;
+			return instance;
+		}
+
+		void BeginFrame()
+		{
+			current_ = (current_ + 1) % FRAME_NUM;
+			arenas_[current_].Reset();
+		}
+
+		// 現在のフレームのアリーナ(BeginFrameから次のBeginFrameまで同じもの)
+		FrameArena& GetCurrent() { return arenas_[current_]; }
+
+		void Release()
+		{
+			for (auto& arena : arenas_) {
+				arena.Release();
+			}
+		}
+	};
+
+}
@@ -0,0 +1,7 @@
+﻿#pragma once
+
+#include "MemoryTracker.h"
+#include "FrameArena.h"
+#include "PoolAllocator.h"
+#include "ResourcePool.h"
+#include "RingAllocator.h"
\ No newline at end of file
@@ -0,0 +1,235 @@
+﻿#include "se/Memory/MemoryTracker.h"
+#include "thirdparty/picojson/picojson.h"
+#include <fstream>
+#include <stdlib.h>
+#if !defined(_WIN32)
+	#include <execinfo.h>
+#endif
+
+namespace se {
+
+	namespace {
+		const char* tagNames[] = {
+			"General",
+			"Mesh",
+			"Texture",
+			"Shader",
+			"Profiler",
+			"ImGui",
+			"Jobs",
+			"IO",
+		};
+		static_assert(ARRAYSIZE(tagNames) == static_cast<int>(MemoryTag::Num), "tag name is missing");
+
+		// TrackedAllocateのヘッダ、返すポインタの直前に置く
+		struct AllocationHeader
+		{
+			void* raw;
+			size_t size;
+			MemoryTag tag;
+		};
+
+		const size_t DEFAULT_CALLSTACK_THRESHOLD = 1024 * 1024;
+	}
+
+
+	const char* GetMemoryTagName(MemoryTag tag)
+	{
+		Assert(tag < MemoryTag::Num);
+		return tagNames[static_cast<int>(tag)];
+	}
+
+
+	MemoryTracker::MemoryTracker()
+		: frame_(0)
+		, nextSample_(0)
+		, callstackThreshold_(DEFAULT_CALLSTACK_THRESHOLD)
+	{
+		for (auto& counter : counters_) {
+			counter.lastFrameAllocNum = 0;
+			counter.budget = 0;
+			counter.overBudget = false;
+		}
+	}
+
+	MemoryTracker::~MemoryTracker()
+	{
+	}
+
+	void MemoryTracker::OnAllocate(MemoryTag tag, size_t size)
+	{
+		Assert(tag < MemoryTag::Num);
+		TagCounter& counter = counters_[static_cast<int>(tag)];
+		size_t current = counter.currentSize.FetchAdd(size, MemoryOrder::Relaxed) + size;
+		counter.totalAllocNum.FetchAdd(1, MemoryOrder::Relaxed);
+		counter.frameAllocNum.FetchAdd(1, MemoryOrder::Relaxed);
+
+		size_t peak = counter.peakSize.Load(MemoryOrder::Relaxed);
+		while (peak < current && !counter.peakSize.CompareExchangeWeak(peak, current, MemoryOrder::Relaxed)) {
+		}
+
+		size_t threshold = callstackThreshold_.Load(MemoryOrder::Relaxed);
+		if (threshold > 0 && size >= threshold) {
+			RecordCallstack(tag, size);
+		}
+	}
+
+	void MemoryTracker::OnFree(MemoryTag tag, size_t size)
+	{
+		Assert(tag < MemoryTag::Num);
+		counters_[static_cast<int>(tag)].currentSize.FetchSub(size, MemoryOrder::Relaxed);
+	}
+
+	void MemoryTracker::RecordCallstack(MemoryTag tag, size_t size)
+	{
+		CallstackSample sample;
+		sample.tag = tag;
+		sample.size = size;
+		sample.frame = frame_;
+#if defined(_WIN32)
+		sample.depth = CaptureStackBackTrace(2, MAX_CALLSTACK_DEPTH, sample.frames, nullptr);
+#else
+		sample.depth = static_cast<uint32_t>(backtrace(sample.frames, MAX_CALLSTACK_DEPTH));
+#endif
+
+		ScopedLock<SpinLock> lock(sampleLock_);
+		if (samples_.size() < MAX_CALLSTACK_SAMPLE_NUM) {
+			samples_.push_back(sample);
+		} else {
+			samples_[nextSample_] = sample;
+		}
+		nextSample_ = (nextSample_ + 1) % MAX_CALLSTACK_SAMPLE_NUM;
+	}
+
+	void MemoryTracker::EndFrame()
+	{
+		for (int i = 0; i < static_cast<int>(MemoryTag::Num); i++) {
+			TagCounter& counter = counters_[i];
+			counter.lastFrameAllocNum = counter.frameAllocNum.Exchange(0, MemoryOrder::Relaxed);
+
+			// 超えた時と戻った時に1回だけ通知する
+			size_t current = counter.currentSize.Load(MemoryOrder::Relaxed);
+			bool overBudget = counter.budget > 0 && current > counter.budget;
+			if (overBudget && !counter.overBudget) {
+				Printf("[MemoryTracker] %s is over budget: %.2fMB / %.2fMB\n", tagNames[i],
+					current / (1024.0 * 1024.0), counter.budget / (1024.0 * 1024.0));
+			}
+			counter.overBudget = overBudget;
+		}
+		frame_++;
+	}
+
+	void MemoryTracker::SetBudget(MemoryTag tag, size_t bytes)
+	{
+		Assert(tag < MemoryTag::Num);
+		counters_[static_cast<int>(tag)].budget = bytes;
+	}
+
+	MemoryTracker::TagStats MemoryTracker::GetTagStats(MemoryTag tag) const
+	{
+		Assert(tag < MemoryTag::Num);
+		const TagCounter& counter = counters_[static_cast<int>(tag)];
+		TagStats stats;
+		stats.currentSize = counter.currentSize.Load(MemoryOrder::Relaxed);
+		stats.peakSize = counter.peakSize.Load(MemoryOrder::Relaxed);
+		stats.budget = counter.budget;
+		stats.totalAllocNum = counter.totalAllocNum.Load(MemoryOrder::Relaxed);
+		stats.frameAllocNum = counter.lastFrameAllocNum;
+		stats.overBudget = counter.overBudget;
+		return stats;
+	}
+
+	std::vector<MemoryTracker::CallstackSample> MemoryTracker::GetCallstackSamples()
+	{
+		ScopedLock<SpinLock> lock(sampleLock_);
+
+		// 古い順に並べて返す
+		std::vector<CallstackSample> result;
+		result.reserve(samples_.size());
+		uint32_t begin = samples_.size() < MAX_CALLSTACK_SAMPLE_NUM ? 0 : nextSample_;
+		for (size_t i = 0; i < samples_.size(); i++) {
+			result.push_back(samples_[(begin + i) % samples_.size()]);
+		}
+		return result;
+	}
+
+	bool MemoryTracker::ExportJson(const char* fileName)
+	{
+		picojson::array tags;
+		for (int i = 0; i < static_cast<int>(MemoryTag::Num); i++) {
+			TagStats stats = GetTagStats(static_cast<MemoryTag>(i));
+			picojson::object tag;
+			tag["name"] = picojson::value(tagNames[i]);
+			tag["currentSize"] = picojson::value(static_cast<double>(stats.currentSize));
+			tag["peakSize"] = picojson::value(static_cast<double>(stats.peakSize));
+			tag["budget"] = picojson::value(static_cast<double>(stats.budget));
+			tag["totalAllocNum"] = picojson::value(static_cast<double>(stats.totalAllocNum));
+			tag["frameAllocNum"] = picojson::value(static_cast<double>(stats.frameAllocNum));
+			tag["overBudget"] = picojson::value(stats.overBudget);
+			tags.push_back(picojson::value(tag));
+		}
+
+		// アドレスのまま出力する(シンボル解決はpdb/mapを使ってオフラインで行う)
+		picojson::array samples;
+		for (const auto& sample : GetCallstackSamples()) {
+			picojson::array callstack;
+			for (uint32_t i = 0; i < sample.depth; i++) {
+				char address[32];
+				snprintf(address, sizeof(address), "0x%llx", static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(sample.frames[i])));
+				callstack.push_back(picojson::value(address));
+			}
+			picojson::object object;
+			object["tag"] = picojson::value(tagNames[static_cast<int>(sample.tag)]);
+			object["size"] = picojson::value(static_cast<double>(sample.size));
+			object["frame"] = picojson::value(static_cast<double>(sample.frame));
+			object["callstack"] = picojson::value(callstack);
+			samples.push_back(picojson::value(object));
+		}
+
+		picojson::object root;
+		root["frame"] = picojson::value(static_cast<double>(frame_));
+		root["tags"] = picojson::value(tags);
+		root["largeAllocations"] = picojson::value(samples);
+
+		std::ofstream file(fileName, std::ios::out | std::ios::trunc);
+		if (!file) {
+			Printf("[MemoryTracker] failed to open %s\n", fileName);
+			return false;
+		}
+		file << picojson::value(root).serialize(true);
+		return static_cast<bool>(file);
+	}
+
+
+	void* TrackedAllocate(MemoryTag tag, size_t size, size_t alignment)
+	{
+		Assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+		if (alignment < alignof(AllocationHeader)) {
+			alignment = alignof(AllocationHeader);
+		}
+
+		uint8_t* raw = static_cast<uint8_t*>(malloc(size + sizeof(AllocationHeader) + alignment - 1));
+		if (!raw) {
+			return nullptr;
+		}
+		uint8_t* ptr = reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(raw + sizeof(AllocationHeader)) + (alignment - 1)) & ~static_cast<uintptr_t>(alignment - 1));
+		AllocationHeader* header = reinterpret_cast<AllocationHeader*>(ptr) - 1;
+		header->raw = raw;
+		header->size = size;
+		header->tag = tag;
+
+		MemoryTracker::Get().OnAllocate(tag, size);
+		return ptr;
+	}
+
+	void TrackedFree(void* ptr)
+	{
+		if (!ptr) {
+			return;
+		}
+		AllocationHeader* header = static_cast<AllocationHeader*>(ptr) - 1;
+		MemoryTracker::Get().OnFree(header->tag, header->size);
+		free(header->raw);
+	}
+
+}
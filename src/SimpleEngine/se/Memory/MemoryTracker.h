@@ -0,0 +1,128 @@
+﻿#pragma once
+
+#include "se/Common.h"
+#include "se/async/Threading.h"
+#include <vector>
+
+namespace se {
+
+	/**
+	 * メモリの用途タグ
+	 */
+	enum class MemoryTag
+	{
+		General,
+		Mesh,
+		Texture,
+		Shader,
+		Profiler,
+		ImGui,
+		Jobs,
+		IO,
+
+		Num,
+	};
+
+	const char* GetMemoryTagName(MemoryTag tag);
+
+
+	/**
+	 * メモリトラッカー
+	 * タグごとに確保中のサイズ・ピーク・フレームあたりの確保回数を集計し、予算を超えたら警告する
+	 * 閾値以上の大きな確保はコールスタックを記録する
+	 * 集計は任意のスレッドから行え、EndFrameはメインスレッドからフレームの終わりに呼ぶ
+	 */
+	class MemoryTracker
+	{
+	public:
+		static const uint32_t MAX_CALLSTACK_DEPTH = 16;
+		static const uint32_t MAX_CALLSTACK_SAMPLE_NUM = 64;
+
+		static MemoryTracker& Get() {
+			static MemoryTracker instance;
+			return instance;
+		}
+
+		struct TagStats
+		{
+			size_t currentSize;
+			size_t peakSize;
+			size_t budget;				// 0なら予算なし
+			uint64_t totalAllocNum;
+			uint32_t frameAllocNum;		// 直前のフレームの確保回数
+			bool overBudget;
+		};
+
+		struct CallstackSample
+		{
+			MemoryTag tag;
+			size_t size;
+			uint64_t frame;
+			uint32_t depth;
+			void* frames[MAX_CALLSTACK_DEPTH];
+		};
+
+	private:
+		struct TagCounter
+		{
+			Atomic<size_t> currentSize;
+			Atomic<size_t> peakSize;
+			Atomic<uint64_t> totalAllocNum;
+			Atomic<uint32_t> frameAllocNum;
+			uint32_t lastFrameAllocNum;
+			size_t budget;
+			bool overBudget;
+		};
+
+	private:
+		TagCounter counters_[static_cast<int>(MemoryTag::Num)];
+		uint64_t frame_;
+
+		SpinLock sampleLock_;
+		std::vector<CallstackSample> samples_;		// 古いものから上書きするリング
+		uint32_t nextSample_;
+		Atomic<size_t> callstackThreshold_;
+
+	private:
+		MemoryTracker();
+		~MemoryTracker();
+		MemoryTracker(const MemoryTracker&) = delete;
+		MemoryTracker& operator=(const MemoryTracker&) = delete;
+
+		void RecordCallstack(MemoryTag tag, size_t size);
+
+	public:
+		void OnAllocate(MemoryTag tag, size_t size);
+		void OnFree(MemoryTag tag, size_t size);
+
+		// フレームごとの集計を締めて予算を確認する
+		void EndFrame();
+
+		// bytes:0で予算なし
+		void SetBudget(MemoryTag tag, size_t bytes);
+
+		// この値以上の確保でコールスタックを記録する、0で記録しない(既定値は1MB)
+		void SetCallstackThreshold(size_t bytes) { callstackThreshold_.Store(bytes, MemoryOrder::Relaxed); }
+
+		TagStats GetTagStats(MemoryTag tag) const;
+		std::vector<CallstackSample> GetCallstackSamples();
+		uint64_t GetFrame() const { return frame_; }
+
+		// 比較用にJSONで書き出す
+		bool ExportJson(const char* fileName);
+	};
+
+
+	/**
+	 * タグ付きの確保
+	 * 解放時にタグとサイズが分かるようヘッダを付けて確保する
+	 */
+	void* TrackedAllocate(MemoryTag tag, size_t size, size_t alignment = 16);
+	void TrackedFree(void* ptr);
+
+	struct TrackedDeleter
+	{
+		void operator()(void* ptr) const { TrackedFree(ptr); }
+	};
+
+}
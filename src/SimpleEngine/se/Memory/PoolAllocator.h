@@ -0,0 +1,348 @@
+﻿#pragma once
+
+#include "se/Common.h"
+#include "se/async/Threading.h"
+#include "se/Memory/MemoryTracker.h"
+#include <vector>
+#include <new>
+#include <utility>
+#include <functional>
+#include <type_traits>
+#include <stddef.h>
+
+namespace se {
+
+	namespace detail {
+
+		struct PoolNode
+		{
+			PoolNode* next;
+		};
+
+		/**
+		 * プールの空きリスト
+		 * ThreadSafe:任意のスレッドから確保・解放できる(128bit CASが使えればlock-free)
+		 */
+		template<bool ThreadSafe>
+		class PoolFreeList;
+
+		template<>
+		class PoolFreeList<false>
+		{
+		private:
+			PoolNode* head_;
+			uint32_t usedNum_;
+
+		public:
+			PoolFreeList()
+				: head_(nullptr)
+				, usedNum_(0)
+			{
+			}
+
+			PoolNode* Pop()
+			{
+				PoolNode* node = head_;
+				if (node) {
+					head_ = node->next;
+				}
+				return node;
+			}
+
+			// first～lastまでつながったノードをまとめて戻す
+			void Push(PoolNode* first, PoolNode* last)
+			{
+				last->next = head_;
+				head_ = first;
+			}
+
+			void AddUsedNum(int32_t value) { usedNum_ += value; }
+			uint32_t GetUsedNum() const { return usedNum_; }
+		};
+
+		template<>
+		class PoolFreeList<true>
+		{
+		private:
+#if SE_HAS_ATOMIC_128
+			Atomic128 head_;		// low:先頭ノード、high:ABA対策の更新回数
+#else
+			SpinLock lock_;
+			PoolNode* head_;
+#endif
+			Atomic<int32_t> usedNum_;
+
+		public:
+			PoolFreeList()
+				: usedNum_(0)
+			{
+#if !SE_HAS_ATOMIC_128
+				head_ = nullptr;
+#endif
+			}
+
+			PoolNode* Pop()
+			{
+#if SE_HAS_ATOMIC_128
+				Uint128 head = head_.Load();
+				for (;;) {
+					PoolNode* node = reinterpret_cast<PoolNode*>(head.low);
+					if (!node) {
+						return nullptr;
+					}
+					// nodeが他のスレッドに取られて書き換わっていても、ページは解放されないので読めて、CASが失敗する
+					Uint128 next;
+					next.low = reinterpret_cast<uint64_t>(node->next);
+					next.high = head.high + 1;
+					if (head_.CompareExchange(head, next)) {
+						return node;
+					}
+				}
+#else
+				ScopedLock<SpinLock> lock(lock_);
+				PoolNode* node = head_;
+				if (node) {
+					head_ = node->next;
+				}
+				return node;
+#endif
+			}
+
+			void Push(PoolNode* first, PoolNode* last)
+			{
+#if SE_HAS_ATOMIC_128
+				Uint128 head = head_.Load();
+				for (;;) {
+					last->next = reinterpret_cast<PoolNode*>(head.low);
+					Uint128 next;
+					next.low = reinterpret_cast<uint64_t>(first);
+					next.high = head.high + 1;
+					if (head_.CompareExchange(head, next)) {
+						return;
+					}
+				}
+#else
+				ScopedLock<SpinLock> lock(lock_);
+				last->next = head_;
+				head_ = first;
+#endif
+			}
+
+			void AddUsedNum(int32_t value) { usedNum_.FetchAdd(value, MemoryOrder::Relaxed); }
+			uint32_t GetUsedNum() const { return static_cast<uint32_t>(usedNum_.Load(MemoryOrder::Relaxed)); }
+		};
+
+	}
+
+
+	/**
+	 * 固定サイズのプールアロケータ
+	 * 同じ型のオブジェクトをページ単位でまとめて確保し、空きリストから切り出す
+	 * ページは破棄まで返さないので、定常状態では確保・解放がOSのヒープを通らない
+	 * ThreadSafe:確保したスレッドと別のスレッドから解放できる(ジョブ、IO要求など)
+	 */
+	template<class T, bool ThreadSafe = false>
+	class PoolAllocator
+	{
+	public:
+		static const size_t DEFAULT_PAGE_SIZE = 64 * 1024;
+
+		struct Stats
+		{
+			uint32_t pageNum;
+			uint32_t capacity;		// 確保できるブロック数
+			uint32_t usedNum;
+		};
+
+	private:
+		static const size_t BLOCK_ALIGNMENT = alignof(T) > alignof(detail::PoolNode) ? alignof(T) : alignof(detail::PoolNode);
+		static const size_t BLOCK_SIZE = ((sizeof(T) > sizeof(detail::PoolNode) ? sizeof(T) : sizeof(detail::PoolNode)) + BLOCK_ALIGNMENT - 1) & ~(BLOCK_ALIGNMENT - 1);
+
+		detail::PoolFreeList<ThreadSafe> freeList_;
+		uint32_t blocksPerPage_;
+		MemoryTag tag_;
+
+		SpinLock pageLock_;
+		std::vector<uint8_t*> pages_;
+
+	private:
+		PoolAllocator(const PoolAllocator&) = delete;
+		PoolAllocator& operator=(const PoolAllocator&) = delete;
+
+		// ページを追加して先頭ブロックを返し、残りは空きリストに入れる
+		detail::PoolNode* Grow()
+		{
+			ScopedLock<SpinLock> lock(pageLock_);
+
+			// 待っている間に他のスレッドが追加していればそちらを使う
+			detail::PoolNode* node = freeList_.Pop();
+			if (node) {
+				return node;
+			}
+
+			uint8_t* page = new uint8_t[GetPageSize()];
+			pages_.push_back(page);
+			MemoryTracker::Get().OnAllocate(tag_, GetPageSize());
+
+			uint8_t* begin = reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(page) + (BLOCK_ALIGNMENT - 1)) & ~static_cast<uintptr_t>(BLOCK_ALIGNMENT - 1));
+			if (blocksPerPage_ > 1) {
+				for (uint32_t i = 1; i < blocksPerPage_ - 1; i++) {
+					reinterpret_cast<detail::PoolNode*>(begin + BLOCK_SIZE * i)->next = reinterpret_cast<detail::PoolNode*>(begin + BLOCK_SIZE * (i + 1));
+				}
+				freeList_.Push(reinterpret_cast<detail::PoolNode*>(begin + BLOCK_SIZE), reinterpret_cast<detail::PoolNode*>(begin + BLOCK_SIZE * (blocksPerPage_ - 1)));
+			}
+			return reinterpret_cast<detail::PoolNode*>(begin);
+		}
+
+		size_t GetPageSize() const { return BLOCK_SIZE * blocksPerPage_ + BLOCK_ALIGNMENT; }
+
+	public:
+		// tag:ページの確保を集計するタグ
+		// blocksPerPage:1ページのブロック数、0ならDEFAULT_PAGE_SIZEに収まる数
+		explicit PoolAllocator(MemoryTag tag = MemoryTag::General, uint32_t blocksPerPage = 0)
+			: blocksPerPage_(blocksPerPage)
+			, tag_(tag)
+		{
+			if (blocksPerPage_ == 0) {
+				blocksPerPage_ = static_cast<uint32_t>(DEFAULT_PAGE_SIZE / BLOCK_SIZE);
+				if (blocksPerPage_ < 16) {
+					blocksPerPage_ = 16;
+				}
+			}
+			// 破棄時に集計できるようトラッカーを先に生成しておく
+			MemoryTracker::Get();
+		}
+
+		// 解放されていないオブジェクトのデストラクタは呼ばれない
+		~PoolAllocator()
+		{
+			Assert(freeList_.GetUsedNum() == 0);
+			for (auto* page : pages_) {
+				delete[] page;
+				MemoryTracker::Get().OnFree(tag_, GetPageSize());
+			}
+		}
+
+		void* Allocate()
+		{
+			detail::PoolNode* node = freeList_.Pop();
+			if (!node) {
+				node = Grow();
+			}
+			freeList_.AddUsedNum(1);
+			return node;
+		}
+
+		void Free(void* ptr)
+		{
+			if (!ptr) {
+				return;
+			}
+			detail::PoolNode* node = static_cast<detail::PoolNode*>(ptr);
+			freeList_.AddUsedNum(-1);
+			freeList_.Push(node, node);
+		}
+
+		template<class... Args>
+		T* New(Args&&... args)
+		{
+			return new (Allocate()) T(std::forward<Args>(args)...);
+		}
+
+		void Delete(T* object)
+		{
+			if (!object) {
+				return;
+			}
+			object->~T();
+			Free(object);
+		}
+
+		Stats GetStats()
+		{
+			ScopedLock<SpinLock> lock(pageLock_);
+			Stats stats;
+			stats.pageNum = static_cast<uint32_t>(pages_.size());
+			stats.capacity = stats.pageNum * blocksPerPage_;
+			stats.usedNum = freeList_.GetUsedNum();
+			return stats;
+		}
+	};
+
+
+	/**
+	 * オブジェクトプール
+	 * 返却されたオブジェクトを破棄せずに取っておき、次のAcquireでそのまま返す
+	 * 生成コストの高いオブジェクト(内部にバッファやリソースを持つもの)を使い回す
+	 * 返却時の後始末はresetterで行う(リソースの解放、状態の初期化など)
+	 */
+	template<class T, bool ThreadSafe = false>
+	class ObjectPool
+	{
+	private:
+		struct Entry
+		{
+			typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;		// 先頭に置いてT*からEntry*に戻せるようにする
+			detail::PoolNode node;
+		};
+
+		PoolAllocator<Entry, ThreadSafe> allocator_;
+		detail::PoolFreeList<ThreadSafe> objects_;		// 返却済み(構築済み)のオブジェクト
+		std::function<void(T*)> resetter_;
+
+	private:
+		ObjectPool(const ObjectPool&) = delete;
+		ObjectPool& operator=(const ObjectPool&) = delete;
+
+		static Entry* GetEntry(detail::PoolNode* node)
+		{
+			return reinterpret_cast<Entry*>(reinterpret_cast<uint8_t*>(node) - offsetof(Entry, node));
+		}
+
+	public:
+		explicit ObjectPool(std::function<void(T*)> resetter = nullptr, MemoryTag tag = MemoryTag::General, uint32_t blocksPerPage = 0)
+			: allocator_(tag, blocksPerPage)
+			, resetter_(std::move(resetter))
+		{
+		}
+
+		~ObjectPool()
+		{
+			Assert(objects_.GetUsedNum() == 0);
+			while (auto* node = objects_.Pop()) {
+				Entry* entry = GetEntry(node);
+				reinterpret_cast<T*>(&entry->storage)->~T();
+				allocator_.Free(entry);
+			}
+		}
+
+		// 返却済みのものがあれば再利用し、なければargsで構築する
+		template<class... Args>
+		T* Acquire(Args&&... args)
+		{
+			objects_.AddUsedNum(1);
+			if (auto* node = objects_.Pop()) {
+				return reinterpret_cast<T*>(&GetEntry(node)->storage);
+			}
+			Entry* entry = static_cast<Entry*>(allocator_.Allocate());
+			return new (&entry->storage) T(std::forward<Args>(args)...);
+		}
+
+		void Release(T* object)
+		{
+			if (!object) {
+				return;
+			}
+			if (resetter_) {
+				resetter_(object);
+			}
+			Entry* entry = reinterpret_cast<Entry*>(object);
+			objects_.AddUsedNum(-1);
+			objects_.Push(&entry->node, &entry->node);
+		}
+
+		uint32_t GetUsedNum() const { return objects_.GetUsedNum(); }
+		uint32_t GetConstructedNum() { return allocator_.GetStats().usedNum; }
+	};
+
+}
@@ -0,0 +1,244 @@
+﻿#pragma once
+
+#include "se/Common.h"
+#include "se/async/Threading.h"
+#include "se/Memory/MemoryTracker.h"
+#include <vector>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+namespace se {
+
+	/**
+	 * リソースハンドル
+	 * 下位20bitがプール内の番号、上位12bitが世代
+	 * 解放されたスロットは世代が進むので、古いハンドルはポインタと違って無効と判定できる
+	 * 0は無効なハンドル
+	 */
+	template<class T>
+	class Handle
+	{
+	public:
+		static const uint32_t INDEX_BITS = 20;
+		static const uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+		static const uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+	private:
+		uint32_t value_;
+
+	public:
+		Handle()
+			: value_(0)
+		{
+		}
+
+		Handle(uint32_t index, uint32_t generation)
+			: value_((generation << INDEX_BITS) | index)
+		{
+			Assert(index <= INDEX_MASK && generation <= GENERATION_MASK);
+		}
+
+		uint32_t GetIndex() const { return value_ & INDEX_MASK; }
+		uint32_t GetGeneration() const { return value_ >> INDEX_BITS; }
+		uint32_t GetValue() const { return value_; }
+		bool IsNull() const { return value_ == 0; }
+
+		bool operator==(const Handle& other) const { return value_ == other.value_; }
+		bool operator!=(const Handle& other) const { return value_ != other.value_; }
+	};
+
+
+	/**
+	 * ハンドルで参照するリソースプール
+	 * オブジェクトはページ単位の連続領域に置かれ、解放されたスロットは再利用される
+	 * 参照カウントが0になった時点でオブジェクトを破棄し、スロットの世代を進める
+	 * 生成・解放は任意のスレッドから行える
+	 * Getはロックを取らないので、参照を持っている(またはGetの間に解放されない)ハンドルに使うこと
+	 * HandleTag:ハンドルの型、内部用の付加情報を持つ型をプールしつつ公開するハンドルはリソースの型にしたい場合に指定する
+	 */
+	template<class T, class HandleTag = T>
+	class ResourcePool
+	{
+	public:
+		typedef Handle<HandleTag> HandleType;
+
+		static const uint32_t PAGE_SLOT_NUM = 256;
+		static const uint32_t MAX_PAGE_NUM = (HandleType::INDEX_MASK + 1) / PAGE_SLOT_NUM;
+
+	private:
+		struct Slot
+		{
+			typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+			Atomic<uint32_t> generation;
+			Atomic<int32_t> refCount;
+			uint32_t nextFree;
+		};
+
+		static const uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+	private:
+		Atomic<Slot*> pages_[MAX_PAGE_NUM];		// 追加のみでページは動かない
+		uint32_t slotNum_;			// 使用したことのあるスロット数
+		uint32_t freeHead_;
+		uint32_t aliveNum_;
+		MemoryTag tag_;
+		SpinLock lock_;
+
+	private:
+		ResourcePool(const ResourcePool&) = delete;
+		ResourcePool& operator=(const ResourcePool&) = delete;
+
+		Slot* GetSlot(uint32_t index) const
+		{
+			Slot* page = pages_[index / PAGE_SLOT_NUM].Load(MemoryOrder::Acquire);
+			return page ? &page[index % PAGE_SLOT_NUM] : nullptr;
+		}
+
+		// 有効なハンドルならスロットを返す
+		Slot* FindSlot(HandleType handle) const
+		{
+			if (handle.IsNull() || handle.GetIndex() >= MAX_PAGE_NUM * PAGE_SLOT_NUM) {
+				return nullptr;
+			}
+			Slot* slot = GetSlot(handle.GetIndex());
+			if (!slot || slot->generation.Load(MemoryOrder::Acquire) != handle.GetGeneration()) {
+				return nullptr;
+			}
+			return slot;
+		}
+
+		// ロック内で呼ぶ
+		uint32_t AllocateIndex()
+		{
+			if (freeHead_ != INVALID_INDEX) {
+				uint32_t index = freeHead_;
+				freeHead_ = GetSlot(index)->nextFree;
+				return index;
+			}
+
+			uint32_t index = slotNum_;
+			if (index >= MAX_PAGE_NUM * PAGE_SLOT_NUM) {
+				return INVALID_INDEX;
+			}
+			uint32_t pageIndex = index / PAGE_SLOT_NUM;
+			if (!pages_[pageIndex].Load(MemoryOrder::Relaxed)) {
+				Slot* page = static_cast<Slot*>(TrackedAllocate(tag_, sizeof(Slot) * PAGE_SLOT_NUM, alignof(Slot)));
+				for (uint32_t i = 0; i < PAGE_SLOT_NUM; i++) {
+					new (&page[i].generation) Atomic<uint32_t>(1);
+					new (&page[i].refCount) Atomic<int32_t>(0);
+					page[i].nextFree = INVALID_INDEX;
+				}
+				// 他のスレッドのGetから見えるのはスロットの初期化後
+				pages_[pageIndex].Store(page, MemoryOrder::Release);
+			}
+			slotNum_++;
+			return index;
+		}
+
+	public:
+		// tag:ページの確保を集計するタグ
+		explicit ResourcePool(MemoryTag tag = MemoryTag::General)
+			: slotNum_(0)
+			, freeHead_(INVALID_INDEX)
+			, aliveNum_(0)
+			, tag_(tag)
+		{
+			// 破棄時に集計できるようトラッカーを先に生成しておく
+			MemoryTracker::Get();
+		}
+
+		// 残っているオブジェクトはここで破棄する
+		~ResourcePool()
+		{
+			for (uint32_t i = 0; i < slotNum_; i++) {
+				Slot* slot = GetSlot(i);
+				if (slot->refCount.Load(MemoryOrder::Relaxed) > 0) {
+					reinterpret_cast<T*>(&slot->storage)->~T();
+				}
+			}
+			for (auto& page : pages_) {
+				TrackedFree(page.Load(MemoryOrder::Relaxed));
+			}
+		}
+
+		// 参照カウント1で生成する、プールが一杯なら無効なハンドル
+		template<class... Args>
+		HandleType Create(Args&&... args)
+		{
+			uint32_t index;
+			{
+				ScopedLock<SpinLock> lock(lock_);
+				index = AllocateIndex();
+				if (index == INVALID_INDEX) {
+					return HandleType();
+				}
+				aliveNum_++;
+			}
+
+			Slot* slot = GetSlot(index);
+			new (&slot->storage) T(std::forward<Args>(args)...);
+			slot->refCount.Store(1, MemoryOrder::Release);
+			return HandleType(index, slot->generation.Load(MemoryOrder::Relaxed));
+		}
+
+		// 無効なハンドルならfalse
+		bool AddRef(HandleType handle)
+		{
+			Slot* slot = FindSlot(handle);
+			if (!slot) {
+				return false;
+			}
+			int32_t count = slot->refCount.FetchAdd(1, MemoryOrder::Relaxed);
+			Assert(count > 0);
+			return true;
+		}
+
+		// 参照カウントが0になって破棄したらtrue
+		bool Release(HandleType handle)
+		{
+			Slot* slot = FindSlot(handle);
+			if (!slot) {
+				return false;
+			}
+			int32_t count = slot->refCount.FetchSub(1, MemoryOrder::AcqRel);
+			Assert(count > 0);
+			if (count != 1) {
+				return false;
+			}
+
+			reinterpret_cast<T*>(&slot->storage)->~T();
+
+			// 世代を進めて既存のハンドルを無効にする(0は使わない)
+			uint32_t generation = (handle.GetGeneration() + 1) & HandleType::GENERATION_MASK;
+			slot->generation.Store(generation == 0 ? 1 : generation, MemoryOrder::Release);
+
+			ScopedLock<SpinLock> lock(lock_);
+			slot->nextFree = freeHead_;
+			freeHead_ = handle.GetIndex();
+			aliveNum_--;
+			return true;
+		}
+
+		// 無効なハンドルならnullptr
+		T* Get(HandleType handle) const
+		{
+			Slot* slot = FindSlot(handle);
+			if (!slot || slot->refCount.Load(MemoryOrder::Acquire) <= 0) {
+				return nullptr;
+			}
+			return reinterpret_cast<T*>(&slot->storage);
+		}
+
+		bool IsValid(HandleType handle) const { return Get(handle) != nullptr; }
+
+		int32_t GetRefCount(HandleType handle) const
+		{
+			Slot* slot = FindSlot(handle);
+			return slot ? slot->refCount.Load(MemoryOrder::Relaxed) : 0;
+		}
+
+		uint32_t GetAliveNum() const { return aliveNum_; }
+	};
+
+}
@@ -0,0 +1,147 @@
+﻿#pragma once
+
+#include "se/Common.h"
+#include <deque>
+
+namespace se {
+
+	/**
+	 * フレームフェンス付きリングアロケータ
+	 * 固定サイズの領域からオフセットを先頭から順に切り出し、フレームの終わりにフェンス値で締める
+	 * GPUなどの消費側がフェンスまで処理したらRetireでそのフレームの領域を再利用に回す
+	 * オフセットの管理のみを行い、実際のメモリ(GPUバッファなど)は利用側が持つ
+	 * スレッドセーフではない
+	 */
+	class RingAllocator
+	{
+	public:
+		static const size_t INVALID_OFFSET = ~static_cast<size_t>(0);
+
+		struct Stats
+		{
+			size_t size;
+			size_t usedSize;			// 消費側の完了待ちを含む使用中のサイズ(アライメントと折り返しの無駄を含む)
+			uint32_t pendingFrameNum;	// 完了待ちのフレーム数
+			uint32_t failedNum;			// 空きが足りず失敗した確保の累計
+		};
+
+	private:
+		struct FrameMark
+		{
+			uint64_t fence;
+			size_t end;			// フレーム終了時のhead
+			size_t usedSize;	// フレーム内で消費したサイズ
+		};
+
+	private:
+		size_t size_;
+		size_t head_;			// 次に確保する位置
+		size_t tail_;			// 完了待ちの最も古い確保の位置(usedSize_が0なら意味を持たない)
+		size_t usedSize_;
+		size_t frameUsedSize_;
+		uint32_t failedNum_;
+		std::deque<FrameMark> frames_;
+
+	public:
+		explicit RingAllocator(size_t size = 0)
+		{
+			Initialize(size);
+		}
+
+		void Initialize(size_t size)
+		{
+			size_ = size;
+			head_ = 0;
+			tail_ = 0;
+			usedSize_ = 0;
+			frameUsedSize_ = 0;
+			failedNum_ = 0;
+			frames_.clear();
+		}
+
+		// alignmentは2のべき乗、空きがなければINVALID_OFFSET
+		// 確保は末尾をまたがず、収まらない場合は末尾を捨てて先頭から切り出す
+		size_t Allocate(size_t size, size_t alignment = 1)
+		{
+			Assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+			if (size == 0 || size > size_) {
+				failedNum_++;
+				return INVALID_OFFSET;
+			}
+
+			// 使用中の領域がなければ先頭から使い直す(何も確保しなかったフレームが完了待ちでもよい)
+			if (usedSize_ == 0) {
+				head_ = 0;
+				tail_ = 0;
+			}
+
+			size_t offset = (head_ + (alignment - 1)) & ~(alignment - 1);
+			size_t consumed;
+			if (usedSize_ == 0 || head_ > tail_) {
+				// [head, size) と [0, tail) が空いている
+				if (offset + size <= size_) {
+					consumed = offset + size - head_;
+				} else if (size <= tail_) {
+					offset = 0;
+					consumed = (size_ - head_) + size;
+				} else {
+					failedNum_++;
+					return INVALID_OFFSET;
+				}
+			} else {
+				// [head, tail) が空いている
+				if (offset + size <= tail_) {
+					consumed = offset + size - head_;
+				} else {
+					failedNum_++;
+					return INVALID_OFFSET;
+				}
+			}
+
+			head_ = offset + size;
+			usedSize_ += consumed;
+			frameUsedSize_ += consumed;
+			return offset;
+		}
+
+		// 現在のフレームの確保をfenceで締める(fenceは単調増加)
+		void EndFrame(uint64_t fence)
+		{
+			Assert(frames_.empty() || frames_.back().fence < fence);
+			FrameMark mark;
+			mark.fence = fence;
+			mark.end = head_;
+			mark.usedSize = frameUsedSize_;
+			frames_.push_back(mark);
+			frameUsedSize_ = 0;
+		}
+
+		// completedFenceまでのフレームの領域を解放する
+		void Retire(uint64_t completedFence)
+		{
+			while (!frames_.empty() && frames_.front().fence <= completedFence) {
+				const FrameMark& mark = frames_.front();
+				// 何も確保しなかったフレームのendは古いheadなのでtailを動かさない
+				if (mark.usedSize > 0) {
+					tail_ = mark.end;
+				}
+				usedSize_ -= mark.usedSize;
+				frames_.pop_front();
+			}
+		}
+
+		size_t GetSize() const { return size_; }
+		size_t GetUsedSize() const { return usedSize_; }
+
+		Stats GetStats() const
+		{
+			Stats stats;
+			stats.size = size_;
+			stats.usedSize = usedSize_;
+			stats.pendingFrameNum = static_cast<uint32_t>(frames_.size());
+			stats.failedNum = failedNum_;
+			return stats;
+		}
+	};
+
+}
@@ -0,0 +1,177 @@
+﻿#include "se/Scene/TransformHierarchy.h"
+#include "se/Math/MathBatch.h"
+#include "se/async/Parallel.h"
+
+namespace se
+{
+	namespace {
+		const uint32_t COMPOSE_BLOCK_SIZE = 64;		// ローカル行列をまとめて作る単位
+		const uint32_t LOCAL_GRAIN_SIZE = 1024;
+		const uint32_t WORLD_GRAIN_SIZE = 1024;
+	}
+
+	TransformHierarchy::TransformHierarchy()
+	{
+		Clear();
+	}
+
+	TransformHierarchy::~TransformHierarchy()
+	{
+	}
+
+	void TransformHierarchy::Reserve(uint32_t nodeNum)
+	{
+		parents_.reserve(nodeNum);
+		depths_.reserve(nodeNum);
+		translations_.reserve(nodeNum);
+		rotations_.reserve(nodeNum);
+		scales_.reserve(nodeNum);
+		localMatrices_.reserve(nodeNum);
+		worldMatrices_.reserve(nodeNum);
+		dirtyFlags_.reserve(nodeNum);
+		dirtyNodes_.reserve(nodeNum);
+	}
+
+	void TransformHierarchy::Clear()
+	{
+		parents_.clear();
+		depths_.clear();
+		translations_.clear();
+		rotations_.clear();
+		scales_.clear();
+		localMatrices_.clear();
+		worldMatrices_.clear();
+		dirtyFlags_.clear();
+		dirtyNodes_.clear();
+		worldDirtyFlags_.clear();
+		stats_ = Stats{};
+	}
+
+	uint32_t TransformHierarchy::AddNode(uint32_t parent)
+	{
+		return AddNode(parent, Vector3(0.0f), Quaternion::Identity(), Vector3(1.0f));
+	}
+
+	uint32_t TransformHierarchy::AddNode(uint32_t parent, const Vector3& translation, const Quaternion& rotation, const Vector3& scale)
+	{
+		uint32_t node = GetNodeNum();
+		Assert(parent == INVALID_NODE || parent < node);
+		parents_.push_back(parent);
+		depths_.push_back(parent == INVALID_NODE ? 0 : depths_[parent] + 1);
+		translations_.push_back(translation);
+		rotations_.push_back(rotation);
+		scales_.push_back(scale);
+		Matrix4x4 identity;
+		identity.Ident();
+		localMatrices_.push_back(identity);
+		worldMatrices_.push_back(identity);
+		dirtyFlags_.push_back(0);
+		MarkDirty(node);
+		return node;
+	}
+
+	void TransformHierarchy::UpdateLocalMatrices()
+	{
+		// 変更されたノードを順にブロックへ集めてまとめて合成する
+		uint32_t dirtyNum = static_cast<uint32_t>(dirtyNodes_.size());
+		ParallelForRange(0, dirtyNum, [this](uint32_t begin, uint32_t end) {
+			Vector3 translation[COMPOSE_BLOCK_SIZE];
+			Quaternion rotation[COMPOSE_BLOCK_SIZE];
+			Vector3 scale[COMPOSE_BLOCK_SIZE];
+			Matrix4x4 local[COMPOSE_BLOCK_SIZE];
+			for (uint32_t blockBegin = begin; blockBegin < end; blockBegin += COMPOSE_BLOCK_SIZE) {
+				uint32_t num = Min(end - blockBegin, COMPOSE_BLOCK_SIZE);
+				const uint32_t* nodes = &dirtyNodes_[blockBegin];
+				for (uint32_t i = 0; i < num; i++) {
+					translation[i] = translations_[nodes[i]];
+					rotation[i] = rotations_[nodes[i]];
+					scale[i] = scales_[nodes[i]];
+				}
+				batch::ComposeTRS(translation, rotation, scale, local, num);
+				for (uint32_t i = 0; i < num; i++) {
+					localMatrices_[nodes[i]] = local[i];
+				}
+			}
+		}, LOCAL_GRAIN_SIZE);
+	}
+
+	void TransformHierarchy::CollectUpdateNodes()
+	{
+		// 親は子より前にあるので、最も前の変更ノードから順に見れば親のダーティが子に伝わる
+		uint32_t nodeNum = GetNodeNum();
+		uint32_t first = nodeNum;
+		for (auto node : dirtyNodes_) {
+			first = Min(first, node);
+		}
+
+		// 追加されたノードの分だけ広げる(既存のフラグは前回の収集後に戻してある)
+		worldDirtyFlags_.resize(nodeNum, 0);
+		collectedNodes_.clear();
+		uint32_t maxDepth = 0;
+		for (uint32_t node = first; node < nodeNum; node++) {
+			uint32_t parent = parents_[node];
+			bool dirty = dirtyFlags_[node] || (parent != INVALID_NODE && worldDirtyFlags_[parent]);
+			if (dirty) {
+				worldDirtyFlags_[node] = 1;
+				collectedNodes_.push_back(node);
+				maxDepth = Max(maxDepth, depths_[node]);
+			}
+		}
+		for (auto node : collectedNodes_) {
+			worldDirtyFlags_[node] = 0;
+		}
+
+		// 階層ごとに並べ替える(同じ階層内は追加順のまま)
+		levelOffsets_.assign(maxDepth + 2, 0);
+		for (auto node : collectedNodes_) {
+			levelOffsets_[depths_[node] + 1]++;
+		}
+		for (uint32_t level = 0; level <= maxDepth; level++) {
+			levelOffsets_[level + 1] += levelOffsets_[level];
+		}
+		levelCursors_.assign(levelOffsets_.begin(), levelOffsets_.end() - 1);
+		updateNodes_.resize(collectedNodes_.size());
+		for (auto node : collectedNodes_) {
+			updateNodes_[levelCursors_[depths_[node]]++] = node;
+		}
+	}
+
+	void TransformHierarchy::UpdateWorldMatrices()
+	{
+		stats_.nodeNum = GetNodeNum();
+		stats_.localUpdatedNum = 0;
+		stats_.worldUpdatedNum = 0;
+		stats_.levelNum = 0;
+		if (dirtyNodes_.empty()) {
+			return;
+		}
+
+		UpdateLocalMatrices();
+		CollectUpdateNodes();
+
+		// 親の階層が終わってから子の階層を計算する
+		uint32_t levelNum = static_cast<uint32_t>(levelOffsets_.size()) - 1;
+		for (uint32_t level = 0; level < levelNum; level++) {
+			ParallelForRange(levelOffsets_[level], levelOffsets_[level + 1], [this](uint32_t begin, uint32_t end) {
+				for (uint32_t i = begin; i < end; i++) {
+					uint32_t node = updateNodes_[i];
+					uint32_t parent = parents_[node];
+					if (parent == INVALID_NODE) {
+						worldMatrices_[node] = localMatrices_[node];
+					} else {
+						worldMatrices_[node] = Matrix4x4(simd::MatrixMultiply(localMatrices_[node].ToSIMD(), worldMatrices_[parent].ToSIMD()));
+					}
+				}
+			}, WORLD_GRAIN_SIZE);
+		}
+
+		stats_.localUpdatedNum = static_cast<uint32_t>(dirtyNodes_.size());
+		stats_.worldUpdatedNum = static_cast<uint32_t>(updateNodes_.size());
+		stats_.levelNum = levelNum;
+
+		for (auto node : dirtyNodes_) {
+			dirtyFlags_[node] = 0;
+		}
+		dirtyNodes_.clear();
+	}
+}
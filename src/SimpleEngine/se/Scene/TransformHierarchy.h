@@ -0,0 +1,104 @@
+﻿#pragma once
+
+#include "se/Common.h"
+#include "se/Math/Math.h"
+#include <vector>
+
+namespace se
+{
+	/**
+	 * 親子関係を持つトランスフォームの集合
+	 * ノードは追加順の配列(SoA)で持ち、親は必ず子より前に並ぶ(親は追加済みのノードしか指定できない)
+	 * ローカルの平行移動・回転・スケールを変更するとダーティになり、UpdateWorldMatricesで
+	 * 変更されたノードとその子孫のワールド行列だけを計算し直す
+	 * 何も変更がなければUpdateWorldMatricesは何もしない
+	 * 更新中以外の呼び出しはスレッドセーフではない
+	 */
+	class TransformHierarchy
+	{
+	public:
+		static const uint32_t INVALID_NODE = 0xffffffff;
+
+		struct Stats
+		{
+			uint32_t nodeNum;
+			uint32_t localUpdatedNum;	// 直前の更新でローカル行列を作り直したノード数
+			uint32_t worldUpdatedNum;	// 直前の更新でワールド行列を作り直したノード数
+			uint32_t levelNum;			// 直前の更新で処理した階層の数
+		};
+
+	private:
+		std::vector<uint32_t> parents_;
+		std::vector<uint32_t> depths_;
+		std::vector<Vector3> translations_;
+		std::vector<Quaternion> rotations_;
+		std::vector<Vector3> scales_;
+		std::vector<Matrix4x4> localMatrices_;
+		std::vector<Matrix4x4> worldMatrices_;
+		std::vector<uint8_t> dirtyFlags_;		// ローカルが変更されたか
+		std::vector<uint32_t> dirtyNodes_;		// ローカルが変更されたノード(重複なし)
+
+		// 更新の作業領域(毎フレーム確保し直さないよう保持する)
+		std::vector<uint8_t> worldDirtyFlags_;	// 収集中以外は全て0
+		std::vector<uint32_t> collectedNodes_;	// ワールド行列の更新対象(追加順)
+		std::vector<uint32_t> updateNodes_;		// 階層の浅い順に並べたワールド行列の更新対象
+		std::vector<uint32_t> levelOffsets_;	// updateNodes_の階層ごとの開始位置
+		std::vector<uint32_t> levelCursors_;	// 階層ごとの書き込み位置
+
+		Stats stats_;
+
+	private:
+		void MarkDirty(uint32_t node)
+		{
+			if (!dirtyFlags_[node]) {
+				dirtyFlags_[node] = 1;
+				dirtyNodes_.push_back(node);
+			}
+		}
+
+		void UpdateLocalMatrices();
+		void CollectUpdateNodes();
+
+	public:
+		TransformHierarchy();
+		~TransformHierarchy();
+
+		void Reserve(uint32_t nodeNum);
+		void Clear();
+
+		// parentはINVALID_NODEか追加済みのノード
+		uint32_t AddNode(uint32_t parent = INVALID_NODE);
+		uint32_t AddNode(uint32_t parent, const Vector3& translation, const Quaternion& rotation, const Vector3& scale);
+
+		void SetTranslation(uint32_t node, const Vector3& translation) { translations_[node] = translation; MarkDirty(node); }
+		void SetRotation(uint32_t node, const Quaternion& rotation) { rotations_[node] = rotation; MarkDirty(node); }
+		void SetScale(uint32_t node, const Vector3& scale) { scales_[node] = scale; MarkDirty(node); }
+		void SetLocal(uint32_t node, const Vector3& translation, const Quaternion& rotation, const Vector3& scale)
+		{
+			translations_[node] = translation;
+			rotations_[node] = rotation;
+			scales_[node] = scale;
+			MarkDirty(node);
+		}
+
+		const Vector3& GetTranslation(uint32_t node) const { return translations_[node]; }
+		const Quaternion& GetRotation(uint32_t node) const { return rotations_[node]; }
+		const Vector3& GetScale(uint32_t node) const { return scales_[node]; }
+		uint32_t GetParent(uint32_t node) const { return parents_[node]; }
+		uint32_t GetNodeNum() const { return static_cast<uint32_t>(parents_.size()); }
+		bool IsDirty() const { return !dirtyNodes_.empty(); }
+
+		// UpdateWorldMatrices後の値
+		const Matrix4x4& GetLocalMatrix(uint32_t node) const { return localMatrices_[node]; }
+		const Matrix4x4& GetWorldMatrix(uint32_t node) const { return worldMatrices_[node]; }
+		const Matrix4x4* GetWorldMatrices() const { return worldMatrices_.data(); }
+
+		/**
+		 * 変更されたノードとその子孫のワールド行列を計算し直す
+		 * ローカル行列はまとめてSIMDで作り、ワールド行列は同じ階層のノードをJobSystemで並列に計算する
+		 */
+		void UpdateWorldMatrices();
+
+		const Stats& GetStats() const { return stats_; }
+	};
+}
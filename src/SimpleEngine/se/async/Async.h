@@ -1,4 +1,11 @@
 ﻿#pragma once
 
 #include "Atomic.h"
-#include "Threading.h"
\ No newline at end of file
+#include "Threading.h"
+#include "Queue.h"
+#include "JobSystem.h"
+#include "Parallel.h"
+#include "Task.h"
+#include "IOService.h"
+#include "TaskGraph.h"
+#include "FramePipeline.h"
\ No newline at end of file
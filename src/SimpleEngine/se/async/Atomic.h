@@ -1,40 +1,252 @@
 ﻿#pragma once
 
 #include "se/Common.h"
+#include <atomic>
+#include <type_traits>
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+// 128bit CASが使えるか
+#if defined(_MSC_VER) && defined(_M_X64)
+	#define SE_HAS_ATOMIC_128	1
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16) || defined(__aarch64__))
+	#define SE_HAS_ATOMIC_128	1
+#else
+	#define SE_HAS_ATOMIC_128	0
+#endif
 
 namespace se {
 
 	/**
-	 * アトミック操作
+	 * メモリオーダー
 	 */
+	enum class MemoryOrder
+	{
+		Relaxed,	// 順序保証なし(カウンタ等)
+		Acquire,	// 以降の読み書きがこの読み込みより前に移動しない
+		Release,	// 以前の読み書きがこの書き込みより後に移動しない
+		AcqRel,		// Acquire + Release
+		SeqCst,		// 全スレッドで一貫した順序(フルフェンス)
+	};
+
+	namespace detail {
+
+		__forceinline std::memory_order ToStdMemoryOrder(MemoryOrder order)
+		{
+			static const std::memory_order orders[] = {
+				std::memory_order_relaxed,
+				std::memory_order_acquire,
+				std::memory_order_release,
+				std::memory_order_acq_rel,
+				std::memory_order_seq_cst,
+			};
+			return orders[static_cast<int>(order)];
+		}
+
+		// CAS失敗時に使えるオーダー(releaseを含められない)
+		__forceinline std::memory_order ToFailureMemoryOrder(MemoryOrder order)
+		{
+			switch (order) {
+			case MemoryOrder::Release:	return std::memory_order_relaxed;
+			case MemoryOrder::AcqRel:	return std::memory_order_acquire;
+			default:					return ToStdMemoryOrder(order);
+			}
+		}
+
+	}
+
+
+	/**
+	 * アトミック変数
+	 * 整数、ポインタ、およびlock-freeで扱えるサイズのトリビアルな型に対応
+	 * オーダーを省略した場合はSeqCst
+	 */
+	template<typename T>
 	class Atomic
 	{
 	public:
+		typedef typename std::conditional<std::is_pointer<T>::value, ptrdiff_t, T>::type DifferenceType;
+
+	private:
+		std::atomic<T> value_;
+
+	private:
+		Atomic(const Atomic&) = delete;
+		Atomic& operator=(const Atomic&) = delete;
+
+	public:
+		Atomic()
+			: value_(T())
+		{
+		}
+
+		Atomic(T value)
+			: value_(value)
+		{
+		}
+
+		bool IsLockFree() const { return value_.is_lock_free(); }
+
+		T Load(MemoryOrder order = MemoryOrder::SeqCst) const
+		{
+			return value_.load(detail::ToStdMemoryOrder(order));
+		}
+
+		void Store(T value, MemoryOrder order = MemoryOrder::SeqCst)
+		{
+			value_.store(value, detail::ToStdMemoryOrder(order));
+		}
+
+		// 前の値を返す
+		T Exchange(T value, MemoryOrder order = MemoryOrder::SeqCst)
+		{
+			return value_.exchange(value, detail::ToStdMemoryOrder(order));
+		}
+
+		// 成功したらtrue、失敗したらexpectedに現在値が入る
+		bool CompareExchange(T& expected, T desired, MemoryOrder order = MemoryOrder::SeqCst)
+		{
+			return value_.compare_exchange_strong(expected, desired, detail::ToStdMemoryOrder(order), detail::ToFailureMemoryOrder(order));
+		}
+
+		// 偽の失敗があり得る、ループ内で使う
+		bool CompareExchangeWeak(T& expected, T desired, MemoryOrder order = MemoryOrder::SeqCst)
+		{
+			return value_.compare_exchange_weak(expected, desired, detail::ToStdMemoryOrder(order), detail::ToFailureMemoryOrder(order));
+		}
 
-		static int32_t InterlockedIncrement(int32_t* value)
+		// 以下、前の値を返す
+		T FetchAdd(DifferenceType value, MemoryOrder order = MemoryOrder::SeqCst)
+		{
+			return value_.fetch_add(value, detail::ToStdMemoryOrder(order));
+		}
+
+		T FetchSub(DifferenceType value, MemoryOrder order = MemoryOrder::SeqCst)
+		{
+			return value_.fetch_sub(value, detail::ToStdMemoryOrder(order));
+		}
+
+		T FetchOr(T value, MemoryOrder order = MemoryOrder::SeqCst)
+		{
+			return value_.fetch_or(value, detail::ToStdMemoryOrder(order));
+		}
+
+		T FetchAnd(T value, MemoryOrder order = MemoryOrder::SeqCst)
+		{
+			return value_.fetch_and(value, detail::ToStdMemoryOrder(order));
+		}
+
+		T FetchXor(T value, MemoryOrder order = MemoryOrder::SeqCst)
+		{
+			return value_.fetch_xor(value, detail::ToStdMemoryOrder(order));
+		}
+
+		// 以下、新しい値を返す(Interlocked*互換)
+		T Increment(MemoryOrder order = MemoryOrder::SeqCst)
+		{
+			return FetchAdd(1, order) + 1;
+		}
+
+		T Decrement(MemoryOrder order = MemoryOrder::SeqCst)
+		{
+			return FetchSub(1, order) - 1;
+		}
+	};
+
+
+	// メモリフェンス
+	__forceinline void AtomicThreadFence(MemoryOrder order = MemoryOrder::SeqCst)
+	{
+		std::atomic_thread_fence(detail::ToStdMemoryOrder(order));
+	}
+
+	// コンパイラの並べ替えのみ抑止
+	__forceinline void AtomicSignalFence(MemoryOrder order = MemoryOrder::SeqCst)
+	{
+		std::atomic_signal_fence(detail::ToStdMemoryOrder(order));
+	}
+
+
+#if SE_HAS_ATOMIC_128
+	/**
+	 * 128bit値
+	 * ABA対策のタグ付きポインタなどに使う
+	 */
+	struct alignas(16) Uint128
+	{
+		uint64_t low;
+		uint64_t high;
+
+		bool operator==(const Uint128& other) const { return low == other.low && high == other.high; }
+		bool operator!=(const Uint128& other) const { return !(*this == other); }
+	};
+
+
+	/**
+	 * 128bitアトミック変数
+	 * std::atomicの16byte版はロックになる実装があるため、命令(cmpxchg16b/casp)を直接使う
+	 */
+	class Atomic128
+	{
+	private:
+		Uint128 value_;
+
+	private:
+		Atomic128(const Atomic128&) = delete;
+		Atomic128& operator=(const Atomic128&) = delete;
+
+	public:
+		Atomic128()
 		{
-			return (LONG)::InterlockedIncrement((LPLONG)value);
+			value_.low = 0;
+			value_.high = 0;
 		}
 
-		static int32_t InterlockedDecrement(int32_t* value)
+		Atomic128(const Uint128& value)
+			: value_(value)
 		{
-			return (LONG)::InterlockedDecrement((LPLONG)value);
 		}
 
-		static int32_t InterlockedAdd(int32_t* value, int32_t amount)
+		// 成功したらtrue、失敗したらexpectedに現在値が入る(常にSeqCst)
+		bool CompareExchange(Uint128& expected, const Uint128& desired)
 		{
-			return (LONG)::InterlockedAdd((LPLONG)value, (LONG)amount);
+#if defined(_MSC_VER)
+			return _InterlockedCompareExchange128(reinterpret_cast<volatile long long*>(&value_),
+				static_cast<long long>(desired.high), static_cast<long long>(desired.low),
+				reinterpret_cast<long long*>(&expected)) != 0;
+#else
+			unsigned __int128* target = reinterpret_cast<unsigned __int128*>(&value_);
+			unsigned __int128 comparand = (static_cast<unsigned __int128>(expected.high) << 64) | expected.low;
+			unsigned __int128 exchange = (static_cast<unsigned __int128>(desired.high) << 64) | desired.low;
+	#if defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16)
+			unsigned __int128 previous = __sync_val_compare_and_swap(target, comparand, exchange);
+			bool result = (previous == comparand);
+	#else
+			unsigned __int128 previous = comparand;
+			bool result = __atomic_compare_exchange_n(target, &previous, exchange, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	#endif
+			expected.low = static_cast<uint64_t>(previous);
+			expected.high = static_cast<uint64_t>(previous >> 64);
+			return result;
+#endif
 		}
 
-		static int32_t InterlockedExchange(int32_t* value, int32_t exchange)
+		// 128bitの読み込みは比較交換で行う
+		Uint128 Load()
 		{
-			return (LONG)::InterlockedExchange((LPLONG)value, (LONG)exchange);
+			Uint128 expected = { 0, 0 };
+			CompareExchange(expected, expected);
+			return expected;
 		}
 
-		static int32_t InterlockedCompareExchange(int32_t* value, int32_t compare, int32_t exchange)
+		void Store(const Uint128& value)
 		{
-			return (LONG)::InterlockedCompareExchange((LPLONG)value, (LONG)exchange, (LONG)compare);
+			Uint128 expected = Load();
+			while (!CompareExchange(expected, value));
 		}
 	};
+#endif
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,439 @@
+﻿#include "se/async/CpuTopology.h"
+#include <thread>
+#include <string>
+#include <map>
+
+namespace se {
+
+	namespace {
+
+#if !defined(_WIN32)
+		// sysfsの1行テキストを読む
+		bool ReadLine(const std::string& path, std::string& out)
+		{
+			FILE* fp = fopen(path.c_str(), "r");
+			if (!fp) {
+				return false;
+			}
+			char buf[1024];
+			bool result = (fgets(buf, sizeof(buf), fp) != nullptr);
+			fclose(fp);
+			if (result) {
+				out = buf;
+				while (!out.empty() && (out.back() == '\n' || out.back() == '\r' || out.back() == ' ')) {
+					out.pop_back();
+				}
+			}
+			return result;
+		}
+
+		bool ReadUint(const std::string& path, uint32_t& out)
+		{
+			std::string line;
+			if (!ReadLine(path, line) || line.empty()) {
+				return false;
+			}
+			out = static_cast<uint32_t>(strtoul(line.c_str(), nullptr, 10));
+			return true;
+		}
+
+		// "0-3,8,10-11" 形式のリストを展開する
+		std::vector<uint32_t> ParseCpuList(const std::string& list)
+		{
+			std::vector<uint32_t> result;
+			const char* p = list.c_str();
+			while (*p) {
+				char* end;
+				uint32_t first = static_cast<uint32_t>(strtoul(p, &end, 10));
+				if (end == p) {
+					break;
+				}
+				uint32_t last = first;
+				p = end;
+				if (*p == '-') {
+					p++;
+					last = static_cast<uint32_t>(strtoul(p, &end, 10));
+					p = end;
+				}
+				for (uint32_t i = first; i <= last; i++) {
+					result.push_back(i);
+				}
+				if (*p == ',') {
+					p++;
+				}
+			}
+			return result;
+		}
+
+		// "32K"、"8M" 形式のサイズ
+		uint32_t ParseSize(const std::string& text)
+		{
+			char* end;
+			uint32_t size = static_cast<uint32_t>(strtoul(text.c_str(), &end, 10));
+			if (*end == 'K') {
+				size *= 1024;
+			} else if (*end == 'M') {
+				size *= 1024 * 1024;
+			}
+			return size;
+		}
+#endif
+
+	}
+
+
+	CpuTopology::CpuTopology()
+		: packageNum_(0)
+		, numaNodeNum_(0)
+	{
+		if (!Query() || logicalProcessors_.empty()) {
+			SetupFallback();
+		}
+		Finish();
+	}
+
+	uint32_t CpuTopology::AddLogicalProcessor(uint32_t osIndex, uint16_t group, uint16_t number)
+	{
+		LogicalProcessor lp;
+		lp.osIndex = osIndex;
+		lp.group = group;
+		lp.number = number;
+		lp.coreIndex = INVALID_INDEX;
+		lp.smtIndex = 0;
+		logicalProcessors_.push_back(lp);
+		return static_cast<uint32_t>(logicalProcessors_.size() - 1);
+	}
+
+	void CpuTopology::SetupFallback()
+	{
+		logicalProcessors_.clear();
+		cores_.clear();
+		caches_.clear();
+
+		uint32_t num = std::max(std::thread::hardware_concurrency(), 1u);
+		for (uint32_t i = 0; i < num; i++) {
+			uint32_t index = AddLogicalProcessor(i, static_cast<uint16_t>(i / 64), static_cast<uint16_t>(i % 64));
+			CpuCore core;
+			core.logicalProcessors.push_back(index);
+			core.efficiencyClass = 0;
+			core.packageIndex = 0;
+			core.numaNode = 0;
+			logicalProcessors_[index].coreIndex = i;
+			cores_.push_back(core);
+		}
+	}
+
+	void CpuTopology::Finish()
+	{
+		packageNum_ = 1;
+		numaNodeNum_ = 1;
+		for (auto& core : cores_) {
+			packageNum_ = std::max(packageNum_, core.packageIndex + 1);
+			numaNodeNum_ = std::max(numaNodeNum_, core.numaNode + 1);
+		}
+
+		// 全コア同じなら非ハイブリッドとして0に揃える
+		if (!IsHybrid()) {
+			for (auto& core : cores_) {
+				core.efficiencyClass = 0;
+			}
+		}
+	}
+
+#if defined(_WIN32)
+
+	bool CpuTopology::Query()
+	{
+		DWORD size = 0;
+		GetLogicalProcessorInformationEx(RelationAll, nullptr, &size);
+		if (GetLastError() != ERROR_INSUFFICIENT_BUFFER) {
+			return false;
+		}
+		std::vector<uint8_t> buffer(size);
+		if (!GetLogicalProcessorInformationEx(RelationAll, reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data()), &size)) {
+			return false;
+		}
+
+		auto forEach = [&](LOGICAL_PROCESSOR_RELATIONSHIP relation, auto func) {
+			for (DWORD offset = 0; offset < size;) {
+				auto* info = reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data() + offset);
+				if (info->Relationship == relation) {
+					func(info);
+				}
+				offset += info->Size;
+			}
+		};
+		auto forEachProcessor = [&](const GROUP_AFFINITY& affinity, auto func) {
+			for (uint32_t bit = 0; bit < sizeof(KAFFINITY) * 8; bit++) {
+				if (affinity.Mask & (static_cast<KAFFINITY>(1) << bit)) {
+					func(affinity.Group * 64u + bit, affinity.Group, bit);
+				}
+			}
+		};
+
+		// コアと論理プロセッサ
+		forEach(RelationProcessorCore, [&](PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX info) {
+			uint32_t coreIndex = static_cast<uint32_t>(cores_.size());
+			CpuCore core;
+			// EfficiencyClassはFlagsの次の1byte(8.1 SDKではReserved[0])
+			core.efficiencyClass = reinterpret_cast<const BYTE*>(&info->Processor)[1];
+			core.packageIndex = 0;
+			core.numaNode = 0;
+			for (WORD g = 0; g < info->Processor.GroupCount; g++) {
+				forEachProcessor(info->Processor.GroupMask[g], [&](uint32_t osIndex, WORD group, uint32_t number) {
+					uint32_t index = AddLogicalProcessor(osIndex, group, static_cast<uint16_t>(number));
+					logicalProcessors_[index].coreIndex = coreIndex;
+					logicalProcessors_[index].smtIndex = static_cast<uint32_t>(core.logicalProcessors.size());
+					core.logicalProcessors.push_back(index);
+				});
+			}
+			cores_.push_back(core);
+		});
+
+		// パッケージ
+		uint32_t packageIndex = 0;
+		forEach(RelationProcessorPackage, [&](PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX info) {
+			for (WORD g = 0; g < info->Processor.GroupCount; g++) {
+				forEachProcessor(info->Processor.GroupMask[g], [&](uint32_t osIndex, WORD, uint32_t) {
+					uint32_t index = FindLogicalProcessor(osIndex);
+					if (index != INVALID_INDEX) {
+						cores_[logicalProcessors_[index].coreIndex].packageIndex = packageIndex;
+					}
+				});
+			}
+			packageIndex++;
+		});
+
+		// NUMAノード
+		forEach(RelationNumaNode, [&](PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX info) {
+			forEachProcessor(info->NumaNode.GroupMask, [&](uint32_t osIndex, WORD, uint32_t) {
+				uint32_t index = FindLogicalProcessor(osIndex);
+				if (index != INVALID_INDEX) {
+					cores_[logicalProcessors_[index].coreIndex].numaNode = info->NumaNode.NodeNumber;
+				}
+			});
+		});
+
+		// キャッシュ(命令キャッシュは除く)
+		forEach(RelationCache, [&](PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX info) {
+			if (info->Cache.Type == CacheInstruction) {
+				return;
+			}
+			CpuCache cache;
+			cache.level = info->Cache.Level;
+			cache.size = info->Cache.CacheSize;
+			forEachProcessor(info->Cache.GroupMask, [&](uint32_t osIndex, WORD, uint32_t) {
+				uint32_t index = FindLogicalProcessor(osIndex);
+				if (index != INVALID_INDEX) {
+					cache.logicalProcessors.push_back(index);
+				}
+			});
+			caches_.push_back(cache);
+		});
+
+		return true;
+	}
+
+#elif defined(__linux__)
+
+	bool CpuTopology::Query()
+	{
+		const std::string cpuRoot = "/sys/devices/system/cpu/";
+
+		std::string line;
+		if (!ReadLine(cpuRoot + "online", line)) {
+			return false;
+		}
+		std::vector<uint32_t> online = ParseCpuList(line);
+
+		// ハイブリッドCPU(Intel)はPコアとEコアが別PMUとして見える
+		std::vector<uint32_t> performanceCpus;
+		if (ReadLine("/sys/devices/cpu_core/cpus", line)) {
+			performanceCpus = ParseCpuList(line);
+		}
+
+		// (パッケージ, コアID)で物理コアを識別
+		std::map<std::pair<uint32_t, uint32_t>, uint32_t> coreMap;
+		for (uint32_t cpu : online) {
+			std::string dir = cpuRoot + "cpu" + std::to_string(cpu) + "/";
+			uint32_t coreId = cpu;
+			uint32_t packageId = 0;
+			ReadUint(dir + "topology/core_id", coreId);
+			ReadUint(dir + "topology/physical_package_id", packageId);
+
+			auto key = std::make_pair(packageId, coreId);
+			auto iter = coreMap.find(key);
+			uint32_t coreIndex;
+			if (iter == coreMap.end()) {
+				coreIndex = static_cast<uint32_t>(cores_.size());
+				coreMap.emplace(key, coreIndex);
+
+				CpuCore core;
+				core.packageIndex = packageId;
+				core.numaNode = 0;
+				core.efficiencyClass = 0;
+				uint32_t capacity;
+				if (!performanceCpus.empty()) {
+					core.efficiencyClass = std::find(performanceCpus.begin(), performanceCpus.end(), cpu) != performanceCpus.end() ? 1 : 0;
+				} else if (ReadUint(dir + "cpu_capacity", capacity)) {
+					// big.LITTLE等は相対性能値が取れる
+					core.efficiencyClass = capacity;
+				}
+				cores_.push_back(core);
+			} else {
+				coreIndex = iter->second;
+			}
+
+			uint32_t index = AddLogicalProcessor(cpu, static_cast<uint16_t>(cpu / 64), static_cast<uint16_t>(cpu % 64));
+			logicalProcessors_[index].coreIndex = coreIndex;
+			logicalProcessors_[index].smtIndex = static_cast<uint32_t>(cores_[coreIndex].logicalProcessors.size());
+			cores_[coreIndex].logicalProcessors.push_back(index);
+		}
+
+		// パッケージIDは飛び番があり得るので詰める
+		std::map<uint32_t, uint32_t> packageMap;
+		for (auto& core : cores_) {
+			auto result = packageMap.emplace(core.packageIndex, static_cast<uint32_t>(packageMap.size()));
+			core.packageIndex = result.first->second;
+		}
+
+		// NUMAノード
+		if (ReadLine("/sys/devices/system/node/online", line)) {
+			for (uint32_t node : ParseCpuList(line)) {
+				std::string cpuList;
+				if (!ReadLine("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist", cpuList)) {
+					continue;
+				}
+				for (uint32_t cpu : ParseCpuList(cpuList)) {
+					uint32_t index = FindLogicalProcessor(cpu);
+					if (index != INVALID_INDEX) {
+						cores_[logicalProcessors_[index].coreIndex].numaNode = node;
+					}
+				}
+			}
+		}
+
+		// キャッシュ、共有しているCPUの組み合わせで重複を除く
+		std::map<std::string, uint32_t> cacheMap;
+		for (uint32_t cpu : online) {
+			for (uint32_t i = 0; ; i++) {
+				std::string dir = cpuRoot + "cpu" + std::to_string(cpu) + "/cache/index" + std::to_string(i) + "/";
+				uint32_t level;
+				if (!ReadUint(dir + "level", level)) {
+					break;
+				}
+				std::string type, shared, size;
+				ReadLine(dir + "type", type);
+				if (type == "Instruction" || !ReadLine(dir + "shared_cpu_list", shared)) {
+					continue;
+				}
+				std::string key = std::to_string(level) + ":" + shared;
+				if (cacheMap.count(key)) {
+					continue;
+				}
+				cacheMap.emplace(key, static_cast<uint32_t>(caches_.size()));
+
+				CpuCache cache;
+				cache.level = level;
+				cache.size = ReadLine(dir + "size", size) ? ParseSize(size) : 0;
+				for (uint32_t sharedCpu : ParseCpuList(shared)) {
+					uint32_t index = FindLogicalProcessor(sharedCpu);
+					if (index != INVALID_INDEX) {
+						cache.logicalProcessors.push_back(index);
+					}
+				}
+				caches_.push_back(cache);
+			}
+		}
+
+		return true;
+	}
+
+#else
+
+	bool CpuTopology::Query()
+	{
+		return false;
+	}
+
+#endif
+
+	uint32_t CpuTopology::FindLogicalProcessor(uint32_t osIndex) const
+	{
+		for (uint32_t i = 0; i < logicalProcessors_.size(); i++) {
+			if (logicalProcessors_[i].osIndex == osIndex) {
+				return i;
+			}
+		}
+		return INVALID_INDEX;
+	}
+
+	std::vector<uint32_t> CpuTopology::GetSiblings(uint32_t logicalProcessor) const
+	{
+		std::vector<uint32_t> result;
+		const auto& core = cores_[logicalProcessors_[logicalProcessor].coreIndex];
+		for (uint32_t index : core.logicalProcessors) {
+			if (index != logicalProcessor) {
+				result.push_back(index);
+			}
+		}
+		return result;
+	}
+
+	uint32_t CpuTopology::FindLastLevelCache(uint32_t logicalProcessor) const
+	{
+		uint32_t result = INVALID_INDEX;
+		for (uint32_t i = 0; i < caches_.size(); i++) {
+			const auto& cache = caches_[i];
+			if (result != INVALID_INDEX && cache.level <= caches_[result].level) {
+				continue;
+			}
+			if (std::find(cache.logicalProcessors.begin(), cache.logicalProcessors.end(), logicalProcessor) != cache.logicalProcessors.end()) {
+				result = i;
+			}
+		}
+		return result;
+	}
+
+	bool CpuTopology::IsHybrid() const
+	{
+		for (auto& core : cores_) {
+			if (core.efficiencyClass != cores_[0].efficiencyClass) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	std::vector<uint32_t> CpuTopology::GetCoresByPerformance() const
+	{
+		std::vector<uint32_t> result(cores_.size());
+		for (uint32_t i = 0; i < result.size(); i++) {
+			result[i] = i;
+		}
+		std::stable_sort(result.begin(), result.end(), [this](uint32_t a, uint32_t b) {
+			return cores_[a].efficiencyClass > cores_[b].efficiencyClass;
+		});
+		return result;
+	}
+
+	void CpuTopology::Dump() const
+	{
+#if defined(_DEBUG)
+		Printf("CPU Topology : %u logical / %u cores / %u packages / %u NUMA nodes%s\n",
+			GetLogicalProcessorNum(), GetCoreNum(), packageNum_, numaNodeNum_, IsHybrid() ? " / hybrid" : "");
+		for (uint32_t i = 0; i < cores_.size(); i++) {
+			const auto& core = cores_[i];
+			Printf("  core %u : class %u package %u node %u threads", i, core.efficiencyClass, core.packageIndex, core.numaNode);
+			for (uint32_t index : core.logicalProcessors) {
+				Printf(" %u", logicalProcessors_[index].osIndex);
+			}
+			Printf("\n");
+		}
+		for (const auto& cache : caches_) {
+			Printf("  L%u %uKB shared by %u\n", cache.level, cache.size / 1024, static_cast<uint32_t>(cache.logicalProcessors.size()));
+		}
+#endif
+	}
+
+}
@@ -0,0 +1,104 @@
+﻿#pragma once
+
+#include "se/Common.h"
+#include <vector>
+
+namespace se {
+
+	/**
+	 * 論理プロセッサ(ハードウェアスレッド)
+	 */
+	struct LogicalProcessor
+	{
+		uint32_t osIndex;		// Linux:cpu番号、Windows:グループ*64+グループ内番号
+		uint16_t group;			// Windowsのプロセッサグループ
+		uint16_t number;		// グループ内の番号
+		uint32_t coreIndex;		// 所属する物理コア
+		uint32_t smtIndex;		// コア内の何番目のスレッドか(0がプライマリ)
+	};
+
+	/**
+	 * 物理コア
+	 */
+	struct CpuCore
+	{
+		std::vector<uint32_t> logicalProcessors;
+		uint32_t efficiencyClass;	// 大きいほど高性能(Pコア)、非ハイブリッドなら全コア0
+		uint32_t packageIndex;
+		uint32_t numaNode;
+	};
+
+	/**
+	 * キャッシュ(共有単位ごと)
+	 */
+	struct CpuCache
+	{
+		uint32_t level;
+		uint32_t size;
+		std::vector<uint32_t> logicalProcessors;	// このキャッシュを共有する論理プロセッサ
+	};
+
+
+	/**
+	 * CPUトポロジ
+	 * 起動時に一度だけOSから取得する(Windows:GetLogicalProcessorInformationEx、Linux:sysfs)
+	 * 取得できない環境では論理プロセッサ1つを1コアとして扱う
+	 * 以下の論理プロセッサ番号はこのクラスの通し番号で、OSの番号はLogicalProcessor::osIndex
+	 */
+	class CpuTopology
+	{
+	public:
+		static const uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+		static CpuTopology& Get() {
+			static CpuTopology instance;
+			return instance;
+		}
+
+	private:
+		std::vector<LogicalProcessor> logicalProcessors_;
+		std::vector<CpuCore> cores_;
+		std::vector<CpuCache> caches_;
+		uint32_t packageNum_;
+		uint32_t numaNodeNum_;
+
+	private:
+		CpuTopology();
+		~CpuTopology() {}
+
+		bool Query();
+		void SetupFallback();
+		void Finish();
+		uint32_t AddLogicalProcessor(uint32_t osIndex, uint16_t group, uint16_t number);
+
+	public:
+		uint32_t GetLogicalProcessorNum() const { return static_cast<uint32_t>(logicalProcessors_.size()); }
+		uint32_t GetCoreNum() const { return static_cast<uint32_t>(cores_.size()); }
+		uint32_t GetCacheNum() const { return static_cast<uint32_t>(caches_.size()); }
+		uint32_t GetPackageNum() const { return packageNum_; }
+		uint32_t GetNumaNodeNum() const { return numaNodeNum_; }
+
+		const LogicalProcessor& GetLogicalProcessor(uint32_t index) const { return logicalProcessors_[index]; }
+		const CpuCore& GetCore(uint32_t index) const { return cores_[index]; }
+		const CpuCache& GetCache(uint32_t index) const { return caches_[index]; }
+
+		// OSの番号から論理プロセッサ番号を引く、見つからなければINVALID_INDEX
+		uint32_t FindLogicalProcessor(uint32_t osIndex) const;
+
+		// SMTで同じコアを共有している他の論理プロセッサ
+		std::vector<uint32_t> GetSiblings(uint32_t logicalProcessor) const;
+
+		// 指定論理プロセッサが使う最も外側(番号の大きい)レベルのキャッシュ、なければINVALID_INDEX
+		uint32_t FindLastLevelCache(uint32_t logicalProcessor) const;
+
+		// 性能の異なるコアが混在しているか(P/Eコア、big.LITTLE)
+		bool IsHybrid() const;
+
+		// 物理コアを高性能順に並べた番号(同クラス内は元の順)
+		std::vector<uint32_t> GetCoresByPerformance() const;
+
+		// デバッグ出力
+		void Dump() const;
+	};
+
+}
@@ -0,0 +1,109 @@
+﻿#pragma once
+
+#include "se/Common.h"
+#include "se/async/Threading.h"
+#include "se/async/Queue.h"
+
+namespace se {
+
+	/**
+	 * フレームパイプライン
+	 * シミュレーションスレッドがフレームN+1のパケットを書いている間に、描画スレッドがフレームNのパケットを描画する
+	 * パケットはBufferNum個を使い回すので、シミュレーションが先行できるのは最大BufferNum-1フレーム
+	 * (2:ダブルバッファ、3:トリプルバッファ)
+	 */
+	template<class Packet, uint32_t BufferNum = 2>
+	class FramePipeline
+	{
+		static_assert(BufferNum >= 2 && BufferNum <= 4, "BufferNum must be 2-4");
+
+	private:
+		static const uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+		Packet packets_[BufferNum];
+		SPSCQueue<uint32_t, 4> freeQueue_;		// 描画 → シミュレーション
+		SPSCQueue<uint32_t, 4> readyQueue_;		// シミュレーション → 描画
+		Event freeEvent_;
+		Event readyEvent_;
+		Atomic<bool> stopped_;
+		uint32_t writeIndex_;
+		uint32_t readIndex_;
+
+	private:
+		FramePipeline(const FramePipeline&) = delete;
+		FramePipeline& operator=(const FramePipeline&) = delete;
+
+	public:
+		FramePipeline()
+			: stopped_(false)
+			, writeIndex_(INVALID_INDEX)
+			, readIndex_(INVALID_INDEX)
+		{
+			freeEvent_.Create(false);
+			readyEvent_.Create(false);
+			for (uint32_t i = 0; i < BufferNum; i++) {
+				freeQueue_.Push(i);
+			}
+		}
+
+		// シミュレーション側:書き込むパケットを取得、描画が追いつくまで待つ
+		// 停止済みならnullptr
+		Packet* BeginWrite()
+		{
+			Assert(writeIndex_ == INVALID_INDEX);
+			while (!freeQueue_.Pop(&writeIndex_)) {
+				if (stopped_.Load(MemoryOrder::Acquire)) {
+					return nullptr;
+				}
+				freeEvent_.Wait();
+			}
+			return &packets_[writeIndex_];
+		}
+
+		// シミュレーション側:書き込んだパケットを描画に渡す
+		void EndWrite()
+		{
+			Assert(writeIndex_ != INVALID_INDEX);
+			readyQueue_.Push(writeIndex_);
+			writeIndex_ = INVALID_INDEX;
+			readyEvent_.Trigger();
+		}
+
+		// 描画側:次のパケットを取得、来るまで待つ
+		// 停止済みで残りのパケットもなければnullptr
+		Packet* BeginRead()
+		{
+			Assert(readIndex_ == INVALID_INDEX);
+			while (!readyQueue_.Pop(&readIndex_)) {
+				if (stopped_.Load(MemoryOrder::Acquire)) {
+					return nullptr;
+				}
+				readyEvent_.Wait();
+			}
+			return &packets_[readIndex_];
+		}
+
+		// 描画側:描画し終えたパケットを返却
+		void EndRead()
+		{
+			Assert(readIndex_ != INVALID_INDEX);
+			freeQueue_.Push(readIndex_);
+			readIndex_ = INVALID_INDEX;
+			freeEvent_.Trigger();
+		}
+
+		// 待っている両側を起こして終了させる
+		void Stop()
+		{
+			stopped_.Store(true, MemoryOrder::Release);
+			freeEvent_.Trigger();
+			readyEvent_.Trigger();
+		}
+
+		bool IsStopped() const { return stopped_.Load(MemoryOrder::Acquire); }
+
+		// 描画待ちのパケット数
+		uint32_t GetPendingNum() const { return readyQueue_.GetSize(); }
+	};
+
+}
@@ -0,0 +1,497 @@
+﻿#include "se/async/IOService.h"
+#include <thread>
+#if !defined(_WIN32)
+	#include <fcntl.h>
+	#include <sys/stat.h>
+	#include <errno.h>
+#endif
+
+namespace se {
+
+	namespace {
+#if defined(_WIN32)
+		// 完了ポートのキー
+		const ULONG_PTR COMPLETION_KEY_READ = 0;
+		const ULONG_PTR COMPLETION_KEY_SUBMIT = 1;	// 発行待ちの要求が追加された
+		const ULONG_PTR COMPLETION_KEY_QUIT = 2;
+
+		const uint32_t DEFAULT_QUEUE_DEPTH = 32;
+#else
+		const uint32_t DEFAULT_QUEUE_DEPTH = 4;
+#endif
+
+		// ブロッキング読み込みの1回の読み込みサイズ(取り消しの確認間隔)
+		const uint64_t BLOCKING_CHUNK_SIZE = 4 * 1024 * 1024;
+	}
+
+
+	/**
+	 * IOスレッド
+	 */
+	class IOThread : public ThreadRunnable
+	{
+	public:
+		virtual uint32_t Run() override
+		{
+			IOService::Get().ThreadLoop();
+			return 0;
+		}
+	};
+
+
+	IOService::IOService()
+		: requestPool_(MemoryTag::IO)
+		, activeNum_(0)
+		, queueDepth_(0)
+		, nextId_(1)
+		, totalReadBytes_(0)
+		, isRunning_(false)
+#if defined(_WIN32)
+		, completionPort_(nullptr)
+#endif
+	{
+	}
+
+	IOService::~IOService()
+	{
+		Finalize();
+	}
+
+	void IOService::Initialize(uint32_t queueDepth)
+	{
+		Assert(!IsInitialized());
+		queueDepth_ = (queueDepth > 0) ? queueDepth : DEFAULT_QUEUE_DEPTH;
+
+#if defined(_WIN32)
+		// 発行と完了処理は1本のスレッドで行い、読み込み自体は完了ポートで並行に進める
+		completionPort_ = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+		Assert(completionPort_);
+		uint32_t threadNum = 1;
+#else
+		// スレッドごとに1つの読み込みをブロッキングで行う
+		wakeEvent_.Create(false);
+		uint32_t threadNum = queueDepth_;
+#endif
+		isRunning_.Store(true, MemoryOrder::Release);
+
+		for (uint32_t i = 0; i < threadNum; i++) {
+			IOThread* runner = new IOThread();
+			Thread* thread = new Thread();
+			char name[Thread::MAX_NAME_LENGTH];
+			snprintf(name, sizeof(name), "IOThread%u", i);
+			thread->Create(runner, name);
+			thread->SetPriority(ThreadPriority::AboveNormal);
+			runners_.push_back(runner);
+			threads_.push_back(thread);
+		}
+	}
+
+	void IOService::Finalize()
+	{
+		if (!IsInitialized()) {
+			return;
+		}
+
+		// 発行待ちは取り消し、発行済みは完了を待つ
+		std::vector<IORequestId> ids;
+		{
+			ScopedLock<Mutex> lock(lock_);
+			for (auto& pair : requests_) {
+				ids.push_back(pair.first);
+			}
+		}
+		for (IORequestId id : ids) {
+			Cancel(id);
+		}
+		while (GetActiveNum() > 0) {
+			std::this_thread::yield();
+		}
+
+		isRunning_.Store(false, MemoryOrder::Release);
+#if defined(_WIN32)
+		for (size_t i = 0; i < threads_.size(); i++) {
+			PostQueuedCompletionStatus(completionPort_, 0, COMPLETION_KEY_QUIT, nullptr);
+		}
+#else
+		wakeEvent_.Trigger();
+#endif
+		for (size_t i = 0; i < threads_.size(); i++) {
+			threads_[i]->Kill(true);
+			delete threads_[i];
+			delete runners_[i];
+		}
+		threads_.clear();
+		runners_.clear();
+
+#if defined(_WIN32)
+		CloseHandle(completionPort_);
+		completionPort_ = nullptr;
+#endif
+	}
+
+	IORequestId IOService::Read(const char* fileName, uint64_t offset, uint64_t size, IOPriority priority, IOCallback callback)
+	{
+		Assert(fileName && priority < IOPriority::Num);
+
+		Request* request = requestPool_.New();
+		request->id = nextId_.FetchAdd(1, MemoryOrder::Relaxed);
+		request->fileName = fileName;
+		request->offset = offset;
+		request->size = size;
+		request->priority = priority;
+		request->callback = std::move(callback);
+		request->result.status = IOStatus::Success;
+		request->started = false;
+		IORequestId id = request->id;
+
+		if (!IsInitialized()) {
+			ReadBlocking(request);
+			Finish(request, request->result.status);
+			return id;
+		}
+
+		{
+			ScopedLock<Mutex> lock(lock_);
+			pendingRequests_[static_cast<int>(priority)].push_back(request);
+			requests_.emplace(id, request);
+		}
+#if defined(_WIN32)
+		PostQueuedCompletionStatus(completionPort_, 0, COMPLETION_KEY_SUBMIT, nullptr);
+#else
+		wakeEvent_.Trigger();
+#endif
+		return id;
+	}
+
+	bool IOService::Cancel(IORequestId id)
+	{
+		Request* cancelled = nullptr;
+		{
+			ScopedLock<Mutex> lock(lock_);
+			auto iter = requests_.find(id);
+			if (iter == requests_.end()) {
+				return false;
+			}
+
+			Request* request = iter->second;
+			request->cancelled.Store(true, MemoryOrder::Relaxed);
+			if (request->started) {
+				// 発行済み:中断できなくても完了時にCancelledになる
+#if defined(_WIN32)
+				if (request->file != INVALID_HANDLE_VALUE) {
+					CancelIoEx(request->file, &request->overlapped);
+				}
+#endif
+				return true;
+			}
+
+			auto& queue = pendingRequests_[static_cast<int>(request->priority)];
+			queue.erase(std::find(queue.begin(), queue.end(), request));
+			requests_.erase(iter);
+			cancelled = request;
+		}
+
+		// 発行前:呼び出したスレッドで完了させる
+		cancelled->result.data.clear();
+		cancelled->result.status = IOStatus::Cancelled;
+		if (cancelled->callback) {
+			cancelled->callback(cancelled->result);
+		}
+		requestPool_.Delete(cancelled);
+		return true;
+	}
+
+	uint32_t IOService::GetPendingNum()
+	{
+		ScopedLock<Mutex> lock(lock_);
+		return static_cast<uint32_t>(requests_.size()) - activeNum_;
+	}
+
+	uint32_t IOService::GetActiveNum()
+	{
+		ScopedLock<Mutex> lock(lock_);
+		return activeNum_;
+	}
+
+	IOService::Request* IOService::PopPendingRequest()
+	{
+		// lock_を取った状態で呼ぶこと
+		if (activeNum_ >= queueDepth_) {
+			return nullptr;
+		}
+		for (auto& queue : pendingRequests_) {
+			if (!queue.empty()) {
+				Request* request = queue.front();
+				queue.pop_front();
+				request->started = true;
+				activeNum_++;
+				return request;
+			}
+		}
+		return nullptr;
+	}
+
+	void IOService::Finish(Request* request, IOStatus status)
+	{
+		if (request->started) {
+			ScopedLock<Mutex> lock(lock_);
+			requests_.erase(request->id);
+			activeNum_--;
+		}
+
+		if (request->cancelled.Load(MemoryOrder::Relaxed)) {
+			status = IOStatus::Cancelled;
+		}
+		if (status == IOStatus::Success) {
+			totalReadBytes_.FetchAdd(request->result.data.size(), MemoryOrder::Relaxed);
+		} else {
+			request->result.data.clear();
+		}
+		request->result.status = status;
+
+		if (request->callback) {
+			request->callback(request->result);
+		}
+		requestPool_.Delete(request);
+	}
+
+	void IOService::ReadBlocking(Request* request)
+	{
+		auto& data = request->result.data;
+#if defined(_WIN32)
+		HANDLE file = CreateFileA(request->fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			DWORD error = GetLastError();
+			request->result.status = (error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND) ? IOStatus::NotFound : IOStatus::Failed;
+			return;
+		}
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize)) {
+			CloseHandle(file);
+			request->result.status = IOStatus::Failed;
+			return;
+		}
+		uint64_t totalSize = static_cast<uint64_t>(fileSize.QuadPart);
+#else
+		int fd = open(request->fileName.c_str(), O_RDONLY);
+		if (fd < 0) {
+			request->result.status = (errno == ENOENT) ? IOStatus::NotFound : IOStatus::Failed;
+			return;
+		}
+		struct stat st;
+		if (fstat(fd, &st) != 0) {
+			close(fd);
+			request->result.status = IOStatus::Failed;
+			return;
+		}
+		uint64_t totalSize = static_cast<uint64_t>(st.st_size);
+#endif
+
+		IOStatus status = IOStatus::Success;
+		if (request->offset > totalSize) {
+			status = IOStatus::Failed;
+		} else {
+			uint64_t size = totalSize - request->offset;
+			if (request->size > 0) {
+				size = std::min(size, request->size);
+			}
+			data.resize(static_cast<size_t>(size));
+
+			uint64_t position = 0;
+			while (position < size) {
+				if (request->cancelled.Load(MemoryOrder::Relaxed)) {
+					status = IOStatus::Cancelled;
+					break;
+				}
+				uint64_t chunk = std::min(size - position, BLOCKING_CHUNK_SIZE);
+				uint64_t offset = request->offset + position;
+#if defined(_WIN32)
+				OVERLAPPED overlapped;
+				ZeroMemory(&overlapped, sizeof(overlapped));
+				overlapped.Offset = static_cast<DWORD>(offset);
+				overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+				DWORD readSize = 0;
+				if (!ReadFile(file, data.data() + position, static_cast<DWORD>(chunk), &readSize, &overlapped) || readSize == 0) {
+					status = IOStatus::Failed;
+					break;
+				}
+#else
+				ssize_t readSize = pread(fd, data.data() + position, static_cast<size_t>(chunk), static_cast<off_t>(offset));
+				if (readSize < 0 && errno == EINTR) {
+					continue;
+				}
+				if (readSize <= 0) {
+					status = IOStatus::Failed;
+					break;
+				}
+#endif
+				position += static_cast<uint64_t>(readSize);
+			}
+		}
+
+#if defined(_WIN32)
+		CloseHandle(file);
+#else
+		close(fd);
+#endif
+		request->result.status = status;
+	}
+
+#if defined(_WIN32)
+
+	void IOService::Pump()
+	{
+		for (;;) {
+			Request* request;
+			{
+				ScopedLock<Mutex> lock(lock_);
+				request = PopPendingRequest();
+				if (request) {
+					request->file = INVALID_HANDLE_VALUE;
+				}
+			}
+			if (!request) {
+				break;
+			}
+			Start(request);
+		}
+	}
+
+	void IOService::Start(Request* request)
+	{
+		HANDLE file = CreateFileA(request->fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			DWORD error = GetLastError();
+			Finish(request, (error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND) ? IOStatus::NotFound : IOStatus::Failed);
+			return;
+		}
+
+		LARGE_INTEGER fileSize;
+		uint64_t totalSize = GetFileSizeEx(file, &fileSize) ? static_cast<uint64_t>(fileSize.QuadPart) : 0;
+		uint64_t size = (request->offset <= totalSize) ? totalSize - request->offset : 0;
+		if (request->size > 0) {
+			size = std::min(size, request->size);
+		}
+		// 1回のReadFileで読める範囲まで
+		if (request->offset > totalSize || size > 0xFFFFFFFFull || !CreateIoCompletionPort(file, completionPort_, COMPLETION_KEY_READ, 0)) {
+			CloseHandle(file);
+			Finish(request, IOStatus::Failed);
+			return;
+		}
+		if (size == 0) {
+			CloseHandle(file);
+			Finish(request, IOStatus::Success);
+			return;
+		}
+
+		{
+			// 取り消しから見えるようにしてから読み込みを発行する
+			ScopedLock<Mutex> lock(lock_);
+			request->file = file;
+		}
+		request->result.data.resize(static_cast<size_t>(size));
+		ZeroMemory(&request->overlapped, sizeof(request->overlapped));
+		request->overlapped.Offset = static_cast<DWORD>(request->offset);
+		request->overlapped.OffsetHigh = static_cast<DWORD>(request->offset >> 32);
+		if (!ReadFile(file, request->result.data.data(), static_cast<DWORD>(size), nullptr, &request->overlapped)) {
+			if (GetLastError() != ERROR_IO_PENDING) {
+				{
+					ScopedLock<Mutex> lock(lock_);
+					request->file = INVALID_HANDLE_VALUE;
+				}
+				CloseHandle(file);
+				Finish(request, IOStatus::Failed);
+			}
+		}
+		// 同期的に完了した場合も完了ポートに通知される
+	}
+
+	void IOService::ThreadLoop()
+	{
+		for (;;) {
+			DWORD transferred = 0;
+			ULONG_PTR key = 0;
+			OVERLAPPED* overlapped = nullptr;
+			BOOL result = GetQueuedCompletionStatus(completionPort_, &transferred, &key, &overlapped, INFINITE);
+			if (key == COMPLETION_KEY_QUIT) {
+				break;
+			}
+			if (key == COMPLETION_KEY_SUBMIT) {
+				Pump();
+				continue;
+			}
+			if (!overlapped) {
+				continue;
+			}
+
+			Request* request = reinterpret_cast<Request*>(overlapped);
+			IOStatus status = IOStatus::Success;
+			if (!result) {
+				status = (GetLastError() == ERROR_OPERATION_ABORTED) ? IOStatus::Cancelled : IOStatus::Failed;
+			} else if (transferred < request->result.data.size()) {
+				request->result.data.resize(transferred);
+			}
+
+			HANDLE file;
+			{
+				ScopedLock<Mutex> lock(lock_);
+				file = request->file;
+				request->file = INVALID_HANDLE_VALUE;
+			}
+			CloseHandle(file);
+			Finish(request, status);
+
+			// 空いた分を発行
+			Pump();
+		}
+	}
+
+#else
+
+	void IOService::ThreadLoop()
+	{
+		for (;;) {
+			Request* request;
+			bool remaining;
+			{
+				ScopedLock<Mutex> lock(lock_);
+				request = PopPendingRequest();
+				remaining = false;
+				for (auto& queue : pendingRequests_) {
+					remaining |= !queue.empty();
+				}
+			}
+
+			if (!request) {
+				if (!IsInitialized()) {
+					// 他のスレッドも起こして終了させる
+					wakeEvent_.Trigger();
+					break;
+				}
+				wakeEvent_.Wait();
+				continue;
+			}
+
+			// 自動リセットなので、まだ残っていれば他のスレッドを起こす
+			if (remaining) {
+				wakeEvent_.Trigger();
+			}
+			ReadBlocking(request);
+			Finish(request, request->result.status);
+		}
+	}
+
+#endif
+
+
+	Task<std::vector<uint8_t>> ReadFileAsync(const char* fileName, IOPriority priority)
+	{
+		auto state = std::make_shared<detail::TaskState<std::vector<uint8_t>>>();
+		IOService::Get().Read(fileName, priority, [state](IOResult& result) {
+			state->SetValue(std::move(result.data));
+		});
+		return Task<std::vector<uint8_t>>(state);
+	}
+
+}
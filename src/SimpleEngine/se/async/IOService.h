@@ -0,0 +1,156 @@
+﻿#pragma once
+
+#include "se/Common.h"
+#include "se/async/Threading.h"
+#include "se/async/Task.h"
+#include "se/Memory/PoolAllocator.h"
+#include <vector>
+#include <deque>
+#include <string>
+#include <functional>
+#include <unordered_map>
+
+namespace se {
+
+	class IOThread;
+
+	/**
+	 * 読み込み要求の優先度
+	 * 発行待ちの要求は優先度の高いものから順に発行される
+	 */
+	enum class IOPriority
+	{
+		High,		// 画面に出ているもの・待っているもの
+		Normal,
+		Low,		// 先読み
+
+		Num,
+	};
+
+	enum class IOStatus
+	{
+		Success,
+		NotFound,
+		Failed,
+		Cancelled,
+	};
+
+	/**
+	 * 読み込み結果
+	 */
+	struct IOResult
+	{
+		IOStatus status;
+		std::vector<uint8_t> data;
+	};
+
+	typedef uint64_t IORequestId;
+	typedef std::function<void(IOResult& result)> IOCallback;
+
+
+	/**
+	 * 非同期ファイル読み込み
+	 * 同時に発行する読み込み数(キュー深度)を保ったまま要求を流し込み、複数ファイルを並行に読む
+	 * Windows:オーバーラップIOとIO完了ポート、それ以外:preadを行うIOスレッドのプール
+	 * 完了コールバックはIOスレッドで呼ばれるので重い処理はしないこと(ReadFileAsyncの継続を使う)
+	 * 未初期化の場合は呼び出したスレッドでその場で読み込む
+	 */
+	class IOService
+	{
+		friend class IOThread;
+
+	public:
+		static const IORequestId INVALID_REQUEST_ID = 0;
+
+		static IOService& Get() {
+			static IOService instance;
+			return instance;
+		}
+
+	private:
+		struct Request
+		{
+#if defined(_WIN32)
+			OVERLAPPED overlapped;		// 完了通知から要求を引くため先頭に置く
+			HANDLE file;
+#endif
+			IORequestId id;
+			std::string fileName;
+			uint64_t offset;
+			uint64_t size;
+			IOPriority priority;
+			IOCallback callback;
+			IOResult result;
+			bool started;
+			Atomic<bool> cancelled;
+
+			Request()
+				:
+#if defined(_WIN32)
+				file(INVALID_HANDLE_VALUE),
+#endif
+				cancelled(false)
+			{
+			}
+		};
+
+	private:
+		Mutex lock_;
+		std::deque<Request*> pendingRequests_[static_cast<int>(IOPriority::Num)];
+		std::unordered_map<IORequestId, Request*> requests_;	// 発行待ち・発行済みの全要求
+		PoolAllocator<Request, true> requestPool_;				// 完了はIOスレッドで返す
+		uint32_t activeNum_;
+		uint32_t queueDepth_;
+		Atomic<uint64_t> nextId_;
+		Atomic<uint64_t> totalReadBytes_;
+		Atomic<bool> isRunning_;
+
+		std::vector<Thread*> threads_;
+		std::vector<IOThread*> runners_;
+#if defined(_WIN32)
+		HANDLE completionPort_;
+#else
+		Event wakeEvent_;
+#endif
+
+	private:
+		IOService();
+		~IOService();
+		IOService(const IOService&) = delete;
+		IOService& operator=(const IOService&) = delete;
+
+		Request* PopPendingRequest();
+		void Finish(Request* request, IOStatus status);
+		void ThreadLoop();
+		static void ReadBlocking(Request* request);
+#if defined(_WIN32)
+		void Pump();
+		void Start(Request* request);
+#endif
+
+	public:
+		// queueDepth:同時に発行する読み込み数、0で既定値(Windows:32、それ以外:IOスレッド4本)
+		void Initialize(uint32_t queueDepth = 0);
+		void Finalize();
+
+		bool IsInitialized() const { return isRunning_.Load(MemoryOrder::Acquire); }
+
+		// offsetからsizeバイト(0ならファイル末尾まで)を読み込み、完了でcallbackを呼ぶ
+		IORequestId Read(const char* fileName, uint64_t offset, uint64_t size, IOPriority priority, IOCallback callback);
+		IORequestId Read(const char* fileName, IOPriority priority, IOCallback callback) { return Read(fileName, 0, 0, priority, std::move(callback)); }
+
+		// 取り消し、発行前ならその場でCancelledで完了する
+		// 発行済みなら中断を試み、間に合わなくても結果はCancelledになる
+		// 既に完了していればfalse
+		bool Cancel(IORequestId id);
+
+		uint32_t GetPendingNum();
+		uint32_t GetActiveNum();
+		uint64_t GetTotalReadBytes() const { return totalReadBytes_.Load(MemoryOrder::Relaxed); }
+	};
+
+
+	// ファイル全体を読み込むタスク、失敗時は空
+	Task<std::vector<uint8_t>> ReadFileAsync(const char* fileName, IOPriority priority = IOPriority::Normal);
+
+}
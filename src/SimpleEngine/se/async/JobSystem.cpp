@@ -0,0 +1,352 @@
+﻿#include "se/async/JobSystem.h"
+#include "se/async/CpuTopology.h"
+#include <thread>
+
+namespace se {
+
+	namespace {
+		// 現在のスレッドのワーカー番号
+		thread_local int32_t tlsWorkerIndex = -1;
+
+		// スリープに入る前に空回りする回数
+		const uint32_t IDLE_SPIN_COUNT = 64;
+
+		uint32_t XorShift(uint32_t& state)
+		{
+			uint32_t x = state;
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			state = x;
+			return x;
+		}
+	}
+
+
+	/**
+	 * ワーカースレッド
+	 */
+	class JobWorker : public ThreadRunnable
+	{
+	private:
+		uint32_t index_;
+
+	public:
+		JobWorker(uint32_t index)
+			: index_(index)
+		{
+		}
+
+		virtual bool Initialize() override
+		{
+			tlsWorkerIndex = static_cast<int32_t>(index_);
+			return true;
+		}
+
+		virtual uint32_t Run() override
+		{
+			JobSystem::Get().WorkerLoop(index_);
+			return 0;
+		}
+
+		virtual void Stop() override
+		{
+			JobSystem::Get().WakeWorkers(JobSystem::MAX_WORKER_NUM);
+		}
+	};
+
+
+	JobSystem::JobSystem()
+		: jobPool_(MemoryTag::Jobs)
+		, sleepingNum_(0)
+		, isRunning_(false)
+	{
+	}
+
+	JobSystem::~JobSystem()
+	{
+		Finalize();
+	}
+
+	void JobSystem::Initialize(uint32_t workerNum, bool pinWorkers)
+	{
+		Assert(!IsInitialized());
+
+		// SMTの兄弟同士は実行資源を取り合うので、ワーカーは物理コアごとに1つ
+		const CpuTopology& topology = CpuTopology::Get();
+		if (workerNum == 0) {
+			workerNum = std::max(topology.GetCoreNum(), 1u);
+		}
+		if (workerNum > MAX_WORKER_NUM) {
+			workerNum = MAX_WORKER_NUM;
+		}
+
+		workers_.resize(workerNum);
+		for (uint32_t i = 0; i < workerNum; i++) {
+			auto* worker = new WorkerContext();
+			worker->sleeping.Store(0, MemoryOrder::Relaxed);
+			worker->runner = nullptr;
+			worker->randomState = 0x9E3779B9u * (i + 1);
+			worker->coreIndex = CpuTopology::INVALID_INDEX;
+			worker->wakeEvent.Create(false);
+			workers_[i] = worker;
+		}
+
+		// 呼び出しスレッドをワーカー0とする
+		tlsWorkerIndex = 0;
+		isRunning_.Store(true, MemoryOrder::Release);
+
+		for (uint32_t i = 1; i < workerNum; i++) {
+			char name[32];
+			snprintf(name, sizeof(name), "JobWorker%u", i);
+			workers_[i]->runner = new JobWorker(i);
+			workers_[i]->thread.Create(workers_[i]->runner, name);
+		}
+
+		// コア数を超える場合はOSに任せる
+		if (pinWorkers && workerNum <= topology.GetCoreNum()) {
+			std::vector<uint32_t> cores = topology.GetCoresByPerformance();
+			for (uint32_t i = 1; i < workerNum; i++) {
+				const CpuCore& core = topology.GetCore(cores[i]);
+				if (workers_[i]->thread.SetAffinity(core.logicalProcessors[0])) {
+					workers_[i]->coreIndex = cores[i];
+				}
+			}
+		}
+	}
+
+	void JobSystem::Finalize()
+	{
+		if (!IsInitialized()) {
+			return;
+		}
+
+		// 残っているジョブを消化してから止める
+		while (ExecuteOne());
+
+		isRunning_.Store(false, MemoryOrder::SeqCst);
+		for (uint32_t i = 1; i < workers_.size(); i++) {
+			workers_[i]->thread.Kill(true);
+		}
+		for (auto* worker : workers_) {
+			delete worker->runner;
+			delete worker;
+		}
+		workers_.clear();
+		tlsWorkerIndex = -1;
+	}
+
+	std::vector<uint32_t> JobSystem::GetFreeProcessors() const
+	{
+		const CpuTopology& topology = CpuTopology::Get();
+		std::vector<bool> pinned(topology.GetCoreNum(), false);
+		for (auto* worker : workers_) {
+			if (worker->coreIndex != CpuTopology::INVALID_INDEX) {
+				pinned[worker->coreIndex] = true;
+			}
+		}
+
+		std::vector<uint32_t> result;
+		for (uint32_t i = 0; i < topology.GetLogicalProcessorNum(); i++) {
+			if (!pinned[topology.GetLogicalProcessor(i).coreIndex]) {
+				result.push_back(i);
+			}
+		}
+		if (result.empty()) {
+			for (uint32_t i = 0; i < topology.GetLogicalProcessorNum(); i++) {
+				if (topology.GetLogicalProcessor(i).smtIndex > 0) {
+					result.push_back(i);
+				}
+			}
+		}
+		return result;
+	}
+
+	int32_t JobSystem::GetCurrentWorkerIndex() const
+	{
+		return tlsWorkerIndex;
+	}
+
+	uint32_t JobSystem::GetLocalJobNum() const
+	{
+		int32_t index = GetCurrentWorkerIndex();
+		if (index >= 0 && index < static_cast<int32_t>(workers_.size())) {
+			return workers_[index]->queue.GetSize();
+		}
+		return globalQueue_.GetSize();
+	}
+
+	Job* JobSystem::AllocateJob()
+	{
+		return jobPool_.New();
+	}
+
+	void JobSystem::FreeJob(Job* job)
+	{
+		jobPool_.Delete(job);
+	}
+
+	void JobSystem::Kick(void (*function)(void* param), void* param, JobCounter* counter)
+	{
+		Kick([function, param]() { function(param); }, counter);
+	}
+
+	void JobSystem::Submit(Job* job)
+	{
+		// 未初期化ならその場で実行
+		if (!IsInitialized()) {
+			Execute(job);
+			return;
+		}
+
+		int32_t index = GetCurrentWorkerIndex();
+		if (index >= 0) {
+			if (!workers_[index]->queue.Push(job)) {
+				// キューが溢れたらその場で実行
+				Execute(job);
+				return;
+			}
+		} else {
+			if (!globalQueue_.Push(job)) {
+				Execute(job);
+				return;
+			}
+		}
+
+		WakeWorkers(1);
+	}
+
+	void JobSystem::WakeWorkers(uint32_t count)
+	{
+		AtomicThreadFence(MemoryOrder::SeqCst);
+		if (sleepingNum_.Load(MemoryOrder::Relaxed) == 0 && IsInitialized()) {
+			return;
+		}
+
+		for (uint32_t i = 1; i < workers_.size() && count > 0; i++) {
+			auto* worker = workers_[i];
+			if (!IsInitialized()) {
+				// 終了時は全員起こす
+				worker->wakeEvent.Trigger();
+				continue;
+			}
+			if (worker->sleeping.Exchange(0, MemoryOrder::AcqRel) == 1) {
+				sleepingNum_.FetchSub(1, MemoryOrder::Relaxed);
+				worker->wakeEvent.Trigger();
+				count--;
+			}
+		}
+	}
+
+	Job* JobSystem::FindJob(uint32_t workerIndex)
+	{
+		Job* job = nullptr;
+		uint32_t workerNum = static_cast<uint32_t>(workers_.size());
+
+		// 自分のキュー
+		if (workerIndex < workerNum && workers_[workerIndex]->queue.Pop(&job)) {
+			return job;
+		}
+
+		// 外部スレッドから投入されたキュー
+		if (globalQueue_.Pop(&job)) {
+			return job;
+		}
+
+		// 他のワーカーから盗む
+		if (workerNum > 1) {
+			uint32_t start = (workerIndex < workerNum) ? XorShift(workers_[workerIndex]->randomState) : workerIndex;
+			for (uint32_t i = 0; i < workerNum; i++) {
+				uint32_t victim = (start + i) % workerNum;
+				if (victim == workerIndex) {
+					continue;
+				}
+				if (workers_[victim]->queue.Steal(&job)) {
+					return job;
+				}
+			}
+		}
+
+		return nullptr;
+	}
+
+	void JobSystem::Execute(Job* job)
+	{
+		JobCounter* counter = job->counter;
+		job->invoke(job);
+		job->destroy(job);
+		FreeJob(job);
+		if (counter) {
+			counter->value_.FetchSub(1, MemoryOrder::Release);
+		}
+	}
+
+	bool JobSystem::ExecuteOne()
+	{
+		if (!IsInitialized()) {
+			return false;
+		}
+
+		int32_t index = GetCurrentWorkerIndex();
+		Job* job = FindJob((index >= 0) ? static_cast<uint32_t>(index) : MAX_WORKER_NUM);
+		if (job) {
+			Execute(job);
+			return true;
+		}
+		return false;
+	}
+
+	void JobSystem::WaitForCounter(JobCounter& counter)
+	{
+		uint32_t idleCount = 0;
+		while (counter.GetValue() > 0) {
+			if (ExecuteOne()) {
+				idleCount = 0;
+				continue;
+			}
+
+			// 他のワーカーが実行中のジョブ待ち
+			if (++idleCount > IDLE_SPIN_COUNT) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void JobSystem::WorkerLoop(uint32_t workerIndex)
+	{
+		auto* worker = workers_[workerIndex];
+		uint32_t idleCount = 0;
+
+		while (IsInitialized()) {
+			Job* job = FindJob(workerIndex);
+			if (job) {
+				Execute(job);
+				idleCount = 0;
+				continue;
+			}
+
+			if (++idleCount < IDLE_SPIN_COUNT) {
+				std::this_thread::yield();
+				continue;
+			}
+			idleCount = 0;
+
+			// スリープ宣言後にもう一度確認してから寝る(起こし損ね防止)
+			worker->sleeping.Store(1, MemoryOrder::SeqCst);
+			sleepingNum_.FetchAdd(1, MemoryOrder::SeqCst);
+			AtomicThreadFence(MemoryOrder::SeqCst);
+			job = FindJob(workerIndex);
+			if (job || !IsInitialized()) {
+				if (worker->sleeping.Exchange(0, MemoryOrder::AcqRel) == 1) {
+					sleepingNum_.FetchSub(1, MemoryOrder::Relaxed);
+				}
+				if (job) {
+					Execute(job);
+				}
+				continue;
+			}
+			worker->wakeEvent.Wait();
+		}
+	}
+
+}
@@ -0,0 +1,173 @@
+﻿#pragma once
+
+#include "se/Common.h"
+#include "se/async/Threading.h"
+#include "se/async/WorkStealingQueue.h"
+#include "se/async/Queue.h"
+#include "se/Memory/PoolAllocator.h"
+#include <vector>
+#include <new>
+#include <utility>
+
+namespace se {
+
+	class JobSystem;
+	class JobWorker;
+
+	/**
+	 * ジョブカウンタ
+	 * キックしたジョブ数で加算され、ジョブ完了で減算される
+	 */
+	class JobCounter
+	{
+		friend class JobSystem;
+
+	private:
+		Atomic<int32_t> value_;
+
+	private:
+		JobCounter(const JobCounter&) = delete;
+		JobCounter& operator=(const JobCounter&) = delete;
+
+	public:
+		JobCounter()
+			: value_(0)
+		{
+		}
+
+		int32_t GetValue() const { return value_.Load(MemoryOrder::Acquire); }
+		bool IsDone() const { return GetValue() == 0; }
+	};
+
+
+	/**
+	 * ジョブ
+	 * 関数オブジェクトはヒープを使わずジョブ内部に直接格納する
+	 */
+	struct Job
+	{
+		static const uint32_t STORAGE_SIZE = 64;
+
+		void (*invoke)(Job* job);
+		void (*destroy)(Job* job);
+		JobCounter* counter;
+		alignas(16) uint8_t storage[STORAGE_SIZE];
+
+		template<class F>
+		F* GetFunction() { return reinterpret_cast<F*>(storage); }
+	};
+
+
+	/**
+	 * ジョブシステム
+	 * コアごとにワーカースレッドを持ち、ワーカーごとのキューから他のワーカーが盗んで負荷分散する
+	 * Initializeを呼んだスレッドはワーカー0として扱われ、待機中にジョブを消化する
+	 */
+	class JobSystem
+	{
+		friend class JobWorker;
+
+	public:
+		static const uint32_t MAX_WORKER_NUM = 64;
+		static const uint32_t QUEUE_CAPACITY = 4096;
+
+		typedef WorkStealingQueue<Job*, QUEUE_CAPACITY> JobQueue;
+		typedef MPMCQueue<Job*, QUEUE_CAPACITY> GlobalJobQueue;
+
+	public:
+		static JobSystem& Get() {
+			static JobSystem instance;
+			return instance;
+		}
+
+	private:
+		struct WorkerContext
+		{
+			JobQueue queue;
+			Thread thread;
+			Event wakeEvent;
+			Atomic<int32_t> sleeping;
+			JobWorker* runner;
+			uint32_t randomState;
+			uint32_t coreIndex;		// 固定先の物理コア、固定しなければCpuTopology::INVALID_INDEX
+		};
+
+	private:
+		std::vector<WorkerContext*> workers_;
+		PoolAllocator<Job, true> jobPool_;		// ジョブは実行したワーカーが解放する
+		GlobalJobQueue globalQueue_;		// ワーカー以外のスレッドから投入されたジョブ
+		Atomic<int32_t> sleepingNum_;
+		Atomic<bool> isRunning_;
+
+	private:
+		JobSystem();
+		~JobSystem();
+
+		Job* AllocateJob();
+		void FreeJob(Job* job);
+		void Submit(Job* job);
+		Job* FindJob(uint32_t workerIndex);
+		void Execute(Job* job);
+		void WakeWorkers(uint32_t count);
+		void WorkerLoop(uint32_t workerIndex);
+
+		template<class F>
+		static void InvokeFunction(Job* job)
+		{
+			(*job->GetFunction<F>())();
+		}
+
+		template<class F>
+		static void DestroyFunction(Job* job)
+		{
+			job->GetFunction<F>()->~F();
+		}
+
+	public:
+		// workerNum:0で物理コア数
+		// pinWorkers:ワーカーを高性能な物理コアから順に1つずつ固定する(ワーカー0=呼び出しスレッドは固定しない)
+		void Initialize(uint32_t workerNum = 0, bool pinWorkers = true);
+		void Finalize();
+
+		bool IsInitialized() const { return isRunning_.Load(MemoryOrder::Acquire); }
+		uint32_t GetWorkerNum() const { return static_cast<uint32_t>(workers_.size()); }
+
+		// ワーカーが固定されていない論理プロセッサ
+		// レイテンシ重視のスレッド(描画コマンド発行、IO完了待ち)を置く先、空きコアがなければSMTの兄弟スレッドを返す
+		std::vector<uint32_t> GetFreeProcessors() const;
+
+		// 現在のスレッドのワーカー番号、ワーカー以外なら-1
+		int32_t GetCurrentWorkerIndex() const;
+
+		// 現在のスレッドから見える未実行ジョブ数(分割判定用の目安)
+		uint32_t GetLocalJobNum() const;
+
+		// ジョブをキック、counterは完了時に減算される
+		void Kick(void (*function)(void* param), void* param, JobCounter* counter = nullptr);
+
+		template<class F>
+		void Kick(F&& function, JobCounter* counter = nullptr)
+		{
+			typedef typename std::decay<F>::type FunctionType;
+			static_assert(sizeof(FunctionType) <= Job::STORAGE_SIZE, "job function is too large");
+			static_assert(alignof(FunctionType) <= 16, "job function alignment is too large");
+
+			Job* job = AllocateJob();
+			new (job->storage) FunctionType(std::forward<F>(function));
+			job->invoke = &InvokeFunction<FunctionType>;
+			job->destroy = &DestroyFunction<FunctionType>;
+			job->counter = counter;
+			if (counter) {
+				counter->value_.FetchAdd(1, MemoryOrder::Relaxed);
+			}
+			Submit(job);
+		}
+
+		// カウンタが0になるまで待つ、待っている間は他のジョブを実行する
+		void WaitForCounter(JobCounter& counter);
+
+		// キューからジョブを1つ取り出して実行、実行できたらtrue
+		bool ExecuteOne();
+	};
+
+}
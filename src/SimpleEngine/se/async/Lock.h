@@ -0,0 +1,548 @@
+﻿#pragma once
+
+#include "se/Common.h"
+#include "se/async/Atomic.h"
+#include <thread>
+#include <chrono>
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+	#include <x86intrin.h>
+#endif
+
+#if defined(__linux__)
+	#include <linux/futex.h>
+	#include <sys/syscall.h>
+	#include <time.h>
+	#include <errno.h>
+#endif
+
+// ロックの競合統計を取るか
+#ifndef SE_ENABLE_LOCK_STATS
+	#define SE_ENABLE_LOCK_STATS	0
+#endif
+
+namespace se {
+
+	// スピンループ内でのCPUヒント(SMTの相方に実行資源を譲る)
+	__forceinline void CpuPause()
+	{
+#if defined(_MSC_VER)
+	#if defined(_M_ARM) || defined(_M_ARM64)
+		__yield();
+	#else
+		_mm_pause();
+	#endif
+#elif defined(__x86_64__) || defined(__i386__)
+		_mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+		__asm__ __volatile__("yield");
+#endif
+	}
+
+	// 軽量なサイクルカウンタ(統計用、周波数は未規定)
+	__forceinline uint64_t ReadCycleCounter()
+	{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+		return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#elif defined(__aarch64__)
+		uint64_t value;
+		__asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(value));
+		return value;
+#else
+		return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+	}
+
+
+	/**
+	 * 指数バックオフ
+	 * pauseの回数を倍々に増やし、上限に達したらOSにスレッドを譲る
+	 */
+	class Backoff
+	{
+	private:
+		static const uint32_t MAX_PAUSE_COUNT = 1024;
+
+		uint32_t count_;
+
+	public:
+		Backoff()
+			: count_(1)
+		{
+		}
+
+		// 待った回数(pause命令数)を返す
+		uint32_t Pause()
+		{
+			if (count_ <= MAX_PAUSE_COUNT) {
+				for (uint32_t i = 0; i < count_; i++) {
+					CpuPause();
+				}
+				uint32_t paused = count_;
+				count_ <<= 1;
+				return paused;
+			}
+			std::this_thread::yield();
+			return 0;
+		}
+
+		bool IsSaturated() const { return count_ > MAX_PAUSE_COUNT; }
+		void Reset() { count_ = 1; }
+	};
+
+
+	/**
+	 * ロックの競合統計
+	 */
+	struct LockStats
+	{
+		uint64_t acquisitions;	// ロック取得回数
+		uint64_t contentions;	// 一発で取れなかった回数
+		uint64_t spins;			// 待機中のpause回数
+		uint64_t waits;			// OSで待機した回数
+		uint64_t holdCycles;	// 排他保持時間の合計(ReadCycleCounter単位)
+	};
+
+#if SE_ENABLE_LOCK_STATS
+	/**
+	 * 統計の記録先
+	 */
+	class LockStatsRecorder
+	{
+	private:
+		Atomic<uint64_t> acquisitions_;
+		Atomic<uint64_t> contentions_;
+		Atomic<uint64_t> spins_;
+		Atomic<uint64_t> waits_;
+		Atomic<uint64_t> holdCycles_;
+		uint64_t acquiredAt_;	// 排他保持者のみが書き込む
+
+	public:
+		LockStatsRecorder()
+			: acquiredAt_(0)
+		{
+		}
+
+		void OnAcquired(uint64_t spins, bool contended)
+		{
+			acquisitions_.FetchAdd(1, MemoryOrder::Relaxed);
+			if (contended) {
+				contentions_.FetchAdd(1, MemoryOrder::Relaxed);
+				spins_.FetchAdd(spins, MemoryOrder::Relaxed);
+			}
+		}
+		void OnWait() { waits_.FetchAdd(1, MemoryOrder::Relaxed); }
+		void OnExclusiveAcquired() { acquiredAt_ = ReadCycleCounter(); }
+		void OnExclusiveReleased() { holdCycles_.FetchAdd(ReadCycleCounter() - acquiredAt_, MemoryOrder::Relaxed); }
+
+		LockStats Get() const
+		{
+			LockStats stats;
+			stats.acquisitions = acquisitions_.Load(MemoryOrder::Relaxed);
+			stats.contentions = contentions_.Load(MemoryOrder::Relaxed);
+			stats.spins = spins_.Load(MemoryOrder::Relaxed);
+			stats.waits = waits_.Load(MemoryOrder::Relaxed);
+			stats.holdCycles = holdCycles_.Load(MemoryOrder::Relaxed);
+			return stats;
+		}
+
+		void Reset()
+		{
+			acquisitions_.Store(0, MemoryOrder::Relaxed);
+			contentions_.Store(0, MemoryOrder::Relaxed);
+			spins_.Store(0, MemoryOrder::Relaxed);
+			waits_.Store(0, MemoryOrder::Relaxed);
+			holdCycles_.Store(0, MemoryOrder::Relaxed);
+		}
+	};
+
+	#define SE_LOCK_STATS_MEMBER			LockStatsRecorder stats_;
+	#define SE_LOCK_STATS(expr)				stats_.expr
+	#define SE_LOCK_STATS_ACCESSOR			LockStats GetStats() const { return stats_.Get(); } void ResetStats() { stats_.Reset(); }
+#else
+	#define SE_LOCK_STATS_MEMBER
+	#define SE_LOCK_STATS(expr)
+	#define SE_LOCK_STATS_ACCESSOR			LockStats GetStats() const { return LockStats(); } void ResetStats() {}
+#endif
+
+
+#if defined(__linux__)
+	namespace detail {
+
+		__forceinline int FutexWait(Atomic<int32_t>& word, int32_t expected, const timespec* timeout = nullptr)
+		{
+			static_assert(sizeof(Atomic<int32_t>) == sizeof(int32_t), "futex requires a plain 32bit word");
+			return (int)syscall(SYS_futex, reinterpret_cast<int32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, timeout, nullptr, 0);
+		}
+
+		__forceinline void FutexWake(Atomic<int32_t>& word, int32_t count)
+		{
+			syscall(SYS_futex, reinterpret_cast<int32_t*>(&word), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+		}
+
+	}
+#endif
+
+
+	/**
+	 * スピンロック
+	 * Test-and-Test-and-Set + 指数バックオフ
+	 * 待機中は読み込みのみでキャッシュラインを共有状態に保つ
+	 */
+	class SpinLock
+	{
+	private:
+		enum {
+			UnLocked,
+			Locked,
+		};
+
+		Atomic<int32_t> lock_;
+		SE_LOCK_STATS_MEMBER
+
+	public:
+		SpinLock()
+			: lock_(UnLocked)
+		{
+		}
+
+		bool TryLock()
+		{
+			if (lock_.Load(MemoryOrder::Relaxed) != UnLocked) {
+				return false;
+			}
+			return lock_.Exchange(Locked, MemoryOrder::Acquire) == UnLocked;
+		}
+
+		void Lock()
+		{
+			uint64_t spins = 0;
+			bool contended = false;
+			Backoff backoff;
+			while (lock_.Exchange(Locked, MemoryOrder::Acquire) != UnLocked) {
+				contended = true;
+				do {
+					spins += backoff.Pause();
+				} while (lock_.Load(MemoryOrder::Relaxed) != UnLocked);
+			}
+			SE_LOCK_STATS(OnAcquired(spins, contended));
+			SE_LOCK_STATS(OnExclusiveAcquired());
+			(void)spins;
+			(void)contended;
+		}
+
+		void Unlock()
+		{
+			SE_LOCK_STATS(OnExclusiveReleased());
+			lock_.Store(UnLocked, MemoryOrder::Release);
+		}
+
+		SE_LOCK_STATS_ACCESSOR
+	};
+
+
+	/**
+	 * チケットロック
+	 * 到着順に取得できる公平なスピンロック
+	 * 待ち人数に比例してpauseするので解放時の一斉読み込みを抑える
+	 */
+	class TicketLock
+	{
+	private:
+		Atomic<uint32_t> nextTicket_;
+		uint8_t padding_[64 - sizeof(Atomic<uint32_t>)];
+		Atomic<uint32_t> nowServing_;
+		SE_LOCK_STATS_MEMBER
+
+	public:
+		TicketLock()
+			: nextTicket_(0)
+			, nowServing_(0)
+		{
+		}
+
+		bool TryLock()
+		{
+			uint32_t serving = nowServing_.Load(MemoryOrder::Relaxed);
+			uint32_t expected = serving;
+			return nextTicket_.CompareExchange(expected, serving + 1, MemoryOrder::Acquire);
+		}
+
+		void Lock()
+		{
+			uint32_t ticket = nextTicket_.FetchAdd(1, MemoryOrder::Relaxed);
+			uint64_t spins = 0;
+			uint32_t waitCount = 0;
+			for (;;) {
+				uint32_t serving = nowServing_.Load(MemoryOrder::Acquire);
+				if (serving == ticket) {
+					break;
+				}
+				// 自分の番が遠いほど長く待つ、長引いたらOSに譲る
+				uint32_t distance = ticket - serving;
+				if (++waitCount > 64) {
+					std::this_thread::yield();
+				} else {
+					for (uint32_t i = 0; i < distance * 32; i++) {
+						CpuPause();
+					}
+					spins += distance * 32;
+				}
+			}
+			SE_LOCK_STATS(OnAcquired(spins, waitCount > 0));
+			SE_LOCK_STATS(OnExclusiveAcquired());
+			(void)spins;
+		}
+
+		void Unlock()
+		{
+			SE_LOCK_STATS(OnExclusiveReleased());
+			// 書き込むのは保持者のみなのでRMWは不要
+			nowServing_.Store(nowServing_.Load(MemoryOrder::Relaxed) + 1, MemoryOrder::Release);
+		}
+
+		SE_LOCK_STATS_ACCESSOR
+	};
+
+
+	/**
+	 * ミューテックス
+	 * 短くスピンした後はOSで待機する非再帰ロック
+	 * Windows:SRWロック、Linux:futex
+	 */
+	class Mutex
+	{
+	private:
+		static const uint32_t SPIN_COUNT = 128;
+
+#if defined(_WIN32)
+		SRWLOCK lock_;
+#elif defined(__linux__)
+		// 0:未ロック、1:ロック(待機者なし)、2:ロック(待機者あり)
+		Atomic<int32_t> state_;
+#else
+		pthread_mutex_t mutex_;
+#endif
+		SE_LOCK_STATS_MEMBER
+
+	private:
+		Mutex(const Mutex&) = delete;
+		Mutex& operator=(const Mutex&) = delete;
+
+	public:
+		Mutex()
+		{
+#if defined(_WIN32)
+			InitializeSRWLock(&lock_);
+#elif defined(__linux__)
+			state_.Store(0, MemoryOrder::Relaxed);
+#else
+			pthread_mutex_init(&mutex_, nullptr);
+#endif
+		}
+
+		~Mutex()
+		{
+#if !defined(_WIN32) && !defined(__linux__)
+			pthread_mutex_destroy(&mutex_);
+#endif
+		}
+
+		bool TryLock()
+		{
+#if defined(_WIN32)
+			return TryAcquireSRWLockExclusive(&lock_) != 0;
+#elif defined(__linux__)
+			int32_t expected = 0;
+			return state_.CompareExchange(expected, 1, MemoryOrder::Acquire);
+#else
+			return pthread_mutex_trylock(&mutex_) == 0;
+#endif
+		}
+
+		void Lock()
+		{
+			uint64_t spins = 0;
+			bool contended = false;
+			if (!TryLock()) {
+				contended = true;
+
+				// 保持時間が短ければスピンで取れる
+				bool acquired = false;
+				for (uint32_t i = 0; i < SPIN_COUNT && !acquired; i++) {
+					CpuPause();
+					spins++;
+					acquired = TryLock();
+				}
+
+				if (!acquired) {
+					SE_LOCK_STATS(OnWait());
+#if defined(_WIN32)
+					AcquireSRWLockExclusive(&lock_);
+#elif defined(__linux__)
+					// 待機者ありに遷移させてから寝る(Drepper "Futexes Are Tricky" mutex3)
+					int32_t previous = state_.Exchange(2, MemoryOrder::Acquire);
+					while (previous != 0) {
+						detail::FutexWait(state_, 2);
+						previous = state_.Exchange(2, MemoryOrder::Acquire);
+					}
+#else
+					pthread_mutex_lock(&mutex_);
+#endif
+				}
+			}
+			SE_LOCK_STATS(OnAcquired(spins, contended));
+			SE_LOCK_STATS(OnExclusiveAcquired());
+			(void)spins;
+			(void)contended;
+		}
+
+		void Unlock()
+		{
+			SE_LOCK_STATS(OnExclusiveReleased());
+#if defined(_WIN32)
+			ReleaseSRWLockExclusive(&lock_);
+#elif defined(__linux__)
+			if (state_.Exchange(0, MemoryOrder::Release) == 2) {
+				detail::FutexWake(state_, 1);
+			}
+#else
+			pthread_mutex_unlock(&mutex_);
+#endif
+		}
+
+		SE_LOCK_STATS_ACCESSOR
+	};
+
+
+	/**
+	 * リーダーライターロック
+	 * 読み込みが大半を占めるレジストリ向け、読み込み同士は並行して取得できる
+	 * 書き込み中の待機はOSに任せる(Windows:SRWロック、それ以外:pthread_rwlock)
+	 */
+	class ReadWriteLock
+	{
+	private:
+#if defined(_WIN32)
+		SRWLOCK lock_;
+#else
+		pthread_rwlock_t lock_;
+#endif
+		SE_LOCK_STATS_MEMBER
+
+	private:
+		ReadWriteLock(const ReadWriteLock&) = delete;
+		ReadWriteLock& operator=(const ReadWriteLock&) = delete;
+
+	public:
+		ReadWriteLock()
+		{
+#if defined(_WIN32)
+			InitializeSRWLock(&lock_);
+#else
+			pthread_rwlock_init(&lock_, nullptr);
+#endif
+		}
+
+		~ReadWriteLock()
+		{
+#if !defined(_WIN32)
+			pthread_rwlock_destroy(&lock_);
+#endif
+		}
+
+		// 排他(書き込み)
+		void Lock()
+		{
+#if defined(_WIN32)
+			bool contended = TryAcquireSRWLockExclusive(&lock_) == 0;
+			if (contended) {
+				SE_LOCK_STATS(OnWait());
+				AcquireSRWLockExclusive(&lock_);
+			}
+#else
+			bool contended = pthread_rwlock_trywrlock(&lock_) != 0;
+			if (contended) {
+				SE_LOCK_STATS(OnWait());
+				pthread_rwlock_wrlock(&lock_);
+			}
+#endif
+			SE_LOCK_STATS(OnAcquired(0, contended));
+			SE_LOCK_STATS(OnExclusiveAcquired());
+			(void)contended;
+		}
+
+		void Unlock()
+		{
+			SE_LOCK_STATS(OnExclusiveReleased());
+#if defined(_WIN32)
+			ReleaseSRWLockExclusive(&lock_);
+#else
+			pthread_rwlock_unlock(&lock_);
+#endif
+		}
+
+		// 共有(読み込み)
+		void LockShared()
+		{
+#if defined(_WIN32)
+			bool contended = TryAcquireSRWLockShared(&lock_) == 0;
+			if (contended) {
+				SE_LOCK_STATS(OnWait());
+				AcquireSRWLockShared(&lock_);
+			}
+#else
+			bool contended = pthread_rwlock_tryrdlock(&lock_) != 0;
+			if (contended) {
+				SE_LOCK_STATS(OnWait());
+				pthread_rwlock_rdlock(&lock_);
+			}
+#endif
+			SE_LOCK_STATS(OnAcquired(0, contended));
+			(void)contended;
+		}
+
+		void UnlockShared()
+		{
+#if defined(_WIN32)
+			ReleaseSRWLockShared(&lock_);
+#else
+			pthread_rwlock_unlock(&lock_);
+#endif
+		}
+
+		SE_LOCK_STATS_ACCESSOR
+	};
+
+
+	/**
+	 * スコープ共有ロック
+	 */
+	template<class T>
+	class ScopedReadLock
+	{
+	private:
+		T* lock_;
+
+	private:
+		ScopedReadLock(const ScopedReadLock&) = delete;
+		ScopedReadLock& operator=(const ScopedReadLock&) = delete;
+
+	public:
+		ScopedReadLock(T& lock)
+			: lock_(&lock)
+		{
+			lock_->LockShared();
+		}
+
+		~ScopedReadLock()
+		{
+			lock_->UnlockShared();
+		}
+	};
+
+}
@@ -0,0 +1,143 @@
+﻿#pragma once
+
+#include "se/Common.h"
+#include "se/async/JobSystem.h"
+#include <vector>
+
+namespace se {
+
+	namespace detail {
+
+		// 1ジョブが分割せずに処理する最小要素数の自動決定
+		// ワーカー数の数十倍程度のチャンクに収まるようにする
+		inline uint32_t ComputeGrainSize(uint32_t count, uint32_t grainSize)
+		{
+			if (grainSize > 0) {
+				return grainSize;
+			}
+			uint32_t workerNum = JobSystem::Get().GetWorkerNum();
+			uint32_t grain = count / (std::max(workerNum, 1u) * 32);
+			return std::max(grain, 1u);
+		}
+
+		/**
+		 * 遅延二分割(Lazy Binary Splitting)
+		 * グレイン分ずつ処理し、自分のキューが空の時だけ残りの半分を切り出して他ワーカーに盗ませる
+		 * 全員が忙しい時はキューが埋まっているので余計な分割が起きない
+		 */
+		template<class Body>
+		void ParallelForSplit(uint32_t begin, uint32_t end, uint32_t grain, const Body& body, JobCounter* counter)
+		{
+			JobSystem& jobSystem = JobSystem::Get();
+			while (begin < end) {
+				uint32_t remaining = end - begin;
+				if (remaining > grain && jobSystem.GetLocalJobNum() == 0) {
+					uint32_t middle = begin + remaining / 2;
+					uint32_t splitEnd = end;
+					jobSystem.Kick([middle, splitEnd, grain, &body, counter]() {
+						ParallelForSplit(middle, splitEnd, grain, body, counter);
+					}, counter);
+					end = middle;
+					continue;
+				}
+
+				uint32_t chunkEnd = begin + std::min(grain, remaining);
+				body(begin, chunkEnd);
+				begin = chunkEnd;
+			}
+		}
+
+	}
+
+
+	/**
+	 * 範囲並列ループ
+	 * body(begin, end) が重ならない部分範囲ごとに呼ばれる
+	 * grainSize:0で自動
+	 */
+	template<class Body>
+	void ParallelForRange(uint32_t begin, uint32_t end, const Body& body, uint32_t grainSize = 0)
+	{
+		if (begin >= end) {
+			return;
+		}
+
+		JobSystem& jobSystem = JobSystem::Get();
+		uint32_t grain = detail::ComputeGrainSize(end - begin, grainSize);
+		if (!jobSystem.IsInitialized() || jobSystem.GetWorkerNum() <= 1 || (end - begin) <= grain) {
+			body(begin, end);
+			return;
+		}
+
+		JobCounter counter;
+		detail::ParallelForSplit(begin, end, grain, body, &counter);
+		jobSystem.WaitForCounter(counter);
+	}
+
+
+	/**
+	 * 並列ループ
+	 * func(index) が各インデックスについて呼ばれる
+	 */
+	template<class Func>
+	void ParallelFor(uint32_t begin, uint32_t end, const Func& func, uint32_t grainSize = 0)
+	{
+		ParallelForRange(begin, end, [&func](uint32_t b, uint32_t e) {
+			for (uint32_t i = b; i < e; i++) {
+				func(i);
+			}
+		}, grainSize);
+	}
+
+
+	/**
+	 * 並列リダクション
+	 * map(begin, end) で部分範囲の値を求め、reduce(a, b) で結合する
+	 * reduceは結合則・交換則を満たすこと(結合順は実行時の分割に依存する)
+	 */
+	template<class T, class Map, class Reduce>
+	T ParallelReduce(uint32_t begin, uint32_t end, const T& identity, const Map& map, const Reduce& reduce, uint32_t grainSize = 0)
+	{
+		if (begin >= end) {
+			return identity;
+		}
+
+		JobSystem& jobSystem = JobSystem::Get();
+		uint32_t grain = detail::ComputeGrainSize(end - begin, grainSize);
+		if (!jobSystem.IsInitialized() || jobSystem.GetWorkerNum() <= 1 || (end - begin) <= grain) {
+			return reduce(identity, map(begin, end));
+		}
+
+		// ワーカーごとの部分結果(末尾はワーカー以外のスレッド用でロックする)
+		struct Partial
+		{
+			T value;
+			uint8_t padding[64];
+		};
+		uint32_t workerNum = jobSystem.GetWorkerNum();
+		std::vector<Partial> partials(workerNum + 1, Partial{ identity, {} });
+		CriticalSection externalLock;
+
+		auto body = [&](uint32_t b, uint32_t e) {
+			T value = map(b, e);
+			int32_t index = jobSystem.GetCurrentWorkerIndex();
+			if (index >= 0 && index < static_cast<int32_t>(workerNum)) {
+				partials[index].value = reduce(partials[index].value, value);
+			} else {
+				ScopedLock<CriticalSection> lock(externalLock);
+				partials[workerNum].value = reduce(partials[workerNum].value, value);
+			}
+		};
+
+		JobCounter counter;
+		detail::ParallelForSplit(begin, end, grain, body, &counter);
+		jobSystem.WaitForCounter(counter);
+
+		T result = identity;
+		for (auto& p : partials) {
+			result = reduce(result, p.value);
+		}
+		return result;
+	}
+
+}
@@ -0,0 +1,224 @@
+﻿#pragma once
+
+#include "se/Common.h"
+#include "se/async/Atomic.h"
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace se {
+
+	/**
+	 * 単一生産者・単一消費者キュー
+	 * Pushは生産者スレッドのみ、Popは消費者スレッドのみから呼び出せる
+	 * 相手側のインデックスをキャッシュして、キャッシュラインの行き来を満杯/空の時だけにする
+	 */
+	template<class T, uint32_t Capacity>
+	class SPSCQueue
+	{
+		static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be power of two");
+
+	private:
+		static const uint64_t MASK = Capacity - 1;
+
+		typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Storage;
+
+		// 消費者側
+		Atomic<uint64_t> head_;
+		uint64_t cachedTail_;
+		uint8_t padding0_[64 - sizeof(Atomic<uint64_t>) - sizeof(uint64_t)];
+		// 生産者側
+		Atomic<uint64_t> tail_;
+		uint64_t cachedHead_;
+		uint8_t padding1_[64 - sizeof(Atomic<uint64_t>) - sizeof(uint64_t)];
+		Storage entries_[Capacity];
+
+	private:
+		SPSCQueue(const SPSCQueue&) = delete;
+		SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+		T* GetEntry(uint64_t index) { return reinterpret_cast<T*>(&entries_[index & MASK]); }
+
+		template<class U>
+		bool Emplace(U&& item)
+		{
+			uint64_t tail = tail_.Load(MemoryOrder::Relaxed);
+			if (tail - cachedHead_ >= Capacity) {
+				cachedHead_ = head_.Load(MemoryOrder::Acquire);
+				if (tail - cachedHead_ >= Capacity) {
+					return false;
+				}
+			}
+			new (GetEntry(tail)) T(std::forward<U>(item));
+			tail_.Store(tail + 1, MemoryOrder::Release);
+			return true;
+		}
+
+	public:
+		SPSCQueue()
+			: head_(0)
+			, cachedTail_(0)
+			, tail_(0)
+			, cachedHead_(0)
+		{
+		}
+
+		~SPSCQueue()
+		{
+			T item;
+			while (Pop(&item));
+		}
+
+		// 満杯ならfalse
+		bool Push(const T& item) { return Emplace(item); }
+		bool Push(T&& item) { return Emplace(std::move(item)); }
+
+		// 空ならfalse
+		bool Pop(T* item)
+		{
+			uint64_t head = head_.Load(MemoryOrder::Relaxed);
+			if (head == cachedTail_) {
+				cachedTail_ = tail_.Load(MemoryOrder::Acquire);
+				if (head == cachedTail_) {
+					return false;
+				}
+			}
+			T* entry = GetEntry(head);
+			*item = std::move(*entry);
+			entry->~T();
+			head_.Store(head + 1, MemoryOrder::Release);
+			return true;
+		}
+
+		// おおよその要素数(相手側から見た場合は目安)
+		uint32_t GetSize() const
+		{
+			uint64_t tail = tail_.Load(MemoryOrder::Acquire);
+			uint64_t head = head_.Load(MemoryOrder::Acquire);
+			return (tail > head) ? static_cast<uint32_t>(tail - head) : 0;
+		}
+
+		bool IsEmpty() const { return GetSize() == 0; }
+		uint32_t GetCapacity() const { return Capacity; }
+	};
+
+
+	/**
+	 * 複数生産者・複数消費者キュー
+	 * 任意のスレッドからPush/Popを呼び出せる
+	 * 要素ごとのシーケンス番号で所有を受け渡す(Vyukov bounded MPMC queue)
+	 */
+	template<class T, uint32_t Capacity>
+	class MPMCQueue
+	{
+		static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be power of two");
+		static_assert(Capacity >= 2, "Capacity must be at least 2");
+
+	private:
+		static const uint64_t MASK = Capacity - 1;
+
+		struct Cell
+		{
+			Atomic<uint64_t> sequence;
+			typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+			T* GetEntry() { return reinterpret_cast<T*>(&storage); }
+		};
+
+		Atomic<uint64_t> enqueuePos_;
+		uint8_t padding0_[64 - sizeof(Atomic<uint64_t>)];
+		Atomic<uint64_t> dequeuePos_;
+		uint8_t padding1_[64 - sizeof(Atomic<uint64_t>)];
+		Cell cells_[Capacity];
+
+	private:
+		MPMCQueue(const MPMCQueue&) = delete;
+		MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+		template<class U>
+		bool Emplace(U&& item)
+		{
+			Cell* cell;
+			uint64_t pos = enqueuePos_.Load(MemoryOrder::Relaxed);
+			for (;;) {
+				cell = &cells_[pos & MASK];
+				uint64_t sequence = cell->sequence.Load(MemoryOrder::Acquire);
+				int64_t diff = static_cast<int64_t>(sequence - pos);
+				if (diff == 0) {
+					// 空きセル、取り合いに勝ったら確保
+					if (enqueuePos_.CompareExchangeWeak(pos, pos + 1, MemoryOrder::Relaxed)) {
+						break;
+					}
+				} else if (diff < 0) {
+					// 一周前の要素がまだ取り出されていない
+					return false;
+				} else {
+					pos = enqueuePos_.Load(MemoryOrder::Relaxed);
+				}
+			}
+			new (cell->GetEntry()) T(std::forward<U>(item));
+			cell->sequence.Store(pos + 1, MemoryOrder::Release);
+			return true;
+		}
+
+	public:
+		MPMCQueue()
+			: enqueuePos_(0)
+			, dequeuePos_(0)
+		{
+			for (uint32_t i = 0; i < Capacity; i++) {
+				cells_[i].sequence.Store(i, MemoryOrder::Relaxed);
+			}
+		}
+
+		~MPMCQueue()
+		{
+			T item;
+			while (Pop(&item));
+		}
+
+		// 満杯ならfalse
+		bool Push(const T& item) { return Emplace(item); }
+		bool Push(T&& item) { return Emplace(std::move(item)); }
+
+		// 空ならfalse
+		bool Pop(T* item)
+		{
+			Cell* cell;
+			uint64_t pos = dequeuePos_.Load(MemoryOrder::Relaxed);
+			for (;;) {
+				cell = &cells_[pos & MASK];
+				uint64_t sequence = cell->sequence.Load(MemoryOrder::Acquire);
+				int64_t diff = static_cast<int64_t>(sequence - (pos + 1));
+				if (diff == 0) {
+					if (dequeuePos_.CompareExchangeWeak(pos, pos + 1, MemoryOrder::Relaxed)) {
+						break;
+					}
+				} else if (diff < 0) {
+					// まだ書き込まれていない
+					return false;
+				} else {
+					pos = dequeuePos_.Load(MemoryOrder::Relaxed);
+				}
+			}
+			T* entry = cell->GetEntry();
+			*item = std::move(*entry);
+			entry->~T();
+			// 次の周回の書き込みを許可
+			cell->sequence.Store(pos + MASK + 1, MemoryOrder::Release);
+			return true;
+		}
+
+		// おおよその要素数(並行して操作されている場合は目安)
+		uint32_t GetSize() const
+		{
+			uint64_t enqueue = enqueuePos_.Load(MemoryOrder::Relaxed);
+			uint64_t dequeue = dequeuePos_.Load(MemoryOrder::Relaxed);
+			return (enqueue > dequeue) ? static_cast<uint32_t>(enqueue - dequeue) : 0;
+		}
+
+		bool IsEmpty() const { return GetSize() == 0; }
+		uint32_t GetCapacity() const { return Capacity; }
+	};
+
+}
@@ -0,0 +1,164 @@
+﻿#include "se/async/Task.h"
+#include <chrono>
+
+namespace se {
+
+	namespace {
+		double GetTimeMilliseconds()
+		{
+			return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+		}
+	}
+
+
+	TaskScheduler::TaskScheduler()
+		: functionPool_(MemoryTag::Jobs)
+	{
+	}
+
+	void TaskScheduler::Initialize()
+	{
+		mainThreadId_ = std::this_thread::get_id();
+	}
+
+	void TaskScheduler::Dispatch(std::function<void()> function, TaskExecution execution)
+	{
+		switch (execution) {
+		case TaskExecution::Inline:
+			function();
+			break;
+
+		case TaskExecution::Worker:
+		{
+			// std::functionはジョブに直接収まらないのでプールに置く
+			auto* task = functionPool_.New(std::move(function));
+			JobSystem::Get().Kick([this, task]() {
+				(*task)();
+				functionPool_.Delete(task);
+			});
+			break;
+		}
+
+		case TaskExecution::MainThread:
+		{
+			ScopedLock<Mutex> lock(lock_);
+			mainThreadTasks_.push_back(std::move(function));
+			break;
+		}
+		}
+	}
+
+	bool TaskScheduler::PopMainThreadTask(std::function<void()>* task)
+	{
+		ScopedLock<Mutex> lock(lock_);
+		if (mainThreadTasks_.empty()) {
+			return false;
+		}
+		*task = std::move(mainThreadTasks_.front());
+		mainThreadTasks_.pop_front();
+		return true;
+	}
+
+	void TaskScheduler::Update(double timeBudget)
+	{
+		Assert(IsMainThread());
+
+		// 実行中に追加されたタスクは次のフレームに回す
+		size_t count;
+		{
+			ScopedLock<Mutex> lock(lock_);
+			count = mainThreadTasks_.size();
+		}
+
+		double startTime = GetTimeMilliseconds();
+		std::function<void()> task;
+		for (size_t i = 0; i < count && PopMainThreadTask(&task); i++) {
+			task();
+			task = nullptr;
+			if (timeBudget > 0.0 && GetTimeMilliseconds() - startTime >= timeBudget) {
+				break;
+			}
+		}
+	}
+
+	bool TaskScheduler::ExecuteOne()
+	{
+		Assert(IsMainThread());
+		std::function<void()> task;
+		if (!PopMainThreadTask(&task)) {
+			return false;
+		}
+		task();
+		return true;
+	}
+
+
+	namespace detail {
+
+		void TaskStateBase::Complete()
+		{
+			std::vector<Continuation> continuations;
+			{
+				ScopedLock<SpinLock> lock(lock_);
+				Assert(!done_.Load(MemoryOrder::Relaxed));
+				done_.Store(true, MemoryOrder::Release);
+				continuations.swap(continuations_);
+			}
+
+			TaskScheduler& scheduler = TaskScheduler::Get();
+			for (auto& continuation : continuations) {
+				scheduler.Dispatch(std::move(continuation.function), continuation.execution);
+			}
+		}
+
+		void TaskStateBase::AddContinuation(std::function<void()> function, TaskExecution execution)
+		{
+			{
+				ScopedLock<SpinLock> lock(lock_);
+				if (!done_.Load(MemoryOrder::Relaxed)) {
+					Continuation continuation;
+					continuation.function = std::move(function);
+					continuation.execution = execution;
+					continuations_.push_back(std::move(continuation));
+					return;
+				}
+			}
+			TaskScheduler::Get().Dispatch(std::move(function), execution);
+		}
+
+		void TaskStateBase::Wait()
+		{
+			JobSystem& jobSystem = JobSystem::Get();
+			TaskScheduler& scheduler = TaskScheduler::Get();
+			bool isMainThread = scheduler.IsMainThread();
+			while (!IsDone()) {
+				// メインスレッド向けの継続を待っているかもしれないので先に消化する
+				if (isMainThread && scheduler.ExecuteOne()) {
+					continue;
+				}
+				if (!jobSystem.ExecuteOne()) {
+					std::this_thread::yield();
+				}
+			}
+		}
+
+	}
+
+
+	Task<void> MakeReadyTask()
+	{
+		auto state = std::make_shared<detail::TaskState<void>>();
+		state->SetValue();
+		return Task<void>(state);
+	}
+
+	Task<void> NextFrame()
+	{
+		auto state = std::make_shared<detail::TaskState<void>>();
+		TaskScheduler::Get().Dispatch([state]() {
+			state->SetValue();
+		}, TaskExecution::MainThread);
+		return Task<void>(state);
+	}
+
+}
@@ -0,0 +1,453 @@
+﻿#pragma once
+
+#include "se/Common.h"
+#include "se/async/JobSystem.h"
+#include "se/Memory/PoolAllocator.h"
+#include <vector>
+#include <deque>
+#include <functional>
+#include <type_traits>
+#include <thread>
+#include <exception>
+
+namespace se {
+
+	template<class T> class Task;
+
+	/**
+	 * 継続の実行先
+	 */
+	enum class TaskExecution
+	{
+		Inline,			// 完了させたスレッドでそのまま実行(軽い処理のみ)
+		Worker,			// ジョブシステムのワーカー
+		MainThread,		// TaskScheduler::Updateを呼ぶメインスレッド(即時コンテキスト・非スレッドセーフな管理クラス用)
+	};
+
+
+	/**
+	 * メインスレッドで実行するタスクのキュー
+	 * Updateをメインスレッドから毎フレーム呼ぶこと
+	 */
+	class TaskScheduler
+	{
+	public:
+		static TaskScheduler& Get() {
+			static TaskScheduler instance;
+			return instance;
+		}
+
+	private:
+		Mutex lock_;
+		std::deque<std::function<void()>> mainThreadTasks_;
+		PoolAllocator<std::function<void()>, true> functionPool_;		// ワーカーに渡す関数の置き場
+		std::thread::id mainThreadId_;
+
+	private:
+		TaskScheduler();
+		TaskScheduler(const TaskScheduler&) = delete;
+		TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+		bool PopMainThreadTask(std::function<void()>* task);
+
+	public:
+		// 呼び出したスレッドをメインスレッドとする
+		void Initialize();
+		bool IsMainThread() const { return std::this_thread::get_id() == mainThreadId_; }
+
+		// 実行先に応じて関数を投入
+		void Dispatch(std::function<void()> function, TaskExecution execution);
+
+		// 前回のUpdate以降に投入されたメインスレッドタスクを実行
+		// timeBudget:ミリ秒、超えたら残りは次フレームへ(0で無制限)
+		void Update(double timeBudget = 0.0);
+
+		// メインスレッドタスクを1つ実行、実行できたらtrue(メインスレッドでの待機用)
+		bool ExecuteOne();
+	};
+
+
+	namespace detail {
+
+		/**
+		 * タスクの共有状態
+		 * 関数が例外を投げた場合は例外を記録して完了させ、後続のタスクへ伝える(Getで再送出する)
+		 */
+		class TaskStateBase
+		{
+		private:
+			struct Continuation
+			{
+				std::function<void()> function;
+				TaskExecution execution;
+			};
+
+			Atomic<bool> done_;
+			SpinLock lock_;
+			std::vector<Continuation> continuations_;
+			std::exception_ptr exception_;		// 完了前に書き、完了後は読むだけ
+
+		private:
+			TaskStateBase(const TaskStateBase&) = delete;
+			TaskStateBase& operator=(const TaskStateBase&) = delete;
+
+		protected:
+			// 完了させて登録済みの継続を投入する
+			void Complete();
+
+		public:
+			TaskStateBase()
+				: done_(false)
+			{
+			}
+
+			virtual ~TaskStateBase() {}
+
+			bool IsDone() const { return done_.Load(MemoryOrder::Acquire); }
+
+			// 値の代わりに例外で完了させる
+			void SetException(std::exception_ptr exception)
+			{
+				Assert(exception);
+				exception_ = exception;
+				Complete();
+			}
+
+			// 完了後に呼ぶこと
+			bool HasException() const { return exception_ != nullptr; }
+			const std::exception_ptr& GetException() const { return exception_; }
+			void RethrowIfFailed() const
+			{
+				if (exception_) {
+					std::rethrow_exception(exception_);
+				}
+			}
+
+			// 完了済みなら直ちに投入する
+			void AddContinuation(std::function<void()> function, TaskExecution execution);
+
+			// 完了まで待つ、待っている間はジョブ(メインスレッドならメインスレッドタスクも)を実行する
+			void Wait();
+		};
+
+		template<class T>
+		class TaskState : public TaskStateBase
+		{
+		private:
+			typename std::aligned_storage<sizeof(T), alignof(T)>::type storage_;
+			bool hasValue_;
+
+		public:
+			TaskState()
+				: hasValue_(false)
+			{
+			}
+
+			virtual ~TaskState()
+			{
+				if (hasValue_) {
+					GetValue().~T();
+				}
+			}
+
+			template<class V>
+			void SetValue(V&& value)
+			{
+				Assert(!hasValue_);
+				new (&storage_) T(std::forward<V>(value));
+				hasValue_ = true;
+				Complete();
+			}
+
+			T& GetValue()
+			{
+				Assert(hasValue_);
+				return *reinterpret_cast<T*>(&storage_);
+			}
+		};
+
+		template<>
+		class TaskState<void> : public TaskStateBase
+		{
+		public:
+			void SetValue() { Complete(); }
+			void GetValue() {}
+		};
+
+
+		// 継続関数の戻り値からタスクの値の型を得る(Task<U>を返す継続はUに展開)
+		template<class R> struct TaskUnwrap { typedef R Type; };
+		template<class U> struct TaskUnwrap<Task<U>> { typedef U Type; };
+
+		// 先行タスクの値を渡して継続関数を呼ぶ
+		template<class T>
+		struct TaskCall
+		{
+			template<class F>
+			static auto Call(F& function, TaskState<T>& state) -> decltype(function(state.GetValue()))
+			{
+				return function(state.GetValue());
+			}
+		};
+
+		template<>
+		struct TaskCall<void>
+		{
+			template<class F>
+			static auto Call(F& function, TaskState<void>&) -> decltype(function())
+			{
+				return function();
+			}
+		};
+
+		template<class T, class F>
+		struct TaskCallResult
+		{
+			typedef decltype(TaskCall<T>::Call(std::declval<F&>(), std::declval<TaskState<T>&>())) Type;
+		};
+
+		// 内側のタスクの結果(例外を含む)を外側へ移す
+		template<class U>
+		struct TaskForward
+		{
+			static void Forward(TaskState<U>& from, TaskState<U>& to)
+			{
+				if (from.HasException()) {
+					to.SetException(from.GetException());
+				} else {
+					to.SetValue(std::move(from.GetValue()));
+				}
+			}
+		};
+
+		template<>
+		struct TaskForward<void>
+		{
+			static void Forward(TaskState<void>& from, TaskState<void>& to)
+			{
+				if (from.HasException()) {
+					to.SetException(from.GetException());
+				} else {
+					to.SetValue();
+				}
+			}
+		};
+
+		// 関数が投げた例外で状態を完了させる
+		// 完了後(継続の投入中)の例外は伝える先がないので止める
+		inline void TaskFail(TaskStateBase& state)
+		{
+			if (state.IsDone()) {
+				Assert(false);
+				std::terminate();
+			}
+			state.SetException(std::current_exception());
+		}
+
+		// 関数を呼んで結果を状態に設定する
+		template<class R>
+		struct TaskFulfill
+		{
+			template<class F>
+			static void Invoke(const std::shared_ptr<TaskState<R>>& state, F& function)
+			{
+				try {
+					state->SetValue(function());
+				} catch (...) {
+					TaskFail(*state);
+				}
+			}
+		};
+
+		template<>
+		struct TaskFulfill<void>
+		{
+			template<class F>
+			static void Invoke(const std::shared_ptr<TaskState<void>>& state, F& function)
+			{
+				try {
+					function();
+					state->SetValue();
+				} catch (...) {
+					TaskFail(*state);
+				}
+			}
+		};
+
+		// 関数がタスクを返した場合はその完了を待たずに、完了時に結果を移す
+		template<class U>
+		struct TaskFulfill<Task<U>>
+		{
+			template<class F>
+			static void Invoke(const std::shared_ptr<TaskState<U>>& state, F& function);
+		};
+
+		struct TaskAccess
+		{
+			template<class T>
+			static const std::shared_ptr<TaskState<T>>& GetState(const Task<T>& task) { return task.state_; }
+		};
+
+	}
+
+
+	/**
+	 * 非同期タスク
+	 * 値(またはvoid)が後で決まる処理の結果を表し、Thenで継続をつなぐ
+	 * スレッドをブロックせずに「読み込み → 分岐して並列処理 → 完了処理」のような非同期の流れを書くためのもの
+	 * (C++14のためコルーチンではなく継続で記述する)
+	 *
+	 *  ReadFileAsync(path)
+	 *      .Then([](std::vector<uint8_t>& data) { return Parse(data); })					// ワーカーで実行
+	 *      .Then([](Mesh& mesh) { Register(mesh); }, TaskExecution::MainThread);			// 次のTaskScheduler::Updateで実行
+	 *
+	 * 継続関数はstd::functionに格納されるのでコピー可能であること
+	 * 継続にはT&が渡される、複数の継続をつなぐ場合は値を移動しないこと
+	 */
+	template<class T>
+	class Task
+	{
+		friend struct detail::TaskAccess;
+
+	public:
+		typedef T ValueType;
+
+	private:
+		std::shared_ptr<detail::TaskState<T>> state_;
+
+	public:
+		Task() {}
+
+		explicit Task(std::shared_ptr<detail::TaskState<T>> state)
+			: state_(std::move(state))
+		{
+		}
+
+		bool IsValid() const { return state_ != nullptr; }
+		bool IsReady() const { return state_ && state_->IsDone(); }
+
+		// 完了まで待つ(待っている間は他のジョブを実行する)
+		void Wait() const
+		{
+			if (state_) {
+				state_->Wait();
+			}
+		}
+
+		// 完了を待って値を取得、タスクが例外で完了していれば再送出する
+		typename std::add_lvalue_reference<T>::type Get() const
+		{
+			Assert(state_);
+			state_->Wait();
+			state_->RethrowIfFailed();
+			return state_->GetValue();
+		}
+
+		// 完了後にfunctionを実行するタスクを作る
+		// functionはT&(voidなら引数なし)を受け取り、値・void・Task<U>のいずれかを返す
+		// このタスクが例外で完了した場合はfunctionを呼ばずに、作ったタスクも同じ例外で完了する
+		template<class F>
+		Task<typename detail::TaskUnwrap<typename detail::TaskCallResult<T, typename std::decay<F>::type>::Type>::Type>
+			Then(F&& function, TaskExecution execution = TaskExecution::Worker) const
+		{
+			typedef typename std::decay<F>::type FunctionType;
+			typedef typename detail::TaskCallResult<T, FunctionType>::Type ResultType;
+			typedef typename detail::TaskUnwrap<ResultType>::Type OutputType;
+
+			Assert(state_);
+			auto input = state_;
+			auto output = std::make_shared<detail::TaskState<OutputType>>();
+			FunctionType continuation(std::forward<F>(function));
+			input->AddContinuation([input, output, continuation]() mutable {
+				if (input->HasException()) {
+					output->SetException(input->GetException());
+					return;
+				}
+				auto call = [&]() -> ResultType { return detail::TaskCall<T>::Call(continuation, *input); };
+				detail::TaskFulfill<ResultType>::Invoke(output, call);
+			}, execution);
+			return Task<OutputType>(output);
+		}
+	};
+
+
+	namespace detail {
+
+		template<class U>
+		template<class F>
+		void TaskFulfill<Task<U>>::Invoke(const std::shared_ptr<TaskState<U>>& state, F& function)
+		{
+			Task<U> inner;
+			try {
+				inner = function();
+			} catch (...) {
+				TaskFail(*state);
+				return;
+			}
+			Assert(inner.IsValid());
+			auto innerState = TaskAccess::GetState(inner);
+			auto output = state;
+			innerState->AddContinuation([innerState, output]() {
+				TaskForward<U>::Forward(*innerState, *output);
+			}, TaskExecution::Inline);
+		}
+
+	}
+
+
+	/**
+	 * functionを非同期に実行するタスクを作る
+	 */
+	template<class F>
+	auto Async(F&& function, TaskExecution execution = TaskExecution::Worker)
+		-> Task<typename detail::TaskUnwrap<typename std::result_of<typename std::decay<F>::type&()>::type>::Type>
+	{
+		typedef typename std::decay<F>::type FunctionType;
+		typedef typename std::result_of<FunctionType&()>::type ResultType;
+		typedef typename detail::TaskUnwrap<ResultType>::Type ValueType;
+
+		auto output = std::make_shared<detail::TaskState<ValueType>>();
+		FunctionType body(std::forward<F>(function));
+		TaskScheduler::Get().Dispatch([output, body]() mutable {
+			detail::TaskFulfill<ResultType>::Invoke(output, body);
+		}, execution);
+		return Task<ValueType>(output);
+	}
+
+	// 値が決まっているタスク
+	template<class T>
+	Task<typename std::decay<T>::type> MakeReadyTask(T&& value)
+	{
+		auto state = std::make_shared<detail::TaskState<typename std::decay<T>::type>>();
+		state->SetValue(std::forward<T>(value));
+		return Task<typename std::decay<T>::type>(state);
+	}
+
+	Task<void> MakeReadyTask();
+
+	// 全タスクの完了で完了するタスク(値は個々のタスクから取得する)
+	template<class T>
+	Task<void> WhenAll(const std::vector<Task<T>>& tasks)
+	{
+		auto output = std::make_shared<detail::TaskState<void>>();
+		if (tasks.empty()) {
+			output->SetValue();
+			return Task<void>(output);
+		}
+
+		auto remaining = std::make_shared<Atomic<int32_t>>(static_cast<int32_t>(tasks.size()));
+		for (const auto& task : tasks) {
+			Assert(task.IsValid());
+			detail::TaskAccess::GetState(task)->AddContinuation([output, remaining]() {
+				if (remaining->Decrement(MemoryOrder::AcqRel) == 0) {
+					output->SetValue();
+				}
+			}, TaskExecution::Inline);
+		}
+		return Task<void>(output);
+	}
+
+	// 次のTaskScheduler::Updateで完了するタスク
+	Task<void> NextFrame();
+
+}
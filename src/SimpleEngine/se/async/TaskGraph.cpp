@@ -0,0 +1,266 @@
+﻿#include "se/async/TaskGraph.h"
+#include <chrono>
+#include <thread>
+
+namespace se {
+
+	namespace {
+		int64_t GetTimeStamp()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+		}
+	}
+
+
+	const uint32_t TaskGraph::INVALID_ID;
+
+	TaskGraph::TaskGraph()
+		: compiled_(false)
+		, remainingNum_(0)
+		, kickTime_(0)
+		, running_(false)
+	{
+	}
+
+	TaskGraph::~TaskGraph()
+	{
+		if (running_) {
+			Wait();
+		}
+	}
+
+	TaskGraph::ResourceId TaskGraph::AddResource(const char* name)
+	{
+		Assert(!running_);
+		resources_.push_back(name);
+		return static_cast<ResourceId>(resources_.size() - 1);
+	}
+
+	TaskGraph::TaskId TaskGraph::AddTask(const char* name, std::function<void()> function,
+		std::initializer_list<ResourceId> reads, std::initializer_list<ResourceId> writes, uint32_t flags)
+	{
+		Assert(!running_);
+		Task task;
+		task.name = name;
+		task.function = std::move(function);
+		task.reads.assign(reads.begin(), reads.end());
+		task.writes.assign(writes.begin(), writes.end());
+		task.flags = flags;
+		tasks_.push_back(std::move(task));
+		compiled_ = false;
+		return static_cast<TaskId>(tasks_.size() - 1);
+	}
+
+	void TaskGraph::AddDependency(TaskId before, TaskId after)
+	{
+		// 登録順をトポロジカル順として扱うので後ろ向きの依存は不可
+		Assert(before < after && after < tasks_.size());
+		tasks_[after].dependencies.push_back(before);
+		compiled_ = false;
+	}
+
+	void TaskGraph::Clear()
+	{
+		Assert(!running_);
+		resources_.clear();
+		tasks_.clear();
+		states_.reset();
+		report_ = TaskGraphReport();
+		compiled_ = false;
+	}
+
+	void TaskGraph::Compile()
+	{
+		Assert(!running_);
+
+		// リソースごとに最後の書き込みタスクと、それ以降の読み込みタスク
+		std::vector<TaskId> lastWriter(resources_.size(), INVALID_ID);
+		std::vector<std::vector<TaskId>> readers(resources_.size());
+
+		for (TaskId id = 0; id < tasks_.size(); id++) {
+			Task& task = tasks_[id];
+			std::vector<TaskId> predecessors = task.dependencies;
+
+			// 読み込みは直前の書き込み後(RAW)
+			for (ResourceId r : task.reads) {
+				Assert(r < resources_.size());
+				if (lastWriter[r] != INVALID_ID) {
+					predecessors.push_back(lastWriter[r]);
+				}
+			}
+			// 書き込みは直前の書き込み(WAW)とその後の読み込み(WAR)の後
+			for (ResourceId r : task.writes) {
+				Assert(r < resources_.size());
+				if (lastWriter[r] != INVALID_ID) {
+					predecessors.push_back(lastWriter[r]);
+				}
+				for (TaskId reader : readers[r]) {
+					if (reader != id) {
+						predecessors.push_back(reader);
+					}
+				}
+			}
+
+			for (ResourceId r : task.reads) {
+				readers[r].push_back(id);
+			}
+			for (ResourceId r : task.writes) {
+				lastWriter[r] = id;
+				readers[r].clear();
+			}
+
+			std::sort(predecessors.begin(), predecessors.end());
+			predecessors.erase(std::unique(predecessors.begin(), predecessors.end()), predecessors.end());
+			task.predecessors = std::move(predecessors);
+			task.successors.clear();
+		}
+
+		for (TaskId id = 0; id < tasks_.size(); id++) {
+			for (TaskId p : tasks_[id].predecessors) {
+				tasks_[p].successors.push_back(id);
+			}
+		}
+
+		static_assert(sizeof(TaskState) >= 64, "TaskState should occupy a cache line");
+		states_.reset(new TaskState[tasks_.size()]);
+		compiled_ = true;
+	}
+
+	double TaskGraph::GetElapsedTime() const
+	{
+		return static_cast<double>(GetTimeStamp() - kickTime_) * 1e-6;
+	}
+
+	void TaskGraph::Kick()
+	{
+		Assert(!running_);
+		if (!compiled_) {
+			Compile();
+		}
+		if (tasks_.empty()) {
+			return;
+		}
+
+		for (TaskId id = 0; id < tasks_.size(); id++) {
+			states_[id].pendingNum.Store(static_cast<int32_t>(tasks_[id].predecessors.size()), MemoryOrder::Relaxed);
+		}
+		remainingNum_.Store(static_cast<int32_t>(tasks_.size()), MemoryOrder::Relaxed);
+		mainThreadTasks_.clear();
+		kickTime_ = GetTimeStamp();
+		running_ = true;
+
+		AtomicThreadFence(MemoryOrder::Release);
+		for (TaskId id = 0; id < tasks_.size(); id++) {
+			if (tasks_[id].predecessors.empty()) {
+				Dispatch(id);
+			}
+		}
+	}
+
+	void TaskGraph::Dispatch(TaskId task)
+	{
+		if (tasks_[task].flags & TASK_FLAG_MAIN_THREAD) {
+			ScopedLock<Mutex> lock(mainThreadLock_);
+			mainThreadTasks_.push_back(task);
+		} else {
+			JobSystem::Get().Kick([this, task]() { Run(task); }, &counter_);
+		}
+	}
+
+	void TaskGraph::Run(TaskId task)
+	{
+		TaskState& state = states_[task];
+		state.timing.workerIndex = JobSystem::Get().GetCurrentWorkerIndex();
+		state.timing.startTime = GetElapsedTime();
+		tasks_[task].function();
+		state.timing.endTime = GetElapsedTime();
+
+		for (TaskId next : tasks_[task].successors) {
+			if (states_[next].pendingNum.Decrement(MemoryOrder::AcqRel) == 0) {
+				Dispatch(next);
+			}
+		}
+		remainingNum_.FetchSub(1, MemoryOrder::Release);
+	}
+
+	void TaskGraph::Wait()
+	{
+		if (!running_) {
+			return;
+		}
+
+		JobSystem& jobSystem = JobSystem::Get();
+		while (remainingNum_.Load(MemoryOrder::Acquire) > 0) {
+			TaskId task = INVALID_ID;
+			{
+				ScopedLock<Mutex> lock(mainThreadLock_);
+				if (!mainThreadTasks_.empty()) {
+					task = mainThreadTasks_.back();
+					mainThreadTasks_.pop_back();
+				}
+			}
+			if (task != INVALID_ID) {
+				Run(task);
+			} else if (!jobSystem.ExecuteOne()) {
+				std::this_thread::yield();
+			}
+		}
+
+		// ジョブの後始末(カウンタの減算)まで待つ
+		jobSystem.WaitForCounter(counter_);
+		running_ = false;
+
+		BuildReport();
+	}
+
+	void TaskGraph::BuildReport()
+	{
+		uint32_t taskNum = GetTaskNum();
+		report_.timings.resize(taskNum);
+		report_.totalTime = 0.0;
+		report_.workTime = 0.0;
+
+		// 依存を辿って所要時間の合計が最長になる連鎖を求める(登録順がトポロジカル順)
+		std::vector<double> finish(taskNum, 0.0);
+		std::vector<TaskId> previous(taskNum, INVALID_ID);
+		TaskId last = INVALID_ID;
+		for (TaskId id = 0; id < taskNum; id++) {
+			const auto& timing = states_[id].timing;
+			report_.timings[id] = timing;
+			double duration = timing.endTime - timing.startTime;
+			report_.totalTime = (std::max)(report_.totalTime, timing.endTime);
+			report_.workTime += duration;
+
+			double start = 0.0;
+			for (TaskId p : tasks_[id].predecessors) {
+				if (finish[p] > start) {
+					start = finish[p];
+					previous[id] = p;
+				}
+			}
+			finish[id] = start + duration;
+			if (last == INVALID_ID || finish[id] > finish[last]) {
+				last = id;
+			}
+		}
+
+		report_.criticalPath.clear();
+		report_.criticalPathTime = (last != INVALID_ID) ? finish[last] : 0.0;
+		for (TaskId id = last; id != INVALID_ID; id = previous[id]) {
+			report_.criticalPath.push_back(id);
+		}
+		std::reverse(report_.criticalPath.begin(), report_.criticalPath.end());
+	}
+
+	void TaskGraph::DumpReport() const
+	{
+#if defined(_DEBUG)
+		Printf("TaskGraph : total %.3fms / work %.3fms / critical path %.3fms\n", report_.totalTime, report_.workTime, report_.criticalPathTime);
+		for (TaskId id : report_.criticalPath) {
+			const auto& timing = report_.timings[id];
+			Printf("  %s : %.3fms (worker %d)\n", tasks_[id].name.c_str(), timing.endTime - timing.startTime, timing.workerIndex);
+		}
+#endif
+	}
+
+}
@@ -0,0 +1,136 @@
+﻿#pragma once
+
+#include "se/Common.h"
+#include "se/async/JobSystem.h"
+#include <vector>
+#include <string>
+#include <functional>
+#include <initializer_list>
+
+namespace se {
+
+	/**
+	 * タスクグラフの実行結果
+	 * 時間はKickからのミリ秒
+	 */
+	struct TaskGraphReport
+	{
+		struct TaskTiming
+		{
+			double startTime;
+			double endTime;
+			int32_t workerIndex;	// 実行したワーカー、ワーカー以外なら-1
+		};
+
+		std::vector<TaskTiming> timings;	// タスク番号順
+		std::vector<uint32_t> criticalPath;	// 所要時間の合計が最長になる依存の連鎖(先頭から順)
+		double criticalPathTime;			// クリティカルパス上のタスク時間の合計
+		double totalTime;					// Kickから全タスク完了までの時間
+		double workTime;					// 全タスク時間の合計
+
+		TaskGraphReport()
+			: criticalPathTime(0.0)
+			, totalTime(0.0)
+			, workTime(0.0)
+		{
+		}
+	};
+
+
+	/**
+	 * タスクグラフ
+	 * 各タスクが読み書きするリソースを宣言すると、登録順を保ったまま依存関係(RAW/WAR/WAW)を組み立てる
+	 * 依存のないタスクはジョブシステム上で並行して実行される
+	 * 構築は一度だけ行い、毎フレームKick/Waitで実行する想定
+	 */
+	class TaskGraph
+	{
+	public:
+		typedef uint32_t ResourceId;
+		typedef uint32_t TaskId;
+
+		static const uint32_t INVALID_ID = 0xFFFFFFFF;
+
+		enum TaskFlag
+		{
+			TASK_FLAG_NONE = 0,
+			TASK_FLAG_MAIN_THREAD = (1 << 0),	// Kickしたスレッドで実行する(ウインドウ・即時コンテキスト等)
+		};
+
+	private:
+		struct Task
+		{
+			std::string name;
+			std::function<void()> function;
+			std::vector<ResourceId> reads;
+			std::vector<ResourceId> writes;
+			std::vector<TaskId> dependencies;	// AddDependencyで明示した依存
+			std::vector<TaskId> predecessors;
+			std::vector<TaskId> successors;
+			uint32_t flags;
+		};
+
+		// 実行中に書き換わる状態、タスクごとにキャッシュラインを分ける
+		struct TaskState
+		{
+			Atomic<int32_t> pendingNum;
+			TaskGraphReport::TaskTiming timing;
+			uint8_t padding[32];
+		};
+
+	private:
+		std::vector<std::string> resources_;
+		std::vector<Task> tasks_;
+		std::unique_ptr<TaskState[]> states_;
+		bool compiled_;
+
+		JobCounter counter_;
+		Atomic<int32_t> remainingNum_;
+		Mutex mainThreadLock_;
+		std::vector<TaskId> mainThreadTasks_;		// 実行可能になったメインスレッドタスク
+		int64_t kickTime_;
+		bool running_;
+
+		TaskGraphReport report_;
+
+	private:
+		TaskGraph(const TaskGraph&) = delete;
+		TaskGraph& operator=(const TaskGraph&) = delete;
+
+		void Dispatch(TaskId task);
+		void Run(TaskId task);
+		void BuildReport();
+		double GetElapsedTime() const;
+
+	public:
+		TaskGraph();
+		~TaskGraph();
+
+		// 構築
+		ResourceId AddResource(const char* name);
+		TaskId AddTask(const char* name, std::function<void()> function,
+			std::initializer_list<ResourceId> reads, std::initializer_list<ResourceId> writes, uint32_t flags = TASK_FLAG_NONE);
+		void AddDependency(TaskId before, TaskId after);
+		void Compile();
+		void Clear();
+
+		// 実行、WaitはKickしたスレッドから呼ぶこと(メインスレッドタスクを消化しながら待つ)
+		void Kick();
+		void Wait();
+		void Execute() { Kick(); Wait(); }
+		bool IsRunning() const { return running_; }
+
+		uint32_t GetTaskNum() const { return static_cast<uint32_t>(tasks_.size()); }
+		const char* GetTaskName(TaskId task) const { return tasks_[task].name.c_str(); }
+		const std::vector<TaskId>& GetPredecessors(TaskId task) const { return tasks_[task].predecessors; }
+		uint32_t GetResourceNum() const { return static_cast<uint32_t>(resources_.size()); }
+		const char* GetResourceName(ResourceId resource) const { return resources_[resource].c_str(); }
+
+		// 直前に完了した実行の結果
+		const TaskGraphReport& GetReport() const { return report_; }
+
+		// クリティカルパスをデバッグ出力
+		void DumpReport() const;
+	};
+
+}
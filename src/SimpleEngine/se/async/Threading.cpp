@@ -0,0 +1,231 @@
+﻿#include "se/async/Threading.h"
+#include "se/async/CpuTopology.h"
+
+#if defined(__linux__)
+	#include <sched.h>
+	#include <sys/resource.h>
+	#include <sys/syscall.h>
+#endif
+
+namespace se {
+
+	namespace {
+
+#if defined(_WIN32)
+		typedef HRESULT(WINAPI *SetThreadDescriptionFunc)(HANDLE, PCWSTR);
+
+#pragma pack(push, 8)
+		struct ThreadNameInfo
+		{
+			DWORD type;		// 0x1000固定
+			LPCSTR name;
+			DWORD threadId;
+			DWORD flags;
+		};
+#pragma pack(pop)
+
+		// 旧来のデバッガ向け、例外で名前を通知する(アンワインドが必要なオブジェクトを置かないこと)
+		void RaiseThreadNameException(DWORD threadId, const char* name)
+		{
+			ThreadNameInfo info;
+			info.type = 0x1000;
+			info.name = name;
+			info.threadId = threadId;
+			info.flags = 0;
+			__try {
+				RaiseException(0x406D1388, 0, sizeof(info) / sizeof(ULONG_PTR), reinterpret_cast<ULONG_PTR*>(&info));
+			}
+			__except (EXCEPTION_EXECUTE_HANDLER) {
+			}
+		}
+
+		void SetNativeName(HANDLE handle, DWORD threadId, const char* name)
+		{
+			// Windows10 1607以降はSetThreadDescriptionでETWやクラッシュダンプにも残る
+			static SetThreadDescriptionFunc setThreadDescription = reinterpret_cast<SetThreadDescriptionFunc>(
+				GetProcAddress(GetModuleHandleA("kernel32.dll"), "SetThreadDescription"));
+			if (setThreadDescription) {
+				wchar_t wideName[Thread::MAX_NAME_LENGTH];
+				MultiByteToWideChar(CP_UTF8, 0, name, -1, wideName, ARRAYSIZE(wideName));
+				wideName[ARRAYSIZE(wideName) - 1] = L'\0';
+				setThreadDescription(handle, wideName);
+			}
+			if (IsDebuggerPresent()) {
+				RaiseThreadNameException(threadId, name);
+			}
+		}
+
+		bool SetNativeAffinity(HANDLE handle, const uint32_t* logicalProcessors, uint32_t count)
+		{
+			if (count == 0) {
+				return false;
+			}
+			const CpuTopology& topology = CpuTopology::Get();
+			GROUP_AFFINITY affinity = {};
+			affinity.Group = topology.GetLogicalProcessor(logicalProcessors[0]).group;
+			for (uint32_t i = 0; i < count; i++) {
+				const LogicalProcessor& lp = topology.GetLogicalProcessor(logicalProcessors[i]);
+				if (lp.group == affinity.Group) {
+					affinity.Mask |= static_cast<KAFFINITY>(1) << lp.number;
+				}
+			}
+			return SetThreadGroupAffinity(handle, &affinity, nullptr) != 0;
+		}
+
+		bool SetNativePriority(HANDLE handle, ThreadPriority priority)
+		{
+			static const int priorities[] = {
+				THREAD_PRIORITY_LOWEST,
+				THREAD_PRIORITY_BELOW_NORMAL,
+				THREAD_PRIORITY_NORMAL,
+				THREAD_PRIORITY_ABOVE_NORMAL,
+				THREAD_PRIORITY_HIGHEST,
+				THREAD_PRIORITY_TIME_CRITICAL,
+			};
+			return SetThreadPriority(handle, priorities[static_cast<int>(priority)]) != 0;
+		}
+#else
+		void SetNativeName(pthread_t thread, const char* name)
+		{
+#if defined(__linux__)
+			// Linuxは終端込みで16文字まで
+			char shortName[16];
+			strncpy(shortName, name, sizeof(shortName) - 1);
+			shortName[sizeof(shortName) - 1] = '\0';
+			pthread_setname_np(thread, shortName);
+#else
+			(void)thread;
+			(void)name;
+#endif
+		}
+
+		bool SetNativeAffinity(pthread_t thread, const uint32_t* logicalProcessors, uint32_t count)
+		{
+#if defined(__linux__)
+			if (count == 0) {
+				return false;
+			}
+			const CpuTopology& topology = CpuTopology::Get();
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			for (uint32_t i = 0; i < count; i++) {
+				CPU_SET(topology.GetLogicalProcessor(logicalProcessors[i]).osIndex, &set);
+			}
+			return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+#else
+			(void)thread;
+			(void)logicalProcessors;
+			(void)count;
+			return false;
+#endif
+		}
+
+		bool SetNativePriority(int32_t tid, ThreadPriority priority)
+		{
+#if defined(__linux__)
+			static const int niceValues[] = { 10, 5, 0, -5, -10, -15 };
+			return setpriority(PRIO_PROCESS, static_cast<id_t>(tid), niceValues[static_cast<int>(priority)]) == 0;
+#else
+			(void)tid;
+			(void)priority;
+			return false;
+#endif
+		}
+
+		int32_t GetCurrentTid()
+		{
+#if defined(__linux__)
+			return static_cast<int32_t>(syscall(SYS_gettid));
+#else
+			return 0;
+#endif
+		}
+#endif
+
+	}
+
+
+#if !defined(_WIN32)
+	void Thread::OnStart()
+	{
+		// SetPriorityとすれ違わないようにSeqCstで書いてから読む
+		tid_.Store(GetCurrentTid(), MemoryOrder::SeqCst);
+		ThreadPriority priority = static_cast<ThreadPriority>(priority_.Load(MemoryOrder::SeqCst));
+		if (priority != ThreadPriority::Normal) {
+			SetNativePriority(tid_.Load(MemoryOrder::Relaxed), priority);
+		}
+	}
+#endif
+
+	void Thread::SetName(const char* name)
+	{
+		strncpy(name_, name, MAX_NAME_LENGTH - 1);
+		name_[MAX_NAME_LENGTH - 1] = '\0';
+		if (!handle_) {
+			return;
+		}
+#if defined(_WIN32)
+		SetNativeName(handle_, id_, name_);
+#else
+		SetNativeName(thread_, name_);
+#endif
+	}
+
+	bool Thread::SetAffinity(const uint32_t* logicalProcessors, uint32_t count)
+	{
+		if (!handle_) {
+			return false;
+		}
+#if defined(_WIN32)
+		return SetNativeAffinity(handle_, logicalProcessors, count);
+#else
+		return SetNativeAffinity(thread_, logicalProcessors, count);
+#endif
+	}
+
+	bool Thread::SetPriority(ThreadPriority priority)
+	{
+		if (!handle_) {
+			return false;
+		}
+#if defined(_WIN32)
+		return SetNativePriority(handle_, priority);
+#else
+		priority_.Store(static_cast<int32_t>(priority), MemoryOrder::SeqCst);
+		int32_t tid = tid_.Load(MemoryOrder::SeqCst);
+		if (tid == 0) {
+			// 開始時に反映される
+			return true;
+		}
+		return SetNativePriority(tid, priority);
+#endif
+	}
+
+	void Thread::SetCurrentThreadName(const char* name)
+	{
+#if defined(_WIN32)
+		SetNativeName(GetCurrentThread(), GetCurrentThreadId(), name);
+#else
+		SetNativeName(pthread_self(), name);
+#endif
+	}
+
+	bool Thread::SetCurrentThreadAffinity(const uint32_t* logicalProcessors, uint32_t count)
+	{
+#if defined(_WIN32)
+		return SetNativeAffinity(GetCurrentThread(), logicalProcessors, count);
+#else
+		return SetNativeAffinity(pthread_self(), logicalProcessors, count);
+#endif
+	}
+
+	bool Thread::SetCurrentThreadPriority(ThreadPriority priority)
+	{
+#if defined(_WIN32)
+		return SetNativePriority(GetCurrentThread(), priority);
+#else
+		return SetNativePriority(GetCurrentTid(), priority);
+#endif
+	}
+
+}
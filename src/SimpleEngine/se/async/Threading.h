@@ -2,17 +2,23 @@
 
 #include "se/Common.h"
 #include "Atomic.h"
+#include "Lock.h"
 
 
 namespace se {
 
+#if defined(_WIN32)
 	static const uint32_t WAIT_INFINITE = INFINITE;
+#else
+	static const uint32_t WAIT_INFINITE = 0xFFFFFFFF;
+#endif
 
 	/**
 	 * クリティカルセクション
 	 */
 	class CriticalSection
 	{
+#if defined(_WIN32)
 	private:
 		CRITICAL_SECTION criticalSection_;
 
@@ -42,37 +48,37 @@ namespace se {
 		{
 			LeaveCriticalSection(&criticalSection_);
 		}
-	};
-
-
-	/**
-	 * スピンロック
-	 */
-	class SpinLock
-	{
+#else
 	private:
-		enum {
-			UnLocked,
-			Locked,
-		};
-
-		int32_t lock_;
+		pthread_mutex_t mutex_;
 
 	public:
-		SpinLock()
-			: lock_(0)
+		CriticalSection()
 		{
+			// Win32のクリティカルセクションに合わせて再帰ロック可能にする
+			pthread_mutexattr_t attr;
+			pthread_mutexattr_init(&attr);
+			pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+			pthread_mutex_init(&mutex_, &attr);
+			pthread_mutexattr_destroy(&attr);
 		}
 
+		~CriticalSection()
+		{
+			pthread_mutex_destroy(&mutex_);
+		}
+
+
 		void Lock()
 		{
-			while (Atomic::InterlockedCompareExchange(&lock_, UnLocked, Locked));
+			pthread_mutex_lock(&mutex_);
 		}
 
 		void Unlock()
 		{
-			Atomic::InterlockedExchange(&lock_, UnLocked);
+			pthread_mutex_unlock(&mutex_);
 		}
+#endif
 	};
 
 
@@ -86,11 +92,12 @@ namespace se {
 		T* lock_;
 
 	private:
-		ScopedLock(const ScopedLock&) {}
+		ScopedLock(const ScopedLock&) = delete;
+		ScopedLock& operator=(const ScopedLock&) = delete;
 
 	public:
 		ScopedLock(T& lock)
-			: lock_(&lock_)
+			: lock_(&lock)
 		{
 			lock_->Lock();
 		}
@@ -107,6 +114,7 @@ namespace se {
 	 */
 	class Event
 	{
+#if defined(_WIN32)
 	private:
 		HANDLE handle_;
 		bool manualReset_;
@@ -150,6 +158,174 @@ namespace se {
 		{
 			return WaitForSingleObject(handle_, waitTime) == WAIT_OBJECT_0;
 		}
+#elif defined(__linux__)
+	private:
+		// 0:非シグナル、1:シグナル
+		Atomic<int32_t> state_;
+		bool manualReset_;
+
+	private:
+		// 自動リセットならシグナルを消費する
+		bool TryConsume()
+		{
+			if (manualReset_) {
+				return state_.Load(MemoryOrder::Acquire) != 0;
+			}
+			int32_t expected = 1;
+			return state_.CompareExchange(expected, 0, MemoryOrder::Acquire);
+		}
+
+	public:
+		Event()
+			: state_(0)
+			, manualReset_(false)
+		{
+		}
+
+		bool IsManualReset() { return manualReset_; }
+
+		void Create(bool isManualReset = false)
+		{
+			state_.Store(0, MemoryOrder::Relaxed);
+			manualReset_ = isManualReset;
+		}
+
+		// イベント発火
+		void Trigger()
+		{
+			if (state_.Exchange(1, MemoryOrder::Release) == 0) {
+				detail::FutexWake(state_, manualReset_ ? INT32_MAX : 1);
+			}
+		}
+
+		void Reset()
+		{
+			state_.Store(0, MemoryOrder::Relaxed);
+		}
+
+		// 正常にシグナルイベントで抜けたかを返す
+		bool Wait(uint32_t waitTime = WAIT_INFINITE)
+		{
+			timespec deadline;
+			if (waitTime != WAIT_INFINITE) {
+				clock_gettime(CLOCK_MONOTONIC, &deadline);
+				deadline.tv_sec += waitTime / 1000;
+				deadline.tv_nsec += (long)(waitTime % 1000) * 1000000;
+				if (deadline.tv_nsec >= 1000000000) {
+					deadline.tv_sec++;
+					deadline.tv_nsec -= 1000000000;
+				}
+			}
+
+			while (!TryConsume()) {
+				if (waitTime == WAIT_INFINITE) {
+					detail::FutexWait(state_, 0);
+					continue;
+				}
+
+				// FUTEX_WAITのタイムアウトは相対時間
+				timespec now, remain;
+				clock_gettime(CLOCK_MONOTONIC, &now);
+				remain.tv_sec = deadline.tv_sec - now.tv_sec;
+				remain.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+				if (remain.tv_nsec < 0) {
+					remain.tv_sec--;
+					remain.tv_nsec += 1000000000;
+				}
+				if (remain.tv_sec < 0) {
+					return false;
+				}
+				detail::FutexWait(state_, 0, &remain);
+			}
+			return true;
+		}
+#else
+	private:
+		pthread_mutex_t mutex_;
+		pthread_cond_t cond_;
+		bool signaled_;
+		bool manualReset_;
+		bool created_;
+
+	public:
+		Event()
+			: signaled_(false)
+			, manualReset_(false)
+			, created_(false)
+		{
+		}
+
+		~Event()
+		{
+			if (created_) {
+				pthread_cond_destroy(&cond_);
+				pthread_mutex_destroy(&mutex_);
+				created_ = false;
+			}
+		}
+
+		bool IsManualReset() { return manualReset_; }
+
+		void Create(bool isManualReset = false)
+		{
+			pthread_mutex_init(&mutex_, nullptr);
+			pthread_cond_init(&cond_, nullptr);
+			signaled_ = false;
+			manualReset_ = isManualReset;
+			created_ = true;
+		}
+
+		// イベント発火
+		void Trigger()
+		{
+			pthread_mutex_lock(&mutex_);
+			signaled_ = true;
+			if (manualReset_) {
+				pthread_cond_broadcast(&cond_);
+			} else {
+				pthread_cond_signal(&cond_);
+			}
+			pthread_mutex_unlock(&mutex_);
+		}
+
+		void Reset()
+		{
+			pthread_mutex_lock(&mutex_);
+			signaled_ = false;
+			pthread_mutex_unlock(&mutex_);
+		}
+
+		// 正常にシグナルイベントで抜けたかを返す
+		bool Wait(uint32_t waitTime = WAIT_INFINITE)
+		{
+			pthread_mutex_lock(&mutex_);
+			if (waitTime == WAIT_INFINITE) {
+				while (!signaled_) {
+					pthread_cond_wait(&cond_, &mutex_);
+				}
+			} else {
+				timespec deadline;
+				clock_gettime(CLOCK_REALTIME, &deadline);
+				deadline.tv_sec += waitTime / 1000;
+				deadline.tv_nsec += (long)(waitTime % 1000) * 1000000;
+				if (deadline.tv_nsec >= 1000000000) {
+					deadline.tv_sec++;
+					deadline.tv_nsec -= 1000000000;
+				}
+				while (!signaled_) {
+					if (pthread_cond_timedwait(&cond_, &mutex_, &deadline) != 0) {
+						break;
+					}
+				}
+			}
+			bool result = signaled_;
+			if (result && !manualReset_) {
+				signaled_ = false;
+			}
+			pthread_mutex_unlock(&mutex_);
+			return result;
+		}
+#endif
 	};
 
 
@@ -194,29 +370,74 @@ namespace se {
 	};
 
 
+	/**
+	 * スレッド優先度
+	 */
+	enum class ThreadPriority
+	{
+		Lowest,
+		BelowNormal,
+		Normal,
+		AboveNormal,
+		Highest,
+		TimeCritical,
+	};
+
+
 	/**
 	 * スレッド
 	 */
 	class Thread
 	{
+	public:
+		static const uint32_t MAX_NAME_LENGTH = 32;
+
 	private:
+#if defined(_WIN32)
 		HANDLE handle_;
+#else
+		pthread_t thread_;
+		bool handle_;
+		// niceはカーネルのスレッドIDにしか設定できないので、開始前に指定されたら開始時に反映する
+		Atomic<int32_t> tid_;
+		Atomic<int32_t> priority_;
+#endif
 		uint32_t id_;
 		ThreadRunnable* runner_;
+		char name_[MAX_NAME_LENGTH];
 
 	private:
 		// スレッドのエントリポイント
+#if defined(_WIN32)
 		static DWORD __stdcall ThreadProc(void* data)
 		{
 			return reinterpret_cast<Thread*>(data)->Run();
 		}
+#else
+		static void* ThreadProc(void* data)
+		{
+			Thread* thread = reinterpret_cast<Thread*>(data);
+			thread->OnStart();
+			uintptr_t exitCode = thread->Run();
+			return reinterpret_cast<void*>(exitCode);
+		}
+
+		void OnStart();
+#endif
 
 	public:
 		Thread()
+#if defined(_WIN32)
 			: handle_(nullptr)
+#else
+			: handle_(false)
+			, tid_(0)
+			, priority_(static_cast<int32_t>(ThreadPriority::Normal))
+#endif
 			, id_(0)
 			, runner_(nullptr)
 		{
+			name_[0] = '\0';
 		}
 
 		~Thread()
@@ -230,22 +451,49 @@ namespace se {
 		void Create(ThreadRunnable* runner, const char* name = nullptr, uint32_t stackSize = 0)
 		{
 			runner_ = runner;
+#if defined(_WIN32)
 			handle_ = ::CreateThread(NULL, stackSize, ThreadProc, this, STACK_SIZE_PARAM_IS_A_RESERVATION, (LPDWORD)&id_);
+#else
+			pthread_attr_t attr;
+			pthread_attr_init(&attr);
+			if (stackSize > 0) {
+				pthread_attr_setstacksize(&attr, stackSize);
+			}
+			handle_ = (pthread_create(&thread_, &attr, ThreadProc, this) == 0);
+			pthread_attr_destroy(&attr);
+#endif
+			if (name) {
+				SetName(name);
+			}
 		}
 
 		void Wait()
 		{
+#if defined(_WIN32)
 			WaitForSingleObject(handle_, WAIT_INFINITE);
+#else
+			if (handle_) {
+				pthread_join(thread_, nullptr);
+				handle_ = false;
+			}
+#endif
 		}
 
+		// 外部からスレッドを一時停止/再開する(Windowsのみ)
+		// pthreadには外部からの一時停止がないため、それ以外では何もしない(デバッグビルドではAssertで止める)
 		void Suspend(bool pause = true)
 		{
+#if defined(_WIN32)
 			if (pause) {
 				::SuspendThread(handle_);
 			}
 			else {
 				::ResumeThread(handle_);
 			}
+#else
+			(void)pause;
+			Assert(false);
+#endif
 		}
 
 		bool Kill(bool wait = false)
@@ -261,11 +509,35 @@ namespace se {
 			}
 
 			// クローズ
+#if defined(_WIN32)
 			CloseHandle(handle_);
 			handle_ = nullptr;
+#else
+			if (handle_) {
+				pthread_detach(thread_);
+				handle_ = false;
+			}
+#endif
 			return true;
 		}
 
+		// デバッガ・プロファイラに表示される名前
+		void SetName(const char* name);
+		const char* GetName() const { return name_; }
+
+		// 指定した論理プロセッサ(CpuTopologyの番号)でのみ実行する
+		// Windowsでは1つのプロセッサグループ内に限られる(先頭のグループを使う)
+		bool SetAffinity(const uint32_t* logicalProcessors, uint32_t count);
+		bool SetAffinity(uint32_t logicalProcessor) { return SetAffinity(&logicalProcessor, 1); }
+
+		// Linuxでは通常スケジューリングのnice値で表現する(上げるには権限が必要)
+		bool SetPriority(ThreadPriority priority);
+
+		// 呼び出しスレッドに対する設定
+		static void SetCurrentThreadName(const char* name);
+		static bool SetCurrentThreadAffinity(const uint32_t* logicalProcessors, uint32_t count);
+		static bool SetCurrentThreadPriority(ThreadPriority priority);
+
 		uint32_t Run()
 		{
 			uint32_t exitCode = 0;
@@ -0,0 +1,103 @@
+﻿#pragma once
+
+#include "se/Common.h"
+#include "se/async/Atomic.h"
+
+namespace se {
+
+	/**
+	 * ワークスティーリングキュー(Chase-Lev deque)
+	 * Push/Popは所有スレッドのみ、Stealは任意のスレッドから呼び出せる
+	 * メモリオーダーは Lê et al. "Correct and Efficient Work-Stealing for Weak Memory Models" に準拠
+	 */
+	template<class T, uint32_t Capacity>
+	class WorkStealingQueue
+	{
+		static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be power of two");
+
+	private:
+		static const int64_t MASK = Capacity - 1;
+
+		// 所有スレッドと盗む側で別キャッシュラインにする
+		Atomic<int64_t> top_;
+		uint8_t padding0_[64 - sizeof(Atomic<int64_t>)];
+		Atomic<int64_t> bottom_;
+		uint8_t padding1_[64 - sizeof(Atomic<int64_t>)];
+		Atomic<T> entries_[Capacity];
+
+	private:
+		WorkStealingQueue(const WorkStealingQueue&) = delete;
+		WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+
+	public:
+		WorkStealingQueue()
+			: top_(0)
+			, bottom_(0)
+		{
+		}
+
+		// 所有スレッドから末尾に積む、満杯ならfalse
+		bool Push(T item)
+		{
+			int64_t b = bottom_.Load(MemoryOrder::Relaxed);
+			int64_t t = top_.Load(MemoryOrder::Acquire);
+			if (b - t > MASK) {
+				return false;
+			}
+			entries_[b & MASK].Store(item, MemoryOrder::Relaxed);
+			AtomicThreadFence(MemoryOrder::Release);
+			bottom_.Store(b + 1, MemoryOrder::Relaxed);
+			return true;
+		}
+
+		// 所有スレッドから末尾を取り出す(LIFO)
+		bool Pop(T* item)
+		{
+			int64_t b = bottom_.Load(MemoryOrder::Relaxed) - 1;
+			bottom_.Store(b, MemoryOrder::Relaxed);
+			AtomicThreadFence(MemoryOrder::SeqCst);
+			int64_t t = top_.Load(MemoryOrder::Relaxed);
+
+			if (t > b) {
+				// 空だった
+				bottom_.Store(b + 1, MemoryOrder::Relaxed);
+				return false;
+			}
+
+			*item = entries_[b & MASK].Load(MemoryOrder::Relaxed);
+			if (t == b) {
+				// 最後の1つはStealと取り合いになる
+				bool won = top_.CompareExchange(t, t + 1, MemoryOrder::SeqCst);
+				bottom_.Store(b + 1, MemoryOrder::Relaxed);
+				return won;
+			}
+			return true;
+		}
+
+		// 他スレッドから先頭を盗む(FIFO)
+		bool Steal(T* item)
+		{
+			int64_t t = top_.Load(MemoryOrder::Acquire);
+			AtomicThreadFence(MemoryOrder::SeqCst);
+			int64_t b = bottom_.Load(MemoryOrder::Acquire);
+
+			if (t >= b) {
+				return false;
+			}
+
+			*item = entries_[t & MASK].Load(MemoryOrder::Relaxed);
+			return top_.CompareExchange(t, t + 1, MemoryOrder::SeqCst);
+		}
+
+		// おおよその要素数(他スレッドから見た場合は目安)
+		uint32_t GetSize() const
+		{
+			int64_t b = bottom_.Load(MemoryOrder::Relaxed);
+			int64_t t = top_.Load(MemoryOrder::Relaxed);
+			return (b > t) ? static_cast<uint32_t>(b - t) : 0;
+		}
+
+		bool IsEmpty() const { return GetSize() == 0; }
+	};
+
+}
@@ -3,7 +3,14 @@
 
 #include "se/Common.h"
 #include "se/Math/Math.h"
+#include "se/Math/MathBatch.h"
+#include "se/Math/FastMath.h"
+#include "se/Math/Frustum.h"
+#include "se/Math/Sequences.h"
+#include "se/Math/Packing.h"
+#include "se/Scene/TransformHierarchy.h"
 #include "se/Graphics/Graphics.h"
 #include "se/async/Async.h"
+#include "se/Memory/Memory.h"
 #include "se/HID/HIDCore.h"
 #include "se/Debug/ImplImgui.h"
@@ -7,6 +7,7 @@ namespace {
 		se::float2 uv;
 	};
 
+	// 描画側(renderFrame)だけが触る、シミュレーション側の値はパケット経由で受け取る
 	se::TUniformParameter<se::ViewParameterData> viewUniforms;
 	se::TUniformParameter<se::ObjectParameterData> objectUniforms;
 	se::ColorBuffer temporalBuffer[3];
@@ -14,20 +15,58 @@ namespace {
 	se::Texture texture;
 
 	se::Atmosphere atm;
+	se::Atmosphere::Settings atmSettings;	// シミュレーション側、ImGuiで編集してパケットにコピーする
+	se::TaskGraph frameGraph;
+
+	/**
+	 * 描画に必要なフレームのスナップショット
+	 * パイプライン時はシミュレーション(メインスレッド)が書いて描画スレッドが読む
+	 * 可変長のデータはGlobalFrameArenaの書いたフレームのアリーナに置く
+	 */
+	struct FramePacket
+	{
+		se::ViewParameterData view;
+		const se::ObjectParameterData* objects;
+		uint32_t objectNum;
+		se::ImGuiDrawSnapshot imgui;
+		se::Atmosphere::Settings atmosphere;
+		bool enableTemporalAA;
+	};
+
+	// ダブルバッファ:シミュレーションは描画より最大1フレーム先行する
+	se::FramePipeline<FramePacket, 2> framePipeline;
 
-	// ハルトンシーケンス
-	float HaltonSequence(uint32_t index, uint32_t base)
+	// GPUプロファイラの結果は描画スレッドで更新されるので参照と排他する
+	se::Mutex gpuProfilerLock;
+
+	/**
+	 * 描画スレッド
+	 */
+	class RenderThreadRunner : public se::ThreadRunnable
 	{
-		float result = 0.0f;
-		float invBase = 1.0f / base;
-		float fraction = invBase;
-		while (index > 0) {
-			result += (index % base) * fraction;
-			index /= base;
-			fraction *= invBase;
+	private:
+		std::function<void(FramePacket&)> render_;
+
+	public:
+		RenderThreadRunner(std::function<void(FramePacket&)> render)
+			: render_(std::move(render))
+		{
 		}
-		return result;
-	}
+
+		virtual uint32_t Run() override
+		{
+			while (FramePacket* packet = framePipeline.BeginRead()) {
+				render_(*packet);
+				framePipeline.EndRead();
+			}
+			return 0;
+		}
+
+		virtual void Stop() override
+		{
+			framePipeline.Stop();
+		}
+	};
 }
 
 void RenderProfileTree(const se::GPUProfiler::ProfilerTreeMember* member, uint32_t layer)
@@ -45,7 +84,8 @@ void RenderProfileTree(const se::GPUProfiler::ProfilerTreeMember* member, uint32
 	}
 }
 
-void ProcImgui()
+// snapshot:指定時は描画せずに記録する(描画スレッド用)
+void ProcImgui(se::ImGuiDrawSnapshot* snapshot)
 {
 	se::ImGuiNewFrame();
 
@@ -65,6 +105,7 @@ void ProcImgui()
 	// GPUプロファイラ
 	{
 		static bool gpuProfilerView = true;
+		se::ScopedLock<se::Mutex> lock(gpuProfilerLock);
 		const auto* profileTree = se::GPUProfiler::Get().GetProfilerTreeRootNode();
 
 		if (!ImGui::Begin("GPU Profile", &gpuProfilerView, ImVec2(0, 0), 0.3f, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoSavedSettings)) {
@@ -79,14 +120,103 @@ void ProcImgui()
 		}
 	}
 
-	atm.DebugGUI();
+	// メモリ(タグごとの使用量、赤は予算超過)
+	{
+		static bool memoryView = true;
+		auto& tracker = se::MemoryTracker::Get();
 
-	se::ImGuiRender();
+		ImGui::SetNextWindowPos(ImVec2(0, 500), ImGuiSetCond_FirstUseEver);
+		if (!ImGui::Begin("Memory", &memoryView, ImVec2(0, 0), 0.3f, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings)) {
+			ImGui::End();
+		} else {
+			const float MB = 1.0f / (1024.0f * 1024.0f);
+			ImGui::Columns(5, "memory");
+			ImGui::Text("Tag"); ImGui::NextColumn();
+			ImGui::Text("Current(MB)"); ImGui::NextColumn();
+			ImGui::Text("Peak(MB)"); ImGui::NextColumn();
+			ImGui::Text("Budget(MB)"); ImGui::NextColumn();
+			ImGui::Text("Allocs/Frame"); ImGui::NextColumn();
+			ImGui::Separator();
+			for (int i = 0; i < static_cast<int>(se::MemoryTag::Num); i++) {
+				auto tag = static_cast<se::MemoryTag>(i);
+				auto stats = tracker.GetTagStats(tag);
+				ImVec4 color = stats.overBudget ? ImVec4(1.0f, 0.3f, 0.3f, 1.0f) : ImVec4(1.0f, 1.0f, 1.0f, 1.0f);
+				ImGui::TextColored(color, "%s", se::GetMemoryTagName(tag)); ImGui::NextColumn();
+				ImGui::TextColored(color, "%.3f", stats.currentSize * MB); ImGui::NextColumn();
+				ImGui::Text("%.3f", stats.peakSize * MB); ImGui::NextColumn();
+				if (stats.budget > 0) {
+					ImGui::Text("%.3f", stats.budget * MB);
+				} else {
+					ImGui::Text("-");
+				}
+				ImGui::NextColumn();
+				ImGui::Text("%u", stats.frameAllocNum); ImGui::NextColumn();
+			}
+			ImGui::Columns(1);
+			ImGui::Separator();
+			if (ImGui::Button("Export JSON")) {
+				tracker.ExportJson("memory_stats.json");
+			}
+			ImGui::SameLine();
+			ImGui::Text("large allocations: %u", static_cast<uint32_t>(tracker.GetCallstackSamples().size()));
+			ImGui::End();
+		}
+	}
+
+	// タスクグラフ(直前のフレームの結果、*はクリティカルパス上のタスク)
+	{
+		static bool taskGraphView = true;
+		const auto& report = frameGraph.GetReport();
+
+		ImGui::SetNextWindowPos(ImVec2(0, 200), ImGuiSetCond_FirstUseEver);
+		if (!ImGui::Begin("Task Graph", &taskGraphView, ImVec2(0, 0), 0.3f, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings)) {
+			ImGui::End();
+		} else {
+			ImGui::Text("Frame %.3fms / Work %.3fms / Critical Path %.3fms", report.totalTime, report.workTime, report.criticalPathTime);
+			ImGui::Separator();
+			for (uint32_t i = 0; i < report.timings.size(); i++) {
+				const auto& timing = report.timings[i];
+				bool critical = std::find(report.criticalPath.begin(), report.criticalPath.end(), i) != report.criticalPath.end();
+				ImGui::Text("%s %s: %.3fms (%.3f - %.3f) worker %d", critical ? "*" : " ", frameGraph.GetTaskName(i),
+					timing.endTime - timing.startTime, timing.startTime, timing.endTime, timing.workerIndex);
+			}
+			ImGui::End();
+		}
+	}
+
+	atm.DebugGUI(atmSettings);
+
+	if (snapshot) {
+		se::ImGuiRender(*snapshot);
+	} else {
+		se::ImGuiRender();
+	}
 }
 
 
 int APIENTRY wWinMain(_In_ HINSTANCE hInstance,_In_opt_ HINSTANCE hPrevInstance, _In_ LPWSTR lpCmdLine, _In_ int nCmdShow)
 {
+	// -pipelined:シミュレーションと描画を別スレッドで並行させる
+	bool pipelined = (lpCmdLine && wcsstr(lpCmdLine, L"-pipelined") != nullptr);
+
+	// タグごとのメモリ予算(MeshとTextureはGPUのバッファとテクスチャを含む)
+	{
+		const size_t MB = 1024 * 1024;
+		auto& tracker = se::MemoryTracker::Get();
+		tracker.SetBudget(se::MemoryTag::General, 128 * MB);
+		tracker.SetBudget(se::MemoryTag::Mesh, 256 * MB);
+		tracker.SetBudget(se::MemoryTag::Texture, 512 * MB);
+		tracker.SetBudget(se::MemoryTag::Shader, 16 * MB);
+		tracker.SetBudget(se::MemoryTag::Profiler, 4 * MB);
+		tracker.SetBudget(se::MemoryTag::ImGui, 16 * MB);
+		tracker.SetBudget(se::MemoryTag::Jobs, 32 * MB);
+		tracker.SetBudget(se::MemoryTag::IO, 64 * MB);
+	}
+
+	se::JobSystem::Get().Initialize();
+	se::TaskScheduler::Get().Initialize();
+	se::IOService::Get().Initialize();
+	se::Sequences::Get().Initialize("bluenoise.cache");
 	se::Window::Initialize(hInstance, 1600, 900, L"SimpleEngine");	// 900p
 	se::GraphicsCore::Initialize();
 	se::ShaderManager::Get().Initialize("./shaders");
@@ -126,11 +256,14 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,_In_opt_ HINSTANCE hPrevInstance,
 	// メッシュ
 #if 0
 	se::StaticMesh mesh;
-	mesh.Create("mesh/sponza/sponza.obj");
-	//mesh.Create("mesh/cube/cube.obj");
 	auto* meshShader = se::ShaderManager::Get().Find("OneTexture");
 	Assert(meshShader);
-	const auto* meshLayout = se::VertexLayoutManager::Get().FindLayout(*meshShader->GetVS(), mesh.GetVertexBuffer().GetAttributes());
+	// 読み込みを待たずにフレームを開始し、読み込み後の入力レイアウト設定はメインスレッドで行う
+	const se::VertexInputLayout* meshLayout = nullptr;
+	mesh.CreateAsync("mesh/sponza/sponza.obj").Then([&]() {
+		meshLayout = se::VertexLayoutManager::Get().FindLayout(*meshShader->GetVS(), mesh.GetVertexBuffer().GetAttributes());
+	}, se::TaskExecution::MainThread);
+	//mesh.CreateAsync("mesh/cube/cube.obj");
 #endif
 
 	se::Camera camera;
@@ -138,10 +271,17 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,_In_opt_ HINSTANCE hPrevInstance,
 	camera.SetPerspective(16.0f / 9.0f, se::DegreeToRadian(45.0f), 0.1f, 1000.0f);
 	camera.Build();
 	se::CameraController cameraController(camera);
-	viewUniforms.Contents().worldToView = se::float4x4::Transpose(camera.GetView());
-	viewUniforms.Contents().viewToClip = se::float4x4::Transpose(camera.GetProjection());
-	viewUniforms.Contents().worldToClip = se::float4x4::Transpose(camera.GetViewProjection());
-	objectUniforms.Contents().localToWorld = se::float4x4::ScaleMatrix(se::float3(0.01f));
+
+	// シミュレーション側の定数(グラフのタスクだけが触る)
+	se::ViewParameterData viewParams;
+	se::ObjectParameterData objectParams;
+	viewParams.worldToView = se::float4x4::Transpose(camera.GetView());
+	viewParams.viewToClip = se::float4x4::Transpose(camera.GetProjection());
+	viewParams.worldToClip = se::float4x4::Transpose(camera.GetViewProjection());
+
+	// オブジェクトの配置
+	se::TransformHierarchy transforms;
+	uint32_t meshNode = transforms.AddNode(se::TransformHierarchy::INVALID_NODE, se::float3(0.0f), se::Quaternion::Identity(), se::float3(0.01f));
 
 
 	bool enableTemporalAA = false;
@@ -149,137 +289,248 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,_In_opt_ HINSTANCE hPrevInstance,
 
 	atm.Initialize();
 
-	// メインループ
-	MSG msg = { 0 };
-	while (se::Window::IsAlive()) {
-		if(!se::Window::IsMinimized()) {
-
-			/**
-			 * メイン 
-			 */
-			se::HIDCore::Update();
-			cameraController.Update();
-
-			/**
-			 * 描画
-			 */
-			auto& context = se::GraphicsCore::GetImmediateContext();
-			se::GPUProfiler::Get().BeginFrameProfiling(context);
-			{
-				seGpuPerfScope(context, 0, "main");
-				auto& colorBuffer = se::GraphicsCore::GetDisplayColorBuffer();
-				auto& depthBuffer = se::GraphicsCore::GetDisplayDepthStencilBuffer();
-				auto& currentBuffer = temporalBuffer[2];
-
-				context.SetRenderTarget(&currentBuffer, 1, &depthBuffer);
-				context.ClearRenderTarget(currentBuffer, se::float4(0.3f, 0.4f, 0.9f, 1.0f));
-				context.ClearDepthStencil(depthBuffer);
-				context.SetViewportAndScissorRect(se::Rect(0, 0, colorBuffer.GetWidth(), colorBuffer.GetHeight()));
-
-				// temporal camera jitter
-				auto projection = camera.GetProjection();
-				if (enableTemporalAA) {
-					float x = HaltonSequence(jitterIndex, 2) * 2.0f - 1.0f;
-					float y = HaltonSequence(jitterIndex, 3) * 2.0f - 1.0f;
-					jitterIndex = (jitterIndex + 1) & 0x7;
-					projection.m[2][0] = -x / se::GraphicsCore::GetDisplayWidth();
-					projection.m[2][1] = -y / se::GraphicsCore::GetDisplayHeight();
-				}
-				auto viewProjection = camera.GetView() * projection;
-				viewUniforms.Contents().worldToClip = se::float4x4::Transpose(viewProjection);
-				viewUniforms.Updated();
-				viewUniforms.Update(context);
+	/**
+	 * フレームの描画
+	 * パケットのみを入力とし、パイプライン時は描画スレッドから呼ばれる
+	 */
+	auto renderFrame = [&](FramePacket& packet) {
+		auto& context = se::GraphicsCore::GetImmediateContext();
+		se::GPUProfiler::Get().BeginFrameProfiling(context);
+		{
+			seGpuPerfScope(context, 0, "main");
+			auto& colorBuffer = se::GraphicsCore::GetDisplayColorBuffer();
+			auto& depthBuffer = se::GraphicsCore::GetDisplayDepthStencilBuffer();
+			auto& currentBuffer = temporalBuffer[2];
+
+			context.SetRenderTarget(&currentBuffer, 1, &depthBuffer);
+			context.ClearRenderTarget(currentBuffer, se::float4(0.3f, 0.4f, 0.9f, 1.0f));
+			context.ClearDepthStencil(depthBuffer);
+			context.SetViewportAndScissorRect(se::Rect(0, 0, colorBuffer.GetWidth(), colorBuffer.GetHeight()));
+
+			viewUniforms.Contents() = packet.view;
+			viewUniforms.Updated();
+			viewUniforms.Update(context);
+			if (packet.objectNum > 0) {
+				objectUniforms.Contents() = packet.objects[0];
+				objectUniforms.Updated();
+			}
 
 #if 0
-				// 3D render
-				{
-					seGpuPerfScope(context, 0, "3DRender");
-					objectUniforms.Update(context);
-					context.SetVertexShader(*meshShader->GetVS());
-					context.SetPixelShader(*meshShader->GetPS());
-					context.SetInputLayout(*meshLayout);
-					context.SetVertexBuffer(0, &mesh.GetVertexBuffer());
-					context.SetIndexBuffer(&mesh.GetIndexBuffer());
-					context.SetVSConstantBuffer(0, viewUniforms.GetResource());
-					context.SetVSConstantBuffer(1, objectUniforms.GetResource());
-					context.SetBlendState(se::BlendState::Get(se::BlendState::Opaque));
-					context.SetDepthStencilState(se::DepthStencilState::Get(se::DepthStencilState::WriteEnable));
-					context.SetRasterizerState(se::RasterizerState::Get(se::RasterizerState::BackFaceCull));
-					context.SetPrimitiveType(se::PRIMITIVE_TYPE_TRIANGLE_LIST);
-					context.SetPSSamplerState(0, se::SamplerState::Get(se::SamplerState::AnisotropicWrap));
-					for (uint32_t i = 0; i < mesh.GetShapeNum(); i++) {
-						const auto& shape = mesh.GetShape(i);
-						const auto& material = mesh.GetMaterial(shape.materialIndex);
-						if (material.albedo) {
-							context.SetPSResource(0, material.albedo);
-						}
-						context.DrawIndexed(shape.indexStart, shape.indexCount);
+			// 3D render
+			if (meshLayout) {
+				seGpuPerfScope(context, 0, "3DRender");
+				objectUniforms.Update(context);
+				context.SetVertexShader(*meshShader->GetVS());
+				context.SetPixelShader(*meshShader->GetPS());
+				context.SetInputLayout(*meshLayout);
+				context.SetVertexBuffer(0, &mesh.GetVertexBuffer());
+				context.SetIndexBuffer(&mesh.GetIndexBuffer());
+				context.SetVSConstantBuffer(0, viewUniforms.GetView());
+				context.SetVSConstantBuffer(1, objectUniforms.GetView());
+				context.SetBlendState(se::BlendState::Get(se::BlendState::Opaque));
+				context.SetDepthStencilState(se::DepthStencilState::Get(se::DepthStencilState::WriteEnable));
+				context.SetRasterizerState(se::RasterizerState::Get(se::RasterizerState::BackFaceCull));
+				context.SetPrimitiveType(se::PRIMITIVE_TYPE_TRIANGLE_LIST);
+				context.SetPSSamplerState(0, se::SamplerState::Get(se::SamplerState::AnisotropicWrap));
+				for (uint32_t i = 0; i < mesh.GetShapeNum(); i++) {
+					const auto& shape = mesh.GetShape(i);
+					const auto& material = mesh.GetMaterial(shape.materialIndex);
+					if (auto* albedo = se::TextureManager::Get().GetTexture(material.albedo)) {
+						context.SetPSResource(0, albedo);
 					}
+					context.DrawIndexed(shape.indexStart, shape.indexCount, shape.vertexStart);
 				}
+			}
 #endif
 
-				// atmosphere
-				atm.Render(context);
-
-				if(enableTemporalAA) {
-					// TemporalAA
-					seGpuPerfScope(context, 0, "TemporalAA");
-					context.SetRenderTarget(&temporalBuffer[currentBufferIndex], 1, nullptr);
-					context.SetVertexShader(*temporalAAShader->GetVS());
-					context.SetPixelShader(*temporalAAShader->GetPS());
-					context.SetInputLayout(*layout);
-					context.SetVertexBuffer(0, &vertexBuffer);
-					context.SetIndexBuffer(&indexBuffer);
-					context.SetPSResource(0, &currentBuffer);
-					context.SetPSResource(1, &temporalBuffer[currentBufferIndex ^ 1]);
-					context.SetPSSamplerState(0, se::SamplerState::Get(se::SamplerState::LinearClamp));
-					context.SetBlendState(se::BlendState::Get(se::BlendState::Opaque));
-					context.SetDepthStencilState(se::DepthStencilState::Get(se::DepthStencilState::Disable));
-					context.SetRasterizerState(se::RasterizerState::Get(se::RasterizerState::NoCull));
-					context.SetPrimitiveType(se::PRIMITIVE_TYPE_TRIANGLE_LIST);
-					context.DrawIndexed(0, 3);
-					context.SetPSResource(0, &se::ColorBuffer());
-					context.SetPSResource(1, &se::ColorBuffer());
-
-					// to displaybuffer
-					context.SetRenderTarget(&colorBuffer, 1, nullptr);
-					context.SetVertexShader(*quadShader->GetVS());
-					context.SetPixelShader(*quadShader->GetPS());
-					context.SetPSResource(0, &temporalBuffer[currentBufferIndex]);
-					context.DrawIndexed(0, 3);
-
-					currentBufferIndex ^= 1;
-				} else {
-					// FXAA
-					seGpuPerfScope(context, 0, "FXAA");
-					context.SetRenderTarget(&colorBuffer, 1, nullptr);
-					context.SetVertexShader(*temporalAAShader->GetVS());
-					context.SetPixelShader(*fxaaShader->GetPS());
-					context.SetInputLayout(*layout);
-					context.SetVertexBuffer(0, &vertexBuffer);
-					context.SetIndexBuffer(&indexBuffer);
-					context.SetPSResource(0, &currentBuffer);
-					context.SetPSSamplerState(0, se::SamplerState::Get(se::SamplerState::LinearClamp));
-					context.SetBlendState(se::BlendState::Get(se::BlendState::Opaque));
-					context.SetDepthStencilState(se::DepthStencilState::Get(se::DepthStencilState::Disable));
-					context.SetRasterizerState(se::RasterizerState::Get(se::RasterizerState::NoCull));
-					context.SetPrimitiveType(se::PRIMITIVE_TYPE_TRIANGLE_LIST);
-					context.DrawIndexed(0, 3);
-					context.SetPSResource(0, &se::ColorBuffer());
-				}
+			// atmosphere
+			atm.Render(context, packet.atmosphere);
+
+			if(packet.enableTemporalAA) {
+				// TemporalAA
+				seGpuPerfScope(context, 0, "TemporalAA");
+				context.SetRenderTarget(&temporalBuffer[currentBufferIndex], 1, nullptr);
+				context.SetVertexShader(*temporalAAShader->GetVS());
+				context.SetPixelShader(*temporalAAShader->GetPS());
+				context.SetInputLayout(*layout);
+				context.SetVertexBuffer(0, &vertexBuffer);
+				context.SetIndexBuffer(&indexBuffer);
+				context.SetPSResource(0, &currentBuffer);
+				context.SetPSResource(1, &temporalBuffer[currentBufferIndex ^ 1]);
+				context.SetPSSamplerState(0, se::SamplerState::Get(se::SamplerState::LinearClamp));
+				context.SetBlendState(se::BlendState::Get(se::BlendState::Opaque));
+				context.SetDepthStencilState(se::DepthStencilState::Get(se::DepthStencilState::Disable));
+				context.SetRasterizerState(se::RasterizerState::Get(se::RasterizerState::NoCull));
+				context.SetPrimitiveType(se::PRIMITIVE_TYPE_TRIANGLE_LIST);
+				context.DrawIndexed(0, 3);
+				context.SetPSResource(0, &se::ColorBuffer());
+				context.SetPSResource(1, &se::ColorBuffer());
+
+				// to displaybuffer
+				context.SetRenderTarget(&colorBuffer, 1, nullptr);
+				context.SetVertexShader(*quadShader->GetVS());
+				context.SetPixelShader(*quadShader->GetPS());
+				context.SetPSResource(0, &temporalBuffer[currentBufferIndex]);
+				context.DrawIndexed(0, 3);
+
+				currentBufferIndex ^= 1;
+			} else {
+				// FXAA
+				seGpuPerfScope(context, 0, "FXAA");
+				context.SetRenderTarget(&colorBuffer, 1, nullptr);
+				context.SetVertexShader(*temporalAAShader->GetVS());
+				context.SetPixelShader(*fxaaShader->GetPS());
+				context.SetInputLayout(*layout);
+				context.SetVertexBuffer(0, &vertexBuffer);
+				context.SetIndexBuffer(&indexBuffer);
+				context.SetPSResource(0, &currentBuffer);
+				context.SetPSSamplerState(0, se::SamplerState::Get(se::SamplerState::LinearClamp));
+				context.SetBlendState(se::BlendState::Get(se::BlendState::Opaque));
+				context.SetDepthStencilState(se::DepthStencilState::Get(se::DepthStencilState::Disable));
+				context.SetRasterizerState(se::RasterizerState::Get(se::RasterizerState::NoCull));
+				context.SetPrimitiveType(se::PRIMITIVE_TYPE_TRIANGLE_LIST);
+				context.DrawIndexed(0, 3);
+				context.SetPSResource(0, &se::ColorBuffer());
 			}
+		}
+	};
 
-			{
-				seGpuPerfScope(context, 0, "imgui");
-				ProcImgui();
-			}
+	/**
+	 * フレームのタスクグラフ
+	 * 各段階が読み書きするリソースから依存を組み立て、独立した段階はワーカーで並行に実行する
+	 * ウインドウ入力と即時コンテキストを触る段階はメインスレッドで実行する
+	 * パイプライン時は描画・Presentを描画スレッドに任せ、グラフはパケットを作るところまで
+	 */
+	FramePacket immediatePacket;
+	FramePacket* currentPacket = &immediatePacket;
+
+	auto resInput = frameGraph.AddResource("Input");
+	auto resCamera = frameGraph.AddResource("Camera");
+	auto resTransform = frameGraph.AddResource("Transform");
+	auto resPacket = frameGraph.AddResource("FramePacket");
+	auto resContext = frameGraph.AddResource("ImmediateContext");
+
+	frameGraph.AddTask("HID Update", []() {
+		se::HIDCore::Update();
+	}, {}, { resInput }, se::TaskGraph::TASK_FLAG_MAIN_THREAD);
+
+	frameGraph.AddTask("Camera Update", [&]() {
+		cameraController.Update();
+	}, { resInput }, { resCamera });
+
+	frameGraph.AddTask("Transform Update", [&]() {
+		transforms.UpdateWorldMatrices();
+		objectParams.localToWorld = se::float4x4::Transpose(transforms.GetWorldMatrix(meshNode));
+	}, {}, { resTransform });
+
+	frameGraph.AddTask("View Setup", [&]() {
+		// temporal camera jitter
+		auto projection = camera.GetProjection();
+		if (enableTemporalAA) {
+			const auto& jitter = se::Sequences::Get().GetHalton23(jitterIndex);
+			float x = jitter.x * 2.0f - 1.0f;
+			float y = jitter.y * 2.0f - 1.0f;
+			jitterIndex = (jitterIndex + 1) & 0x7;
+			projection.m[2][0] = -x / se::GraphicsCore::GetDisplayWidth();
+			projection.m[2][1] = -y / se::GraphicsCore::GetDisplayHeight();
+		}
+		auto viewProjection = camera.GetView() * projection;
+		FramePacket& packet = *currentPacket;
+		packet.view = viewParams;
+		packet.view.worldToClip = se::float4x4::Transpose(viewProjection);
+		auto* objects = se::GlobalFrameArena::Get().GetCurrent().NewArray<se::ObjectParameterData>(1);
+		objects[0] = objectParams;
+		packet.objects = objects;
+		packet.objectNum = 1;
+		packet.atmosphere = atmSettings;
+		packet.enableTemporalAA = enableTemporalAA;
+		// 一度だけの指示は渡したら戻す(ImGuiはこのタスクの後に実行される)
+		atmSettings.recomputeTransmittance = false;
+	}, { resCamera, resTransform }, { resPacket });
+
+	if (pipelined) {
+		frameGraph.AddTask("ImGui", [&]() {
+			ProcImgui(&currentPacket->imgui);
+		}, {}, { resPacket }, se::TaskGraph::TASK_FLAG_MAIN_THREAD);
+	} else {
+		frameGraph.AddTask("Render", [&]() {
+			renderFrame(*currentPacket);
+		}, { resPacket }, { resContext }, se::TaskGraph::TASK_FLAG_MAIN_THREAD);
+
+		frameGraph.AddTask("ImGui", []() {
+			auto& context = se::GraphicsCore::GetImmediateContext();
+			seGpuPerfScope(context, 0, "imgui");
+			ProcImgui(nullptr);
+		}, {}, { resContext }, se::TaskGraph::TASK_FLAG_MAIN_THREAD);
 
+		frameGraph.AddTask("Present", []() {
+			auto& context = se::GraphicsCore::GetImmediateContext();
 			se::GPUProfiler::Get().EndFrameProfiling(context);
 			se::GraphicsCore::Present(1, 0);
+		}, {}, { resContext }, se::TaskGraph::TASK_FLAG_MAIN_THREAD);
+	}
+
+	frameGraph.Compile();
+
+	// 描画スレッド
+	RenderThreadRunner renderRunner([&](FramePacket& packet) {
+		auto& context = se::GraphicsCore::GetImmediateContext();
+		renderFrame(packet);
+		{
+			seGpuPerfScope(context, 0, "imgui");
+			se::ImGuiRenderSnapshot(packet.imgui);
 		}
+		{
+			se::ScopedLock<se::Mutex> lock(gpuProfilerLock);
+			se::GPUProfiler::Get().EndFrameProfiling(context);
+		}
+		se::GraphicsCore::Present(1, 0);
+	});
+	se::Thread renderThread;
+	if (pipelined) {
+		renderThread.Create(&renderRunner, "RenderThread");
+		renderThread.SetPriority(se::ThreadPriority::AboveNormal);
+		// ワーカーと同じコアを避ける
+		auto freeProcessors = se::JobSystem::Get().GetFreeProcessors();
+		if (!freeProcessors.empty()) {
+			renderThread.SetAffinity(freeProcessors.data(), static_cast<uint32_t>(freeProcessors.size()));
+		}
+	}
+
+	// メインループ
+	MSG msg = { 0 };
+	while (se::Window::IsAlive()) {
+		// 非同期タスクのメインスレッド側の継続
+		se::TaskScheduler::Get().Update(2.0);
+
+		if(!se::Window::IsMinimized()) {
+			if (pipelined) {
+				// 描画スレッドが1フレーム以上遅れていればここで待つ
+				currentPacket = framePipeline.BeginWrite();
+				if (!currentPacket) {
+					break;
+				}
+				// パケットが空いた時点で、それを読んだフレームのアリーナも使い終わっている
+				se::GlobalFrameArena::Get().BeginFrame();
+				frameGraph.Execute();
+				framePipeline.EndWrite();
+			} else {
+				se::GlobalFrameArena::Get().BeginFrame();
+				frameGraph.Execute();
+			}
+		}
+		se::MemoryTracker::Get().EndFrame();
 		se::Window::MessageLoop(msg);
 	}
 
+	if (pipelined) {
+		renderThread.Kill(true);
+	}
+	frameGraph.Clear();
+	se::GlobalFrameArena::Get().Release();
 	se::GraphicsCore::Finalize();
+	se::Sequences::Get().Finalize();
+	se::IOService::Get().Finalize();
+	se::JobSystem::Get().Finalize();
     return (int) msg.wParam;
 }
@@ -0,0 +1,244 @@
+﻿#include "UnitTest.h"
+#include "se/Math/FastMath.h"
+#include <math.h>
+#include <vector>
+#include <random>
+#include <type_traits>
+
+/**
+ * FastMath.hのテストとベンチマーク
+ * 各関数・各精度について、doubleのlibmとの誤差を標本で測り、FastMath.hのコメントの上限以内か確かめる
+ * 続けて同じ関数をlibm(float版)と速さを比べる
+ */
+namespace {
+	using namespace se;
+	using fastmath::Precision;
+
+	const int SAMPLE_NUM = 2000000;
+
+	// FastMath.hのコメントにある上限(Low, Medium, High)
+	struct Bound
+	{
+		const char* name;
+		bool relative;
+		double bound[3];
+	};
+	const Bound SQRT_BOUND = { "Sqrt", true, { 3.7e-4, 3.0e-7, 6.0e-8 } };
+	const Bound RSQRT_BOUND = { "Rsqrt", true, { 3.7e-4, 2.8e-7, 9.0e-8 } };
+	const Bound EXP_BOUND = { "Exp", true, { 1.1e-4, 3.0e-6, 1.2e-7 } };
+	const Bound SIN_BOUND = { "Sin", false, { 1.4e-4, 1.3e-6, 2.4e-7 } };
+	const Bound COS_BOUND = { "Cos", false, { 8.5e-6, 3.1e-7, 2.8e-7 } };
+	const Bound ATAN2_BOUND = { "Atan2", false, { 2.1e-4, 8.6e-7, 3.0e-7 } };
+
+	const char* GetPrecisionName(Precision p)
+	{
+		return p == Precision::Low ? "Low" : (p == Precision::Medium ? "Medium" : "High");
+	}
+
+	/**
+	 * 入力を4個ずつfuncに渡して、referenceとの最大誤差を返す
+	 * 正確さの基準はdoubleで計算した値を使う
+	 */
+	template<class Input, class Func, class Reference>
+	double MeasureError(bool relative, Input input, Func func, Reference reference)
+	{
+		double maxError = 0.0;
+		for (int i = 0; i < SAMPLE_NUM; i += 4) {
+			float a[4], b[4], result[4];
+			for (int j = 0; j < 4; j++) {
+				input(i + j, &a[j], &b[j]);
+			}
+			simd::StoreFloat4(result, func(simd::LoadFloat4(a), simd::LoadFloat4(b)));
+			for (int j = 0; j < 4; j++) {
+				double expected = reference(a[j], b[j]);
+				double error = fabs(static_cast<double>(result[j]) - expected);
+				if (relative && expected != 0.0) {
+					error /= fabs(expected);
+				}
+				maxError = (std::max)(maxError, error);
+			}
+		}
+		return maxError;
+	}
+
+	void CheckBound(const Bound& bound, Precision p, double error)
+	{
+		double limit = bound.bound[static_cast<int>(p)];
+		printf("  %-6s %-6s %s error %.3e (documented %.1e)\n", bound.name, GetPrecisionName(p), bound.relative ? "rel" : "abs", error, limit);
+		SE_CHECK_MSG(error <= limit, "%s %s: error %.3e exceeds %.1e", bound.name, GetPrecisionName(p), error, limit);
+	}
+
+	// 標本の入力、一様乱数と区間の等分を交互に使う
+	class Sampler
+	{
+	private:
+		std::mt19937 random_;
+		float min_;
+		float max_;
+
+	public:
+		Sampler(float min, float max, uint32_t seed)
+			: random_(seed)
+			, min_(min)
+			, max_(max)
+		{
+		}
+
+		float Get(int index)
+		{
+			if (index & 1) {
+				return std::uniform_real_distribution<float>(min_, max_)(random_);
+			}
+			return min_ + (max_ - min_) * (static_cast<float>(index) / SAMPLE_NUM);
+		}
+	};
+
+	// 2^-60～2^60で指数を一様にする
+	float GetPositiveSample(std::mt19937& random)
+	{
+		float exponent = std::uniform_real_distribution<float>(-60.0f, 60.0f)(random);
+		return static_cast<float>(exp2(exponent));
+	}
+
+	template<Precision P>
+	void TestPrecision()
+	{
+		std::mt19937 random(static_cast<uint32_t>(P) + 1);
+
+		auto positive = [&](int, float* a, float* b) { *a = GetPositiveSample(random); *b = 0.0f; };
+		CheckBound(SQRT_BOUND, P, MeasureError(true, positive,
+			[](simd::Vector v, simd::Vector) { return fastmath::Sqrt<P>(v); },
+			[](float v, float) { return sqrt(static_cast<double>(v)); }));
+		CheckBound(RSQRT_BOUND, P, MeasureError(true, positive,
+			[](simd::Vector v, simd::Vector) { return fastmath::Rsqrt<P>(v); },
+			[](float v, float) { return 1.0 / sqrt(static_cast<double>(v)); }));
+		// 0のsqrtは0
+		SE_CHECK(fastmath::Sqrt<P>(0.0f) == 0.0f);
+
+		Sampler expSampler(-87.3f, 88.3f, 10);
+		CheckBound(EXP_BOUND, P, MeasureError(true, [&](int i, float* a, float* b) { *a = expSampler.Get(i); *b = 0.0f; },
+			[](simd::Vector x, simd::Vector) { return fastmath::Exp<P>(x); },
+			[](float x, float) { return exp(static_cast<double>(x)); }));
+
+		Sampler angleSampler(-1000.0f, 1000.0f, 20);
+		auto angle = [&](int i, float* a, float* b) { *a = angleSampler.Get(i); *b = 0.0f; };
+		CheckBound(SIN_BOUND, P, MeasureError(false, angle,
+			[](simd::Vector x, simd::Vector) { return fastmath::Sin<P>(x); },
+			[](float x, float) { return sin(static_cast<double>(x)); }));
+		CheckBound(COS_BOUND, P, MeasureError(false, angle,
+			[](simd::Vector x, simd::Vector) { return fastmath::Cos<P>(x); },
+			[](float x, float) { return cos(static_cast<double>(x)); }));
+
+		// SinCosはSin/Cosと同じ値
+		simd::Vector s, c;
+		fastmath::SinCos<P>(simd::Set(0.5f, -2.0f, 100.0f, -999.0f), &s, &c);
+		float sinResult[4], cosResult[4];
+		simd::StoreFloat4(sinResult, s);
+		simd::StoreFloat4(cosResult, c);
+		SE_CHECK(sinResult[2] == fastmath::Sin<P>(100.0f) && cosResult[3] == fastmath::Cos<P>(-999.0f));
+
+		// 様々な大きさのベクトルの角度
+		auto direction = [&](int, float* y, float* x) {
+			std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+			float scale = GetPositiveSample(random);
+			*y = dist(random) * scale;
+			*x = dist(random) * scale;
+		};
+		CheckBound(ATAN2_BOUND, P, MeasureError(false, direction,
+			[](simd::Vector y, simd::Vector x) { return fastmath::Atan2<P>(y, x); },
+			[](float y, float x) { return atan2(static_cast<double>(y), static_cast<double>(x)); }));
+		SE_CHECK(fastmath::Atan2<P>(0.0f, 0.0f) == 0.0f);
+		SE_CHECK(fabsf(fastmath::Atan2<P>(0.0f, -1.0f) - 3.14159265f) <= 1e-6f);
+	}
+
+	/* ベンチマーク */
+
+	const int BENCH_COUNT = 4096;
+	const int BENCH_REPEAT = 1000;
+
+	template<class Func>
+	double Time(Func func)
+	{
+		func();
+		se::test::Timer timer;
+		for (int i = 0; i < BENCH_REPEAT; i++) {
+			func();
+		}
+		return timer.GetSeconds() * 1e9 / (static_cast<double>(BENCH_REPEAT) * BENCH_COUNT);
+	}
+
+	// fastの第1引数で精度を渡す
+	template<Precision P>
+	using PrecisionTag = std::integral_constant<Precision, P>;
+
+	template<class Tag, class FastFunc>
+	void CompareTier(Tag tag, const std::vector<float>& a, const std::vector<float>& b, std::vector<float>& out, FastFunc fast, double libmTime)
+	{
+		double fastTime = Time([&]() {
+			for (int i = 0; i < BENCH_COUNT; i += 4) {
+				simd::StoreFloat4(&out[i], fast(tag, simd::LoadFloat4(&a[i]), simd::LoadFloat4(&b[i])));
+			}
+			se::test::DoNotOptimize(out[BENCH_COUNT - 1]);
+		});
+		printf("  %s %5.2f ns (x%.1f)", GetPrecisionName(Tag::value), fastTime, libmTime / fastTime);
+	}
+
+	// 4要素ずつのfastmathと、1要素ずつのlibmを比べる
+	template<class FastFunc, class LibmFunc>
+	void Compare(const char* name, const std::vector<float>& a, const std::vector<float>& b, std::vector<float>& out, FastFunc fast, LibmFunc libm)
+	{
+		double libmTime = Time([&]() {
+			for (int i = 0; i < BENCH_COUNT; i++) {
+				out[i] = libm(a[i], b[i]);
+			}
+			se::test::DoNotOptimize(out[BENCH_COUNT - 1]);
+		});
+		printf("  %-6s libm %6.2f ns", name, libmTime);
+		CompareTier(PrecisionTag<Precision::Low>(), a, b, out, fast, libmTime);
+		CompareTier(PrecisionTag<Precision::Medium>(), a, b, out, fast, libmTime);
+		CompareTier(PrecisionTag<Precision::High>(), a, b, out, fast, libmTime);
+		printf("\n");
+	}
+
+	void Benchmark()
+	{
+		std::mt19937 random(99);
+		std::uniform_real_distribution<float> dist(-10.0f, 10.0f);
+		std::vector<float> a(BENCH_COUNT), b(BENCH_COUNT), positive(BENCH_COUNT), out(BENCH_COUNT);
+		for (int i = 0; i < BENCH_COUNT; i++) {
+			a[i] = dist(random);
+			b[i] = dist(random);
+			positive[i] = fabsf(a[i]) + 0.01f;
+		}
+
+		printf("per element (%s)\n", SE_SIMD_BACKEND_NAME);
+		Compare("Sqrt", positive, b, out,
+			[](auto p, simd::Vector v, simd::Vector) { return fastmath::Sqrt<decltype(p)::value>(v); },
+			[](float v, float) { return sqrtf(v); });
+		Compare("Rsqrt", positive, b, out,
+			[](auto p, simd::Vector v, simd::Vector) { return fastmath::Rsqrt<decltype(p)::value>(v); },
+			[](float v, float) { return 1.0f / sqrtf(v); });
+		Compare("Exp", a, b, out,
+			[](auto p, simd::Vector x, simd::Vector) { return fastmath::Exp<decltype(p)::value>(x); },
+			[](float x, float) { return expf(x); });
+		Compare("Sin", a, b, out,
+			[](auto p, simd::Vector x, simd::Vector) { return fastmath::Sin<decltype(p)::value>(x); },
+			[](float x, float) { return sinf(x); });
+		Compare("Cos", a, b, out,
+			[](auto p, simd::Vector x, simd::Vector) { return fastmath::Cos<decltype(p)::value>(x); },
+			[](float x, float) { return cosf(x); });
+		Compare("Atan2", a, b, out,
+			[](auto p, simd::Vector y, simd::Vector x) { return fastmath::Atan2<decltype(p)::value>(y, x); },
+			[](float y, float x) { return atan2f(y, x); });
+	}
+}
+
+int main()
+{
+	printf("error (%d samples, %s)\n", SAMPLE_NUM, SE_SIMD_BACKEND_NAME);
+	TestPrecision<Precision::Low>();
+	TestPrecision<Precision::Medium>();
+	TestPrecision<Precision::High>();
+	Benchmark();
+	return se::test::Finish("FastMathTest");
+}
@@ -0,0 +1,142 @@
+﻿#include "UnitTest.h"
+#include "se/Math/Frustum.h"
+#include <vector>
+#include <random>
+
+/**
+ * Frustum::CullAABBsのテストとベンチマーク
+ * ランダムなボックスでIntersects(const AABB&)と結果が一致することを確かめ、1秒あたりの判定数を比べる
+ */
+namespace {
+	using namespace se;
+
+	struct Boxes
+	{
+		std::vector<AABB> boxes;
+		std::vector<float> soa[6];
+
+		AABBSoA GetSoA()
+		{
+			AABBSoA result = { soa[0].data(), soa[1].data(), soa[2].data(), soa[3].data(), soa[4].data(), soa[5].data() };
+			return result;
+		}
+	};
+
+	// Intersectsと同じ値になるよう、SoAには各ボックスのGetCenter/GetExtentを入れる
+	void MakeRandomBoxes(Boxes& out, uint32_t count, uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+		std::uniform_real_distribution<float> size(0.0f, 10.0f);
+		out.boxes.resize(count);
+		for (auto& v : out.soa) {
+			v.resize(count);
+		}
+		for (uint32_t i = 0; i < count; i++) {
+			float3 minPos(position(random), position(random), position(random));
+			float3 maxPos(minPos.x + size(random), minPos.y + size(random), minPos.z + size(random));
+			AABB box(minPos, maxPos);
+			float3 center = box.GetCenter();
+			float3 extent = box.GetExtent();
+			out.boxes[i] = box;
+			out.soa[0][i] = center.x;
+			out.soa[1][i] = center.y;
+			out.soa[2][i] = center.z;
+			out.soa[3][i] = extent.x;
+			out.soa[4][i] = extent.y;
+			out.soa[5][i] = extent.z;
+		}
+	}
+
+	Frustum MakeFrustum()
+	{
+		Matrix4x4 view = Matrix4x4::LookAtRH(float3(0.0f, 10.0f, 50.0f), float3(0.0f), float3(0.0f, 1.0f, 0.0f));
+		Matrix4x4 projection = Matrix4x4::PerspectiveFovRH(DegreeToRadian(60.0f), 16.0f / 9.0f, 0.1f, 150.0f);
+		return Frustum(view * projection);
+	}
+
+	void TestMatchesIntersects(uint32_t count, uint32_t seed)
+	{
+		Frustum frustum = MakeFrustum();
+		Boxes boxes;
+		MakeRandomBoxes(boxes, count, seed);
+
+		std::vector<uint32_t> expected;
+		for (uint32_t i = 0; i < count; i++) {
+			if (frustum.Intersects(boxes.boxes[i])) {
+				expected.push_back(i);
+			}
+		}
+
+		std::vector<uint32_t> visible(count + 1, 0xffffffff);
+		uint32_t visibleNum = frustum.CullAABBs(boxes.GetSoA(), count, visible.data());
+		SE_CHECK_MSG(visibleNum == expected.size(), "count %u: %u visible, expected %zu", count, visibleNum, expected.size());
+		for (uint32_t i = 0; i < visibleNum && i < expected.size(); i++) {
+			if (visible[i] != expected[i]) {
+				SE_CHECK_MSG(visible[i] == expected[i], "count %u: visible[%u] = %u, expected %u", count, i, visible[i], expected[i]);
+				break;
+			}
+		}
+		// count個より先には書かない
+		SE_CHECK(visible[count] == 0xffffffff);
+		if (count == 10007) {
+			printf("  %u boxes: %u/%zu visible boxes match\n", count, visibleNum, expected.size());
+		}
+	}
+
+	void TestKnownBoxes()
+	{
+		Frustum frustum = MakeFrustum();
+		// 原点付近は見えて、カメラの後ろと遠平面より先は見えない
+		SE_CHECK(frustum.Intersects(AABB(float3(-1.0f), float3(1.0f))));
+		SE_CHECK(!frustum.Intersects(AABB(float3(-1.0f, 9.0f, 60.0f), float3(1.0f, 11.0f, 62.0f))));
+		SE_CHECK(!frustum.Intersects(AABB(float3(-1.0f, -1.0f, -200.0f), float3(1.0f, 1.0f, -198.0f))));
+		// 近平面をまたぐもの
+		SE_CHECK(frustum.Intersects(AABB(float3(-1.0f, 9.0f, 49.0f), float3(1.0f, 11.0f, 51.0f))));
+	}
+
+	void Benchmark()
+	{
+		const uint32_t COUNT = 100000;
+		const int REPEAT = 200;
+		Frustum frustum = MakeFrustum();
+		Boxes boxes;
+		MakeRandomBoxes(boxes, COUNT, 12345);
+		std::vector<uint32_t> visible(COUNT);
+
+		uint32_t visibleNum = 0;
+		se::test::Timer batchTimer;
+		for (int r = 0; r < REPEAT; r++) {
+			visibleNum = frustum.CullAABBs(boxes.GetSoA(), COUNT, visible.data());
+			se::test::DoNotOptimize(visibleNum);
+		}
+		double batchSeconds = batchTimer.GetSeconds();
+
+		se::test::Timer singleTimer;
+		for (int r = 0; r < REPEAT; r++) {
+			uint32_t num = 0;
+			for (uint32_t i = 0; i < COUNT; i++) {
+				visible[num] = i;
+				num += frustum.Intersects(boxes.boxes[i]) ? 1 : 0;
+			}
+			se::test::DoNotOptimize(num);
+		}
+		double singleSeconds = singleTimer.GetSeconds();
+
+		double total = static_cast<double>(COUNT) * REPEAT;
+		printf("  CullAABBs (%s): %8.1f M boxes/s\n", simd::IsAVX2Supported() ? "AVX2" : SE_SIMD_BACKEND_NAME, total / batchSeconds * 1e-6);
+		printf("  Intersects per box: %8.1f M boxes/s (x%.1f)\n", total / singleSeconds * 1e-6, singleSeconds / batchSeconds);
+		printf("  %u/%u visible\n", visibleNum, COUNT);
+	}
+}
+
+int main()
+{
+	TestKnownBoxes();
+	const uint32_t counts[] = { 0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 1000, 10007 };
+	for (uint32_t count : counts) {
+		TestMatchesIntersects(count, count + 1);
+	}
+	Benchmark();
+	return se::test::Finish("FrustumTest");
+}
@@ -0,0 +1,411 @@
+﻿#include "UnitTest.h"
+#include "se/Math/Packing.h"
+#include <math.h>
+#include <float.h>
+#include <string.h>
+#include <vector>
+#include <random>
+
+/**
+ * Packing.hのテストとベンチマーク
+ * 半精度の全値と、floatのビット列を7刻みで網羅して、1要素版と配列版(F16Cなど)と参照実装が一致することを確かめる
+ * 正規化整数は全値が往復で元に戻ること、八面体マッピングは角度の誤差が上限以内であることを確かめる
+ */
+namespace {
+	using namespace se;
+
+	float BitsToFloat(uint32_t bits)
+	{
+		float f;
+		memcpy(&f, &bits, sizeof(f));
+		return f;
+	}
+
+	bool IsHalfNaN(uint16_t h)
+	{
+		return (h & 0x7c00) == 0x7c00 && (h & 0x03ff) != 0;
+	}
+
+	// 参照実装: doubleで計算してから最近接偶数丸め
+	uint16_t ReferenceFloatToHalf(float f)
+	{
+		uint16_t sign = signbit(f) ? 0x8000 : 0;
+		if (isnan(f)) {
+			return sign | 0x7e00;
+		}
+		if (isinf(f)) {
+			return sign | 0x7c00;
+		}
+		double a = fabs(static_cast<double>(f));
+		if (a < ldexp(1.0, -14)) {
+			// 非正規化数(丸めで最小の正規化数になる場合もそのまま繋がる)
+			return sign | static_cast<uint16_t>(nearbyint(a * ldexp(1.0, 24)));
+		}
+		int exponent;
+		double mantissa = frexp(a, &exponent);		// [0.5, 1)
+		exponent -= 1;
+		double fraction = nearbyint((mantissa * 2.0 - 1.0) * 1024.0);
+		if (fraction == 1024.0) {
+			fraction = 0.0;
+			exponent++;
+		}
+		if (exponent + 15 >= 31) {
+			return sign | 0x7c00;
+		}
+		return sign | static_cast<uint16_t>(((exponent + 15) << 10) | static_cast<int>(fraction));
+	}
+
+	double ReferenceHalfToFloat(uint16_t h)
+	{
+		double sign = (h & 0x8000) ? -1.0 : 1.0;
+		int exponent = (h >> 10) & 0x1f;
+		int fraction = h & 0x3ff;
+		if (exponent == 0) {
+			return sign * ldexp(fraction, -24);
+		}
+		if (exponent == 31) {
+			return fraction == 0 ? sign * INFINITY : NAN;
+		}
+		return sign * ldexp(1024 + fraction, exponent - 25);
+	}
+
+	// 半精度の全65536値
+	void TestHalfExhaustive()
+	{
+		const uint32_t num = 65536;
+		std::vector<uint16_t> halfs(num);
+		std::vector<float> floats(num);
+		std::vector<uint16_t> roundTrip(num);
+		for (uint32_t i = 0; i < num; i++) {
+			halfs[i] = static_cast<uint16_t>(i);
+		}
+		packing::HalfToFloat(halfs.data(), floats.data(), num);
+		packing::FloatToHalf(floats.data(), roundTrip.data(), num);
+
+		uint32_t failures = 0;
+		for (uint32_t i = 0; i < num && failures < 10; i++) {
+			uint16_t h = halfs[i];
+			float scalar = packing::HalfToFloat(h);
+			if (IsHalfNaN(h)) {
+				bool ok = isnan(scalar) && isnan(floats[i]) && IsHalfNaN(packing::FloatToHalf(scalar)) && IsHalfNaN(roundTrip[i]);
+				SE_CHECK_MSG(ok, "NaN 0x%04x", h);
+				failures += ok ? 0 : 1;
+				continue;
+			}
+			bool ok = memcmp(&scalar, &floats[i], sizeof(float)) == 0
+				&& static_cast<double>(scalar) == ReferenceHalfToFloat(h)
+				&& signbit(scalar) == ((h & 0x8000) != 0)
+				&& packing::FloatToHalf(scalar) == h
+				&& roundTrip[i] == h;
+			SE_CHECK_MSG(ok, "0x%04x: scalar %.9g array %.9g round trip 0x%04x 0x%04x", h, scalar, floats[i], packing::FloatToHalf(scalar), roundTrip[i]);
+			failures += ok ? 0 : 1;
+		}
+	}
+
+	// floatのビット列を7刻みで全域(約6億個)、7は2のべき乗と互いに素なので指数と仮数の全ての下位ビットを通る
+	void TestFloatSweep()
+	{
+		const uint32_t block = 4096;
+		std::vector<float> floats(block);
+		std::vector<uint16_t> halfs(block);
+		uint32_t failures = 0;
+		uint64_t bits = 0;
+		uint64_t checked = 0;
+		while (bits <= 0xffffffffull && failures < 10) {
+			uint32_t num = 0;
+			for (; num < block && bits <= 0xffffffffull; num++, bits += 7) {
+				floats[num] = BitsToFloat(static_cast<uint32_t>(bits));
+			}
+			packing::FloatToHalf(floats.data(), halfs.data(), num);
+			for (uint32_t i = 0; i < num; i++) {
+				float f = floats[i];
+				uint16_t scalar = packing::FloatToHalf(f);
+				uint16_t expected = ReferenceFloatToHalf(f);
+				bool ok = isnan(f) ? (IsHalfNaN(scalar) && IsHalfNaN(halfs[i])) : (scalar == expected && halfs[i] == expected);
+				if (!ok) {
+					uint32_t fbits;
+					memcpy(&fbits, &f, sizeof(f));
+					SE_CHECK_MSG(ok, "0x%08x (%.9g): scalar 0x%04x array 0x%04x expected 0x%04x", fbits, f, scalar, halfs[i], expected);
+					failures++;
+				}
+			}
+			checked += num;
+		}
+		printf("  float sweep: %llu values\n", static_cast<unsigned long long>(checked));
+	}
+
+	// 正規化整数は全ての値が往復で元に戻る
+	void TestNormRoundTrip()
+	{
+		{
+			std::vector<uint8_t> values(256), result(256);
+			std::vector<float> floats(256);
+			for (uint32_t i = 0; i < 256; i++) {
+				values[i] = static_cast<uint8_t>(i);
+			}
+			packing::UNorm8ToFloat(values.data(), floats.data(), 256);
+			packing::FloatToUNorm8(floats.data(), result.data(), 256);
+			SE_CHECK(values == result);
+			SE_CHECK(floats[0] == 0.0f && floats[255] == 1.0f);
+			// 1/255を掛けるので、割り算との差は1ULPまで
+			for (uint32_t i = 0; i < 256; i++) {
+				float expected = static_cast<float>(i) / 255.0f;
+				SE_CHECK_MSG(fabsf(floats[i] - expected) <= expected * FLT_EPSILON, "unorm8 %u -> %.9g", i, floats[i]);
+			}
+		}
+		{
+			std::vector<uint16_t> values(65536), result(65536);
+			std::vector<float> floats(65536);
+			for (uint32_t i = 0; i < 65536; i++) {
+				values[i] = static_cast<uint16_t>(i);
+			}
+			packing::UNorm16ToFloat(values.data(), floats.data(), 65536);
+			packing::FloatToUNorm16(floats.data(), result.data(), 65536);
+			SE_CHECK(values == result);
+			SE_CHECK(floats[0] == 0.0f && floats[65535] == 1.0f);
+		}
+		{
+			std::vector<int8_t> values(256), result(256);
+			std::vector<float> floats(256);
+			for (uint32_t i = 0; i < 256; i++) {
+				values[i] = static_cast<int8_t>(static_cast<int32_t>(i) - 128);
+			}
+			packing::SNorm8ToFloat(values.data(), floats.data(), 256);
+			packing::FloatToSNorm8(floats.data(), result.data(), 256);
+			// -128は-1.0になり、-127に戻る
+			SE_CHECK(floats[0] == -1.0f && floats[1] == -1.0f);
+			SE_CHECK(result[0] == -127);
+			SE_CHECK(floats[128] == 0.0f && floats[255] == 1.0f);
+			for (uint32_t i = 1; i < 256; i++) {
+				SE_CHECK_MSG(result[i] == values[i], "snorm8 %d -> %.9g -> %d", values[i], floats[i], result[i]);
+			}
+		}
+		{
+			std::vector<int16_t> values(65536), result(65536);
+			std::vector<float> floats(65536);
+			for (uint32_t i = 0; i < 65536; i++) {
+				values[i] = static_cast<int16_t>(static_cast<int32_t>(i) - 32768);
+			}
+			packing::SNorm16ToFloat(values.data(), floats.data(), 65536);
+			packing::FloatToSNorm16(floats.data(), result.data(), 65536);
+			SE_CHECK(floats[0] == -1.0f && floats[1] == -1.0f);
+			SE_CHECK(result[0] == -32767);
+			SE_CHECK(floats[32768] == 0.0f && floats[65535] == 1.0f);
+			uint32_t mismatch = 0;
+			for (uint32_t i = 1; i < 65536; i++) {
+				mismatch += (result[i] != values[i]) ? 1 : 0;
+			}
+			SE_CHECK_MSG(mismatch == 0, "snorm16: %u values do not round trip", mismatch);
+		}
+
+		// 範囲外とNaNは飽和させる
+		const float edges[] = { -2.0f, 2.0f, NAN, INFINITY, -INFINITY, 0.5f, -0.5f };
+		uint8_t unorm[7];
+		int8_t snorm[7];
+		packing::FloatToUNorm8(edges, unorm, 7);
+		packing::FloatToSNorm8(edges, snorm, 7);
+		SE_CHECK(unorm[0] == 0 && unorm[1] == 255 && unorm[2] == 0 && unorm[3] == 255 && unorm[4] == 0 && unorm[5] == 128);
+		SE_CHECK(snorm[0] == -127 && snorm[1] == 127 && snorm[2] == 0 && snorm[3] == 127 && snorm[4] == -127 && snorm[5] == 64 && snorm[6] == -64);
+	}
+
+	// 詰めた形式は全てのビット列が往復で元に戻る(SNORMの-128を除く)
+	void TestPackRoundTrip()
+	{
+		std::mt19937 random(7);
+		const uint32_t num = 100003;
+		std::vector<uint32_t> packed(num), repacked(num);
+		std::vector<Vector4> vectors(num);
+		for (auto& p : packed) {
+			p = random();
+		}
+
+		packing::UnpackR8G8B8A8UNorm(packed.data(), vectors.data(), num);
+		packing::PackR8G8B8A8UNorm(vectors.data(), repacked.data(), num);
+		SE_CHECK(packed == repacked);
+
+		packing::UnpackR10G10B10A2UNorm(packed.data(), vectors.data(), num);
+		packing::PackR10G10B10A2UNorm(vectors.data(), repacked.data(), num);
+		SE_CHECK(packed == repacked);
+
+		packing::UnpackR8G8B8A8SNorm(packed.data(), vectors.data(), num);
+		packing::PackR8G8B8A8SNorm(vectors.data(), repacked.data(), num);
+		uint32_t mismatch = 0;
+		for (uint32_t i = 0; i < num; i++) {
+			uint32_t expected = packed[i];
+			for (int c = 0; c < 4; c++) {
+				if (((expected >> (c * 8)) & 0xff) == 0x80) {
+					expected = (expected & ~(0xffu << (c * 8))) | (0x81u << (c * 8));
+				}
+			}
+			mismatch += (repacked[i] != expected) ? 1 : 0;
+		}
+		SE_CHECK_MSG(mismatch == 0, "R8G8B8A8_SNORM: %u values do not round trip", mismatch);
+
+		Vector4 v;
+		uint32_t minimum = 0x80808080u;
+		packing::UnpackR8G8B8A8SNorm(&minimum, &v, 1);
+		SE_CHECK(v.x == -1.0f && v.y == -1.0f && v.z == -1.0f && v.w == -1.0f);
+		uint32_t order = 0x04030201u;
+		packing::UnpackR8G8B8A8UNorm(&order, &v, 1);
+		SE_CHECK(v.x == 1.0f / 255.0f && v.w == 4.0f / 255.0f);
+	}
+
+	double AngleDegrees(const Vector3& a, const Vector3& b)
+	{
+		double dot = static_cast<double>(a.x) * b.x + static_cast<double>(a.y) * b.y + static_cast<double>(a.z) * b.z;
+		double la = sqrt(static_cast<double>(a.x) * a.x + static_cast<double>(a.y) * a.y + static_cast<double>(a.z) * a.z);
+		double lb = sqrt(static_cast<double>(b.x) * b.x + static_cast<double>(b.y) * b.y + static_cast<double>(b.z) * b.z);
+		double c = dot / (la * lb);
+		return acos(c > 1.0 ? 1.0 : (c < -1.0 ? -1.0 : c)) * 180.0 / 3.14159265358979323846;
+	}
+
+	// Packing.hのコメントにある上限
+	const double OCTAHEDRAL_SNORM16_MAX_DEGREES = 0.005;
+
+	void TestOctahedral()
+	{
+		std::mt19937 random(11);
+		std::normal_distribution<float> dist;
+		const uint32_t num = 1000003;
+		std::vector<Vector3> normals(num), decoded(num), snormDecoded(num);
+		for (uint32_t i = 0; i < num; i++) {
+			Vector3 n(dist(random), dist(random), dist(random));
+			n.Normalize();
+			normals[i] = n;
+		}
+		// 軸と八面体の辺の上
+		const Vector3 special[] = {
+			Vector3(1.0f, 0.0f, 0.0f), Vector3(-1.0f, 0.0f, 0.0f), Vector3(0.0f, 1.0f, 0.0f), Vector3(0.0f, -1.0f, 0.0f),
+			Vector3(0.0f, 0.0f, 1.0f), Vector3(0.0f, 0.0f, -1.0f), Vector3(0.70710678f, 0.0f, -0.70710678f), Vector3(-0.70710678f, -0.70710678f, 0.0f),
+		};
+		for (uint32_t i = 0; i < 8; i++) {
+			normals[i] = special[i];
+		}
+
+		std::vector<Vector2> encoded(num);
+		std::vector<uint32_t> packed(num);
+		packing::EncodeOctahedral(normals.data(), encoded.data(), num);
+		packing::DecodeOctahedral(encoded.data(), decoded.data(), num);
+		packing::EncodeOctahedralSNorm16(normals.data(), packed.data(), num);
+		packing::DecodeOctahedralSNorm16(packed.data(), snormDecoded.data(), num);
+
+		double maxFloatError = 0.0;
+		double maxSNormError = 0.0;
+		bool inRange = true;
+		for (uint32_t i = 0; i < num; i++) {
+			maxFloatError = (std::max)(maxFloatError, AngleDegrees(normals[i], decoded[i]));
+			maxSNormError = (std::max)(maxSNormError, AngleDegrees(normals[i], snormDecoded[i]));
+			inRange = inRange && fabsf(encoded[i].x) <= 1.0f && fabsf(encoded[i].y) <= 1.0f;
+		}
+		printf("  octahedral: float %.2e deg, snorm16 %.2e deg (documented %.1e)\n", maxFloatError, maxSNormError, OCTAHEDRAL_SNORM16_MAX_DEGREES);
+		SE_CHECK(inRange);
+		SE_CHECK(maxFloatError <= 1e-3);
+		SE_CHECK(maxSNormError <= OCTAHEDRAL_SNORM16_MAX_DEGREES);
+
+		// 長さ0は(0, 0)になり、戻すと(0, 0, 1)
+		Vector3 zero(0.0f);
+		Vector2 zeroEncoded;
+		Vector3 zeroDecoded;
+		packing::EncodeOctahedral(&zero, &zeroEncoded, 1);
+		packing::DecodeOctahedral(&zeroEncoded, &zeroDecoded, 1);
+		SE_CHECK(zeroEncoded.x == 0.0f && zeroEncoded.y == 0.0f);
+		SE_CHECK(zeroDecoded.x == 0.0f && zeroDecoded.y == 0.0f && zeroDecoded.z == 1.0f);
+	}
+
+	/* ベンチマーク */
+
+	template<class Func>
+	void Run(const char* name, size_t count, Func func)
+	{
+		const int repeat = 100;
+		func();
+		se::test::Timer timer;
+		for (int i = 0; i < repeat; i++) {
+			func();
+		}
+		double seconds = timer.GetSeconds();
+		printf("  %-28s %8.1f M elements/s\n", name, static_cast<double>(count) * repeat / seconds * 1e-6);
+	}
+
+	void Benchmark()
+	{
+		const size_t count = 1 << 16;
+		std::mt19937 random(3);
+		std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+		std::vector<float> floats(count), floatOut(count);
+		std::vector<uint16_t> halfs(count), unorm16(count);
+		std::vector<int16_t> snorm16(count);
+		std::vector<uint8_t> unorm8(count);
+		std::vector<Vector4> colors(count);
+		std::vector<Vector3> normals(count);
+		std::vector<uint32_t> packed(count);
+		for (size_t i = 0; i < count; i++) {
+			floats[i] = dist(random) * 1000.0f;
+			colors[i] = Vector4(dist(random), dist(random), dist(random), dist(random));
+			Vector3 n(dist(random), dist(random), dist(random));
+			n.Normalize();
+			normals[i] = n;
+		}
+
+		printf("throughput (half: %s)\n", packing::GetHalfBackendName());
+		Run("FloatToHalf (array)", count, [&]() {
+			packing::FloatToHalf(floats.data(), halfs.data(), count);
+			se::test::DoNotOptimize(halfs[count - 1]);
+		});
+		Run("FloatToHalf (per element)", count, [&]() {
+			for (size_t i = 0; i < count; i++) {
+				halfs[i] = packing::FloatToHalf(floats[i]);
+			}
+			se::test::DoNotOptimize(halfs[count - 1]);
+		});
+		Run("HalfToFloat (array)", count, [&]() {
+			packing::HalfToFloat(halfs.data(), floatOut.data(), count);
+			se::test::DoNotOptimize(floatOut[count - 1]);
+		});
+		Run("HalfToFloat (per element)", count, [&]() {
+			for (size_t i = 0; i < count; i++) {
+				floatOut[i] = packing::HalfToFloat(halfs[i]);
+			}
+			se::test::DoNotOptimize(floatOut[count - 1]);
+		});
+		Run("FloatToUNorm8", count, [&]() {
+			packing::FloatToUNorm8(floats.data(), unorm8.data(), count);
+			se::test::DoNotOptimize(unorm8[count - 1]);
+		});
+		Run("FloatToSNorm16", count, [&]() {
+			packing::FloatToSNorm16(floats.data(), snorm16.data(), count);
+			se::test::DoNotOptimize(snorm16[count - 1]);
+		});
+		Run("UNorm16ToFloat", count, [&]() {
+			packing::UNorm16ToFloat(unorm16.data(), floatOut.data(), count);
+			se::test::DoNotOptimize(floatOut[count - 1]);
+		});
+		Run("PackR8G8B8A8UNorm", count, [&]() {
+			packing::PackR8G8B8A8UNorm(colors.data(), packed.data(), count);
+			se::test::DoNotOptimize(packed[count - 1]);
+		});
+		Run("UnpackR10G10B10A2UNorm", count, [&]() {
+			packing::UnpackR10G10B10A2UNorm(packed.data(), colors.data(), count);
+			se::test::DoNotOptimize(colors[count - 1].x);
+		});
+		Run("EncodeOctahedralSNorm16", count, [&]() {
+			packing::EncodeOctahedralSNorm16(normals.data(), packed.data(), count);
+			se::test::DoNotOptimize(packed[count - 1]);
+		});
+		Run("DecodeOctahedralSNorm16", count, [&]() {
+			packing::DecodeOctahedralSNorm16(packed.data(), normals.data(), count);
+			se::test::DoNotOptimize(normals[count - 1].x);
+		});
+	}
+}
+
+int main()
+{
+	TestHalfExhaustive();
+	TestFloatSweep();
+	TestNormRoundTrip();
+	TestPackRoundTrip();
+	TestOctahedral();
+	Benchmark();
+	return se::test::Finish("PackingTest");
+}
@@ -0,0 +1,207 @@
+﻿#include "UnitTest.h"
+#include "se/Memory/RingAllocator.h"
+#include <vector>
+#include <deque>
+#include <random>
+
+/**
+ * RingAllocatorのテスト
+ * 折り返し・満杯・空・フェンスの順不同な完了と、ランダムな操作で確保が重ならないことを確かめる
+ */
+namespace {
+	using se::RingAllocator;
+
+	void TestEmpty()
+	{
+		RingAllocator ring(256);
+		SE_CHECK(ring.Allocate(0) == RingAllocator::INVALID_OFFSET);
+		SE_CHECK(ring.Allocate(257) == RingAllocator::INVALID_OFFSET);
+		SE_CHECK(ring.GetUsedSize() == 0);
+
+		// 空のフレームを締めて完了させても状態は変わらない
+		ring.EndFrame(1);
+		ring.EndFrame(2);
+		ring.Retire(2);
+		SE_CHECK(ring.GetStats().pendingFrameNum == 0);
+		SE_CHECK(ring.Allocate(256) == 0);
+	}
+
+	void TestFull()
+	{
+		RingAllocator ring(256);
+		SE_CHECK(ring.Allocate(128) == 0);
+		SE_CHECK(ring.Allocate(128) == 128);
+		SE_CHECK(ring.Allocate(1) == RingAllocator::INVALID_OFFSET);
+		SE_CHECK(ring.GetUsedSize() == 256);
+		ring.EndFrame(1);
+		SE_CHECK(ring.Allocate(1) == RingAllocator::INVALID_OFFSET);
+		SE_CHECK(ring.GetStats().failedNum == 2);
+
+		ring.Retire(1);
+		SE_CHECK(ring.GetUsedSize() == 0);
+		SE_CHECK(ring.Allocate(256) == 0);
+	}
+
+	void TestWrap()
+	{
+		RingAllocator ring(256);
+		SE_CHECK(ring.Allocate(100) == 0);
+		ring.EndFrame(1);
+		SE_CHECK(ring.Allocate(100) == 100);
+		ring.EndFrame(2);
+		ring.Retire(1);
+
+		// 末尾の56byteに収まらないので先頭へ折り返す(末尾は捨てる)
+		SE_CHECK(ring.Allocate(64) == 0);
+		SE_CHECK(ring.GetUsedSize() == 100 + 56 + 64);
+		// [64, 100)しか空いていない
+		SE_CHECK(ring.Allocate(40) == RingAllocator::INVALID_OFFSET);
+		SE_CHECK(ring.Allocate(36) == 64);
+		ring.EndFrame(3);
+
+		ring.Retire(3);
+		SE_CHECK(ring.GetUsedSize() == 0);
+		SE_CHECK(ring.GetStats().pendingFrameNum == 0);
+	}
+
+	void TestAlignment()
+	{
+		RingAllocator ring(1024);
+		SE_CHECK(ring.Allocate(10) == 0);
+		SE_CHECK(ring.Allocate(10, 256) == 256);
+		SE_CHECK(ring.Allocate(10, 16) == 272);
+	}
+
+	void TestRetireOutOfOrder()
+	{
+		RingAllocator ring(300);
+		SE_CHECK(ring.Allocate(100) == 0);
+		ring.EndFrame(10);
+		SE_CHECK(ring.Allocate(100) == 100);
+		ring.EndFrame(20);
+		SE_CHECK(ring.Allocate(100) == 200);
+		ring.EndFrame(30);
+
+		// まとめて完了
+		ring.Retire(25);
+		SE_CHECK(ring.GetUsedSize() == 100);
+		SE_CHECK(ring.GetStats().pendingFrameNum == 1);
+		// 古いフェンスの完了は何もしない
+		ring.Retire(5);
+		ring.Retire(20);
+		SE_CHECK(ring.GetUsedSize() == 100);
+		SE_CHECK(ring.Allocate(200) == 0);
+		SE_CHECK(ring.Allocate(1) == RingAllocator::INVALID_OFFSET);
+	}
+
+	// 空のフレームが完了待ちのまま使用量が0になっても、古いtailで確保が重ならない
+	void TestIdleFramesPending()
+	{
+		RingAllocator ring(325);
+		SE_CHECK(ring.Allocate(78) == 0);
+		ring.EndFrame(1);
+		ring.EndFrame(2);		// 空のフレーム
+		ring.Retire(1);
+		SE_CHECK(ring.GetUsedSize() == 0);
+		SE_CHECK(ring.GetStats().pendingFrameNum == 1);
+
+		size_t a = ring.Allocate(93, 256);
+		SE_CHECK(a == 0);
+		size_t b = ring.Allocate(35);
+		SE_CHECK(b == 93);
+		ring.EndFrame(3);
+		ring.Retire(2);			// 空のフレームの完了でtailを戻さない
+		SE_CHECK(ring.GetUsedSize() == 128);
+		SE_CHECK(ring.Allocate(300) == RingAllocator::INVALID_OFFSET);
+		size_t c = ring.Allocate(197);
+		SE_CHECK(c == 128);
+		SE_CHECK(ring.Allocate(1) == RingAllocator::INVALID_OFFSET);
+	}
+
+	/**
+	 * ランダムな操作で確保が重ならないことを確かめる
+	 * バイトごとに使用中のフレームを記録して比較する
+	 */
+	void TestRandomNoOverlap(uint32_t seed, size_t ringSize)
+	{
+		struct Allocation
+		{
+			size_t offset;
+			size_t size;
+		};
+		struct Frame
+		{
+			uint64_t fence;
+			std::vector<Allocation> allocations;
+		};
+
+		RingAllocator ring(ringSize);
+		std::vector<uint8_t> owned(ringSize, 0);
+		std::deque<Frame> pending;
+		Frame current;
+		uint64_t fence = 0;
+		std::mt19937 random(seed);
+
+		auto release = [&](const Frame& frame) {
+			for (const auto& a : frame.allocations) {
+				for (size_t i = a.offset; i < a.offset + a.size; i++) {
+					owned[i] = 0;
+				}
+			}
+		};
+
+		for (int step = 0; step < 200000; step++) {
+			uint32_t op = random() % 16;
+			if (op < 10) {
+				size_t size = 1 + random() % (ringSize / 3);
+				size_t alignment = static_cast<size_t>(1) << (random() % 9);
+				size_t offset = ring.Allocate(size, alignment);
+				if (offset != RingAllocator::INVALID_OFFSET) {
+					SE_CHECK_MSG(offset % alignment == 0, "offset %zu alignment %zu", offset, alignment);
+					SE_CHECK_MSG(offset + size <= ringSize, "offset %zu size %zu", offset, size);
+					for (size_t i = offset; i < offset + size && i < ringSize; i++) {
+						if (owned[i]) {
+							SE_CHECK_MSG(!owned[i], "seed %u step %d: [%zu, +%zu) overlaps a live allocation", seed, step, offset, size);
+							return;
+						}
+						owned[i] = 1;
+					}
+					current.allocations.push_back(Allocation{ offset, size });
+				}
+			} else if (op < 13) {
+				current.fence = ++fence;
+				ring.EndFrame(current.fence);
+				pending.push_back(current);
+				current.allocations.clear();
+			} else if (!pending.empty()) {
+				// 完了待ちのうちいくつかを完了させる(0個もある)
+				size_t count = random() % (pending.size() + 1);
+				uint64_t completed = (count == 0) ? pending.front().fence - 1 : pending[count - 1].fence;
+				ring.Retire(completed);
+				for (size_t i = 0; i < count; i++) {
+					release(pending.front());
+					pending.pop_front();
+				}
+			}
+			SE_CHECK_MSG(ring.GetUsedSize() <= ringSize, "seed %u step %d: used %zu", seed, step, ring.GetUsedSize());
+			if (se::test::GetFailureCount() > 0) {
+				return;
+			}
+		}
+	}
+}
+
+int main()
+{
+	TestEmpty();
+	TestFull();
+	TestWrap();
+	TestAlignment();
+	TestRetireOutOfOrder();
+	TestIdleFramesPending();
+	for (uint32_t seed = 1; seed <= 8; seed++) {
+		TestRandomNoOverlap(seed, 325);
+		TestRandomNoOverlap(seed, 4096);
+	}
+	return se::test::Finish("RingAllocatorTest");
+}
@@ -0,0 +1,204 @@
+﻿#include "UnitTest.h"
+#include "se/Math/Math.h"
+#include "se/Math/MathBatch.h"
+#include <vector>
+#include <random>
+#include <string.h>
+
+#if defined(_WIN32)
+	#include <DirectXMath.h>
+#endif
+
+/**
+ * SIMDバックエンドのベンチマーク
+ * Math.hの主な演算を、素朴なスカラー実装(とWindowsではDirectXMath)と比べる
+ * バックエンドはコンパイル時に決まるので、SE_MATH_FORCE_SCALARの有無で2回ビルドして比べる
+ * 結果のハッシュも表示するので、バックエンド間でビット列が一致するかもそれで確かめられる
+ */
+namespace {
+	using namespace se;
+
+	const size_t COUNT = 4096;
+	const int REPEAT = 200;
+
+	uint32_t HashFloats(const void* data, size_t bytes)
+	{
+		// FNV-1a
+		const uint8_t* p = static_cast<const uint8_t*>(data);
+		uint32_t hash = 2166136261u;
+		for (size_t i = 0; i < bytes; i++) {
+			hash = (hash ^ p[i]) * 16777619u;
+		}
+		return hash;
+	}
+
+	template<class Func>
+	void Run(const char* name, Func func)
+	{
+		func();		// 温める
+		se::test::Timer timer;
+		for (int i = 0; i < REPEAT; i++) {
+			func();
+		}
+		double seconds = timer.GetSeconds();
+		printf("  %-36s %8.2f ns/op\n", name, seconds * 1e9 / (static_cast<double>(REPEAT) * COUNT));
+	}
+
+	// 比較用の素朴な実装
+	Matrix4x4 NaiveMultiply(const Matrix4x4& a, const Matrix4x4& b)
+	{
+		Matrix4x4 result;
+		for (int i = 0; i < 4; i++) {
+			for (int j = 0; j < 4; j++) {
+				result.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j] + a.m[i][3] * b.m[3][j];
+			}
+		}
+		return result;
+	}
+
+	Vector3 NaiveTransformCoord(const Vector3& v, const Matrix4x4& m)
+	{
+		float x = v.x * m._11 + v.y * m._21 + v.z * m._31 + m._41;
+		float y = v.x * m._12 + v.y * m._22 + v.z * m._32 + m._42;
+		float z = v.x * m._13 + v.y * m._23 + v.z * m._33 + m._43;
+		float w = v.x * m._14 + v.y * m._24 + v.z * m._34 + m._44;
+		return Vector3(x / w, y / w, z / w);
+	}
+
+	Vector3 NaiveNormalize(const Vector3& v)
+	{
+		float length = sqrtf(v.x * v.x + v.y * v.y + v.z * v.z);
+		return length > 0.0f ? Vector3(v.x / length, v.y / length, v.z / length) : Vector3(0.0f);
+	}
+}
+
+int main()
+{
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+	std::vector<Matrix4x4> matrices(COUNT), matrixResults(COUNT);
+	std::vector<Vector3> vectors(COUNT), vectorResults(COUNT);
+	std::vector<Quaternion> quaternions(COUNT);
+	for (size_t i = 0; i < COUNT; i++) {
+		Quaternion q = Quaternion::Normalize(Quaternion(dist(random), dist(random), dist(random), dist(random)));
+		Matrix4x4 m = q.ToFloat4x4();
+		m.SetTranslation(Vector3(dist(random), dist(random), dist(random)) * 10.0f);
+		matrices[i] = m;
+		quaternions[i] = q;
+		vectors[i] = Vector3(dist(random), dist(random), dist(random)) * 10.0f;
+	}
+	Matrix4x4 viewProjection = Matrix4x4::LookAtRH(Vector3(0.0f, 5.0f, 20.0f), Vector3(0.0f), Vector3(0.0f, 1.0f, 0.0f))
+		* Matrix4x4::PerspectiveFovRH(DegreeToRadian(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+
+	printf("SIMD backend: %s, batch: %s\n", SE_SIMD_BACKEND_NAME, batch::GetBackendName());
+
+	printf("Matrix4x4 multiply\n");
+	Run("Matrix4x4::operator*", [&]() {
+		for (size_t i = 0; i < COUNT; i++) {
+			matrixResults[i] = matrices[i] * viewProjection;
+		}
+		se::test::DoNotOptimize(matrixResults[COUNT - 1]._11);
+	});
+	uint32_t multiplyHash = HashFloats(matrixResults.data(), sizeof(Matrix4x4) * COUNT);
+	Run("batch::MultiplyMatrices", [&]() {
+		batch::MultiplyMatrices(matrices.data(), viewProjection, matrixResults.data(), COUNT);
+		se::test::DoNotOptimize(matrixResults[COUNT - 1]._11);
+	});
+	Run("naive scalar", [&]() {
+		for (size_t i = 0; i < COUNT; i++) {
+			matrixResults[i] = NaiveMultiply(matrices[i], viewProjection);
+		}
+		se::test::DoNotOptimize(matrixResults[COUNT - 1]._11);
+	});
+#if defined(_WIN32)
+	Run("DirectX::XMMatrixMultiply", [&]() {
+		DirectX::XMMATRIX b = DirectX::XMLoadFloat4x4(reinterpret_cast<const DirectX::XMFLOAT4X4*>(&viewProjection));
+		for (size_t i = 0; i < COUNT; i++) {
+			DirectX::XMMATRIX a = DirectX::XMLoadFloat4x4(reinterpret_cast<const DirectX::XMFLOAT4X4*>(&matrices[i]));
+			DirectX::XMStoreFloat4x4(reinterpret_cast<DirectX::XMFLOAT4X4*>(&matrixResults[i]), DirectX::XMMatrixMultiply(a, b));
+		}
+		se::test::DoNotOptimize(matrixResults[COUNT - 1]._11);
+	});
+#endif
+
+	printf("Vector3 transform coord\n");
+	Run("Vector3::Transform", [&]() {
+		for (size_t i = 0; i < COUNT; i++) {
+			vectorResults[i] = Vector3::Transform(vectors[i], viewProjection);
+		}
+		se::test::DoNotOptimize(vectorResults[COUNT - 1].x);
+	});
+	uint32_t transformHash = HashFloats(vectorResults.data(), sizeof(Vector3) * COUNT);
+	Run("batch::TransformPoints", [&]() {
+		batch::TransformPoints(vectors.data(), vectorResults.data(), COUNT, viewProjection);
+		se::test::DoNotOptimize(vectorResults[COUNT - 1].x);
+	});
+	Run("naive scalar", [&]() {
+		for (size_t i = 0; i < COUNT; i++) {
+			vectorResults[i] = NaiveTransformCoord(vectors[i], viewProjection);
+		}
+		se::test::DoNotOptimize(vectorResults[COUNT - 1].x);
+	});
+#if defined(_WIN32)
+	Run("DirectX::XMVector3TransformCoord", [&]() {
+		DirectX::XMMATRIX m = DirectX::XMLoadFloat4x4(reinterpret_cast<const DirectX::XMFLOAT4X4*>(&viewProjection));
+		for (size_t i = 0; i < COUNT; i++) {
+			DirectX::XMVECTOR v = DirectX::XMLoadFloat3(reinterpret_cast<const DirectX::XMFLOAT3*>(&vectors[i]));
+			DirectX::XMStoreFloat3(reinterpret_cast<DirectX::XMFLOAT3*>(&vectorResults[i]), DirectX::XMVector3TransformCoord(v, m));
+		}
+		se::test::DoNotOptimize(vectorResults[COUNT - 1].x);
+	});
+#endif
+
+	printf("Vector3 normalize\n");
+	Run("Vector3::Normalize", [&]() {
+		for (size_t i = 0; i < COUNT; i++) {
+			Vector3 v = vectors[i];
+			v.Normalize();
+			vectorResults[i] = v;
+		}
+		se::test::DoNotOptimize(vectorResults[COUNT - 1].x);
+	});
+	uint32_t normalizeHash = HashFloats(vectorResults.data(), sizeof(Vector3) * COUNT);
+	Run("batch::NormalizeVectors", [&]() {
+		batch::NormalizeVectors(vectors.data(), vectorResults.data(), COUNT);
+		se::test::DoNotOptimize(vectorResults[COUNT - 1].x);
+	});
+	Run("naive scalar", [&]() {
+		for (size_t i = 0; i < COUNT; i++) {
+			vectorResults[i] = NaiveNormalize(vectors[i]);
+		}
+		se::test::DoNotOptimize(vectorResults[COUNT - 1].x);
+	});
+#if defined(_WIN32)
+	Run("DirectX::XMVector3Normalize", [&]() {
+		for (size_t i = 0; i < COUNT; i++) {
+			DirectX::XMVECTOR v = DirectX::XMLoadFloat3(reinterpret_cast<const DirectX::XMFLOAT3*>(&vectors[i]));
+			DirectX::XMStoreFloat3(reinterpret_cast<DirectX::XMFLOAT3*>(&vectorResults[i]), DirectX::XMVector3Normalize(v));
+		}
+		se::test::DoNotOptimize(vectorResults[COUNT - 1].x);
+	});
+#endif
+
+	printf("Matrix4x4 invert / Quaternion\n");
+	Run("Matrix4x4::Invert", [&]() {
+		for (size_t i = 0; i < COUNT; i++) {
+			matrixResults[i] = Matrix4x4::Invert(matrices[i]);
+		}
+		se::test::DoNotOptimize(matrixResults[COUNT - 1]._11);
+	});
+	uint32_t invertHash = HashFloats(matrixResults.data(), sizeof(Matrix4x4) * COUNT);
+	Run("Quaternion::operator* + ToFloat4x4", [&]() {
+		for (size_t i = 0; i < COUNT; i++) {
+			matrixResults[i] = (quaternions[i] * quaternions[(i + 1) % COUNT]).ToFloat4x4();
+		}
+		se::test::DoNotOptimize(matrixResults[COUNT - 1]._11);
+	});
+	uint32_t quaternionHash = HashFloats(matrixResults.data(), sizeof(Matrix4x4) * COUNT);
+
+	// SE_MATH_FORCE_SCALARでビルドしたものと比べて、一致していればビット列が同じ
+	printf("result hash: multiply %08x transform %08x normalize %08x invert %08x quaternion %08x\n",
+		multiplyHash, transformHash, normalizeHash, invertHash, quaternionHash);
+	return 0;
+}
@@ -0,0 +1,177 @@
+﻿#include "UnitTest.h"
+#include "se/Math/Sequences.h"
+#include "se/async/JobSystem.h"
+#include "se/async/IOService.h"
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+
+/**
+ * Sequencesのテスト
+ * Sobol列の方向数、まとめて生成する版と1要素版の一致、ブルーノイズの順位の重複と、ブルーノイズの遅延読み込みを確かめる
+ */
+namespace {
+	using se::Sequences;
+
+	/**
+	 * Joe-Kuoの表(new-joe-kuo-6.21201)の先頭から作った方向数m_i
+	 * 方向数はv_i = m_i / 2^(i+1)なので、Sobol(1 << i)はm_i / 2^(i+1)になる
+	 * 1次元目はビット反転なので全て1
+	 */
+	const uint32_t SOBOL_M[Sequences::SOBOL_DIMENSION_NUM][12] = {
+		{ 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 },
+		{ 1, 3, 5, 15, 17, 51, 85, 255, 257, 771, 1285, 3855 },
+		{ 1, 3, 3, 9, 29, 23, 71, 197, 209, 627, 1907, 1369 },
+		{ 1, 3, 1, 5, 31, 29, 81, 147, 433, 149, 719, 3693 },
+	};
+
+	void TestSobolDirections()
+	{
+		for (uint32_t d = 0; d < Sequences::SOBOL_DIMENSION_NUM; d++) {
+			SE_CHECK(Sequences::Sobol(0, d) == 0.0f);
+			for (uint32_t i = 0; i < 12; i++) {
+				float expected = static_cast<float>(SOBOL_M[d][i]) / static_cast<float>(2u << i);
+				float actual = Sequences::Sobol(1u << i, d);
+				SE_CHECK_MSG(actual == expected, "dimension %u, bit %u: %.9g expected %.9g", d, i, actual, expected);
+			}
+		}
+	}
+
+	// 1, 2次元目の先頭2^k点は(0, k, 2)ネットになる: 面積2^-kのどの基本区間にもちょうど1点入る
+	// (GetSobol2Dのテーブルはこの2次元を使う、それ以外の組はtが0にならない)
+	void TestSobolNet()
+	{
+		const uint32_t k = 10;
+		const uint32_t num = 1u << k;
+		for (uint32_t bitsX = 0; bitsX <= k; bitsX++) {
+			uint32_t bitsY = k - bitsX;
+			std::vector<uint32_t> hit(num, 0);
+			for (uint32_t i = 0; i < num; i++) {
+				uint32_t cx = static_cast<uint32_t>(Sequences::Sobol(i, 0) * (1u << bitsX));
+				uint32_t cy = static_cast<uint32_t>(Sequences::Sobol(i, 1) * (1u << bitsY));
+				hit[(cy << bitsX) | cx]++;
+			}
+			bool ok = std::all_of(hit.begin(), hit.end(), [](uint32_t h) { return h == 1; });
+			SE_CHECK_MSG(ok, "%u x %u cells", 1u << bitsX, 1u << bitsY);
+		}
+	}
+
+	// まとめて生成する版は1要素版と同じ値(端数と途中からの生成も)
+	void TestBatchMatchesSingle()
+	{
+		const uint32_t firsts[] = { 0, 1, 5, 1000, 0x7ffffffd };
+		const uint32_t counts[] = { 0, 1, 3, 4, 7, 64 };
+		std::vector<float> values(64);
+		std::vector<se::float2> points(64);
+		for (uint32_t first : firsts) {
+			for (uint32_t count : counts) {
+				for (uint32_t d = 0; d < Sequences::SOBOL_DIMENSION_NUM; d++) {
+					Sequences::GenerateSobol(d, first, count, values.data());
+					for (uint32_t i = 0; i < count; i++) {
+						SE_CHECK(values[i] == Sequences::Sobol(first + i, d));
+					}
+				}
+				const uint32_t bases[] = { 2, 3, 5 };
+				for (uint32_t base : bases) {
+					Sequences::GenerateHalton(base, first, count, values.data());
+					for (uint32_t i = 0; i < count; i++) {
+						SE_CHECK(values[i] == Sequences::Halton(first + i, base));
+					}
+				}
+				Sequences::GenerateR2(first, count, points.data());
+				for (uint32_t i = 0; i < count; i++) {
+					se::float2 expected = Sequences::R2(first + i);
+					SE_CHECK(points[i].x == expected.x && points[i].y == expected.y);
+				}
+			}
+		}
+
+		// Halton列の定義通りの値
+		SE_CHECK(Sequences::Halton(1, 3) == 1.0f / 3.0f);
+		SE_CHECK(Sequences::Halton(5, 3) == static_cast<float>(7.0 / 9.0));
+		SE_CHECK(Sequences::Halton(6, 2) == 0.375f);
+	}
+
+	// 各値は順位/要素数なので、全ての順位がちょうど1回ずつ現れる
+	void CheckBlueNoiseRanks(const float* values, uint32_t size)
+	{
+		const uint32_t num = size * size;
+		std::vector<uint32_t> count(num, 0);
+		for (uint32_t i = 0; i < num; i++) {
+			float rank = values[i] * num;
+			uint32_t r = static_cast<uint32_t>(rank);
+			SE_CHECK_MSG(values[i] >= 0.0f && values[i] < 1.0f && static_cast<float>(r) == rank, "size %u, [%u] = %.9g", size, i, values[i]);
+			if (r < num) {
+				count[r]++;
+			}
+		}
+		bool unique = std::all_of(count.begin(), count.end(), [](uint32_t c) { return c == 1; });
+		SE_CHECK_MSG(unique, "size %u: ranks are not unique", size);
+	}
+
+	void TestBlueNoiseRanks()
+	{
+		const uint32_t sizes[] = { 1, 4, 16, Sequences::BLUE_NOISE_SIZE };
+		for (uint32_t size : sizes) {
+			std::vector<float> values(size * size);
+			Sequences::GenerateBlueNoise(size, values.data());
+			CheckBlueNoiseRanks(values.data(), size);
+		}
+
+		// 乱数の種は固定なので毎回同じ
+		std::vector<float> a(16 * 16), b(16 * 16);
+		Sequences::GenerateBlueNoise(16, a.data());
+		Sequences::GenerateBlueNoise(16, b.data());
+		SE_CHECK(a == b);
+	}
+
+	// Initializeではブルーノイズを作らず、最初に使うときに作ってキャッシュに書き出す
+	void TestBlueNoiseLazyLoad()
+	{
+		const char* cachePath = "SequencesTest_bluenoise.cache";
+		remove(cachePath);
+
+		se::JobSystem::Get().Initialize(2, false);
+		se::IOService::Get().Initialize();
+
+		Sequences& sequences = Sequences::Get();
+		sequences.Initialize(cachePath);
+		SE_CHECK(!sequences.IsBlueNoiseReady());
+		SE_CHECK(sequences.GetHalton23(1).x == 0.5f);
+		FILE* file = fopen(cachePath, "rb");
+		SE_CHECK(file == nullptr);
+		if (file) {
+			fclose(file);
+		}
+
+		float first = sequences.GetBlueNoise(3, 5);
+		SE_CHECK(sequences.IsBlueNoiseReady());
+		std::vector<float> generated(sequences.GetBlueNoiseTable(), sequences.GetBlueNoiseTable() + Sequences::BLUE_NOISE_SIZE * Sequences::BLUE_NOISE_SIZE);
+		CheckBlueNoiseRanks(generated.data(), Sequences::BLUE_NOISE_SIZE);
+		SE_CHECK(first == generated[5 * Sequences::BLUE_NOISE_SIZE + 3]);
+		SE_CHECK(sequences.GetBlueNoise(3 + Sequences::BLUE_NOISE_SIZE, 5) == first);
+		sequences.Finalize();
+
+		// 2回目はキャッシュから読み込む
+		sequences.Initialize(cachePath);
+		SE_CHECK(!sequences.IsBlueNoiseReady());
+		sequences.LoadBlueNoiseAsync().Wait();
+		SE_CHECK(sequences.IsBlueNoiseReady());
+		SE_CHECK(std::equal(generated.begin(), generated.end(), sequences.GetBlueNoiseTable()));
+		sequences.Finalize();
+
+		se::IOService::Get().Finalize();
+		se::JobSystem::Get().Finalize();
+		remove(cachePath);
+	}
+}
+
+int main()
+{
+	TestSobolDirections();
+	TestSobolNet();
+	TestBatchMatchesSingle();
+	TestBlueNoiseRanks();
+	TestBlueNoiseLazyLoad();
+	return se::test::Finish("SequencesTest");
+}
@@ -0,0 +1,78 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <chrono>
+
+/**
+ * 単体テストとベンチマークの共通部分
+ * 各テストはmainを持つ単独のプログラムで、Linuxでもg++だけでビルドできる(README.md参照)
+ */
+namespace se {
+	namespace test {
+
+		inline int& GetFailureCount()
+		{
+			static int count = 0;
+			return count;
+		}
+
+		// 失敗があれば1を返す(mainの戻り値にする)
+		inline int Finish(const char* name)
+		{
+			int failures = GetFailureCount();
+			printf("%s: %s (%d failures)\n", name, failures == 0 ? "PASSED" : "FAILED", failures);
+			return failures == 0 ? 0 : 1;
+		}
+
+		/**
+		 * 経過時間の計測
+		 */
+		class Timer
+		{
+		private:
+			std::chrono::high_resolution_clock::time_point start_;
+
+		public:
+			Timer()
+				: start_(std::chrono::high_resolution_clock::now())
+			{
+			}
+
+			double GetSeconds() const
+			{
+				return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_).count();
+			}
+		};
+
+		// 最適化で計算が消えないように結果を捨てる先
+		template<class T>
+		inline void DoNotOptimize(const T& value)
+		{
+			static volatile T sink;
+			sink = value;
+			(void)sink;
+		}
+
+	}
+}
+
+// 条件が偽なら場所を表示して失敗を数える(テストは続ける)
+#define SE_CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			printf("%s(%d): CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+			se::test::GetFailureCount()++; \
+		} \
+	} while (0)
+
+// 失敗時に値も表示する
+#define SE_CHECK_MSG(cond, ...) \
+	do { \
+		if (!(cond)) { \
+			printf("%s(%d): CHECK failed: %s: ", __FILE__, __LINE__, #cond); \
+			printf(__VA_ARGS__); \
+			printf("\n"); \
+			se::test::GetFailureCount()++; \
+		} \
+	} while (0)